@@ -0,0 +1,116 @@
+/**
+ * @brief MAVConn bonded multi-link interface
+ * @file bond.h
+ *
+ * @addtogroup mavconn
+ * @{
+ */
+/*
+ * libmavconn
+ *
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <mavconn/interface.h>
+
+namespace mavconn {
+/**
+ * @brief Several physical links bonded into one logical connection
+ *
+ * Receives from every member link and suppresses the duplicates that
+ * redundant paths deliver, using per-(sysid, compid) sequence windows
+ * in a small lock-free table. Transmits on the first healthy link in
+ * member order (list the preferred path first); when rx traffic on
+ * the active path stops for longer than the failover timeout, the
+ * next healthy member takes over at the next send. BULK-priority
+ * traffic (e.g. FTP) can be steered to a designated member, so bulk
+ * transfers ride the fat link while setpoints keep the radio.
+ *
+ * Liveness is judged by any received traffic, not HEARTBEAT alone:
+ * on a busy telemetry link a dead path is detected within the
+ * timeout (default 500 ms) instead of after a missed 1 Hz beat.
+ */
+class MAVConnBond : public MAVConnInterface {
+public:
+	using Ptr = std::shared_ptr<MAVConnBond>;
+
+	/**
+	 * @param[in] members		opened member links, preferred first
+	 * @param[in] bulk_member	index of the link carrying BULK
+	 *				priority traffic (-1: no steering)
+	 * @param[in] fail_timeout_ms	rx silence after which a link is
+	 *				considered unhealthy
+	 */
+	MAVConnBond(const std::vector<MAVConnInterface::Ptr> &members,
+			int bulk_member = -1,
+			unsigned fail_timeout_ms = 500);
+	~MAVConnBond();
+
+	void close() override;
+
+	using MAVConnInterface::send_message;
+	using MAVConnInterface::send_bytes;
+
+	void send_message(const mavlink::mavlink_message_t *message, Priority prio) override;
+	void send_message(const mavlink::Message &message, Priority prio) override;
+	void send_bytes(const uint8_t *bytes, size_t length, Priority prio) override;
+
+	void set_protocol_version(Protocol pver) override;
+	void set_protocol_auto(bool enabled) override;
+	void set_peer_mavlink2(bool capable) override;
+
+	//! delegates to the member link delivering the current message
+	RxMsgRef borrow_rx_message() override;
+
+	mavlink::mavlink_status_t get_status() override;
+	IOStat get_iostat() override;
+	bool get_stat_snapshot(StatSnapshot &out) override;
+	bool is_open() override;
+
+private:
+	static constexpr size_t DEDUP_TABLE_SIZE = 16;
+	//! seqs older than the window pass through undeduplicated
+	static constexpr int DEDUP_WINDOW = 56;
+
+	std::vector<MAVConnInterface::Ptr> members;
+	int bulk_member;
+	uint64_t fail_timeout_ns;
+
+	//! last rx activity per member [steady ns]
+	std::vector<std::unique_ptr<std::atomic<uint64_t>>> last_rx_ns;
+	std::atomic<size_t> closed_members;
+	std::atomic<bool> table_full_warned;
+
+	/**
+	 * One sender in the dedup table. key = (sysid << 8 | compid) + 1,
+	 * claimed by CAS (0: free). seq_window packs the last accepted
+	 * sequence number (low byte) with a seen-bitmap of the
+	 * DEDUP_WINDOW sequences before it, updated by CAS so rx threads
+	 * of different members never block each other.
+	 */
+	struct DedupEntry {
+		std::atomic<uint32_t> key {0};
+		std::atomic<uint64_t> seq_window {0};
+	};
+	std::array<DedupEntry, DEDUP_TABLE_SIZE> dedup_table;
+
+	//! true when the message was not yet seen on another member
+	bool accept_message(const mavlink::mavlink_message_t *message);
+	static bool accept_seq(std::atomic<uint64_t> &entry, uint8_t seq);
+
+	//! member rx path: health bookkeeping, dedup, forward
+	void member_receive(size_t idx, const mavlink::mavlink_message_t *message, Framing framing);
+
+	//! first healthy member in order; prefers bulk link for BULK
+	MAVConnInterface *select_link(Priority prio, size_t skip = SIZE_MAX);
+	bool healthy(size_t idx, uint64_t now_ns);
+};
+}	// namespace mavconn
@@ -0,0 +1,249 @@
+/**
+ * @brief MAVConn transmit buffer pool (internal)
+ * @file bufferpool.h
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup mavconn
+ * @{
+ */
+/*
+ * libmavconn
+ * Copyright 2017 Vladimir Ermakov, All rights reserved.
+ *
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+
+#pragma once
+
+#include <new>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <mavconn/ring.h>
+#include <mavconn/crc16.h>
+#include <mavconn/msgbuffer.h>
+
+namespace mavconn {
+/**
+ * @brief Per-connection pool of transmit buffers.
+ *
+ * Two size classes: small (HEARTBEAT, setpoints, RC, most of periodic
+ * traffic) and large (PARAM_VALUE, FTP, full-size payloads).
+ * Free buffers live in lock-free MPMC rings (any thread may make()
+ * or release(): ROS callback producers, asio completion handlers), so
+ * steady-state sending
+ * does zero heap allocations.
+ *
+ * When a class ring runs dry make() falls back to the heap
+ * (pooled = false), release() then frees the chunk.
+ */
+class BufferPool {
+public:
+	//! Small class covers v2 wire size of up to 52 byte payloads
+	static constexpr ssize_t SMALL_SIZE = 64;
+	static constexpr ssize_t LARGE_SIZE = MsgBuffer::MAX_SIZE;
+	static constexpr size_t SMALL_COUNT = 256;
+	static constexpr size_t LARGE_COUNT = 64;
+
+	BufferPool() :
+		small_free(SMALL_COUNT),
+		large_free(LARGE_COUNT),
+		small_slab(new uint8_t[SMALL_COUNT * slot_size(SMALL_SIZE)]),
+		large_slab(new uint8_t[LARGE_COUNT * slot_size(LARGE_SIZE)])
+	{
+		for (size_t i = 0; i < SMALL_COUNT; i++)
+			small_free.push(construct(small_slab.get() + i * slot_size(SMALL_SIZE), SMALL_SIZE));
+
+		for (size_t i = 0; i < LARGE_COUNT; i++)
+			large_free.push(construct(large_slab.get() + i * slot_size(LARGE_SIZE), LARGE_SIZE));
+	}
+
+	BufferPool(const BufferPool&) = delete;
+
+	/**
+	 * @brief Make buffer for mavlink_message_t (no finalization done)
+	 */
+	MsgBuffer *make(const mavlink::mavlink_message_t *msg)
+	{
+		auto *buf = alloc(wire_size(msg));
+		buf->fill(msg);
+		return buf;
+	}
+
+	/**
+	 * @brief Make buffer for mavlink::Message derived object.
+	 *
+	 * Does serialization and finalization inside: the frame is built
+	 * directly in the wire buffer with the fast whole-buffer CRC
+	 * kernel, skipping mavlink_finalize_message_buffer() and its
+	 * byte-at-a-time checksum plus the mavlink_msg_to_send_buffer()
+	 * copy pass. @a seq is the sequence number claimed by the caller
+	 * (MAVConnInterface::next_tx_seq()).
+	 *
+	 * With @a auto_framing the protocol version is chosen per
+	 * message instead of taken from the status flag alone: on a v2
+	 * link, v1-set messages with unused extensions go out as v1
+	 * when that is smaller on the wire (4 header bytes saved vs. v2
+	 * payload truncation lost); extended ids always force v2, even
+	 * on a link still pinned to v1 by auto-negotiation.
+	 */
+	MsgBuffer *make(const mavlink::Message &obj, mavlink::mavlink_status_t *status, uint8_t seq,
+			uint8_t sysid, uint8_t compid,
+			bool auto_framing = false)
+	{
+		mavlink::mavlink_message_t msg;
+		mavlink::MsgMap map(msg);
+
+		auto mi = obj.get_message_info();
+
+		obj.serialize(map);
+
+		if (status->signing != nullptr) {
+			// signed links are rare: use the generic helper path
+			// (it consumes and re-increments current_tx_seq)
+			status->current_tx_seq = seq;
+			mavlink::mavlink_finalize_message_buffer(&msg, sysid, compid, status, mi.min_length, mi.length, mi.crc_extra);
+			return make(&msg);
+		}
+
+		bool mavlink1 = (status->flags & MAVLINK_STATUS_FLAG_OUT_MAVLINK1);
+		const auto *payload = reinterpret_cast<const uint8_t *>(msg.payload64);
+
+		// v2 trims trailing payload zeros
+		uint8_t length = mi.length;
+		while (length > 1 && payload[length - 1] == 0)
+			length--;
+
+		if (auto_framing) {
+			if (mi.id > 255)
+				mavlink1 = false;	// v1 can't carry extended ids
+			else if (!mavlink1)
+				// v1 pays the untrimmed v1-set payload but saves
+				// 4 header bytes: take it when the extensions are
+				// unused and it actually wins
+				mavlink1 = length <= mi.min_length &&
+						mi.min_length < unsigned(length) + 4;
+		}
+
+		if (mavlink1)
+			length = mi.min_length;
+
+		auto *buf = alloc(1 + (mavlink1 ? MAVLINK_CORE_HEADER_MAVLINK1_LEN : MAVLINK_CORE_HEADER_LEN) + length + 2);
+		uint8_t *p = buf->data;
+
+		if (mavlink1) {
+			*p++ = MAVLINK_STX_MAVLINK1;
+			*p++ = length;
+			*p++ = seq;
+			*p++ = sysid;
+			*p++ = compid;
+			*p++ = mi.id & 0xff;
+		}
+		else {
+			*p++ = MAVLINK_STX;
+			*p++ = length;
+			*p++ = 0;	// incompat_flags
+			*p++ = 0;	// compat_flags
+			*p++ = seq;
+			*p++ = sysid;
+			*p++ = compid;
+			*p++ = mi.id & 0xff;
+			*p++ = (mi.id >> 8) & 0xff;
+			*p++ = (mi.id >> 16) & 0xff;
+		}
+
+		memcpy(p, payload, length);
+		p += length;
+
+		uint16_t crc = crc16::accumulate(X25_INIT_CRC, buf->data + 1, p - buf->data - 1);
+		crc = crc16::accumulate(crc, &mi.crc_extra, 1);
+		*p++ = crc & 0xff;
+		*p++ = crc >> 8;
+
+		buf->stamp();
+		buf->pos = 0;
+		buf->len = p - buf->data;
+		return buf;
+	}
+
+	/**
+	 * @brief Make buffer for send_bytes()
+	 */
+	MsgBuffer *make(const uint8_t *bytes, ssize_t nbytes)
+	{
+		auto *buf = alloc(nbytes);
+		buf->fill(bytes, nbytes);
+		return buf;
+	}
+
+	/**
+	 * @brief Drop one reference; recycle the buffer back to the free
+	 *        ring of its owning pool when the last one is gone.
+	 */
+	static void release(MsgBuffer *buf)
+	{
+		if (buf->refcnt.fetch_sub(1, std::memory_order_acq_rel) != 1)
+			return;
+
+		if (!buf->pooled) {
+			buf->~MsgBuffer();
+			delete[] reinterpret_cast<uint8_t *>(buf);
+			return;
+		}
+
+		auto &ring = (buf->capacity == SMALL_SIZE) ? buf->owner->small_free : buf->owner->large_free;
+		bool ok = ring.push(buf);
+		assert(ok);	// pooled buffers always fit back
+		(void)ok;
+	}
+
+	/**
+	 * @brief Serialized wire size of an already finalized message.
+	 */
+	static ssize_t wire_size(const mavlink::mavlink_message_t *msg)
+	{
+		if (msg->magic == MAVLINK_STX_MAVLINK1)
+			return msg->len + MAVLINK_CORE_HEADER_MAVLINK1_LEN + 1 + 2;
+
+		return msg->len + MAVLINK_NUM_NON_PAYLOAD_BYTES
+		       + ((msg->incompat_flags & MAVLINK_IFLAG_SIGNED) ? MAVLINK_SIGNATURE_BLOCK_LEN : 0);
+	}
+
+private:
+	static constexpr size_t slot_size(ssize_t class_size)
+	{
+		return sizeof(MsgBuffer) + class_size;
+	}
+
+	MsgBuffer *construct(uint8_t *slot, ssize_t class_size)
+	{
+		return new (slot) MsgBuffer(this, slot + sizeof(MsgBuffer), class_size, true);
+	}
+
+	MsgBuffer *alloc(ssize_t nbytes)
+	{
+		assert(nbytes <= LARGE_SIZE);
+
+		MsgBuffer *buf = nullptr;
+		if (nbytes <= SMALL_SIZE)
+			buf = small_free.pop();
+		if (buf == nullptr)
+			buf = large_free.pop();
+		if (buf != nullptr) {
+			buf->refcnt.store(1, std::memory_order_relaxed);
+			return buf;
+		}
+
+		// pool exhausted: heap fallback, freed in release()
+		auto *chunk = new uint8_t[slot_size(LARGE_SIZE)];
+		return new (chunk) MsgBuffer(this, chunk + sizeof(MsgBuffer), LARGE_SIZE, false);
+	}
+
+	MPMCRing<MsgBuffer *> small_free;
+	MPMCRing<MsgBuffer *> large_free;
+	std::unique_ptr<uint8_t[]> small_slab;
+	std::unique_ptr<uint8_t[]> large_slab;
+};
+}	// namespace mavconn
@@ -21,6 +21,7 @@
 
 #pragma once
 
+#include <boost/asio.hpp>
 #include <boost/system/system_error.hpp>
 
 #include <deque>
@@ -35,6 +36,8 @@
 #include <stdexcept>
 #include <unordered_map>
 #include <mavconn/mavlink_dialect.h>
+#include <mavconn/rxpool.h>
+#include <mavconn/txqueue.h>
 
 
 namespace mavconn {
@@ -105,11 +108,26 @@ public:
 	using ConstPtr = std::shared_ptr<MAVConnInterface const>;
 	using WeakPtr = std::weak_ptr<MAVConnInterface>;
 
+	//! Per-message-id counters, part of IOStat
+	struct MsgStat {
+		mavlink::msgid_t msgid;
+		size_t tx_count;
+		size_t tx_bytes;
+		size_t rx_count;
+		size_t rx_bytes;
+	};
+
 	struct IOStat {
 		size_t tx_total_bytes;	//!< total bytes transferred
 		size_t rx_total_bytes;	//!< total bytes received
 		float tx_speed;		//!< current transfer speed [B/s]
 		float rx_speed;		//!< current receive speed [B/s]
+		size_t tx_dropped;	//!< messages rejected by the queue limit or shed under backpressure
+		//! enqueue-to-wire latency percentiles [us] (0.0 while no samples)
+		float tx_latency_p50_us;
+		float tx_latency_p90_us;
+		float tx_latency_p99_us;
+		std::vector<MsgStat> message_stat;	//!< per-message-id counters, sorted by msgid
 	};
 
 	/**
@@ -117,6 +135,7 @@ public:
 	 * @param[in] component_id  compid for send_message
 	 */
 	MAVConnInterface(uint8_t system_id = 1, uint8_t component_id = MAV_COMP_ID_UDP_BRIDGE);
+	virtual ~MAVConnInterface();
 
 	/**
 	 * @brief Close connection.
@@ -130,10 +149,15 @@ public:
 	 *
 	 * @note Does not do finalization!
 	 *
-	 * @throws std::length_error  On exceeding Tx queue limit (MAX_TXQ_SIZE)
+	 * @throws std::length_error  On exceeding the per-class Tx queue limit (MAX_TXQ_SIZE)
 	 * @param[in] *message  not changed
+	 * @param[in] prio      transmit priority class
 	 */
-	virtual void send_message(const mavlink::mavlink_message_t *message) = 0;
+	virtual void send_message(const mavlink::mavlink_message_t *message, Priority prio) = 0;
+
+	inline void send_message(const mavlink::mavlink_message_t *message) {
+		send_message(message, Priority::NORMAL);
+	}
 
 	/**
 	 * @brief Send message (child of mavlink::Message)
@@ -141,26 +165,103 @@ public:
 	 * Does serialization inside.
 	 * System and Component ID = from this object.
 	 *
-	 * @throws std::length_error  On exceeding Tx queue limit (MAX_TXQ_SIZE)
+	 * @throws std::length_error  On exceeding the per-class Tx queue limit (MAX_TXQ_SIZE)
 	 * @param[in] &message  not changed
+	 * @param[in] prio      transmit priority class
 	 */
-	virtual void send_message(const mavlink::Message &message) = 0;
+	virtual void send_message(const mavlink::Message &message, Priority prio) = 0;
+
+	inline void send_message(const mavlink::Message &message) {
+		send_message(message, Priority::NORMAL);
+	}
 
 	/**
 	 * @brief Send raw bytes (for some quirks)
-	 * @throws std::length_error  On exceeding Tx queue limit (MAX_TXQ_SIZE)
+	 * @throws std::length_error  On exceeding the per-class Tx queue limit (MAX_TXQ_SIZE)
 	 */
-	virtual void send_bytes(const uint8_t *bytes, size_t length) = 0;
+	virtual void send_bytes(const uint8_t *bytes, size_t length, Priority prio) = 0;
+
+	inline void send_bytes(const uint8_t *bytes, size_t length) {
+		send_bytes(bytes, length, Priority::NORMAL);
+	}
 
 	/**
 	 * @brief Send message and ignore possible drop due to Tx queue limit
 	 */
-	void send_message_ignore_drop(const mavlink::mavlink_message_t *message);
+	void send_message_ignore_drop(const mavlink::mavlink_message_t *message, Priority prio = Priority::NORMAL);
 
 	/**
 	 * @brief Send message and ignore possible drop due to Tx queue limit
 	 */
-	void send_message_ignore_drop(const mavlink::Message &message);
+	void send_message_ignore_drop(const mavlink::Message &message, Priority prio = Priority::NORMAL);
+
+	/**
+	 * @brief Borrow the message being delivered to message_received_cb.
+	 *
+	 * Valid only while inside the delivery callback. The borrow pins
+	 * the underlying receive pool slot, so the handler may queue the
+	 * message for another thread without copying it; the rx path
+	 * simply frames the next message into a different slot.
+	 *
+	 * @return empty RxMsgRef when the pool is exhausted (all
+	 *         RxPool::POOL_SIZE slots still borrowed): the caller
+	 *         must fall back to copying the message.
+	 */
+	virtual RxMsgRef borrow_rx_message();
+
+	/**
+	 * @brief Kernel receive timestamp of the current delivery.
+	 *
+	 * CLOCK_REALTIME nanoseconds taken by the kernel when the
+	 * datagram carrying the message now passing through
+	 * message_received_cb arrived, so the stamp predates asio and
+	 * rx-thread scheduling. Valid only while inside the delivery
+	 * callback; messages framed from one datagram share its stamp.
+	 *
+	 * @return 0 when the transport provides no kernel timestamps.
+	 */
+	inline uint64_t get_rx_kernel_stamp_ns() {
+		return rx_kernel_stamp_ns.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * Plain-data link statistics, see get_stat_snapshot().
+	 * Parser counters come from mavlink_status_t, byte/latency
+	 * figures from IOStat; per-message-id counters are not included
+	 * (use get_iostat() for those).
+	 */
+	struct StatSnapshot {
+		unsigned packet_rx_success_count;
+		unsigned packet_rx_drop_count;
+		unsigned buffer_overrun;
+		unsigned parse_error;
+		uint8_t current_rx_seq;
+		uint8_t current_tx_seq;
+		size_t tx_total_bytes;
+		size_t rx_total_bytes;
+		float tx_speed;		//!< [B/s] over the publish interval
+		float rx_speed;		//!< [B/s] over the publish interval
+		size_t tx_dropped;
+		float tx_latency_p50_us;
+		float tx_latency_p90_us;
+		float tx_latency_p99_us;
+	};
+
+	/**
+	 * @brief Lock-free statistics snapshot.
+	 *
+	 * The connection's IO thread publishes into a seqlocked double
+	 * buffer at its convenience (piggybacked on rx/tx completion
+	 * work, roughly every 250 ms); readers copy the stable side and
+	 * never touch a hot-path lock — unlike get_iostat(), whose
+	 * speed bookkeeping serializes concurrent callers. Made for the
+	 * 0.5 s diagnostics timer, which used to coincide with setpoint
+	 * jitter when it contended with the rx path.
+	 *
+	 * @return false while nothing was published yet (idle link):
+	 *         the caller may fall back to get_status()/get_iostat()
+	 */
+	virtual bool get_stat_snapshot(StatSnapshot &out);
 
 	//! Message receive callback
 	ReceivedCb message_received_cb;
@@ -187,9 +288,106 @@ public:
 	/**
 	 * Set protocol used for encoding mavlink::Mavlink messages.
 	 */
-	void set_protocol_version(Protocol pver);
+	virtual void set_protocol_version(Protocol pver);
 	Protocol get_protocol_version();
 
+	/**
+	 * @brief Enable protocol version auto-negotiation.
+	 *
+	 * Tx starts with v1 framing and upgrades to v2 once the peer
+	 * proves v2 capability: a received v2 frame, or an explicit
+	 * report via set_peer_mavlink2(). The switch itself happens on
+	 * the rx thread, which owns the parser status.
+	 *
+	 * While negotiated up, framing is still chosen per message:
+	 * v1-set messages whose extension fields are all zero go out as
+	 * v1 when that is smaller on the wire (v1 saves 4 header bytes
+	 * but forfeits v2 payload truncation); extended message ids and
+	 * populated extensions force v2. On narrow serial links the
+	 * difference is real bandwidth.
+	 */
+	virtual void set_protocol_auto(bool enabled);
+
+	/**
+	 * @brief Out-of-band peer v2 capability confirmation.
+	 *
+	 * For consumers that learn capability above the link layer,
+	 * e.g. MAV_PROTOCOL_CAPABILITY_MAVLINK2 in AUTOPILOT_VERSION:
+	 * some FCUs answer in v1 framing until spoken to in v2, so the
+	 * rx-side magic detection alone would never upgrade.
+	 * No effect unless auto-negotiation is enabled; downgrade is
+	 * not supported.
+	 */
+	virtual void set_peer_mavlink2(bool capable);
+
+	/**
+	 * @brief Enable adaptive busy-poll receive.
+	 *
+	 * After each received packet the transport spins on non-blocking
+	 * reads for up to @a window_us before falling back to the
+	 * reactor wakeup path; every hit restarts the window. Cuts rx
+	 * latency to the syscall cost while traffic flows and costs
+	 * nothing on an idle link, at the price of one busy IO thread
+	 * during active exchange.
+	 *
+	 * Honored by the UDP (Linux) and serial transports.
+	 * URL option: ?busypoll=window_us. 0 disables (default).
+	 */
+	inline void set_busy_poll(unsigned window_us) {
+		busy_poll_us.store(window_us, std::memory_order_relaxed);
+	}
+	inline unsigned get_busy_poll() {
+		return busy_poll_us.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Register a periodic pre-serialized transmission.
+	 *
+	 * The message is serialized once into a retained wire frame; a
+	 * timer on the shared IO pool then emits it at @a rate_hz with
+	 * only the sequence number and CRC patched per beat. Made for
+	 * our outgoing HEARTBEAT and similar constant keepalives: they
+	 * keep flowing even when the ROS callback threads are starved,
+	 * which is exactly when a missed heartbeat trips GCS failsafe.
+	 *
+	 * The frame keeps the framing (and sysid/compid) chosen at
+	 * registration time and is sent with REALTIME priority. Link
+	 * signing is not applied to retained frames. Beats that hit a
+	 * full tx queue are skipped and counted into IOStat::tx_dropped.
+	 *
+	 * Registrations are cancelled when the connection object is
+	 * destroyed; use unregister_periodic_tx() to stop one earlier.
+	 *
+	 * @param[in] message  serialized and retained, not referenced after return
+	 * @param[in] rate_hz  transmission rate, > 0
+	 * @return handle for unregister_periodic_tx()
+	 */
+	size_t register_periodic_tx(const mavlink::Message &message, float rate_hz);
+
+	/**
+	 * @brief Stop a periodic transmission.
+	 *
+	 * No beat touches the connection after return.
+	 */
+	void unregister_periodic_tx(size_t handle);
+
+	/**
+	 * @brief Feed link-buffer backpressure into the tx scheduler.
+	 *
+	 * For consumers that learn the real channel state, e.g. the
+	 * 3dr_radio plugin decoding RADIO_STATUS.txbuf of SiK radios.
+	 * While the reported free space stays below a threshold the
+	 * scheduler pauses bulk-class traffic and sheds stale queued
+	 * bulk; realtime and normal classes are unaffected and recovery
+	 * is automatic with the next higher report. Shed messages count
+	 * into IOStat::tx_dropped.
+	 *
+	 * Ignored by transports without a priority queue.
+	 *
+	 * @param[in] free_percent  remaining buffer space, 0..100
+	 */
+	virtual void set_link_txbuf(uint8_t free_percent);
+
 	/**
 	 * @brief Construct connection from URL
 	 *
@@ -212,25 +410,70 @@ public:
 
 	static std::vector<std::string> get_known_dialects();
 
+	/**
+	 * @brief Shared IO service, run by a small thread pool.
+	 *
+	 * All connections post their async work here; per-connection
+	 * handler ordering is kept by a strand in each transport.
+	 * The pool is started on first use and sized from
+	 * hardware_concurrency (2 to 4 threads).
+	 */
+	static boost::asio::io_service &io_service();
+
+	/**
+	 * @brief Apply scheduling options to the shared IO threads.
+	 *
+	 * Connections share one IO pool, so CPU affinity and SCHED_FIFO
+	 * priority apply to all links at once. Driven by the ?affinity=
+	 * and ?rtprio= URL options in open_url(); the real-time part
+	 * needs CAP_SYS_NICE.
+	 *
+	 * @param[in] cpus    CPUs to pin the IO threads to (empty: keep)
+	 * @param[in] rtprio  SCHED_FIFO priority (0: keep current policy)
+	 */
+	static void apply_io_sched(const std::vector<int> &cpus, int rtprio);
+
 protected:
 	uint8_t sys_id;		//!< Connection System Id
 	uint8_t comp_id;	//!< Connection Component Id
 
 	//! Maximum mavlink packet size + some extra bytes for padding.
 	static constexpr size_t MAX_PACKET_SIZE = MAVLINK_MAX_PACKET_LEN + 16;
-	//! Maximum count of transmission buffers.
+	//! Maximum count of transmission buffers (enforced per priority class).
 	static constexpr size_t MAX_TXQ_SIZE = 1000;
 
-	//! This map merge all dialect mavlink_msg_entry_t structs. Needed for packet parser.
-	static std::unordered_map<mavlink::msgid_t, const mavlink::mavlink_msg_entry_t*> message_entries;
+	//! Msgid-sorted table merging all dialect mavlink_msg_entry_t structs.
+	//! Looked up with a branchless binary search by the packet parser.
+	static std::vector<const mavlink::mavlink_msg_entry_t*> message_entries;
 
 	//! Channel number used for logging.
 	size_t conn_id;
 
+	//! see get_rx_kernel_stamp_ns(); transports store, rx thread reads
+	std::atomic<uint64_t> rx_kernel_stamp_ns;
+
 	inline mavlink::mavlink_status_t *get_status_p() {
 		return &m_status;
 	}
 
+	//! per-message framing choice for BufferPool::make()
+	inline bool auto_framing() {
+		return protocol_auto.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * Claim the next tx sequence number.
+	 *
+	 * Senders race without a lock since the tx path went lock-free,
+	 * so the counter is atomic; the parser status gets a relaxed
+	 * mirror so get_status() keeps reporting current_tx_seq.
+	 */
+	inline uint8_t next_tx_seq() {
+		uint8_t seq = tx_seq.fetch_add(1, std::memory_order_relaxed);
+		m_status.current_tx_seq = uint8_t(seq + 1);
+		return seq;
+	}
+
 	inline mavlink::mavlink_message_t *get_buffer_p() {
 		return &m_buffer;
 	}
@@ -243,6 +486,22 @@ protected:
 	void iostat_tx_add(size_t bytes);
 	void iostat_rx_add(size_t bytes);
 
+	// Per-msgid / drop / latency instrumentation.
+	// All of it is lock-free and wait-free on the hot path;
+	// aggregation happens in get_iostat().
+	void iostat_tx_msg(mavlink::msgid_t msgid, size_t bytes);
+	void iostat_rx_msg(mavlink::msgid_t msgid, size_t bytes);
+	void iostat_tx_drop(size_t n = 1);
+	void iostat_tx_latency(uint64_t enqueue_stamp_ns);
+
+	/**
+	 * Refresh the inactive snapshot buffer when the publish interval
+	 * elapsed. Must be called from the connection's serialized IO
+	 * context only (strand handler or the raw backend's io thread);
+	 * already hooked into parse_buffer() and iostat_tx_add().
+	 */
+	void maybe_publish_snapshot();
+
 	void log_recv(const char *pfx, mavlink::mavlink_message_t &msg, Framing framing);
 	void log_send(const char *pfx, const mavlink::mavlink_message_t *msg);
 	void log_send_obj(const char *pfx, const mavlink::Message &msg);
@@ -253,11 +512,68 @@ private:
 	mavlink::mavlink_status_t m_status;
 	mavlink::mavlink_message_t m_buffer;
 
+	//! tx sequence counter, see next_tx_seq()
+	std::atomic<uint8_t> tx_seq;
+
+	//! receive slot pool; rx_slot is the one being parsed into,
+	//! touched from the connection strand only
+	RxPool rx_pool;
+	RxPool::Slot *rx_slot;
+
 	std::atomic<size_t> tx_total_bytes, rx_total_bytes;
 	std::recursive_mutex iostat_mutex;
 	size_t last_tx_total_bytes, last_rx_total_bytes;
 	std::chrono::time_point<steady_clock> last_iostat;
 
+	//! open-addressed per-msgid counter table slot
+	struct MsgCounter {
+		std::atomic<uint32_t> msgid_p1 {0};	//!< msgid + 1; 0 marks a free slot
+		std::atomic<size_t> tx_count {0};
+		std::atomic<size_t> tx_bytes {0};
+		std::atomic<size_t> rx_count {0};
+		std::atomic<size_t> rx_bytes {0};
+	};
+	//! latency sample ring slot [us]
+	struct LatSample {
+		std::atomic<uint32_t> us {0};
+	};
+
+	static constexpr size_t MSG_STAT_SLOTS = 512;	//!< power of two
+	static constexpr size_t LAT_SAMPLES = 1024;	//!< power of two
+
+	std::unique_ptr<MsgCounter[]> msg_stat;
+	std::atomic<unsigned> busy_poll_us;
+	//! see set_protocol_auto() / set_peer_mavlink2()
+	std::atomic<bool> protocol_auto;
+	std::atomic<bool> peer_mavlink2;
+	std::atomic<size_t> tx_dropped;
+	std::atomic<uint32_t> lat_head;
+	std::unique_ptr<LatSample[]> lat_ring;
+
+	MsgCounter *msg_stat_slot(mavlink::msgid_t msgid);
+
+	//! snapshot publish interval [ns]
+	static constexpr uint64_t SNAP_INTERVAL_NS = 250ULL * 1000 * 1000;
+
+	//! seqlocked double buffer, writer side is the IO thread
+	StatSnapshot snap_buf[2];
+	std::atomic<uint32_t> snap_seq[2];	//!< odd while being written
+	std::atomic<uint8_t> snap_active;
+	// publish bookkeeping, IO thread only
+	uint64_t snap_last_ns;
+	size_t snap_last_tx_bytes, snap_last_rx_bytes;
+
+	void tx_latency_percentiles(float &p50, float &p90, float &p99);
+
+	//! one retained frame + its schedule, see register_periodic_tx()
+	struct PeriodicTx;
+
+	std::mutex periodic_mutex;	//!< guards periodic_txs (cold path)
+	std::vector<std::shared_ptr<PeriodicTx>> periodic_txs;
+
+	static void periodic_tick(const boost::system::error_code &error,
+			std::shared_ptr<PeriodicTx> p);
+
 	//! monotonic counter (increment only)
 	static std::atomic<size_t> conn_id_counter;
 
@@ -265,7 +581,7 @@ private:
 	static std::once_flag init_flag;
 
 	/**
-	 * Initialize message_entries map
+	 * Initialize the sorted message_entries table
 	 *
 	 * autogenerated. placed in mavlink_helpers.cpp
 	 */
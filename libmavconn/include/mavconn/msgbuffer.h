@@ -8,7 +8,7 @@
  */
 /*
  * libmavconn
- * Copyright 2014,2015,2016 Vladimir Ermakov, All rights reserved.
+ * Copyright 2014,2015,2016,2017 Vladimir Ermakov, All rights reserved.
  *
  * This file is part of the mavros package and subject to the license terms
  * in the top-level LICENSE file of the mavros repository.
@@ -17,70 +17,89 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <cassert>
+#include <cstring>
 #include <mavconn/mavlink_dialect.h>
 
 namespace mavconn {
+class BufferPool;
+
 /**
  * @brief Message buffer for internal use in libmavconn
+ *
+ * Non-owning header over transmit storage: @a data points into
+ * a BufferPool size-class slab (or a heap fallback chunk).
+ * Buffers are obtained from BufferPool::make() and recycled
+ * with BufferPool::release().
+ *
+ * Buffers are reference counted so that one serialized message can sit
+ * on several transmit queues at once (MAVConnTCPServer broadcast);
+ * release() recycles the storage only when the last reference is gone.
+ * Shared buffers must be treated as immutable by the consumers.
  */
 struct MsgBuffer {
 	//! Maximum buffer size with padding for CRC bytes (280 + padding)
 	static constexpr ssize_t MAX_SIZE = MAVLINK_MAX_PACKET_LEN + 16;
-	uint8_t data[MAX_SIZE];
+
+	uint8_t *data;		//!< storage, owned by BufferPool
+	ssize_t capacity;	//!< storage size (size class)
 	ssize_t len;
 	ssize_t pos;
+	bool pooled;		//!< false for heap-fallback chunks
+	BufferPool *owner;	//!< pool the storage came from
+	uint64_t stamp_ns;	//!< enqueue timestamp for tx latency stats
+	std::atomic<uint32_t> refcnt;	//!< outstanding references, @see ref()
 
-	MsgBuffer() :
+	MsgBuffer(BufferPool *owner_, uint8_t *storage, ssize_t capacity_, bool pooled_) :
+		data(storage),
+		capacity(capacity_),
+		len(0),
 		pos(0),
-		len(0)
+		pooled(pooled_),
+		owner(owner_),
+		refcnt(1)
 	{ }
 
 	/**
-	 * @brief Buffer constructor from mavlink_message_t
+	 * @brief Take an additional reference for queue sharing.
+	 *
+	 * Each reference is dropped with BufferPool::release().
 	 */
-	explicit MsgBuffer(const mavlink::mavlink_message_t *msg) :
-		pos(0)
+	void ref()
 	{
-		len = mavlink::mavlink_msg_to_send_buffer(data, msg);
-		// paranoic check, it must be less than MAVLINK_MAX_PACKET_LEN
-		assert(len < MAX_SIZE);
+		refcnt.fetch_add(1, std::memory_order_relaxed);
 	}
 
 	/**
-	 * @brief Buffer constructor for mavlink::Message derived object.
+	 * @brief Fill from mavlink_message_t
 	 */
-	MsgBuffer(const mavlink::Message &obj, mavlink::mavlink_status_t *status, uint8_t sysid, uint8_t compid) :
-		pos(0)
+	void fill(const mavlink::mavlink_message_t *msg)
 	{
-		mavlink::mavlink_message_t msg;
-		mavlink::MsgMap map(msg);
-
-		auto mi = obj.get_message_info();
-
-		obj.serialize(map);
-		mavlink::mavlink_finalize_message_buffer(&msg, sysid, compid, status, mi.min_length, mi.length, mi.crc_extra);
-
-		len = mavlink::mavlink_msg_to_send_buffer(data, &msg);
-		// paranoic check, it must be less than MAVLINK_MAX_PACKET_LEN
-		assert(len < MAX_SIZE);
+		stamp();
+		pos = 0;
+		len = mavlink::mavlink_msg_to_send_buffer(data, msg);
+		// paranoic check, it must be less than capacity of choosen size class
+		assert(len <= capacity);
 	}
 
 	/**
-	 * @brief Buffer constructor for send_bytes()
-	 * @param[in] nbytes should be less than MAX_SIZE
+	 * @brief Fill for send_bytes()
+	 * @param[in] nbytes should be less than capacity
 	 */
-	MsgBuffer(const uint8_t *bytes, ssize_t nbytes) :
-		pos(0),
-		len(nbytes)
+	void fill(const uint8_t *bytes, ssize_t nbytes)
 	{
-		assert(0 < nbytes && nbytes < MAX_SIZE);
+		assert(0 < nbytes && nbytes <= capacity);
+		stamp();
+		pos = 0;
+		len = nbytes;
 		memcpy(data, bytes, nbytes);
 	}
 
-	virtual ~MsgBuffer() {
-		pos = 0;
-		len = 0;
+	void stamp() {
+		stamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
 	}
 
 	uint8_t *dpos() {
@@ -92,4 +111,3 @@ struct MsgBuffer {
 	}
 };
 }	// namespace mavconn
-
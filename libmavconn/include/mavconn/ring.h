@@ -0,0 +1,111 @@
+/**
+ * @brief MAVConn lock-free MPMC ring (internal)
+ * @file ring.h
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup mavconn
+ * @{
+ */
+/*
+ * libmavconn
+ * Copyright 2017 Vladimir Ermakov, All rights reserved.
+ *
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cassert>
+#include <cstdint>
+#include <cstddef>
+
+namespace mavconn {
+/**
+ * @brief Lock-free bounded MPMC ring.
+ *
+ * Sequence-slot scheme after D. Vyukov's bounded MPMC queue, both
+ * cursors advance by CAS: any thread may push() or pop(). Used for
+ * the BufferPool free lists and the receive slot pool; T is expected
+ * to be a pointer type.
+ */
+template <typename T>
+class MPMCRing {
+public:
+	explicit MPMCRing(size_t capacity) :
+		mask(capacity - 1),
+		slot(new Slot[capacity]),
+		head(0),
+		tail(0)
+	{
+		assert((capacity & mask) == 0);	// power of two
+		for (size_t i = 0; i < capacity; i++)
+			slot[i].seq.store(i, std::memory_order_relaxed);
+	}
+
+	MPMCRing(const MPMCRing&) = delete;
+
+	bool push(T v)
+	{
+		size_t pos = head.load(std::memory_order_relaxed);
+		for (;;) {
+			auto &s = slot[pos & mask];
+			size_t seq = s.seq.load(std::memory_order_acquire);
+			intptr_t dif = intptr_t(seq) - intptr_t(pos);
+
+			if (dif == 0) {
+				if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					s.value = v;
+					s.seq.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (dif < 0) {
+				return false;	// full
+			}
+			else {
+				pos = head.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	//! @return default-constructed T (nullptr) when empty
+	T pop()
+	{
+		size_t pos = tail.load(std::memory_order_relaxed);
+		for (;;) {
+			auto &s = slot[pos & mask];
+			size_t seq = s.seq.load(std::memory_order_acquire);
+			intptr_t dif = intptr_t(seq) - intptr_t(pos + 1);
+
+			if (dif == 0) {
+				if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					auto v = s.value;
+					s.seq.store(pos + mask + 1, std::memory_order_release);
+					return v;
+				}
+			}
+			else if (dif < 0) {
+				return T();	// empty
+			}
+			else {
+				pos = tail.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+private:
+	struct Slot {
+		std::atomic<size_t> seq;
+		T value;
+	};
+
+	const size_t mask;
+	std::unique_ptr<Slot[]> slot;
+	alignas(64) std::atomic<size_t> head;
+	alignas(64) std::atomic<size_t> tail;
+};
+}	// namespace mavconn
@@ -0,0 +1,158 @@
+/**
+ * @brief MAVConn receive slot pool (internal)
+ * @file rxpool.h
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup mavconn
+ * @{
+ */
+/*
+ * libmavconn
+ * Copyright 2017 Vladimir Ermakov, All rights reserved.
+ *
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <mavconn/ring.h>
+#include <mavconn/mavlink_dialect.h>
+
+namespace mavconn {
+/**
+ * @brief Pool of received-message slots with refcounted borrows.
+ *
+ * parse_buffer() frames messages directly into pool slots; the
+ * delivery callback may take a RxMsgRef borrow to hand a message to
+ * another thread without copying it and without blocking the rx path.
+ * A slot returns to the lock-free free ring when the last reference
+ * is dropped, from whatever thread that happens on.
+ */
+class RxPool {
+public:
+	//! Bounds the rx-to-handler pipelining depth.
+	static constexpr size_t POOL_SIZE = 64;
+
+	struct Slot {
+		mavlink::mavlink_message_t msg;
+		std::atomic<uint32_t> refcnt;
+		RxPool *owner;
+	};
+
+	RxPool() :
+		free_ring(POOL_SIZE),
+		slots(new Slot[POOL_SIZE])
+	{
+		for (size_t i = 0; i < POOL_SIZE; i++) {
+			slots[i].refcnt.store(0, std::memory_order_relaxed);
+			slots[i].owner = this;
+			free_ring.push(&slots[i]);
+		}
+	}
+
+	RxPool(const RxPool&) = delete;
+
+	/**
+	 * @brief Take a free slot holding one reference.
+	 * @return nullptr when every slot is still borrowed
+	 */
+	Slot *acquire()
+	{
+		auto *s = free_ring.pop();
+		if (s != nullptr)
+			s->refcnt.store(1, std::memory_order_relaxed);
+
+		return s;
+	}
+
+	static void ref(Slot *s)
+	{
+		s->refcnt.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	static void unref(Slot *s)
+	{
+		if (s->refcnt.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			s->owner->free_ring.push(s);
+	}
+
+private:
+	MPMCRing<Slot *> free_ring;
+	std::unique_ptr<Slot[]> slots;
+};
+
+/**
+ * @brief Refcounted borrow of a received message.
+ *
+ * Obtained with MAVConnInterface::borrow_rx_message() inside the
+ * delivery callback. May be copied or moved to any thread, but must
+ * not outlive the connection object owning the pool.
+ */
+class RxMsgRef {
+public:
+	RxMsgRef() :
+		slot(nullptr)
+	{ }
+
+	explicit RxMsgRef(RxPool::Slot *slot_) :
+		slot(slot_)
+	{
+		if (slot != nullptr)
+			RxPool::ref(slot);
+	}
+
+	RxMsgRef(const RxMsgRef &other) :
+		slot(other.slot)
+	{
+		if (slot != nullptr)
+			RxPool::ref(slot);
+	}
+
+	RxMsgRef(RxMsgRef &&other) :
+		slot(other.slot)
+	{
+		other.slot = nullptr;
+	}
+
+	RxMsgRef &operator=(RxMsgRef other)
+	{
+		std::swap(slot, other.slot);
+		return *this;
+	}
+
+	~RxMsgRef()
+	{
+		if (slot != nullptr)
+			RxPool::unref(slot);
+	}
+
+	//! @return nullptr for an empty borrow (pool was exhausted)
+	const mavlink::mavlink_message_t *get() const
+	{
+		return (slot != nullptr) ? &slot->msg : nullptr;
+	}
+
+	const mavlink::mavlink_message_t &operator*() const
+	{
+		return slot->msg;
+	}
+
+	const mavlink::mavlink_message_t *operator->() const
+	{
+		return &slot->msg;
+	}
+
+	explicit operator bool() const
+	{
+		return slot != nullptr;
+	}
+
+private:
+	RxPool::Slot *slot;
+};
+}	// namespace mavconn
@@ -21,6 +21,8 @@
 #include <boost/asio.hpp>
 #include <mavconn/interface.h>
 #include <mavconn/msgbuffer.h>
+#include <mavconn/bufferpool.h>
+#include <mavconn/txqueue.h>
 
 namespace mavconn {
 /**
@@ -44,25 +46,35 @@ public:
 
 	void close() override;
 
-	void send_message(const mavlink::mavlink_message_t *message) override;
-	void send_message(const mavlink::Message &message) override;
-	void send_bytes(const uint8_t *bytes, size_t length) override;
+	using MAVConnInterface::send_message;
+	using MAVConnInterface::send_bytes;
+
+	void send_message(const mavlink::mavlink_message_t *message, Priority prio) override;
+	void send_message(const mavlink::Message &message, Priority prio) override;
+	void send_bytes(const uint8_t *bytes, size_t length, Priority prio) override;
+
+	void set_link_txbuf(uint8_t free_percent) override;
 
 	inline bool is_open() override {
 		return serial_dev.is_open();
 	}
 
 private:
-	boost::asio::io_service io_service;
-	std::thread io_thread;
+	boost::asio::io_service::strand strand;
 	boost::asio::serial_port serial_dev;
 
+	//! Maximum number of queued buffers coalesced into one gathered write
+	static constexpr size_t MAX_GATHER = 16;
+
 	std::atomic<bool> tx_in_progress;
-	std::deque<MsgBuffer> tx_q;
+	BufferPool pool;
+	PrioTxQueue tx_q;
+	std::array<boost::asio::const_buffer, MAX_GATHER> tx_gather;
 	std::array<uint8_t, MsgBuffer::MAX_SIZE> rx_buf;
 	std::recursive_mutex mutex;
 
 	void do_read();
+	void busy_poll_read();
 	void do_write(bool check_tx_state);
 };
 }	// namespace mavconn
@@ -0,0 +1,89 @@
+/**
+ * @brief MAVConn raw epoll serial link class
+ * @file serial_raw.h
+ *
+ * @addtogroup mavconn
+ * @{
+ */
+/*
+ * libmavconn
+ *
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <mavconn/interface.h>
+#include <mavconn/msgbuffer.h>
+#include <mavconn/bufferpool.h>
+#include <mavconn/txqueue.h>
+
+namespace mavconn {
+/**
+ * @brief Serial interface on a raw termios fd, epoll driven
+ *
+ * Alternative to MAVConnSerial for RT-patched companions where the
+ * asio reactor hop costs measurable latency: one dedicated thread
+ * blocks in epoll_wait() on the tty fd, stamps the receive time at
+ * the wakeup (before any parsing), reads until EAGAIN and drains the
+ * priority tx queue with direct gathered writev() — no io_service,
+ * no strand, no completion-handler round trip.
+ *
+ * Selected with the ?backend=raw URL option on serial:// URLs; the
+ * default asio backend is unchanged. ?busypoll= and the tx priority
+ * classes behave the same on both backends.
+ *
+ * @note Linux only (epoll, eventfd).
+ */
+class MAVConnSerialRaw : public MAVConnInterface {
+public:
+	MAVConnSerialRaw(uint8_t system_id = 1, uint8_t component_id = MAV_COMP_ID_UDP_BRIDGE,
+			std::string device = "/dev/ttyACM0", unsigned baudrate = 57600, bool hwflow = false);
+	~MAVConnSerialRaw();
+
+	void close() override;
+
+	using MAVConnInterface::send_message;
+	using MAVConnInterface::send_bytes;
+
+	void send_message(const mavlink::mavlink_message_t *message, Priority prio) override;
+	void send_message(const mavlink::Message &message, Priority prio) override;
+	void send_bytes(const uint8_t *bytes, size_t length, Priority prio) override;
+
+	void set_link_txbuf(uint8_t free_percent) override;
+
+	inline bool is_open() override {
+		return fd >= 0;
+	}
+
+private:
+	//! Maximum number of queued buffers coalesced into one writev()
+	static constexpr size_t MAX_GATHER = 16;
+
+	int fd;		//!< tty, O_NONBLOCK
+	int epoll_fd;
+	int event_fd;	//!< tx kick / shutdown wakeup
+
+	std::atomic<bool> running;
+	//! EPOLLOUT currently subscribed (io thread only)
+	bool tx_armed;
+	BufferPool pool;
+	PrioTxQueue tx_q;
+	std::array<uint8_t, MsgBuffer::MAX_SIZE> rx_buf;
+	std::recursive_mutex mutex;
+	std::thread io_thread;
+
+	void io_loop();
+	//! @return false on fatal tty error (io loop must exit)
+	bool do_read();
+	void busy_poll_read();
+	//! @return false when the tty blocked and EPOLLOUT is needed
+	bool do_write();
+	void arm_tx(bool enable);
+	void kick();
+};
+}	// namespace mavconn
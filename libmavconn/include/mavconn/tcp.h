@@ -23,6 +23,8 @@
 #include <boost/asio.hpp>
 #include <mavconn/interface.h>
 #include <mavconn/msgbuffer.h>
+#include <mavconn/bufferpool.h>
+#include <mavconn/txqueue.h>
 
 
 namespace mavconn {
@@ -53,9 +55,14 @@ public:
 
 	void close() override;
 
-	void send_message(const mavlink::mavlink_message_t *message) override;
-	void send_message(const mavlink::Message &message) override;
-	void send_bytes(const uint8_t *bytes, size_t length) override;
+	using MAVConnInterface::send_message;
+	using MAVConnInterface::send_bytes;
+
+	void send_message(const mavlink::mavlink_message_t *message, Priority prio) override;
+	void send_message(const mavlink::Message &message, Priority prio) override;
+	void send_bytes(const uint8_t *bytes, size_t length, Priority prio) override;
+
+	void set_link_txbuf(uint8_t free_percent) override;
 
 	inline bool is_open() override {
 		return socket.is_open();
@@ -63,15 +70,21 @@ public:
 
 private:
 	friend class MAVConnTCPServer;
-	boost::asio::io_service io_service;
-	std::unique_ptr<boost::asio::io_service::work> io_work;
-	std::thread io_thread;
+	boost::asio::io_service::strand strand;
 
 	boost::asio::ip::tcp::socket socket;
 	boost::asio::ip::tcp::endpoint server_ep;
 
+	//! Maximum number of queued buffers coalesced into one gathered write
+	static constexpr size_t MAX_GATHER = 16;
+
 	std::atomic<bool> tx_in_progress;
-	std::deque<MsgBuffer> tx_q;
+	//! sent bytes of the front queued buffer; kept outside MsgBuffer
+	//! because broadcast buffers are shared between clients
+	size_t tx_front_pos;
+	BufferPool pool;
+	PrioTxQueue tx_q;
+	std::array<boost::asio::const_buffer, MAX_GATHER> tx_gather;
 	std::array<uint8_t, MsgBuffer::MAX_SIZE> rx_buf;
 	std::recursive_mutex mutex;
 
@@ -80,6 +93,16 @@ private:
 	 */
 	void client_connected(size_t server_channel);
 
+	/**
+	 * Enqueue an already serialized (possibly shared) buffer.
+	 * Used by MAVConnTCPServer broadcast; the caller holds one
+	 * reference for this client, dropped here on failure or
+	 * after transmission.
+	 *
+	 * @return false if the queue was full and the message dropped
+	 */
+	bool send_buffer(MsgBuffer *bufp, Priority prio);
+
 	void do_recv();
 	void do_send(bool check_tx_state);
 };
@@ -105,9 +128,14 @@ public:
 
 	void close() override;
 
-	void send_message(const mavlink::mavlink_message_t *message) override;
-	void send_message(const mavlink::Message &message) override;
-	void send_bytes(const uint8_t *bytes, size_t length) override;
+	using MAVConnInterface::send_message;
+	using MAVConnInterface::send_bytes;
+
+	void send_message(const mavlink::mavlink_message_t *message, Priority prio) override;
+	void send_message(const mavlink::Message &message, Priority prio) override;
+	void send_bytes(const uint8_t *bytes, size_t length, Priority prio) override;
+
+	void set_link_txbuf(uint8_t free_percent) override;
 
 	mavlink::mavlink_status_t get_status() override;
 	IOStat get_iostat() override;
@@ -116,17 +144,18 @@ public:
 	}
 
 private:
-	boost::asio::io_service io_service;
-	std::unique_ptr<boost::asio::io_service::work> io_work;
-	std::thread io_thread;
+	boost::asio::io_service::strand strand;
 
 	boost::asio::ip::tcp::acceptor acceptor;
 	boost::asio::ip::tcp::endpoint bind_ep;
 
+	//! broadcast buffers: serialized once, shared by all clients
+	BufferPool pool;
 	std::list<std::shared_ptr<MAVConnTCPClient> > client_list;
 	std::recursive_mutex mutex;
 
 	void do_accept();
+	void broadcast_buffer(MsgBuffer *bufp, Priority prio, mavlink::msgid_t msgid);
 
 	// client slots
 	void client_closed(std::weak_ptr<MAVConnTCPClient> weak_instp);
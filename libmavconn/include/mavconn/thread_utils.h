@@ -20,10 +20,17 @@
 
 #include <thread>
 #include <string>
+#include <vector>
 #include <cstdio>
+#include <cstdarg>
 #include <sstream>
+#include <sched.h>
 #include <pthread.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace mavconn {
 namespace utils {
 
@@ -43,6 +50,47 @@ std::string format(const std::string &fmt, Args ... args)
 	return ret;
 }
 
+/**
+ * @brief Fixed stack-buffer printf formatter
+ *
+ * Zero-allocation replacement for format() on hot paths: the text is
+ * rendered into an in-object buffer, the heap is touched only when a
+ * message does not fit (rare — logging lines are short). Unlike the
+ * template above the format string is checked at compile time.
+ */
+class StackFormat {
+public:
+	StackFormat(const char *fmt, ...) __attribute__((format(printf, 2, 3)))
+	{
+		va_list ap;
+
+		va_start(ap, fmt);
+		int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+		va_end(ap);
+
+		if (n >= int(sizeof(buf))) {
+			// oversize message: pay the one allocation
+			overflow.resize(n + 1);
+			va_start(ap, fmt);
+			vsnprintf(&overflow.front(), n + 1, fmt, ap);
+			va_end(ap);
+			overflow.resize(n);
+		}
+	}
+
+	const char *c_str() const {
+		return overflow.empty() ? buf : overflow.c_str();
+	}
+
+	operator const char *() const {
+		return c_str();
+	}
+
+private:
+	char buf[256];
+	std::string overflow;
+};
+
 /**
  * @brief Set name to current thread, printf-like
  * @param[in] name name for thread
@@ -64,6 +112,56 @@ bool set_this_thread_name(const std::string &name, Args&& ... args)
 #endif
 }
 
+/**
+ * @brief CPU pause hint for spin-wait loops
+ */
+inline void cpu_relax()
+{
+#if defined(__SSE2__)
+	_mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+	asm volatile ("yield" ::: "memory");
+#else
+	std::this_thread::yield();
+#endif
+}
+
+/**
+ * @brief Pin current thread to a set of CPUs
+ * @param[in] cpu_ids  zero-based CPU numbers
+ * @return true if success, errno set otherwise
+ *
+ * @note Only for Linux target
+ */
+inline bool set_this_thread_affinity(const std::vector<int> &cpu_ids)
+{
+#ifdef __linux__
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (auto id : cpu_ids)
+		CPU_SET(id, &set);
+
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+	(void)cpu_ids;
+	return false;
+#endif
+}
+
+/**
+ * @brief Raise current thread to SCHED_FIFO real-time scheduling
+ * @param[in] prio SCHED_FIFO priority (1..99 on Linux)
+ * @return true if success, errno set otherwise
+ *
+ * @note Needs CAP_SYS_NICE (or root) on Linux
+ */
+inline bool set_this_thread_rt_prio(int prio)
+{
+	sched_param sp {};
+	sp.sched_priority = prio;
+	return pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp) == 0;
+}
+
 /**
  * @brief Convert to string objects with operator <<
  */
@@ -0,0 +1,45 @@
+/**
+ * @brief Static tracepoints (USDT)
+ * @file trace.h
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup mavconn
+ * @{
+ *  @brief Static tracepoints for the rx -> route -> publish pipeline
+ */
+/*
+ * libmavconn
+ * Copyright 2017 Vladimir Ermakov, All rights reserved.
+ *
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+
+#pragma once
+
+/**
+ * USDT probes under the "mavros" provider. A disabled probe compiles
+ * to a single nop, so they stay in production builds; timestamps come
+ * from the tracer (perf/bpftrace read the clock at the probe site),
+ * so probes only carry msgid and seq.
+ *
+ * Without <sys/sdt.h> (systemtap-sdt-dev) the macros expand to
+ * nothing and no dependency is added.
+ */
+#if defined(__has_include)
+#  if __has_include(<sys/sdt.h>)
+#    include <sys/sdt.h>
+#    define MAVCONN_HAVE_SDT
+#  endif
+#endif
+
+#ifdef MAVCONN_HAVE_SDT
+#  define MAVCONN_TRACE1(name, a)	DTRACE_PROBE1(mavros, name, a)
+#  define MAVCONN_TRACE2(name, a, b)	DTRACE_PROBE2(mavros, name, a, b)
+#  define MAVCONN_TRACE3(name, a, b, c)	DTRACE_PROBE3(mavros, name, a, b, c)
+#else
+#  define MAVCONN_TRACE1(name, a)	do { } while (0)
+#  define MAVCONN_TRACE2(name, a, b)	do { } while (0)
+#  define MAVCONN_TRACE3(name, a, b, c)	do { } while (0)
+#endif
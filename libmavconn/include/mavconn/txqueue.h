@@ -0,0 +1,330 @@
+/**
+ * @brief MAVConn lock-free transmit queue (internal)
+ * @file txqueue.h
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup mavconn
+ * @{
+ */
+/*
+ * libmavconn
+ * Copyright 2017 Vladimir Ermakov, All rights reserved.
+ *
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mavconn/msgbuffer.h>
+#include <mavconn/bufferpool.h>
+
+namespace mavconn {
+/**
+ * @brief Lock-free bounded transmit queue.
+ *
+ * Multiple-producer (ROS callback threads calling send_message())
+ * single-consumer (asio io thread draining in do_write()) ring of
+ * BufferPool-owned MsgBuffer pointers, based on D. Vyukov's bounded
+ * MPMC queue. Enqueue never takes a lock, so publishers do not block
+ * on the IO thread completion handlers.
+ *
+ * The queue does not own the buffers: the caller gets them from
+ * BufferPool::make() and releases them after transmission (or on
+ * push() failure).
+ *
+ * Producer API: push().
+ * Consumer API (IO thread only): front(), pop(), empty().
+ */
+class TxQueue {
+public:
+	//! Ring capacity: power of two not less than MAVConnInterface::MAX_TXQ_SIZE
+	static constexpr size_t CAPACITY = 1024;
+
+	TxQueue() :
+		head(0),
+		tail(0)
+	{
+		for (size_t i = 0; i < CAPACITY; i++)
+			slot[i].seq.store(i, std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Enqueue a filled buffer.
+	 *
+	 * Thread-safe for any number of producers.
+	 *
+	 * @return false if the queue is full (caller releases buf and
+	 *         decides to drop or throw)
+	 */
+	bool push(MsgBuffer *buf)
+	{
+		size_t pos = head.load(std::memory_order_relaxed);
+		for (;;) {
+			auto &s = slot[pos & MASK];
+			size_t seq = s.seq.load(std::memory_order_acquire);
+			intptr_t dif = intptr_t(seq) - intptr_t(pos);
+
+			if (dif == 0) {
+				if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					s.buf = buf;
+					s.seq.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+				// CAS failure reloads pos, retry
+			}
+			else if (dif < 0) {
+				return false;	// full
+			}
+			else {
+				pos = head.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	/**
+	 * @brief Buffer @a index entries past the front, or nullptr if not ready.
+	 *
+	 * Used by the transports to gather several queued buffers
+	 * into one scatter-gather write.
+	 *
+	 * @note IO thread only. @a index must be less than CAPACITY.
+	 */
+	MsgBuffer *peek(size_t index)
+	{
+		size_t pos = tail + index;
+		auto &s = slot[pos & MASK];
+		if (s.seq.load(std::memory_order_acquire) != pos + 1)
+			return nullptr;
+
+		return s.buf;
+	}
+
+	/**
+	 * @brief Oldest queued buffer, or nullptr if none ready.
+	 * @note IO thread only.
+	 */
+	MsgBuffer *front()
+	{
+		return peek(0);
+	}
+
+	/**
+	 * @brief Release front slot. Does not release the buffer itself.
+	 * @note IO thread only. Call only after front() returned non-null.
+	 */
+	void pop()
+	{
+		auto &s = slot[tail & MASK];
+		s.seq.store(tail + CAPACITY, std::memory_order_release);
+		tail++;
+	}
+
+	//! @note IO thread only.
+	inline bool empty()
+	{
+		return front() == nullptr;
+	}
+
+private:
+	static constexpr size_t MASK = CAPACITY - 1;
+	static_assert((CAPACITY & MASK) == 0, "CAPACITY must be power of two");
+
+	struct Slot {
+		std::atomic<size_t> seq;
+		MsgBuffer *buf;
+	};
+
+	//! pad producer and consumer cursors to separate cache lines
+	alignas(64) std::atomic<size_t> head;	//!< producer cursor
+	alignas(64) size_t tail;		//!< consumer cursor (IO thread only)
+	alignas(64) Slot slot[CAPACITY];
+};
+
+//! Transmit priority class. @see PrioTxQueue
+enum class Priority : uint8_t {
+	REALTIME = 0,	//!< time-critical: setpoints, RC override
+	NORMAL = 1,	//!< default telemetry traffic
+	BULK = 2,	//!< background transfers: param sync, FTP
+};
+
+/**
+ * @brief Priority-classed transmit queues.
+ *
+ * One TxQueue ring per Priority class, so the queue limit is enforced
+ * per class and a param bulk push or FTP transfer can neither evict
+ * nor starve time-critical setpoints. The consumer drains the classes
+ * in weighted round-robin order (realtime 8 / normal 4 / bulk 1 per
+ * round), refilling a small consumer-owned FIFO that keeps gather
+ * order stable across partial writes.
+ *
+ * Link backpressure: set_txbuf() feeds the remote buffer fill level
+ * (e.g. RADIO_STATUS.txbuf of SiK radios) into the scheduler. While
+ * the reported free space is below TXBUF_CONGESTED the bulk class is
+ * paused and bulk messages older than BULK_SHED_AGE_NS are shed, so a
+ * param or FTP transfer cannot overrun the radio; realtime and normal
+ * traffic is unaffected and recovery is automatic.
+ *
+ * Same threading contract as TxQueue: push() and set_txbuf() from any
+ * producer, the rest from the connection strand only.
+ */
+class PrioTxQueue {
+public:
+	static constexpr size_t NUM_CLASSES = 3;
+	//! Drain FIFO depth; not less than the transports' MAX_GATHER
+	static constexpr size_t FIFO_SIZE = 32;
+	//! below this reported free space [%] the bulk class is paused
+	static constexpr uint8_t TXBUF_CONGESTED = 25;
+	//! queued bulk older than this is shed while congested [ns]
+	static constexpr uint64_t BULK_SHED_AGE_NS = 1000000000ULL;
+
+	PrioTxQueue() :
+		f_head(0),
+		f_tail(0),
+		txbuf_free(100),
+		shed(0)
+	{
+		reset_credits();
+	}
+
+	/**
+	 * @brief Link buffer feedback.
+	 * @param[in] free_percent  remote buffer free space, 0..100
+	 * @see MAVConnInterface::set_link_txbuf()
+	 */
+	void set_txbuf(uint8_t free_percent)
+	{
+		txbuf_free.store(free_percent, std::memory_order_relaxed);
+	}
+
+	//! @return bulk messages shed since the last call
+	size_t take_shed()
+	{
+		return shed.exchange(0, std::memory_order_relaxed);
+	}
+
+	//! @return false if the class ring is full
+	bool push(MsgBuffer *buf, Priority prio)
+	{
+		return q[size_t(prio)].push(buf);
+	}
+
+	//! @note connection strand only.
+	MsgBuffer *peek(size_t index)
+	{
+		refill();
+		if (index >= f_head - f_tail)
+			return nullptr;
+
+		return fifo[(f_tail + index) & (FIFO_SIZE - 1)];
+	}
+
+	//! @note connection strand only.
+	MsgBuffer *front()
+	{
+		return peek(0);
+	}
+
+	//! @note connection strand only.
+	void pop()
+	{
+		f_tail++;
+	}
+
+	//! @note connection strand only.
+	inline bool empty()
+	{
+		return front() == nullptr;
+	}
+
+private:
+	//! weighted round-robin share per drain round
+	static constexpr unsigned weight(size_t class_)
+	{
+		return (class_ == size_t(Priority::REALTIME)) ? 8 :
+		       (class_ == size_t(Priority::NORMAL)) ? 4 : 1;
+	}
+
+	void reset_credits()
+	{
+		for (size_t c = 0; c < NUM_CLASSES; c++)
+			credit[c] = weight(c);
+	}
+
+	//! shed bulk entries that went stale while the link is congested
+	void shed_stale_bulk()
+	{
+		auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
+
+		while (auto *stale = q[size_t(Priority::BULK)].front()) {
+			if (uint64_t(now) - stale->stamp_ns < BULK_SHED_AGE_NS)
+				break;
+
+			q[size_t(Priority::BULK)].pop();
+			BufferPool::release(stale);
+			shed.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	//! move ready buffers from class rings into the drain FIFO
+	void refill()
+	{
+		const bool congested = txbuf_free.load(std::memory_order_relaxed) < TXBUF_CONGESTED;
+		if (congested)
+			shed_stale_bulk();
+
+		while (f_head - f_tail < FIFO_SIZE) {
+			MsgBuffer *buf = nullptr;
+			for (size_t c = 0; c < NUM_CLASSES; c++) {
+				if (credit[c] == 0)
+					continue;
+
+				if (c == size_t(Priority::BULK) && congested)
+					continue;	// bulk waits for the link to drain
+
+				buf = q[c].front();
+				if (buf != nullptr) {
+					q[c].pop();
+					credit[c]--;
+					break;
+				}
+			}
+
+			if (buf == nullptr) {
+				// round exhausted (or nothing queued at all)
+				bool any = false;
+				for (size_t c = 0; c < NUM_CLASSES; c++) {
+					if (c == size_t(Priority::BULK) && congested)
+						continue;
+
+					any = any || !q[c].empty();
+				}
+
+				if (!any)
+					return;
+
+				reset_credits();
+				continue;
+			}
+
+			fifo[f_head & (FIFO_SIZE - 1)] = buf;
+			f_head++;
+		}
+	}
+
+	TxQueue q[NUM_CLASSES];
+
+	// consumer-owned drain FIFO (connection strand only)
+	MsgBuffer *fifo[FIFO_SIZE];
+	size_t f_head, f_tail;
+	unsigned credit[NUM_CLASSES];
+
+	std::atomic<uint8_t> txbuf_free;
+	std::atomic<size_t> shed;
+};
+}	// namespace mavconn
@@ -21,6 +21,8 @@
 #include <boost/asio.hpp>
 #include <mavconn/interface.h>
 #include <mavconn/msgbuffer.h>
+#include <mavconn/bufferpool.h>
+#include <mavconn/txqueue.h>
 
 namespace mavconn {
 /**
@@ -51,32 +53,50 @@ public:
 
 	void close() override;
 
-	void send_message(const mavlink::mavlink_message_t *message) override;
-	void send_message(const mavlink::Message &message) override;
-	void send_bytes(const uint8_t *bytes, size_t length) override;
+	using MAVConnInterface::send_message;
+	using MAVConnInterface::send_bytes;
+
+	void send_message(const mavlink::mavlink_message_t *message, Priority prio) override;
+	void send_message(const mavlink::Message &message, Priority prio) override;
+	void send_bytes(const uint8_t *bytes, size_t length, Priority prio) override;
+
+	void set_link_txbuf(uint8_t free_percent) override;
 
 	inline bool is_open() override {
 		return socket.is_open();
 	}
 
 private:
-	boost::asio::io_service io_service;
-	std::unique_ptr<boost::asio::io_service::work> io_work;
-	std::thread io_thread;
+	boost::asio::io_service::strand strand;
 
 	std::atomic<bool> remote_exists;
+	//! socket is connect()ed to the remote (Linux fast path)
+	std::atomic<bool> socket_locked;
 	boost::asio::ip::udp::socket socket;
 	boost::asio::ip::udp::endpoint remote_ep;
 	boost::asio::ip::udp::endpoint last_remote_ep;
 	boost::asio::ip::udp::endpoint bind_ep;
 
+	//! Maximum datagrams per recvmmsg()/sendmmsg() batch (Linux only)
+	static constexpr size_t MAX_BATCH = 16;
+
 	std::atomic<bool> tx_in_progress;
-	std::deque<MsgBuffer> tx_q;
+	BufferPool pool;
+	PrioTxQueue tx_q;
 	std::array<uint8_t, MsgBuffer::MAX_SIZE> rx_buf;
+#ifdef __linux__
+	std::array<std::array<uint8_t, MsgBuffer::MAX_SIZE>, MAX_BATCH> rx_batch;
+#endif
 	std::recursive_mutex mutex;
 
 	void do_recvfrom();
 	void do_sendto(bool check_tx_state);
+#ifdef __linux__
+	int recv_batch();
+	bool send_batch();
+	void busy_poll_recv();
+	void unlock_remote();
+#endif
 };
 }	// namespace mavconn
 
@@ -0,0 +1,354 @@
+/**
+ * @brief MAVConn bonded multi-link interface
+ * @file bond.cpp
+ *
+ * @addtogroup mavconn
+ * @{
+ */
+/*
+ * libmavconn
+ *
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+
+#include <cassert>
+#include <algorithm>
+#include <console_bridge/console.h>
+
+#include <mavconn/bond.h>
+
+namespace mavconn {
+
+#define PFX	"mavconn: bond"
+#define PFXd	PFX "%zu: "
+
+//! member link whose rx thread is delivering right now, so
+//! borrow_rx_message() pins the slot of the real transport
+static thread_local MAVConnInterface *rx_origin = nullptr;
+
+static inline uint64_t now_ns()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			steady_clock::now().time_since_epoch()).count();
+}
+
+MAVConnBond::MAVConnBond(const std::vector<MAVConnInterface::Ptr> &members,
+		int bulk_member,
+		unsigned fail_timeout_ms) :
+	MAVConnInterface(members.at(0)->get_system_id(), members.at(0)->get_component_id()),
+	members(members),
+	bulk_member(bulk_member),
+	fail_timeout_ns(uint64_t(fail_timeout_ms) * 1000000),
+	closed_members(0),
+	table_full_warned(false)
+{
+	assert(!members.empty());
+
+	const uint64_t now = now_ns();
+	for (size_t i = 0; i < members.size(); i++)
+		last_rx_ns.emplace_back(new std::atomic<uint64_t>(now));
+
+	for (size_t i = 0; i < members.size(); i++) {
+		auto &link = this->members[i];
+
+		link->message_received_cb = [this, i](const mavlink::mavlink_message_t *message, const Framing framing) {
+					member_receive(i, message, framing);
+				};
+
+		// the bond is closed only when every path is gone;
+		// losing one member is exactly what the bond is for
+		link->port_closed_cb = [this, i]() {
+					logWarn(PFXd "member %zu closed", conn_id, i);
+					if (++closed_members == this->members.size() && port_closed_cb)
+						port_closed_cb();
+				};
+	}
+
+	logInform(PFXd "bonded %zu links, failover timeout %u ms, bulk member %d",
+			conn_id, members.size(), fail_timeout_ms, bulk_member);
+}
+
+MAVConnBond::~MAVConnBond()
+{
+	close();
+}
+
+void MAVConnBond::close()
+{
+	for (auto &link : members) {
+		// member close fires its port_closed_cb; detach ours first
+		link->port_closed_cb = ClosedCb();
+		link->message_received_cb = ReceivedCb();
+		if (link->is_open())
+			link->close();
+	}
+
+	if (port_closed_cb)
+		port_closed_cb();
+}
+
+bool MAVConnBond::is_open()
+{
+	for (auto &link : members)
+		if (link->is_open())
+			return true;
+
+	return false;
+}
+
+bool MAVConnBond::healthy(size_t idx, uint64_t now)
+{
+	return members[idx]->is_open() &&
+		now - last_rx_ns[idx]->load(std::memory_order_relaxed) < fail_timeout_ns;
+}
+
+MAVConnInterface *MAVConnBond::select_link(Priority prio, size_t skip)
+{
+	const uint64_t now = now_ns();
+
+	if (prio == Priority::BULK && bulk_member >= 0 &&
+			size_t(bulk_member) != skip && healthy(bulk_member, now))
+		return members[bulk_member].get();
+
+	for (size_t i = 0; i < members.size(); i++)
+		if (i != skip && healthy(i, now))
+			return members[i].get();
+
+	// no path looks alive: keep trying the preferred one anyway,
+	// the FCU may just be quiet
+	return members[skip == 0 && members.size() > 1 ? 1 : 0].get();
+}
+
+void MAVConnBond::send_message(const mavlink::mavlink_message_t *message, Priority prio)
+{
+	auto *link = select_link(prio);
+
+	try {
+		link->send_message(message, prio);
+	}
+	catch (std::length_error &e) {
+		// full tx queue on the active path is a failure too:
+		// try the next member once before reporting the drop
+		size_t idx = 0;
+		while (members[idx].get() != link)
+			idx++;
+
+		auto *alt = select_link(prio, idx);
+		if (alt == link)
+			throw;
+
+		alt->send_message(message, prio);
+	}
+}
+
+void MAVConnBond::send_message(const mavlink::Message &message, Priority prio)
+{
+	auto *link = select_link(prio);
+
+	try {
+		link->send_message(message, prio);
+	}
+	catch (std::length_error &e) {
+		size_t idx = 0;
+		while (members[idx].get() != link)
+			idx++;
+
+		auto *alt = select_link(prio, idx);
+		if (alt == link)
+			throw;
+
+		alt->send_message(message, prio);
+	}
+}
+
+void MAVConnBond::send_bytes(const uint8_t *bytes, size_t length, Priority prio)
+{
+	select_link(prio)->send_bytes(bytes, length, prio);
+}
+
+void MAVConnBond::set_protocol_version(Protocol pver)
+{
+	MAVConnInterface::set_protocol_version(pver);
+	for (auto &link : members)
+		link->set_protocol_version(pver);
+}
+
+void MAVConnBond::set_protocol_auto(bool enabled)
+{
+	// each member negotiates on its own: paths may prove v2
+	// capability at different times
+	MAVConnInterface::set_protocol_auto(enabled);
+	for (auto &link : members)
+		link->set_protocol_auto(enabled);
+}
+
+void MAVConnBond::set_peer_mavlink2(bool capable)
+{
+	MAVConnInterface::set_peer_mavlink2(capable);
+	for (auto &link : members)
+		link->set_peer_mavlink2(capable);
+}
+
+mavlink::mavlink_status_t MAVConnBond::get_status()
+{
+	return select_link(Priority::NORMAL)->get_status();
+}
+
+MAVConnInterface::IOStat MAVConnBond::get_iostat()
+{
+	// totals and speeds add up across paths; latency percentiles do
+	// not, so report the worst path — that is the one that matters
+	IOStat stat {};
+
+	for (auto &link : members) {
+		auto s = link->get_iostat();
+
+		stat.tx_total_bytes += s.tx_total_bytes;
+		stat.rx_total_bytes += s.rx_total_bytes;
+		stat.tx_speed += s.tx_speed;
+		stat.rx_speed += s.rx_speed;
+		stat.tx_dropped += s.tx_dropped;
+		stat.tx_latency_p50_us = std::max(stat.tx_latency_p50_us, s.tx_latency_p50_us);
+		stat.tx_latency_p90_us = std::max(stat.tx_latency_p90_us, s.tx_latency_p90_us);
+		stat.tx_latency_p99_us = std::max(stat.tx_latency_p99_us, s.tx_latency_p99_us);
+	}
+
+	return stat;
+}
+
+bool MAVConnBond::get_stat_snapshot(StatSnapshot &out)
+{
+	// same aggregation as get_iostat(): totals add up, percentiles
+	// report the worst path; parser counters sum across members
+	bool any = false;
+	out = StatSnapshot {};
+
+	for (auto &link : members) {
+		StatSnapshot s;
+		if (!link->get_stat_snapshot(s))
+			continue;
+
+		if (!any) {
+			out.current_rx_seq = s.current_rx_seq;
+			out.current_tx_seq = s.current_tx_seq;
+		}
+		any = true;
+
+		out.packet_rx_success_count += s.packet_rx_success_count;
+		out.packet_rx_drop_count += s.packet_rx_drop_count;
+		out.buffer_overrun += s.buffer_overrun;
+		out.parse_error += s.parse_error;
+		out.tx_total_bytes += s.tx_total_bytes;
+		out.rx_total_bytes += s.rx_total_bytes;
+		out.tx_speed += s.tx_speed;
+		out.rx_speed += s.rx_speed;
+		out.tx_dropped += s.tx_dropped;
+		out.tx_latency_p50_us = std::max(out.tx_latency_p50_us, s.tx_latency_p50_us);
+		out.tx_latency_p90_us = std::max(out.tx_latency_p90_us, s.tx_latency_p90_us);
+		out.tx_latency_p99_us = std::max(out.tx_latency_p99_us, s.tx_latency_p99_us);
+	}
+
+	return any;
+}
+
+/**
+ * Accept/drop decision on one sender's packed seq window.
+ *
+ * Low byte: newest accepted seq. Bits 8.. : bitmap, bit (8 + k)
+ * set when seq (newest - 1 - k) was seen. The whole decision is one
+ * CAS loop, so rx threads of different members race without locks;
+ * a lost CAS simply re-reads the window the winner published.
+ */
+bool MAVConnBond::accept_seq(std::atomic<uint64_t> &entry, uint8_t seq)
+{
+	constexpr uint64_t window_mask = (uint64_t(1) << DEDUP_WINDOW) - 1;
+
+	uint64_t cur = entry.load(std::memory_order_relaxed);
+	for (;;) {
+		const uint8_t newest = cur & 0xff;
+		const uint64_t window = cur >> 8;
+		const int8_t diff = int8_t(seq - newest);	// wraparound-aware
+		uint64_t next;
+
+		if (diff == 0)
+			return false;	// repeat of the newest seq
+		else if (diff > 0) {
+			// ahead of everything seen: slide the window
+			uint64_t w = 0;
+			if (diff <= DEDUP_WINDOW)
+				w = ((window << diff) | (uint64_t(1) << (diff - 1))) & window_mask;
+			next = (w << 8) | seq;
+		}
+		else {
+			const int back = -diff;
+			if (back > DEDUP_WINDOW)
+				return true;	// beyond the window: can't judge, pass
+			const uint64_t bit = uint64_t(1) << (back - 1);
+			if (window & bit)
+				return false;	// already arrived via another member
+			next = ((window | bit) << 8) | newest;
+		}
+
+		if (entry.compare_exchange_weak(cur, next,
+				std::memory_order_acq_rel, std::memory_order_relaxed))
+			return true;
+	}
+}
+
+bool MAVConnBond::accept_message(const mavlink::mavlink_message_t *message)
+{
+	const uint32_t key = (uint32_t(message->sysid) << 8 | message->compid) + 1;
+	const size_t start = (key * 2654435761u) & (DEDUP_TABLE_SIZE - 1);
+
+	for (size_t probe = 0; probe < DEDUP_TABLE_SIZE; probe++) {
+		auto &slot = dedup_table[(start + probe) & (DEDUP_TABLE_SIZE - 1)];
+
+		uint32_t k = slot.key.load(std::memory_order_acquire);
+		if (k == 0) {
+			// free slot: publish the seq before claiming the key,
+			// so a racing loser sees a consistent entry
+			slot.seq_window.store(message->seq, std::memory_order_relaxed);
+			if (slot.key.compare_exchange_strong(k, key,
+					std::memory_order_release, std::memory_order_acquire))
+				return true;
+			// lost the claim; k now holds the winner's key
+		}
+		if (k == key)
+			return accept_seq(slot.seq_window, message->seq);
+	}
+
+	// more senders than slots: pass everything through rather than
+	// lose traffic — worst case is duplicates for the extra senders
+	if (!table_full_warned.exchange(true))
+		logWarn(PFXd "dedup table full, %u.%u not deduplicated",
+				conn_id, message->sysid, message->compid);
+	return true;
+}
+
+void MAVConnBond::member_receive(size_t idx, const mavlink::mavlink_message_t *message, Framing framing)
+{
+	last_rx_ns[idx]->store(now_ns(), std::memory_order_relaxed);
+
+	// only clean frames carry a trustworthy seq; a corrupted frame is
+	// worth reporting once, not once per path
+	if (framing == Framing::ok && !accept_message(message))
+		return;
+
+	if (message_received_cb) {
+		rx_origin = members[idx].get();
+		rx_kernel_stamp_ns.store(rx_origin->get_rx_kernel_stamp_ns(),
+				std::memory_order_relaxed);
+		message_received_cb(message, framing);
+		rx_origin = nullptr;
+	}
+}
+
+RxMsgRef MAVConnBond::borrow_rx_message()
+{
+	if (rx_origin != nullptr)
+		return rx_origin->borrow_rx_message();
+	return RxMsgRef();
+}
+}	// namespace mavconn
@@ -16,14 +16,33 @@
  */
 
 #include <set>
+#include <list>
+#include <cerrno>
 #include <cassert>
+#include <cstring>
+#include <algorithm>
 #include <console_bridge/console.h>
 
+#include <mavconn/thread_utils.h>
+#include <mavconn/trace.h>
 #include <mavconn/interface.h>
 #include <mavconn/msgbuffer.h>
+#include <mavconn/bufferpool.h>
 #include <mavconn/serial.h>
+#ifdef __linux__
+#include <mavconn/serial_raw.h>
+#endif
 #include <mavconn/udp.h>
 #include <mavconn/tcp.h>
+#ifdef HAVE_ZSTD
+#include <mavconn/tcpz.h>
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 namespace mavconn {
 #define PFX	"mavconn: "
@@ -33,25 +52,164 @@ using mavlink::mavlink_status_t;
 
 // static members
 std::once_flag MAVConnInterface::init_flag;
-std::unordered_map<mavlink::msgid_t, const mavlink::mavlink_msg_entry_t*> MAVConnInterface::message_entries {};
+std::vector<const mavlink::mavlink_msg_entry_t*> MAVConnInterface::message_entries {};
 std::atomic<size_t> MAVConnInterface::conn_id_counter {0};
 
+namespace {
+/**
+ * Shared IO thread pool, owns the io_service used by all connections.
+ */
+class IOThreadPool {
+public:
+	boost::asio::io_service io;
+
+	IOThreadPool() :
+		io_work(new boost::asio::io_service::work(io))
+	{
+		size_t n = std::thread::hardware_concurrency() / 2;
+		n = std::max<size_t>(2, std::min<size_t>(4, n));
+
+		logDebug(PFX "io: starting %zu io threads", n);
+		for (size_t i = 0; i < n; i++)
+			threads.emplace_back([this, i] () {
+						utils::set_this_thread_name("mconnio%zu", i);
+						io.run();
+					});
+	}
+
+	~IOThreadPool()
+	{
+		io_work.reset();
+		io.stop();
+
+		for (auto &td : threads)
+			if (td.joinable())
+				td.join();
+	}
+
+	void apply_sched(std::vector<int> cpus, int rtprio)
+	{
+		// one handler per pool thread; the spin barrier keeps a
+		// single thread from servicing several of them
+		auto remaining = std::make_shared<std::atomic<size_t>>(threads.size());
+		for (size_t i = 0; i < threads.size(); i++)
+			io.post([remaining, cpus, rtprio] () {
+						if (!cpus.empty() && !utils::set_this_thread_affinity(cpus))
+							logWarn(PFX "io: set affinity failed: %s", strerror(errno));
+
+						if (rtprio > 0 && !utils::set_this_thread_rt_prio(rtprio))
+							logWarn(PFX "io: SCHED_FIFO prio %d failed: %s (missing CAP_SYS_NICE?)",
+								rtprio, strerror(errno));
+
+						remaining->fetch_sub(1);
+						while (remaining->load() > 0)
+							std::this_thread::yield();
+					});
+	}
+
+private:
+	std::unique_ptr<boost::asio::io_service::work> io_work;
+	std::list<std::thread> threads;
+};
+
+IOThreadPool &io_pool()
+{
+	static IOThreadPool pool;
+	return pool;
+}
+}	// namespace
+
+boost::asio::io_service &MAVConnInterface::io_service()
+{
+	return io_pool().io;
+}
+
+void MAVConnInterface::apply_io_sched(const std::vector<int> &cpus, int rtprio)
+{
+	io_pool().apply_sched(cpus, rtprio);
+}
+
+
+/**
+ * One periodic registration, see register_periodic_tx(). The mutex
+ * serializes timer beats against unregister/destruction: once running
+ * is cleared under it, no beat dereferences owner again. Kept alive by
+ * the handler's shared_ptr, so a cancelled timer can finish its last
+ * invocation safely.
+ */
+struct MAVConnInterface::PeriodicTx {
+	boost::asio::deadline_timer timer;
+	std::mutex mutex;
+	bool running;
+	MAVConnInterface *owner;	//!< valid while running is set
+
+	std::vector<uint8_t> frame;	//!< retained wire frame
+	size_t seq_ofs;			//!< seq byte position in frame
+	uint8_t crc_extra;
+	long period_ms;
+
+	explicit PeriodicTx(boost::asio::io_service &io) :
+		timer(io),
+		running(true),
+		owner(nullptr),
+		seq_ofs(0),
+		crc_extra(0),
+		period_ms(0)
+	{ }
+};
+
 
 MAVConnInterface::MAVConnInterface(uint8_t system_id, uint8_t component_id) :
 	sys_id(system_id),
 	comp_id(component_id),
+	rx_kernel_stamp_ns(0),
 	m_status {},
 	m_buffer {},
+	tx_seq(0),
 	tx_total_bytes(0),
 	rx_total_bytes(0),
 	last_tx_total_bytes(0),
 	last_rx_total_bytes(0),
-	last_iostat(steady_clock::now())
+	last_iostat(steady_clock::now()),
+	rx_slot(nullptr),
+	msg_stat(new MsgCounter[MSG_STAT_SLOTS]),
+	busy_poll_us(0),
+	protocol_auto(false),
+	peer_mavlink2(false),
+	tx_dropped(0),
+	lat_head(0),
+	lat_ring(new LatSample[LAT_SAMPLES]),
+	snap_buf {},
+	snap_seq {},
+	snap_active(0),
+	snap_last_ns(0),
+	snap_last_tx_bytes(0),
+	snap_last_rx_bytes(0)
 {
 	conn_id = conn_id_counter.fetch_add(1);
 	std::call_once(init_flag, init_msg_entry);
 }
 
+MAVConnInterface::~MAVConnInterface()
+{
+	for (auto &p : periodic_txs) {
+		if (!p)
+			continue;
+
+		std::lock_guard<std::mutex> lock(p->mutex);
+		p->running = false;
+		p->timer.cancel();
+	}
+
+	if (rx_slot != nullptr)
+		RxPool::unref(rx_slot);
+}
+
+RxMsgRef MAVConnInterface::borrow_rx_message()
+{
+	return RxMsgRef(rx_slot);
+}
+
 mavlink_status_t MAVConnInterface::get_status()
 {
 	return m_status;
@@ -79,12 +237,183 @@ MAVConnInterface::IOStat MAVConnInterface::get_iostat()
 	stat.tx_speed = d_tx / dt_s;
 	stat.rx_speed = d_rx / dt_s;
 
+	stat.tx_dropped = tx_dropped.load(std::memory_order_relaxed);
+
+	tx_latency_percentiles(stat.tx_latency_p50_us,
+			stat.tx_latency_p90_us, stat.tx_latency_p99_us);
+
+	// snapshot per-msgid counters
+	for (size_t i = 0; i < MSG_STAT_SLOTS; i++) {
+		auto &slot = msg_stat[i];
+		auto key = slot.msgid_p1.load(std::memory_order_acquire);
+		if (key == 0)
+			continue;
+
+		MsgStat ms;
+		ms.msgid = key - 1;
+		ms.tx_count = slot.tx_count.load(std::memory_order_relaxed);
+		ms.tx_bytes = slot.tx_bytes.load(std::memory_order_relaxed);
+		ms.rx_count = slot.rx_count.load(std::memory_order_relaxed);
+		ms.rx_bytes = slot.rx_bytes.load(std::memory_order_relaxed);
+		stat.message_stat.push_back(ms);
+	}
+	std::sort(stat.message_stat.begin(), stat.message_stat.end(),
+			[](const MsgStat &a, const MsgStat &b) {
+				return a.msgid < b.msgid;
+			});
+
 	return stat;
 }
 
+MAVConnInterface::MsgCounter *MAVConnInterface::msg_stat_slot(mavlink::msgid_t msgid)
+{
+	const uint32_t key = msgid + 1;
+	size_t idx = (msgid * 2654435761u) & (MSG_STAT_SLOTS - 1);
+
+	// short linear probe; a full table just leaves rare ids untracked
+	for (size_t probe = 0; probe < 8; probe++, idx = (idx + 1) & (MSG_STAT_SLOTS - 1)) {
+		auto &slot = msg_stat[idx];
+		auto cur = slot.msgid_p1.load(std::memory_order_acquire);
+		if (cur == key)
+			return &slot;
+
+		if (cur == 0) {
+			uint32_t expected = 0;
+			if (slot.msgid_p1.compare_exchange_strong(expected, key, std::memory_order_acq_rel))
+				return &slot;
+			if (expected == key)
+				return &slot;
+		}
+	}
+
+	return nullptr;
+}
+
+void MAVConnInterface::iostat_tx_msg(mavlink::msgid_t msgid, size_t bytes)
+{
+	auto *slot = msg_stat_slot(msgid);
+	if (slot != nullptr) {
+		slot->tx_count.fetch_add(1, std::memory_order_relaxed);
+		slot->tx_bytes.fetch_add(bytes, std::memory_order_relaxed);
+	}
+}
+
+void MAVConnInterface::iostat_rx_msg(mavlink::msgid_t msgid, size_t bytes)
+{
+	auto *slot = msg_stat_slot(msgid);
+	if (slot != nullptr) {
+		slot->rx_count.fetch_add(1, std::memory_order_relaxed);
+		slot->rx_bytes.fetch_add(bytes, std::memory_order_relaxed);
+	}
+}
+
+void MAVConnInterface::iostat_tx_drop(size_t n)
+{
+	tx_dropped.fetch_add(n, std::memory_order_relaxed);
+}
+
+void MAVConnInterface::set_link_txbuf(uint8_t)
+{
+	// transports with a priority tx queue override this
+}
+
+void MAVConnInterface::iostat_tx_latency(uint64_t enqueue_stamp_ns)
+{
+	auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			steady_clock::now().time_since_epoch()).count();
+
+	uint64_t us = (uint64_t(now) - enqueue_stamp_ns) / 1000;
+	lat_ring[lat_head.fetch_add(1, std::memory_order_relaxed) & (LAT_SAMPLES - 1)]
+		.us.store(uint32_t(std::min<uint64_t>(us, UINT32_MAX)), std::memory_order_relaxed);
+}
+
+void MAVConnInterface::tx_latency_percentiles(float &p50, float &p90, float &p99)
+{
+	// percentiles over the latency sample ring
+	p50 = p90 = p99 = 0.0;
+
+	size_t nsamples = std::min<size_t>(lat_head.load(std::memory_order_relaxed), LAT_SAMPLES);
+	if (nsamples == 0)
+		return;
+
+	std::vector<uint32_t> samples(nsamples);
+	for (size_t i = 0; i < nsamples; i++)
+		samples[i] = lat_ring[i].us.load(std::memory_order_relaxed);
+
+	std::sort(samples.begin(), samples.end());
+	auto pct = [&](size_t p) {
+				return float(samples[std::min(nsamples - 1, nsamples * p / 100)]);
+			};
+	p50 = pct(50);
+	p90 = pct(90);
+	p99 = pct(99);
+}
+
+void MAVConnInterface::maybe_publish_snapshot()
+{
+	const uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			steady_clock::now().time_since_epoch()).count();
+	if (now - snap_last_ns < SNAP_INTERVAL_NS)
+		return;
+
+	const uint8_t idx = snap_active.load(std::memory_order_relaxed) ^ 1;
+	auto &s = snap_buf[idx];
+
+	// seqlock write: readers retry while the count is odd
+	auto seq = snap_seq[idx].load(std::memory_order_relaxed);
+	snap_seq[idx].store(seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	s.packet_rx_success_count = m_status.packet_rx_success_count;
+	s.packet_rx_drop_count = m_status.packet_rx_drop_count;
+	s.buffer_overrun = m_status.buffer_overrun;
+	s.parse_error = m_status.parse_error;
+	s.current_rx_seq = m_status.current_rx_seq;
+	s.current_tx_seq = m_status.current_tx_seq;
+
+	s.tx_total_bytes = tx_total_bytes.load(std::memory_order_relaxed);
+	s.rx_total_bytes = rx_total_bytes.load(std::memory_order_relaxed);
+	s.tx_dropped = tx_dropped.load(std::memory_order_relaxed);
+
+	// speed over the real interval since the last publish
+	const double dt_s = (snap_last_ns != 0) ? (now - snap_last_ns) / 1e9 : 0.0;
+	s.tx_speed = (dt_s > 0.0) ? (s.tx_total_bytes - snap_last_tx_bytes) / dt_s : 0.0;
+	s.rx_speed = (dt_s > 0.0) ? (s.rx_total_bytes - snap_last_rx_bytes) / dt_s : 0.0;
+
+	tx_latency_percentiles(s.tx_latency_p50_us, s.tx_latency_p90_us, s.tx_latency_p99_us);
+
+	snap_seq[idx].store(seq + 2, std::memory_order_release);
+	snap_active.store(idx, std::memory_order_release);
+
+	snap_last_ns = now;
+	snap_last_tx_bytes = s.tx_total_bytes;
+	snap_last_rx_bytes = s.rx_total_bytes;
+}
+
+bool MAVConnInterface::get_stat_snapshot(StatSnapshot &out)
+{
+	for (int attempt = 0; attempt < 16; attempt++) {
+		const uint8_t idx = snap_active.load(std::memory_order_acquire);
+		const auto s1 = snap_seq[idx].load(std::memory_order_acquire);
+
+		if (s1 == 0)
+			return false;	// nothing published yet
+		if (s1 & 1)
+			continue;	// write in flight
+
+		out = snap_buf[idx];
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (snap_seq[idx].load(std::memory_order_relaxed) == s1)
+			return true;
+	}
+
+	return false;	// pathological publish rate: caller falls back
+}
+
 void MAVConnInterface::iostat_tx_add(size_t bytes)
 {
 	tx_total_bytes += bytes;
+	maybe_publish_snapshot();
 }
 
 void MAVConnInterface::iostat_rx_add(size_t bytes)
@@ -92,10 +421,55 @@ void MAVConnInterface::iostat_rx_add(size_t bytes)
 	rx_total_bytes += bytes;
 }
 
+/**
+ * Find the next MAVLink STX candidate (v2 0xFD or v1 0xFE).
+ *
+ * Used to resynchronize framing on noisy links: instead of one full
+ * parser invocation per garbage byte this skips 16 bytes per step.
+ *
+ * @return number of bytes before the candidate (len if none found)
+ */
+static size_t resync_scan(const uint8_t *buf, size_t len)
+{
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	const __m128i stx2 = _mm_set1_epi8(char(MAVLINK_STX));
+	const __m128i stx1 = _mm_set1_epi8(char(MAVLINK_STX_MAVLINK1));
+
+	for (; i + 16 <= len; i += 16) {
+		__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf + i));
+		__m128i hit = _mm_or_si128(_mm_cmpeq_epi8(chunk, stx2), _mm_cmpeq_epi8(chunk, stx1));
+
+		int mask = _mm_movemask_epi8(hit);
+		if (mask != 0)
+			return i + __builtin_ctz(mask);
+	}
+#elif defined(__ARM_NEON)
+	const uint8x16_t stx2 = vdupq_n_u8(MAVLINK_STX);
+	const uint8x16_t stx1 = vdupq_n_u8(MAVLINK_STX_MAVLINK1);
+
+	for (; i + 16 <= len; i += 16) {
+		uint8x16_t chunk = vld1q_u8(buf + i);
+		uint8x16_t hit = vorrq_u8(vceqq_u8(chunk, stx2), vceqq_u8(chunk, stx1));
+
+		uint8x8_t nar = vorr_u8(vget_low_u8(hit), vget_high_u8(hit));
+		if (vget_lane_u64(vreinterpret_u64_u8(nar), 0) != 0)
+			break;	// hit in this chunk: tail loop finds the position
+	}
+#endif
+
+	for (; i < len; i++)
+		if (buf[i] == MAVLINK_STX || buf[i] == MAVLINK_STX_MAVLINK1)
+			return i;
+
+	return len;
+}
+
 void MAVConnInterface::parse_buffer(const char *pfx, uint8_t *buf, const size_t bufsize, size_t bytes_received)
 {
 	mavlink::mavlink_status_t status;
-	mavlink::mavlink_message_t message;
+	mavlink::mavlink_message_t scratch;
 
 	assert(bufsize >= bytes_received);
 
@@ -103,8 +477,28 @@ void MAVConnInterface::parse_buffer(const char *pfx, uint8_t *buf, const size_t
 	for (; bytes_received > 0; bytes_received--) {
 		auto c = *buf++;
 
+		// frame into a pooled slot so the delivery callback can
+		// borrow the message instead of copying it; fall back to
+		// the stack while all slots are borrowed
+		if (rx_slot == nullptr)
+			rx_slot = rx_pool.acquire();
+
+		auto *message = (rx_slot != nullptr) ? &rx_slot->msg : &scratch;
+
+		if (c != MAVLINK_STX && c != MAVLINK_STX_MAVLINK1 &&
+				(m_status.parse_state == mavlink::MAVLINK_PARSE_STATE_IDLE ||
+				m_status.parse_state == mavlink::MAVLINK_PARSE_STATE_UNINIT)) {
+			// the parser would discard this byte anyway: skip
+			// straight to the next STX candidate and let the
+			// parser validate the header from there
+			size_t skip = resync_scan(buf, bytes_received - 1);
+			buf += skip;
+			bytes_received -= skip;
+			continue;
+		}
+
 		// based on mavlink_parse_char()
-		auto msg_received = static_cast<Framing>(mavlink::mavlink_frame_char_buffer(&m_buffer, &m_status, c, &message, &status));
+		auto msg_received = static_cast<Framing>(mavlink::mavlink_frame_char_buffer(&m_buffer, &m_status, c, message, &status));
 		if (msg_received == Framing::bad_crc || msg_received == Framing::bad_signature) {
 			mavlink::_mav_parse_error(&m_status);
 			m_status.msg_received = mavlink::MAVLINK_FRAMING_INCOMPLETE;
@@ -117,16 +511,52 @@ void MAVConnInterface::parse_buffer(const char *pfx, uint8_t *buf, const size_t
 		}
 
 		if (msg_received != Framing::incomplete) {
-			log_recv(pfx, message, msg_received);
+			log_recv(pfx, *message, msg_received);
+			MAVCONN_TRACE3(msg_parsed, message->msgid, message->seq, conn_id);
+
+			if (msg_received == Framing::ok) {
+				iostat_rx_msg(message->msgid, BufferPool::wire_size(message));
+
+				// auto-negotiation: upgrade tx framing once the
+				// peer proves v2 — a v2 frame from it, or a
+				// capability report via set_peer_mavlink2()
+				if (protocol_auto.load(std::memory_order_relaxed) &&
+						(m_status.flags & MAVLINK_STATUS_FLAG_OUT_MAVLINK1)) {
+					if (message->magic == MAVLINK_STX)
+						peer_mavlink2.store(true, std::memory_order_relaxed);
+					if (peer_mavlink2.load(std::memory_order_relaxed)) {
+						m_status.flags &= ~(MAVLINK_STATUS_FLAG_OUT_MAVLINK1);
+						logInform("mavconn%zu: peer speaks MAVLink v2, switching tx framing", conn_id);
+					}
+				}
+			}
 
 			if (message_received_cb)
-				message_received_cb(&message, msg_received);
+				message_received_cb(message, msg_received);
+
+			// handler kept a borrow: hand the slot over and
+			// frame the next message into a fresh one
+			if (rx_slot != nullptr && rx_slot->refcnt.load(std::memory_order_relaxed) > 1) {
+				RxPool::unref(rx_slot);
+				rx_slot = nullptr;
+			}
 		}
 	}
+
+	maybe_publish_snapshot();
+}
+
+//! per-message logging must cost nothing while debug output is off
+static inline bool debug_log_enabled()
+{
+	return console_bridge::getLogLevel() <= console_bridge::CONSOLE_BRIDGE_LOG_DEBUG;
 }
 
 void MAVConnInterface::log_recv(const char *pfx, mavlink_message_t &msg, Framing framing)
 {
+	if (!debug_log_enabled())
+		return;
+
 	const char *framing_str = (framing == Framing::ok) ? "OK" :
 			(framing == Framing::bad_crc) ? "!CRC" :
 			(framing == Framing::bad_signature) ? "!SIG" : "ERR";
@@ -142,6 +572,9 @@ void MAVConnInterface::log_recv(const char *pfx, mavlink_message_t &msg, Framing
 
 void MAVConnInterface::log_send(const char *pfx, const mavlink_message_t *msg)
 {
+	if (!debug_log_enabled())
+		return;
+
 	const char *proto_version_str = (msg->magic == MAVLINK_STX) ? "v2.0" : "v1.0";
 
 	logDebug("%s%zu: send: %s Message-Id: %u [%u bytes] IDs: %u.%u Seq: %u",
@@ -152,13 +585,18 @@ void MAVConnInterface::log_send(const char *pfx, const mavlink_message_t *msg)
 
 void MAVConnInterface::log_send_obj(const char *pfx, const mavlink::Message &msg)
 {
+	// to_yaml() allocates and walks every field: never pay for it
+	// unless the text is actually going somewhere
+	if (!debug_log_enabled())
+		return;
+
 	logDebug("%s%zu: send: %s", pfx, conn_id, msg.to_yaml().c_str());
 }
 
-void MAVConnInterface::send_message_ignore_drop(const mavlink::mavlink_message_t *msg)
+void MAVConnInterface::send_message_ignore_drop(const mavlink::mavlink_message_t *msg, Priority prio)
 {
 	try {
-		send_message(msg);
+		send_message(msg, prio);
 	}
 	catch (std::length_error &e) {
 		logError(PFX "%zu: DROPPED Message-Id %u [%u bytes] IDs: %u.%u Seq: %u: %s",
@@ -168,10 +606,10 @@ void MAVConnInterface::send_message_ignore_drop(const mavlink::mavlink_message_t
 	}
 }
 
-void MAVConnInterface::send_message_ignore_drop(const mavlink::Message &msg)
+void MAVConnInterface::send_message_ignore_drop(const mavlink::Message &msg, Priority prio)
 {
 	try {
-		send_message(msg);
+		send_message(msg, prio);
 	}
 	catch (std::length_error &e) {
 		logError(PFX "%zu: DROPPED Message %s: %s",
@@ -181,6 +619,109 @@ void MAVConnInterface::send_message_ignore_drop(const mavlink::Message &msg)
 	}
 }
 
+size_t MAVConnInterface::register_periodic_tx(const mavlink::Message &message, float rate_hz)
+{
+	assert(rate_hz > 0.0f);
+
+	mavlink::mavlink_message_t msg;
+	mavlink::MsgMap map(msg);
+
+	auto mi = message.get_message_info();
+	message.serialize(map);
+
+	// one-time serialization: the generic helper path is fine here
+	auto status = m_status;
+	if (status.signing != nullptr) {
+		logWarn(PFX "%zu: periodic tx: retained %s frames are not signed",
+				conn_id, message.get_name().c_str());
+		status.signing = nullptr;
+	}
+	mavlink::mavlink_finalize_message_buffer(&msg, sys_id, comp_id, &status,
+			mi.min_length, mi.length, mi.crc_extra);
+
+	auto p = std::make_shared<PeriodicTx>(io_service());
+	p->owner = this;
+	p->frame.resize(BufferPool::wire_size(&msg));
+	mavlink::mavlink_msg_to_send_buffer(p->frame.data(), &msg);
+	p->seq_ofs = (p->frame[0] == MAVLINK_STX_MAVLINK1) ? 2 : 4;
+	p->crc_extra = mi.crc_extra;
+	p->period_ms = std::max<long>(1, long(1000.0f / rate_hz + 0.5f));
+
+	size_t handle;
+	{
+		std::lock_guard<std::mutex> lock(periodic_mutex);
+		periodic_txs.push_back(p);
+		handle = periodic_txs.size() - 1;
+	}
+
+	p->timer.expires_from_now(boost::posix_time::milliseconds(p->period_ms));
+	p->timer.async_wait([p](const boost::system::error_code &error) {
+				periodic_tick(error, p);
+			});
+
+	logInform(PFX "%zu: periodic tx: %s every %ld ms [%zu bytes retained]",
+			conn_id, message.get_name().c_str(), p->period_ms, p->frame.size());
+
+	return handle;
+}
+
+void MAVConnInterface::unregister_periodic_tx(size_t handle)
+{
+	std::shared_ptr<PeriodicTx> p;
+	{
+		std::lock_guard<std::mutex> lock(periodic_mutex);
+		if (handle >= periodic_txs.size() || !periodic_txs[handle])
+			return;
+
+		p.swap(periodic_txs[handle]);
+	}
+
+	// a beat in flight holds the mutex: after this no beat touches us
+	std::lock_guard<std::mutex> lock(p->mutex);
+	p->running = false;
+	p->timer.cancel();
+}
+
+void MAVConnInterface::periodic_tick(const boost::system::error_code &error,
+		std::shared_ptr<PeriodicTx> p)
+{
+	if (error)
+		return;	// cancelled
+
+	std::lock_guard<std::mutex> lock(p->mutex);
+	if (!p->running)
+		return;
+
+	auto *self = p->owner;
+
+	// only the sequence number and CRC change between beats
+	p->frame[p->seq_ofs] = self->next_tx_seq();
+
+	uint16_t crc = crc16::accumulate(X25_INIT_CRC, p->frame.data() + 1, p->frame.size() - 3);
+	crc = crc16::accumulate(crc, &p->crc_extra, 1);
+	p->frame[p->frame.size() - 2] = crc & 0xff;
+	p->frame[p->frame.size() - 1] = crc >> 8;
+
+	try {
+		self->send_bytes(p->frame.data(), p->frame.size(), Priority::REALTIME);
+	}
+	catch (std::length_error &e) {
+		self->iostat_tx_drop();
+	}
+
+	// drift-free schedule; after a long stall continue from now
+	// instead of bursting the missed beats
+	auto next = p->timer.expires_at() + boost::posix_time::milliseconds(p->period_ms);
+	auto now = boost::posix_time::microsec_clock::universal_time();
+	if (next < now)
+		next = now;
+
+	p->timer.expires_at(next);
+	p->timer.async_wait([p](const boost::system::error_code &error) {
+				periodic_tick(error, p);
+			});
+}
+
 void MAVConnInterface::set_protocol_version(Protocol pver)
 {
 	if (pver == Protocol::V10)
@@ -197,6 +738,21 @@ Protocol MAVConnInterface::get_protocol_version()
 		return Protocol::V20;
 }
 
+void MAVConnInterface::set_protocol_auto(bool enabled)
+{
+	protocol_auto.store(enabled, std::memory_order_relaxed);
+	if (enabled && !peer_mavlink2.load(std::memory_order_relaxed))
+		set_protocol_version(Protocol::V10);	// until the peer proves v2
+}
+
+void MAVConnInterface::set_peer_mavlink2(bool capable)
+{
+	// only record the fact here: the actual tx flag flip happens on
+	// the rx thread (see parse_buffer), which owns the parser status
+	if (capable)
+		peer_mavlink2.store(true, std::memory_order_relaxed);
+}
+
 /**
  * Parse host:port pairs
  */
@@ -234,37 +790,91 @@ static void url_parse_host(std::string host,
 }
 
 /**
- * Parse ?ids=sid,cid
+ * Parse ?ids=sid,cid&affinity=cpu[,cpu...]&rtprio=prio&busypoll=us
  */
-static void url_parse_query(std::string query, uint8_t &sysid, uint8_t &compid)
+static void url_parse_query(std::string query, uint8_t &sysid, uint8_t &compid,
+		unsigned *busy_poll_us = nullptr)
 {
-	const std::string ids_end("ids=");
-	std::string sys, comp;
+	std::vector<int> cpus;
+	int rtprio = 0;
 
 	if (query.empty())
 		return;
 
-	auto ids_it = std::search(query.begin(), query.end(),
-			ids_end.begin(), ids_end.end());
-	if (ids_it == query.end()) {
-		logWarn(PFX "URL: unknown query arguments");
-		return;
+	auto key_value = [](const std::string & arg, const std::string & key, std::string & value) {
+				if (arg.compare(0, key.size(), key) != 0)
+					return false;
+
+				value = arg.substr(key.size());
+				return true;
+			};
+
+	size_t pos = 0;
+	while (pos < query.size()) {
+		auto amp = query.find('&', pos);
+		if (amp == std::string::npos)
+			amp = query.size();
+
+		auto arg = query.substr(pos, amp - pos);
+		pos = amp + 1;
+
+		std::string value;
+		if (key_value(arg, "ids=", value)) {
+			auto comma = value.find(',');
+			if (comma == std::string::npos) {
+				logError(PFX "URL: no comma in ids= query");
+				continue;
+			}
+
+			sysid = std::stoi(value.substr(0, comma));
+			compid = std::stoi(value.substr(comma + 1));
+			logDebug(PFX "URL: found system/component id = [%u, %u]", sysid, compid);
+		}
+		else if (key_value(arg, "affinity=", value)) {
+			size_t vpos = 0;
+			while (vpos < value.size()) {
+				size_t used = 0;
+				cpus.push_back(std::stoi(value.substr(vpos), &used));
+				vpos += used + 1;
+			}
+		}
+		else if (key_value(arg, "rtprio=", value)) {
+			rtprio = std::stoi(value);
+		}
+		else if (key_value(arg, "busypoll=", value) && busy_poll_us != nullptr) {
+			*busy_poll_us = std::stoi(value);
+		}
+		else {
+			logWarn(PFX "URL: unknown query arguments");
+		}
 	}
 
-	std::advance(ids_it, ids_end.length());
-	auto comma_it = std::find(ids_it, query.end(), ',');
-	if (comma_it == query.end()) {
-		logError(PFX "URL: no comma in ids= query");
-		return;
+	if (!cpus.empty() || rtprio > 0) {
+		logInform(PFX "URL: applying io sched options (affinity: %zu cpus, rtprio: %d)",
+				cpus.size(), rtprio);
+		MAVConnInterface::apply_io_sched(cpus, rtprio);
 	}
+}
 
-	sys.assign(ids_it, comma_it);
-	comp.assign(comma_it + 1, query.end());
+//! extract and remove one "key=value" option; "" when absent
+static std::string url_take_option(std::string &query, const std::string &key)
+{
+	size_t pos = 0;
+	while (pos < query.size()) {
+		auto amp = query.find('&', pos);
+		if (amp == std::string::npos)
+			amp = query.size();
+
+		if (query.compare(pos, key.size(), key) == 0) {
+			auto value = query.substr(pos + key.size(), amp - pos - key.size());
+			query.erase(pos, std::min(amp + 1, query.size()) - pos);
+			return value;
+		}
 
-	sysid = std::stoi(sys);
-	compid = std::stoi(comp);
+		pos = amp + 1;
+	}
 
-	logDebug(PFX "URL: found system/component id = [%u, %u]", sysid, compid);
+	return "";
 }
 
 static MAVConnInterface::Ptr url_parse_serial(
@@ -274,12 +884,30 @@ static MAVConnInterface::Ptr url_parse_serial(
 	std::string file_path;
 	int baudrate;
 
-	// /dev/ttyACM0:57600
+	// /dev/ttyACM0:57600?backend=raw
+	unsigned busy_poll_us = 0;
 	url_parse_host(path, file_path, baudrate, MAVConnSerial::DEFAULT_DEVICE, MAVConnSerial::DEFAULT_BAUDRATE);
-	url_parse_query(query, system_id, component_id);
-
-	return std::make_shared<MAVConnSerial>(system_id, component_id,
-			file_path, baudrate, hwflow);
+	std::string backend = url_take_option(query, "backend=");
+	url_parse_query(query, system_id, component_id, &busy_poll_us);
+
+	MAVConnInterface::Ptr conn;
+#ifdef __linux__
+	if (backend == "raw")
+		// epoll/termios backend: no asio reactor hop on the rx path
+		conn = std::make_shared<MAVConnSerialRaw>(system_id, component_id,
+				file_path, baudrate, hwflow);
+#else
+	if (backend == "raw")
+		throw DeviceError("url", "serial backend=raw is Linux only");
+#endif
+	else if (!backend.empty() && backend != "asio")
+		logWarn(PFX "URL: unknown serial backend '%s', using asio", backend.c_str());
+
+	if (!conn)
+		conn = std::make_shared<MAVConnSerial>(system_id, component_id,
+				file_path, baudrate, hwflow);
+	conn->set_busy_poll(busy_poll_us);
+	return conn;
 }
 
 static MAVConnInterface::Ptr url_parse_udp(
@@ -301,15 +929,18 @@ static MAVConnInterface::Ptr url_parse_udp(
 
 	// udp://0.0.0.0:14555@:14550
 	url_parse_host(bind_pair, bind_host, bind_port, "0.0.0.0", MAVConnUDP::DEFAULT_BIND_PORT);
+	unsigned busy_poll_us = 0;
 	url_parse_host(remote_pair, remote_host, remote_port, MAVConnUDP::DEFAULT_REMOTE_HOST, MAVConnUDP::DEFAULT_REMOTE_PORT);
-	url_parse_query(query, system_id, component_id);
+	url_parse_query(query, system_id, component_id, &busy_poll_us);
 
 	if (is_udpb)
 		remote_host = MAVConnUDP::BROADCAST_REMOTE_HOST;
 
-	return std::make_shared<MAVConnUDP>(system_id, component_id,
+	auto conn = std::make_shared<MAVConnUDP>(system_id, component_id,
 			bind_host, bind_port,
 			remote_host, remote_port);
+	conn->set_busy_poll(busy_poll_us);
+	return conn;
 }
 
 static MAVConnInterface::Ptr url_parse_tcp_client(
@@ -327,6 +958,35 @@ static MAVConnInterface::Ptr url_parse_tcp_client(
 			server_host, server_port);
 }
 
+#ifdef HAVE_ZSTD
+static MAVConnInterface::Ptr url_parse_tcpz(
+		std::string host, std::string query,
+		uint8_t system_id, uint8_t component_id, bool listen)
+{
+	std::string peer_host;
+	int peer_port;
+
+	// tcpz://relay:5790?zlevel=3&flush_ms=5&dict=/path
+	url_parse_host(host, peer_host, peer_port, MAVConnTCPZ::DEFAULT_HOST, MAVConnTCPZ::DEFAULT_PORT);
+
+	unsigned flush_ms = MAVConnTCPZ::DEFAULT_FLUSH_MS;
+	int level = MAVConnTCPZ::DEFAULT_LEVEL;
+
+	auto value = url_take_option(query, "flush_ms=");
+	if (!value.empty())
+		flush_ms = std::stoi(value);
+	value = url_take_option(query, "zlevel=");
+	if (!value.empty())
+		level = std::stoi(value);
+	std::string dict_path = url_take_option(query, "dict=");
+
+	url_parse_query(query, system_id, component_id);
+
+	return std::make_shared<MAVConnTCPZ>(system_id, component_id,
+			peer_host, peer_port, listen, flush_ms, level, dict_path);
+}
+#endif
+
 static MAVConnInterface::Ptr url_parse_tcp_server(
 		std::string host, std::string query,
 		uint8_t system_id, uint8_t component_id)
@@ -396,6 +1056,15 @@ MAVConnInterface::Ptr MAVConnInterface::open_url(std::string url,
 		return url_parse_tcp_client(host, query, system_id, component_id);
 	else if (proto == "tcp-l")
 		return url_parse_tcp_server(host, query, system_id, component_id);
+#ifdef HAVE_ZSTD
+	else if (proto == "tcpz")
+		return url_parse_tcpz(host, query, system_id, component_id, false);
+	else if (proto == "tcpz-l")
+		return url_parse_tcpz(host, query, system_id, component_id, true);
+#else
+	else if (proto == "tcpz" || proto == "tcpz-l")
+		throw DeviceError("url", "tcpz support not built (libzstd missing)");
+#endif
 	else if (proto == "serial")
 		return url_parse_serial(path, query, system_id, component_id, false);
 	else if (proto == "serial-hwfc")
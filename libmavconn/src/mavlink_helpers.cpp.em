@@ -20,6 +20,8 @@
 @# EmPy template of dialect helpers source file
 @#
 
+#include <cstring>
+#include <algorithm>
 #include <console_bridge/console.h>
 #include <mavconn/interface.h>
 
@@ -30,12 +32,16 @@ using mavconn::MAVConnInterface;
 
 void MAVConnInterface::init_msg_entry()
 {
-	logDebug("mavconn: Initialize message_entries map");
+	logDebug("mavconn: Initialize message_entries table");
 
 	auto load = [&](const char *dialect, const mavlink::mavlink_msg_entry_t & e) {
-		auto it = message_entries.find(e.msgid);
-		if (it != message_entries.end()) {
-			if (memcmp(&e, it->second, sizeof(e)) != 0) {
+		// keep the table sorted by msgid while merging dialects
+		auto it = std::lower_bound(message_entries.begin(), message_entries.end(), e.msgid,
+				[](const mavlink::mavlink_msg_entry_t *p, uint32_t msgid) {
+					return p->msgid < msgid;
+				});
+		if (it != message_entries.end() && (*it)->msgid == e.msgid) {
+			if (memcmp(&e, *it, sizeof(e)) != 0) {
 				logWarn("mavconn: init: message from %s, MSG-ID %d ignored! Table has different entry.", dialect, e.msgid);
 			}
 			else {
@@ -44,7 +50,7 @@ void MAVConnInterface::init_msg_entry()
 		}
 		else {
 			logDebug("mavconn: init: add message entry for %s, MSG-ID %d", dialect, e.msgid);
-			message_entries[e.msgid] = &e;
+			message_entries.insert(it, &e);
 		}
 	};
 
@@ -62,12 +68,22 @@ std::vector<std::string> MAVConnInterface::get_known_dialects()
 
 /**
  * Internal function to give access to message information such as additional crc byte.
+ *
+ * Called for every framed packet's CRC check: branchless binary search
+ * over the msgid-sorted table, no hashing on the rx hot path.
  */
 const mavlink::mavlink_msg_entry_t* mavlink::mavlink_get_msg_entry(uint32_t msgid)
 {
-	auto it = MAVConnInterface::message_entries.find(msgid);
-	if (it != MAVConnInterface::message_entries.end())
-		return it->second;
-	else
-		return nullptr;
+	auto &table = MAVConnInterface::message_entries;
+
+	const mavlink::mavlink_msg_entry_t *const *base = table.data();
+	size_t len = table.size();
+	while (len > 1) {
+		size_t half = len / 2;
+		// conditional move instead of a hard-to-predict branch
+		base += (base[half - 1]->msgid < msgid) ? half : 0;
+		len -= half;
+	}
+
+	return (len != 0 && (*base)->msgid == msgid) ? *base : nullptr;
 }
@@ -15,7 +15,10 @@
  * https://github.com/mavlink/mavros/tree/master/LICENSE.md
  */
 
+#include <cerrno>
 #include <cassert>
+#include <unistd.h>
+#include <algorithm>
 #include <console_bridge/console.h>
 
 #include <mavconn/thread_utils.h>
@@ -38,8 +41,8 @@ MAVConnSerial::MAVConnSerial(uint8_t system_id, uint8_t component_id,
 	tx_in_progress(false),
 	tx_q {},
 	rx_buf {},
-	io_service(),
-	serial_dev(io_service)
+	strand(MAVConnInterface::io_service()),
+	serial_dev(MAVConnInterface::io_service())
 {
 	using SPB = boost::asio::serial_port_base;
 
@@ -61,14 +64,8 @@ MAVConnSerial::MAVConnSerial(uint8_t system_id, uint8_t component_id,
 
 	// NOTE: shared_from_this() should not be used in constructors
 
-	// give some work to io_service before start
-	io_service.post(std::bind(&MAVConnSerial::do_read, this));
-
-	// run io_service for async io
-	io_thread = std::thread([this] () {
-				utils::set_this_thread_name("mserial%zu", conn_id);
-				io_service.run();
-			});
+	// start reading on the shared io pool
+	strand.post(std::bind(&MAVConnSerial::do_read, this));
 }
 
 MAVConnSerial::~MAVConnSerial()
@@ -82,35 +79,36 @@ void MAVConnSerial::close()
 	if (!is_open())
 		return;
 
-	io_service.stop();
 	serial_dev.close();
 
-	if (io_thread.joinable())
-		io_thread.join();
+	// recycle buffers still queued at teardown
+	while (auto *bufp = tx_q.front()) {
+		tx_q.pop();
+		pool.release(bufp);
+	}
 
 	if (port_closed_cb)
 		port_closed_cb();
 }
 
-void MAVConnSerial::send_bytes(const uint8_t *bytes, size_t length)
+void MAVConnSerial::send_bytes(const uint8_t *bytes, size_t length, Priority prio)
 {
 	if (!is_open()) {
 		logError(PFXd "send: channel closed!", conn_id);
 		return;
 	}
 
-	{
-		lock_guard lock(mutex);
-
-		if (tx_q.size() >= MAX_TXQ_SIZE)
-			throw std::length_error("MAVConnSerial::send_bytes: TX queue overflow");
-
-		tx_q.emplace_back(bytes, length);
+	auto *bufp = pool.make(bytes, length);
+	if (!tx_q.push(bufp, prio)) {
+		pool.release(bufp);
+		iostat_tx_drop();
+		throw std::length_error("MAVConnSerial::send_bytes: TX queue overflow");
 	}
-	io_service.post(std::bind(&MAVConnSerial::do_write, shared_from_this(), true));
+
+	strand.post(std::bind(&MAVConnSerial::do_write, shared_from_this(), true));
 }
 
-void MAVConnSerial::send_message(const mavlink_message_t *message)
+void MAVConnSerial::send_message(const mavlink_message_t *message, Priority prio)
 {
 	assert(message != nullptr);
 
@@ -121,18 +119,18 @@ void MAVConnSerial::send_message(const mavlink_message_t *message)
 
 	log_send(PFX, message);
 
-	{
-		lock_guard lock(mutex);
-
-		if (tx_q.size() >= MAX_TXQ_SIZE)
-			throw std::length_error("MAVConnSerial::send_message: TX queue overflow");
-
-		tx_q.emplace_back(message);
+	auto *bufp = pool.make(message);
+	iostat_tx_msg(message->msgid, bufp->len);
+	if (!tx_q.push(bufp, prio)) {
+		pool.release(bufp);
+		iostat_tx_drop();
+		throw std::length_error("MAVConnSerial::send_message: TX queue overflow");
 	}
-	io_service.post(std::bind(&MAVConnSerial::do_write, shared_from_this(), true));
+
+	strand.post(std::bind(&MAVConnSerial::do_write, shared_from_this(), true));
 }
 
-void MAVConnSerial::send_message(const mavlink::Message &message)
+void MAVConnSerial::send_message(const mavlink::Message &message, Priority prio)
 {
 	if (!is_open()) {
 		logError(PFXd "send: channel closed!", conn_id);
@@ -141,15 +139,22 @@ void MAVConnSerial::send_message(const mavlink::Message &message)
 
 	log_send_obj(PFX, message);
 
-	{
-		lock_guard lock(mutex);
+	auto *bufp = pool.make(message, get_status_p(), next_tx_seq(), sys_id, comp_id, auto_framing());
+	iostat_tx_msg(message.get_message_info().id, bufp->len);
+	if (!tx_q.push(bufp, prio)) {
+		pool.release(bufp);
+		iostat_tx_drop();
+		throw std::length_error("MAVConnSerial::send_message: TX queue overflow");
+	}
+
+	strand.post(std::bind(&MAVConnSerial::do_write, shared_from_this(), true));
+}
 
-		if (tx_q.size() >= MAX_TXQ_SIZE)
-			throw std::length_error("MAVConnSerial::send_message: TX queue overflow");
 
-		tx_q.emplace_back(message, get_status_p(), sys_id, comp_id);
-	}
-	io_service.post(std::bind(&MAVConnSerial::do_write, shared_from_this(), true));
+void MAVConnSerial::set_link_txbuf(uint8_t free_percent)
+{
+	tx_q.set_txbuf(free_percent);
+	iostat_tx_drop(tx_q.take_shed());
 }
 
 void MAVConnSerial::do_read(void)
@@ -157,7 +162,7 @@ void MAVConnSerial::do_read(void)
 	auto sthis = shared_from_this();
 	serial_dev.async_read_some(
 			buffer(rx_buf),
-			[sthis] (error_code error, size_t bytes_transferred) {
+			strand.wrap([sthis] (error_code error, size_t bytes_transferred) {
 				if (error) {
 					logError(PFXd "receive: %s", sthis->conn_id, error.message().c_str());
 					sthis->close();
@@ -165,8 +170,34 @@ void MAVConnSerial::do_read(void)
 				}
 
 				sthis->parse_buffer(PFX, sthis->rx_buf.data(), sthis->rx_buf.size(), bytes_transferred);
+				sthis->busy_poll_read();
 				sthis->do_read();
-			});
+			}));
+}
+
+void MAVConnSerial::busy_poll_read()
+{
+	unsigned window_us = get_busy_poll();
+	if (window_us == 0)
+		return;
+
+	// adaptive busy poll: data just arrived, more likely follows.
+	// Spin on the non-blocking fd for the window; every hit skips a
+	// reactor wakeup and restarts the window.
+	auto deadline = steady_clock::now() + std::chrono::microseconds(window_us);
+	while (steady_clock::now() < deadline) {
+		auto n = ::read(serial_dev.native_handle(), rx_buf.data(), rx_buf.size());
+		if (n > 0) {
+			parse_buffer(PFX, rx_buf.data(), rx_buf.size(), n);
+			deadline = steady_clock::now() + std::chrono::microseconds(window_us);
+			continue;
+		}
+
+		if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+			return;	// let the async path report the error
+
+		utils::cpu_relax();
+	}
 }
 
 void MAVConnSerial::do_write(bool check_tx_state)
@@ -174,18 +205,28 @@ void MAVConnSerial::do_write(bool check_tx_state)
 	if (check_tx_state && tx_in_progress)
 		return;
 
-	lock_guard lock(mutex);
-	if (tx_q.empty())
+	// NOTE: tx_q consumer side is only touched from the connection
+	// strand, so no lock is needed here.
+	// Coalesce up to MAX_GATHER queued buffers into one gathered
+	// write: one syscall and one completion round-trip per burst.
+	tx_gather.fill(boost::asio::const_buffer());
+	size_t count = 0;
+	while (count < MAX_GATHER) {
+		auto *bufp = tx_q.peek(count);
+		if (bufp == nullptr)
+			break;
+
+		tx_gather[count] = boost::asio::const_buffer(bufp->dpos(), bufp->nbytes());
+		count++;
+	}
+	if (count == 0)
 		return;
 
 	tx_in_progress = true;
 	auto sthis = shared_from_this();
-	auto &buf_ref = tx_q.front();
 	serial_dev.async_write_some(
-			buffer(buf_ref.dpos(), buf_ref.nbytes()),
-			[sthis, &buf_ref] (error_code error, size_t bytes_transferred) {
-				assert(bytes_transferred <= buf_ref.len);
-
+			tx_gather,
+			strand.wrap([sthis] (error_code error, size_t bytes_transferred) {
 				if (error) {
 					logError(PFXd "write: %s", sthis->conn_id, error.message().c_str());
 					sthis->close();
@@ -193,22 +234,28 @@ void MAVConnSerial::do_write(bool check_tx_state)
 				}
 
 				sthis->iostat_tx_add(bytes_transferred);
-				lock_guard lock(sthis->mutex);
-
-				if (sthis->tx_q.empty()) {
-					sthis->tx_in_progress = false;
-					return;
-				}
 
-				buf_ref.pos += bytes_transferred;
-				if (buf_ref.nbytes() == 0) {
-					sthis->tx_q.pop_front();
+				// release fully transmitted buffers,
+				// account partial write into the first unsent one
+				while (bytes_transferred > 0) {
+					auto *bufp = sthis->tx_q.front();
+					assert(bufp != nullptr);
+
+					auto n = std::min<size_t>(bytes_transferred, bufp->nbytes());
+					bufp->pos += n;
+					bytes_transferred -= n;
+
+					if (bufp->nbytes() == 0) {
+						sthis->iostat_tx_latency(bufp->stamp_ns);
+						sthis->tx_q.pop();
+						sthis->pool.release(bufp);
+					}
 				}
 
 				if (!sthis->tx_q.empty())
 					sthis->do_write(false);
 				else
 					sthis->tx_in_progress = false;
-			});
+			}));
 }
 }	// namespace mavconn
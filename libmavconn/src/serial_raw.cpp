@@ -0,0 +1,407 @@
+/**
+ * @brief MAVConn raw epoll serial link class
+ * @file serial_raw.cpp
+ *
+ * @addtogroup mavconn
+ * @{
+ */
+/*
+ * libmavconn
+ *
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+
+#ifdef __linux__
+
+#include <cerrno>
+#include <ctime>
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <console_bridge/console.h>
+
+#include <mavconn/thread_utils.h>
+#include <mavconn/serial_raw.h>
+
+namespace mavconn {
+using mavlink::mavlink_message_t;
+
+
+#define PFX	"mavconn: serial_raw"
+#define PFXd	PFX "%zu: "
+
+
+static speed_t baud_to_speed(unsigned baudrate)
+{
+	switch (baudrate) {
+	case 9600:	return B9600;
+	case 19200:	return B19200;
+	case 38400:	return B38400;
+	case 57600:	return B57600;
+	case 115200:	return B115200;
+	case 230400:	return B230400;
+	case 460800:	return B460800;
+	case 500000:	return B500000;
+	case 921600:	return B921600;
+	case 1500000:	return B1500000;
+	case 3000000:	return B3000000;
+	default:	return B0;
+	}
+}
+
+MAVConnSerialRaw::MAVConnSerialRaw(uint8_t system_id, uint8_t component_id,
+		std::string device, unsigned baudrate, bool hwflow) :
+	MAVConnInterface(system_id, component_id),
+	fd(-1),
+	epoll_fd(-1),
+	event_fd(-1),
+	running(false),
+	tx_armed(false),
+	tx_q {},
+	rx_buf {}
+{
+	logInform(PFXd "device: %s @ %d bps", conn_id, device.c_str(), baudrate);
+
+	speed_t speed = baud_to_speed(baudrate);
+	if (speed == B0)
+		throw DeviceError("serial_raw", "unsupported baudrate");
+
+	fd = ::open(device.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+	if (fd < 0)
+		throw DeviceError("serial_raw: open", errno);
+
+	struct termios tio;
+	if (::tcgetattr(fd, &tio) < 0) {
+		auto err = errno;
+		::close(fd);
+		throw DeviceError("serial_raw: tcgetattr", err);
+	}
+
+	::cfmakeraw(&tio);
+	tio.c_cc[VMIN] = 0;
+	tio.c_cc[VTIME] = 0;
+	if (hwflow)
+		tio.c_cflag |= CRTSCTS;
+	else
+		tio.c_cflag &= ~CRTSCTS;
+	::cfsetispeed(&tio, speed);
+	::cfsetospeed(&tio, speed);
+
+	if (::tcsetattr(fd, TCSANOW, &tio) < 0) {
+		auto err = errno;
+		::close(fd);
+		throw DeviceError("serial_raw: tcsetattr", err);
+	}
+	::tcflush(fd, TCIOFLUSH);
+
+	event_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+	if (event_fd < 0 || epoll_fd < 0) {
+		auto err = errno;
+		if (event_fd >= 0)
+			::close(event_fd);
+		if (epoll_fd >= 0)
+			::close(epoll_fd);
+		::close(fd);
+		throw DeviceError("serial_raw: epoll", err);
+	}
+
+	struct epoll_event ev {};
+	ev.events = EPOLLIN;
+	ev.data.fd = fd;
+	::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+	ev.data.fd = event_fd;
+	::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, event_fd, &ev);
+
+	running = true;
+	io_thread = std::thread(&MAVConnSerialRaw::io_loop, this);
+}
+
+MAVConnSerialRaw::~MAVConnSerialRaw()
+{
+	close();
+}
+
+void MAVConnSerialRaw::close()
+{
+	lock_guard lock(mutex);
+	if (fd < 0)
+		return;
+
+	running = false;
+	kick();
+	if (io_thread.joinable())
+		io_thread.join();
+
+	::close(fd);
+	fd = -1;
+	::close(epoll_fd);
+	::close(event_fd);
+
+	// recycle buffers still queued at teardown
+	while (auto *bufp = tx_q.front()) {
+		tx_q.pop();
+		pool.release(bufp);
+	}
+
+	if (port_closed_cb)
+		port_closed_cb();
+}
+
+void MAVConnSerialRaw::kick()
+{
+	uint64_t one = 1;
+	if (::write(event_fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+		logError(PFXd "kick: %s", conn_id, ::strerror(errno));
+}
+
+void MAVConnSerialRaw::send_bytes(const uint8_t *bytes, size_t length, Priority prio)
+{
+	if (!is_open()) {
+		logError(PFXd "send: channel closed!", conn_id);
+		return;
+	}
+
+	auto *bufp = pool.make(bytes, length);
+	if (!tx_q.push(bufp, prio)) {
+		pool.release(bufp);
+		iostat_tx_drop();
+		throw std::length_error("MAVConnSerialRaw::send_bytes: TX queue overflow");
+	}
+
+	kick();
+}
+
+void MAVConnSerialRaw::send_message(const mavlink_message_t *message, Priority prio)
+{
+	assert(message != nullptr);
+
+	if (!is_open()) {
+		logError(PFXd "send: channel closed!", conn_id);
+		return;
+	}
+
+	log_send(PFX, message);
+
+	auto *bufp = pool.make(message);
+	iostat_tx_msg(message->msgid, bufp->len);
+	if (!tx_q.push(bufp, prio)) {
+		pool.release(bufp);
+		iostat_tx_drop();
+		throw std::length_error("MAVConnSerialRaw::send_message: TX queue overflow");
+	}
+
+	kick();
+}
+
+void MAVConnSerialRaw::send_message(const mavlink::Message &message, Priority prio)
+{
+	if (!is_open()) {
+		logError(PFXd "send: channel closed!", conn_id);
+		return;
+	}
+
+	log_send_obj(PFX, message);
+
+	auto *bufp = pool.make(message, get_status_p(), next_tx_seq(), sys_id, comp_id, auto_framing());
+	iostat_tx_msg(message.get_message_info().id, bufp->len);
+	if (!tx_q.push(bufp, prio)) {
+		pool.release(bufp);
+		iostat_tx_drop();
+		throw std::length_error("MAVConnSerialRaw::send_message: TX queue overflow");
+	}
+
+	kick();
+}
+
+void MAVConnSerialRaw::set_link_txbuf(uint8_t free_percent)
+{
+	tx_q.set_txbuf(free_percent);
+	iostat_tx_drop(tx_q.take_shed());
+}
+
+void MAVConnSerialRaw::arm_tx(bool enable)
+{
+	if (enable == tx_armed)
+		return;
+
+	struct epoll_event ev {};
+	ev.events = EPOLLIN | (enable ? EPOLLOUT : 0);
+	ev.data.fd = fd;
+	::epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+	tx_armed = enable;
+}
+
+void MAVConnSerialRaw::io_loop()
+{
+	utils::set_this_thread_name("mser_raw%zu", conn_id);
+
+	struct epoll_event events[4];
+
+	while (running) {
+		int n = ::epoll_wait(epoll_fd, events, 4, -1);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			logError(PFXd "epoll_wait: %s", conn_id, ::strerror(errno));
+			break;
+		}
+
+		// receive stamp at the wakeup, before reads and parsing —
+		// the closest this backend gets to the kernel rx time
+		struct timespec ts;
+		::clock_gettime(CLOCK_REALTIME, &ts);
+		rx_kernel_stamp_ns.store(
+				uint64_t(ts.tv_sec) * 1000000000ULL + ts.tv_nsec,
+				std::memory_order_relaxed);
+
+		bool can_rx = false;
+		bool want_tx = false;
+
+		for (int i = 0; i < n; i++) {
+			if (events[i].data.fd == event_fd) {
+				uint64_t cnt;
+				while (::read(event_fd, &cnt, sizeof(cnt)) > 0)
+					;	// drain the kick counter
+				want_tx = true;
+			}
+			else {
+				if (events[i].events & EPOLLIN)
+					can_rx = true;
+				if (events[i].events & EPOLLOUT)
+					want_tx = true;
+				if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+					logError(PFXd "tty error/hangup", conn_id);
+					running = false;
+					if (port_closed_cb)
+						port_closed_cb();
+					return;
+				}
+			}
+		}
+
+		if (can_rx) {
+			if (!do_read())
+				return;
+			busy_poll_read();
+		}
+
+		if (want_tx || tx_armed) {
+			// writes go to the tty straight from the priority
+			// queue drain; EPOLLOUT only while the tty pushes back
+			arm_tx(!do_write());
+		}
+	}
+}
+
+//! @return false on fatal tty error (loop must exit)
+bool MAVConnSerialRaw::do_read()
+{
+	for (;;) {
+		ssize_t n = ::read(fd, rx_buf.data(), rx_buf.size());
+		if (n > 0) {
+			parse_buffer(PFX, rx_buf.data(), rx_buf.size(), n);
+			continue;
+		}
+
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			return true;
+		if (n < 0 && errno == EINTR)
+			continue;
+
+		logError(PFXd "receive: %s", conn_id,
+				(n == 0) ? "device gone" : ::strerror(errno));
+		running = false;
+		if (port_closed_cb)
+			port_closed_cb();
+		return false;
+	}
+}
+
+void MAVConnSerialRaw::busy_poll_read()
+{
+	unsigned window_us = get_busy_poll();
+	if (window_us == 0)
+		return;
+
+	// adaptive busy poll: data just arrived, more likely follows.
+	// Every hit skips an epoll wakeup and restarts the window.
+	auto deadline = steady_clock::now() + std::chrono::microseconds(window_us);
+	while (steady_clock::now() < deadline) {
+		ssize_t n = ::read(fd, rx_buf.data(), rx_buf.size());
+		if (n > 0) {
+			parse_buffer(PFX, rx_buf.data(), rx_buf.size(), n);
+			deadline = steady_clock::now() + std::chrono::microseconds(window_us);
+			continue;
+		}
+
+		if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+			return;	// let the epoll path report the error
+
+		utils::cpu_relax();
+	}
+}
+
+bool MAVConnSerialRaw::do_write()
+{
+	for (;;) {
+		struct iovec iov[MAX_GATHER];
+		size_t count = 0;
+
+		while (count < MAX_GATHER) {
+			auto *bufp = tx_q.peek(count);
+			if (bufp == nullptr)
+				break;
+
+			iov[count].iov_base = bufp->dpos();
+			iov[count].iov_len = bufp->nbytes();
+			count++;
+		}
+		if (count == 0)
+			return true;
+
+		ssize_t n = ::writev(fd, iov, count);
+		if (n < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return false;
+			if (errno == EINTR)
+				continue;
+
+			logError(PFXd "write: %s", conn_id, ::strerror(errno));
+			running = false;
+			if (port_closed_cb)
+				port_closed_cb();
+			return true;
+		}
+
+		iostat_tx_add(n);
+
+		// release fully transmitted buffers,
+		// account partial write into the first unsent one
+		while (n > 0) {
+			auto *bufp = tx_q.front();
+			assert(bufp != nullptr);
+
+			auto m = std::min<size_t>(n, bufp->nbytes());
+			bufp->pos += m;
+			n -= m;
+
+			if (bufp->nbytes() == 0) {
+				iostat_tx_latency(bufp->stamp_ns);
+				tx_q.pop();
+				pool.release(bufp);
+			}
+		}
+	}
+}
+}	// namespace mavconn
+
+#endif	// __linux__
@@ -16,6 +16,7 @@
  */
 
 #include <cassert>
+#include <algorithm>
 #include <console_bridge/console.h>
 
 #include <mavconn/thread_utils.h>
@@ -64,13 +65,13 @@ MAVConnTCPClient::MAVConnTCPClient(uint8_t system_id, uint8_t component_id,
 		std::string server_host, unsigned short server_port) :
 	MAVConnInterface(system_id, component_id),
 	tx_in_progress(false),
+	tx_front_pos(0),
 	tx_q {},
 	rx_buf {},
-	io_service(),
-	io_work(new io_service::work(io_service)),
-	socket(io_service)
+	strand(MAVConnInterface::io_service()),
+	socket(MAVConnInterface::io_service())
 {
-	if (!resolve_address_tcp(io_service, conn_id, server_host, server_port, server_ep))
+	if (!resolve_address_tcp(MAVConnInterface::io_service(), conn_id, server_host, server_port, server_ep))
 		throw DeviceError("tcp: resolve", "Bind address resolve failed");
 
 	logInform(PFXd "Server address: %s", conn_id, to_string_ss(server_ep).c_str());
@@ -85,22 +86,18 @@ MAVConnTCPClient::MAVConnTCPClient(uint8_t system_id, uint8_t component_id,
 
 	// NOTE: shared_from_this() should not be used in constructors
 
-	// give some work to io_service before start
-	io_service.post(std::bind(&MAVConnTCPClient::do_recv, this));
-
-	// run io_service for async io
-	io_thread = std::thread([this] () {
-				utils::set_this_thread_name("mtcp%zu", conn_id);
-				io_service.run();
-			});
+	// start reading on the shared io pool
+	strand.post(std::bind(&MAVConnTCPClient::do_recv, this));
 }
 
 MAVConnTCPClient::MAVConnTCPClient(uint8_t system_id, uint8_t component_id,
 		boost::asio::io_service &server_io) :
 	MAVConnInterface(system_id, component_id),
 	tx_in_progress(false),
+	tx_front_pos(0),
 	tx_q {},
 	rx_buf {},
+	strand(server_io),
 	socket(server_io)
 {
 	// waiting when server call client_connected()
@@ -112,7 +109,7 @@ void MAVConnTCPClient::client_connected(size_t server_channel)
 			server_channel, conn_id, to_string_ss(server_ep).c_str());
 
 	// start recv
-	socket.get_io_service().post(std::bind(&MAVConnTCPClient::do_recv, shared_from_this()));
+	strand.post(std::bind(&MAVConnTCPClient::do_recv, shared_from_this()));
 }
 
 MAVConnTCPClient::~MAVConnTCPClient()
@@ -126,36 +123,37 @@ void MAVConnTCPClient::close()
 	if (!is_open())
 		return;
 
-	io_work.reset();
-	io_service.stop();
 	socket.close();
 
-	if (io_thread.joinable())
-		io_thread.join();
+	// recycle buffers still queued at teardown
+	while (auto *bufp = tx_q.front()) {
+		tx_q.pop();
+		BufferPool::release(bufp);
+	}
+	tx_front_pos = 0;
 
 	if (port_closed_cb)
 		port_closed_cb();
 }
 
-void MAVConnTCPClient::send_bytes(const uint8_t *bytes, size_t length)
+void MAVConnTCPClient::send_bytes(const uint8_t *bytes, size_t length, Priority prio)
 {
 	if (!is_open()) {
 		logError(PFXd "send: channel closed!", conn_id);
 		return;
 	}
 
-	{
-		lock_guard lock(mutex);
-
-		if (tx_q.size() >= MAX_TXQ_SIZE)
-			throw std::length_error("MAVConnTCPClient::send_bytes: TX queue overflow");
-
-		tx_q.emplace_back(bytes, length);
+	auto *bufp = pool.make(bytes, length);
+	if (!tx_q.push(bufp, prio)) {
+		pool.release(bufp);
+		iostat_tx_drop();
+		throw std::length_error("MAVConnTCPClient::send_bytes: TX queue overflow");
 	}
-	socket.get_io_service().post(std::bind(&MAVConnTCPClient::do_send, shared_from_this(), true));
+
+	strand.post(std::bind(&MAVConnTCPClient::do_send, shared_from_this(), true));
 }
 
-void MAVConnTCPClient::send_message(const mavlink_message_t *message)
+void MAVConnTCPClient::send_message(const mavlink_message_t *message, Priority prio)
 {
 	assert(message != nullptr);
 
@@ -166,18 +164,18 @@ void MAVConnTCPClient::send_message(const mavlink_message_t *message)
 
 	log_send(PFX, message);
 
-	{
-		lock_guard lock(mutex);
-
-		if (tx_q.size() >= MAX_TXQ_SIZE)
-			throw std::length_error("MAVConnTCPClient::send_message: TX queue overflow");
-
-		tx_q.emplace_back(message);
+	auto *bufp = pool.make(message);
+	iostat_tx_msg(message->msgid, bufp->len);
+	if (!tx_q.push(bufp, prio)) {
+		pool.release(bufp);
+		iostat_tx_drop();
+		throw std::length_error("MAVConnTCPClient::send_message: TX queue overflow");
 	}
-	socket.get_io_service().post(std::bind(&MAVConnTCPClient::do_send, shared_from_this(), true));
+
+	strand.post(std::bind(&MAVConnTCPClient::do_send, shared_from_this(), true));
 }
 
-void MAVConnTCPClient::send_message(const mavlink::Message &message)
+void MAVConnTCPClient::send_message(const mavlink::Message &message, Priority prio)
 {
 	if (!is_open()) {
 		logError(PFXd "send: channel closed!", conn_id);
@@ -186,15 +184,36 @@ void MAVConnTCPClient::send_message(const mavlink::Message &message)
 
 	log_send_obj(PFX, message);
 
-	{
-		lock_guard lock(mutex);
+	auto *bufp = pool.make(message, get_status_p(), next_tx_seq(), sys_id, comp_id, auto_framing());
+	iostat_tx_msg(message.get_message_info().id, bufp->len);
+	if (!tx_q.push(bufp, prio)) {
+		pool.release(bufp);
+		iostat_tx_drop();
+		throw std::length_error("MAVConnTCPClient::send_message: TX queue overflow");
+	}
+
+	strand.post(std::bind(&MAVConnTCPClient::do_send, shared_from_this(), true));
+}
 
-		if (tx_q.size() >= MAX_TXQ_SIZE)
-			throw std::length_error("MAVConnTCPClient::send_message: TX queue overflow");
 
-		tx_q.emplace_back(message, get_status_p(), sys_id, comp_id);
+void MAVConnTCPClient::set_link_txbuf(uint8_t free_percent)
+{
+	tx_q.set_txbuf(free_percent);
+	iostat_tx_drop(tx_q.take_shed());
+}
+
+bool MAVConnTCPClient::send_buffer(MsgBuffer *bufp, Priority prio)
+{
+	if (!is_open() || !tx_q.push(bufp, prio)) {
+		// broadcast must not abort on one slow client: drop for
+		// this client only, the others still get the message
+		BufferPool::release(bufp);
+		iostat_tx_drop();
+		return false;
 	}
-	socket.get_io_service().post(std::bind(&MAVConnTCPClient::do_send, shared_from_this(), true));
+
+	strand.post(std::bind(&MAVConnTCPClient::do_send, shared_from_this(), true));
+	return true;
 }
 
 void MAVConnTCPClient::do_recv()
@@ -202,7 +221,7 @@ void MAVConnTCPClient::do_recv()
 	auto sthis = shared_from_this();
 	socket.async_receive(
 			buffer(rx_buf),
-			[sthis] (error_code error, size_t bytes_transferred) {
+			strand.wrap([sthis] (error_code error, size_t bytes_transferred) {
 				if (error) {
 					logError(PFXd "receive: %s", sthis->conn_id, error.message().c_str());
 					sthis->close();
@@ -211,7 +230,7 @@ void MAVConnTCPClient::do_recv()
 
 				sthis->parse_buffer(PFX, sthis->rx_buf.data(), sthis->rx_buf.size(), bytes_transferred);
 				sthis->do_recv();
-			});
+			}));
 }
 
 void MAVConnTCPClient::do_send(bool check_tx_state)
@@ -219,18 +238,31 @@ void MAVConnTCPClient::do_send(bool check_tx_state)
 	if (check_tx_state && tx_in_progress)
 		return;
 
-	lock_guard lock(mutex);
-	if (tx_q.empty())
+	// NOTE: tx_q consumer side is only touched from the connection
+	// strand, so no lock is needed here.
+	// Coalesce up to MAX_GATHER queued buffers into one gathered
+	// write: one syscall and one completion round-trip per burst.
+	tx_gather.fill(boost::asio::const_buffer());
+	size_t count = 0;
+	while (count < MAX_GATHER) {
+		auto *bufp = tx_q.peek(count);
+		if (bufp == nullptr)
+			break;
+
+		// shared broadcast buffers are immutable: the send position
+		// lives in tx_front_pos, not in the buffer itself
+		size_t off = (count == 0) ? tx_front_pos : 0;
+		tx_gather[count] = boost::asio::const_buffer(bufp->data + off, bufp->len - off);
+		count++;
+	}
+	if (count == 0)
 		return;
 
 	tx_in_progress = true;
 	auto sthis = shared_from_this();
-	auto &buf_ref = tx_q.front();
 	socket.async_send(
-			buffer(buf_ref.dpos(), buf_ref.nbytes()),
-			[sthis, &buf_ref] (error_code error, size_t bytes_transferred) {
-				assert(bytes_transferred <= buf_ref.len);
-
+			tx_gather,
+			strand.wrap([sthis] (error_code error, size_t bytes_transferred) {
 				if (error) {
 					logError(PFXd "send: %s", sthis->conn_id, error.message().c_str());
 					sthis->close();
@@ -238,23 +270,30 @@ void MAVConnTCPClient::do_send(bool check_tx_state)
 				}
 
 				sthis->iostat_tx_add(bytes_transferred);
-				lock_guard lock(sthis->mutex);
 
-				if (sthis->tx_q.empty()) {
-					sthis->tx_in_progress = false;
-					return;
-				}
-
-				buf_ref.pos += bytes_transferred;
-				if (buf_ref.nbytes() == 0) {
-					sthis->tx_q.pop_front();
+				// release fully transmitted buffers,
+				// account partial write into the first unsent one
+				while (bytes_transferred > 0) {
+					auto *bufp = sthis->tx_q.front();
+					assert(bufp != nullptr);
+
+					auto n = std::min<size_t>(bytes_transferred, bufp->len - sthis->tx_front_pos);
+					sthis->tx_front_pos += n;
+					bytes_transferred -= n;
+
+					if (sthis->tx_front_pos == size_t(bufp->len)) {
+						sthis->iostat_tx_latency(bufp->stamp_ns);
+						sthis->tx_q.pop();
+						sthis->tx_front_pos = 0;
+						BufferPool::release(bufp);
+					}
 				}
 
 				if (!sthis->tx_q.empty())
 					sthis->do_send(false);
 				else
 					sthis->tx_in_progress = false;
-			});
+			}));
 }
 
 
@@ -263,10 +302,10 @@ void MAVConnTCPClient::do_send(bool check_tx_state)
 MAVConnTCPServer::MAVConnTCPServer(uint8_t system_id, uint8_t component_id,
 		std::string server_host, unsigned short server_port) :
 	MAVConnInterface(system_id, component_id),
-	io_service(),
-	acceptor(io_service)
+	strand(MAVConnInterface::io_service()),
+	acceptor(MAVConnInterface::io_service())
 {
-	if (!resolve_address_tcp(io_service, conn_id, server_host, server_port, bind_ep))
+	if (!resolve_address_tcp(MAVConnInterface::io_service(), conn_id, server_host, server_port, bind_ep))
 		throw DeviceError("tcp-l: resolve", "Bind address resolve failed");
 
 	logInform(PFXd "Bind address: %s", conn_id, to_string_ss(bind_ep).c_str());
@@ -281,14 +320,8 @@ MAVConnTCPServer::MAVConnTCPServer(uint8_t system_id, uint8_t component_id,
 		throw DeviceError("tcp-l", err);
 	}
 
-	// give some work to io_service before start
-	io_service.post(std::bind(&MAVConnTCPServer::do_accept, this));
-
-	// run io_service for async io
-	io_thread = std::thread([this] () {
-				utils::set_this_thread_name("mtcps%zu", conn_id);
-				io_service.run();
-			});
+	// start accepting on the shared io pool
+	strand.post(std::bind(&MAVConnTCPServer::do_accept, this));
 }
 
 MAVConnTCPServer::~MAVConnTCPServer()
@@ -305,11 +338,13 @@ void MAVConnTCPServer::close()
 	logInform(PFXd "Terminating server. "
 			"All connections will be closed.", conn_id);
 
-	io_service.stop();
 	acceptor.close();
 
-	if (io_thread.joinable())
-		io_thread.join();
+	// clients no longer share this object's io_service lifetime,
+	// close them explicitly (client_closed() erases from client_list)
+	auto clients = client_list;
+	for (auto &instp : clients)
+		instp->close();
 
 	if (port_closed_cb)
 		port_closed_cb();
@@ -341,7 +376,9 @@ mavlink_status_t MAVConnTCPServer::get_status()
 
 MAVConnInterface::IOStat MAVConnTCPServer::get_iostat()
 {
-	MAVConnInterface::IOStat iostat {};
+	// start from own counters: broadcast per-msgid tx is
+	// accounted on the server channel, bytes on the clients
+	auto iostat = MAVConnInterface::get_iostat();
 
 	lock_guard lock(mutex);
 	for (auto &instp : client_list) {
@@ -357,43 +394,100 @@ MAVConnInterface::IOStat MAVConnTCPServer::get_iostat()
 		iostat.rx_total_bytes += inst_iostat.rx_total_bytes;
 		iostat.rx_speed       += inst_iostat.rx_speed;
 		// [[[end]]] (checksum: fb4fe06794471d9b068ce0c129ee7673)
+
+		iostat.tx_dropped += inst_iostat.tx_dropped;
+
+		// latency percentiles can not be summed: report the worst client
+		iostat.tx_latency_p50_us = std::max(iostat.tx_latency_p50_us, inst_iostat.tx_latency_p50_us);
+		iostat.tx_latency_p90_us = std::max(iostat.tx_latency_p90_us, inst_iostat.tx_latency_p90_us);
+		iostat.tx_latency_p99_us = std::max(iostat.tx_latency_p99_us, inst_iostat.tx_latency_p99_us);
+
+		// merge per-msgid counters (both inputs sorted by msgid)
+		for (auto &ms : inst_iostat.message_stat) {
+			auto it = std::lower_bound(iostat.message_stat.begin(), iostat.message_stat.end(), ms.msgid,
+					[](const MsgStat &a, mavlink::msgid_t id) {
+						return a.msgid < id;
+					});
+			if (it != iostat.message_stat.end() && it->msgid == ms.msgid) {
+				it->tx_count += ms.tx_count;
+				it->tx_bytes += ms.tx_bytes;
+				it->rx_count += ms.rx_count;
+				it->rx_bytes += ms.rx_bytes;
+			}
+			else {
+				iostat.message_stat.insert(it, ms);
+			}
+		}
 	}
 
 	return iostat;
 }
 
-void MAVConnTCPServer::send_bytes(const uint8_t *bytes, size_t length)
+/**
+ * Share one serialized buffer with every connected client:
+ * take a reference per client, drop our own when all are queued.
+ */
+void MAVConnTCPServer::broadcast_buffer(MsgBuffer *bufp, Priority prio, mavlink::msgid_t msgid)
 {
-	lock_guard lock(mutex);
 	for (auto &instp : client_list) {
-		instp->send_bytes(bytes, length);
+		bufp->ref();
+		if (instp->send_buffer(bufp, prio) && msgid != UINT32_MAX)
+			iostat_tx_msg(msgid, bufp->len);
 	}
+
+	BufferPool::release(bufp);
 }
 
-void MAVConnTCPServer::send_message(const mavlink_message_t *message)
+void MAVConnTCPServer::send_bytes(const uint8_t *bytes, size_t length, Priority prio)
 {
 	lock_guard lock(mutex);
-	for (auto &instp : client_list) {
-		instp->send_message(message);
-	}
+	if (client_list.empty())
+		return;
+
+	broadcast_buffer(pool.make(bytes, length), prio, UINT32_MAX);
 }
 
-void MAVConnTCPServer::send_message(const mavlink::Message &message)
+void MAVConnTCPServer::send_message(const mavlink_message_t *message, Priority prio)
 {
+	assert(message != nullptr);
+
 	lock_guard lock(mutex);
-	for (auto &instp : client_list) {
-		instp->send_message(message);
-	}
+	if (client_list.empty())
+		return;
+
+	log_send(PFX, message);
+	broadcast_buffer(pool.make(message), prio, message->msgid);
+}
+
+void MAVConnTCPServer::send_message(const mavlink::Message &message, Priority prio)
+{
+	lock_guard lock(mutex);
+	if (client_list.empty())
+		return;
+
+	log_send_obj(PFX, message);
+
+	// NOTE: serialize-once means one tx sequence stream for all
+	// clients, owned by the server channel status
+	broadcast_buffer(pool.make(message, get_status_p(), next_tx_seq(), sys_id, comp_id, auto_framing()),
+			prio, message.get_message_info().id);
+}
+
+void MAVConnTCPServer::set_link_txbuf(uint8_t free_percent)
+{
+	lock_guard lock(mutex);
+	for (auto &instp : client_list)
+		instp->set_link_txbuf(free_percent);
 }
 
 void MAVConnTCPServer::do_accept()
 {
 	auto sthis = shared_from_this();
-	auto acceptor_client = std::make_shared<MAVConnTCPClient>(sys_id, comp_id, io_service);
+	auto acceptor_client = std::make_shared<MAVConnTCPClient>(sys_id, comp_id, MAVConnInterface::io_service());
 	acceptor.async_accept(
 			acceptor_client->socket,
 			acceptor_client->server_ep,
-			[sthis, acceptor_client] (error_code error) {
+			strand.wrap([sthis, acceptor_client] (error_code error) {
 				if (error) {
 					logError(PFXd "accept: %s", sthis->conn_id, error.message().c_str());
 					sthis->close();
@@ -409,7 +503,7 @@ void MAVConnTCPServer::do_accept()
 
 				sthis->client_list.push_back(acceptor_client);
 				sthis->do_accept();
-			});
+			}));
 }
 
 void MAVConnTCPServer::client_closed(std::weak_ptr<MAVConnTCPClient> weak_instp)
@@ -0,0 +1,389 @@
+/**
+ * @brief MAVConn compressed TCP tunnel class
+ * @file tcpz.cpp
+ *
+ * @addtogroup mavconn
+ * @{
+ */
+/*
+ * libmavconn
+ *
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+
+#include <cassert>
+#include <fstream>
+#include <console_bridge/console.h>
+
+#include <zstd.h>
+#include <mavconn/tcpz.h>
+
+namespace mavconn {
+using boost::system::error_code;
+using boost::asio::buffer;
+using boost::asio::ip::tcp;
+using mavlink::mavlink_message_t;
+
+
+#define PFX	"mavconn: tcpz"
+#define PFXd	PFX "%zu: "
+
+
+static bool resolve_address_tcpz(boost::asio::io_service &io, size_t chan,
+		std::string host, unsigned short port, tcp::endpoint &ep)
+{
+	bool result = false;
+	tcp::resolver resolver(io);
+	error_code ec;
+
+	tcp::resolver::query query(host, "");
+	std::for_each(resolver.resolve(query, ec), tcp::resolver::iterator(),
+		[&](const tcp::endpoint & q_ep) {
+			ep = q_ep;
+			ep.port(port);
+			result = true;
+			logDebug(PFXd "host %s resolved as %s:%u", chan, host.c_str(),
+					ep.address().to_string().c_str(), port);
+		});
+
+	if (ec)
+		logWarn(PFXd "resolve error: %s", chan, ec.message().c_str());
+
+	return result;
+}
+
+MAVConnTCPZ::MAVConnTCPZ(uint8_t system_id, uint8_t component_id,
+		std::string host, unsigned short port,
+		bool listen, unsigned flush_ms, int level, std::string dict_path) :
+	MAVConnInterface(system_id, component_id),
+	strand(MAVConnInterface::io_service()),
+	socket(MAVConnInterface::io_service()),
+	acceptor(MAVConnInterface::io_service()),
+	flush_timer(MAVConnInterface::io_service()),
+	flush_ms(flush_ms),
+	cctx(nullptr),
+	dctx(nullptr),
+	tx_in_progress(false),
+	flush_dirty(false),
+	flush_armed(false),
+	tx_q {},
+	rx_zbuf {},
+	rx_plain {}
+{
+	if (!resolve_address_tcpz(MAVConnInterface::io_service(), conn_id, host, port, ep))
+		throw DeviceError("tcpz: resolve", "address resolve failed");
+
+	logInform(PFXd "%s: %s:%u, zstd level %d, flush %u ms", conn_id,
+			listen ? "listening on" : "tunnel to",
+			ep.address().to_string().c_str(), port, level, flush_ms);
+
+	try {
+		if (listen) {
+			acceptor.open(tcp::v4());
+			acceptor.set_option(tcp::acceptor::reuse_address(true));
+			acceptor.bind(ep);
+			acceptor.listen(1);
+		}
+		else {
+			socket.open(tcp::v4());
+			socket.connect(ep);
+		}
+	}
+	catch (boost::system::system_error &err) {
+		throw DeviceError("tcpz", err);
+	}
+
+	cctx = ZSTD_createCCtx();
+	dctx = ZSTD_createDCtx();
+	if (cctx == nullptr || dctx == nullptr)
+		throw DeviceError("tcpz", "can't create zstd contexts");
+
+	ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level);
+
+	if (!dict_path.empty()) {
+		std::string err;
+		std::ifstream f(dict_path, std::ios::binary);
+
+		if (f) {
+			std::vector<char> dict((std::istreambuf_iterator<char>(f)),
+					std::istreambuf_iterator<char>());
+
+			// both directions and both peers must share this dictionary
+			if (ZSTD_isError(ZSTD_CCtx_loadDictionary(cctx, dict.data(), dict.size())) ||
+					ZSTD_isError(ZSTD_DCtx_loadDictionary(dctx, dict.data(), dict.size())))
+				err = "zstd rejected the dictionary";
+			else
+				logInform(PFXd "dictionary: %s (%zu bytes)", conn_id, dict_path.c_str(), dict.size());
+		}
+		else
+			err = "can't open " + dict_path;
+
+		if (!err.empty()) {
+			// ctor throw skips the dtor: free by hand
+			ZSTD_freeCCtx(cctx);
+			ZSTD_freeDCtx(dctx);
+			throw DeviceError("tcpz: dict", err.c_str());
+		}
+	}
+
+	// NOTE: shared_from_this() should not be used in constructors
+	if (listen)
+		strand.post(std::bind(&MAVConnTCPZ::do_accept, this));
+	else
+		strand.post(std::bind(&MAVConnTCPZ::do_recv, this));
+}
+
+MAVConnTCPZ::~MAVConnTCPZ()
+{
+	close();
+
+	ZSTD_freeCCtx(cctx);
+	ZSTD_freeDCtx(dctx);
+}
+
+void MAVConnTCPZ::close()
+{
+	lock_guard lock(mutex);
+	if (!is_open())
+		return;
+
+	error_code ignored;
+	flush_timer.cancel(ignored);
+	if (acceptor.is_open())
+		acceptor.close(ignored);
+	if (socket.is_open())
+		socket.close(ignored);
+
+	// recycle buffers still queued at teardown
+	while (auto *bufp = tx_q.front()) {
+		tx_q.pop();
+		pool.release(bufp);
+	}
+
+	if (port_closed_cb)
+		port_closed_cb();
+}
+
+void MAVConnTCPZ::do_accept()
+{
+	auto sthis = shared_from_this();
+	acceptor.async_accept(socket,
+			strand.wrap([sthis] (error_code error) {
+				if (error) {
+					logError(PFXd "accept: %s", sthis->conn_id, error.message().c_str());
+					sthis->close();
+					return;
+				}
+
+				logInform(PFXd "peer: %s", sthis->conn_id,
+						sthis->socket.remote_endpoint().address().to_string().c_str());
+
+				// single-peer tunnel: stop accepting
+				error_code ignored;
+				sthis->acceptor.close(ignored);
+
+				sthis->do_recv();
+				sthis->process_tx();
+			}));
+}
+
+void MAVConnTCPZ::send_bytes(const uint8_t *bytes, size_t length, Priority prio)
+{
+	if (!is_open()) {
+		logError(PFXd "send: channel closed!", conn_id);
+		return;
+	}
+
+	auto *bufp = pool.make(bytes, length);
+	if (!tx_q.push(bufp, prio)) {
+		pool.release(bufp);
+		iostat_tx_drop();
+		throw std::length_error("MAVConnTCPZ::send_bytes: TX queue overflow");
+	}
+
+	strand.post(std::bind(&MAVConnTCPZ::process_tx, shared_from_this()));
+}
+
+void MAVConnTCPZ::send_message(const mavlink_message_t *message, Priority prio)
+{
+	assert(message != nullptr);
+
+	if (!is_open()) {
+		logError(PFXd "send: channel closed!", conn_id);
+		return;
+	}
+
+	log_send(PFX, message);
+
+	auto *bufp = pool.make(message);
+	iostat_tx_msg(message->msgid, bufp->len);
+	if (!tx_q.push(bufp, prio)) {
+		pool.release(bufp);
+		iostat_tx_drop();
+		throw std::length_error("MAVConnTCPZ::send_message: TX queue overflow");
+	}
+
+	strand.post(std::bind(&MAVConnTCPZ::process_tx, shared_from_this()));
+}
+
+void MAVConnTCPZ::send_message(const mavlink::Message &message, Priority prio)
+{
+	if (!is_open()) {
+		logError(PFXd "send: channel closed!", conn_id);
+		return;
+	}
+
+	log_send_obj(PFX, message);
+
+	auto *bufp = pool.make(message, get_status_p(), next_tx_seq(), sys_id, comp_id, auto_framing());
+	iostat_tx_msg(message.get_message_info().id, bufp->len);
+	if (!tx_q.push(bufp, prio)) {
+		pool.release(bufp);
+		iostat_tx_drop();
+		throw std::length_error("MAVConnTCPZ::send_message: TX queue overflow");
+	}
+
+	strand.post(std::bind(&MAVConnTCPZ::process_tx, shared_from_this()));
+}
+
+void MAVConnTCPZ::compress_chunk(const uint8_t *data, size_t len)
+{
+	ZSTD_inBuffer in {data, len, 0};
+
+	while (in.pos < in.size) {
+		uint8_t chunk[4096];
+		ZSTD_outBuffer out {chunk, sizeof(chunk), 0};
+
+		auto r = ZSTD_compressStream2(cctx, &out, &in, ZSTD_e_continue);
+		if (ZSTD_isError(r)) {
+			logError(PFXd "compress: %s", conn_id, ZSTD_getErrorName(r));
+			close();
+			return;
+		}
+
+		z_staging.insert(z_staging.end(), chunk, chunk + out.pos);
+	}
+
+	flush_dirty = true;
+}
+
+void MAVConnTCPZ::process_tx()
+{
+	if (!socket.is_open())
+		return;	// still waiting for the peer; queue keeps the frames
+
+	while (auto *bufp = tx_q.front()) {
+		tx_q.pop();
+		compress_chunk(bufp->dpos(), bufp->nbytes());
+		iostat_tx_latency(bufp->stamp_ns);
+		pool.release(bufp);
+	}
+
+	if (!flush_dirty)
+		return;
+
+	if (flush_ms == 0) {
+		flush_now();
+		return;
+	}
+
+	// latency bound: the compressor may hold bytes back for ratio,
+	// but never longer than flush_ms past the first unflushed byte
+	if (!flush_armed) {
+		flush_armed = true;
+		auto sthis = shared_from_this();
+		flush_timer.expires_from_now(boost::posix_time::milliseconds(flush_ms));
+		flush_timer.async_wait(
+				strand.wrap([sthis] (error_code error) {
+					sthis->flush_armed = false;
+					if (!error)
+						sthis->flush_now();
+				}));
+	}
+}
+
+void MAVConnTCPZ::flush_now()
+{
+	ZSTD_inBuffer in {nullptr, 0, 0};
+	size_t remaining;
+
+	do {
+		uint8_t chunk[4096];
+		ZSTD_outBuffer out {chunk, sizeof(chunk), 0};
+
+		remaining = ZSTD_compressStream2(cctx, &out, &in, ZSTD_e_flush);
+		if (ZSTD_isError(remaining)) {
+			logError(PFXd "flush: %s", conn_id, ZSTD_getErrorName(remaining));
+			close();
+			return;
+		}
+
+		z_staging.insert(z_staging.end(), chunk, chunk + out.pos);
+	} while (remaining != 0);
+
+	flush_dirty = false;
+	do_write();
+}
+
+void MAVConnTCPZ::do_write()
+{
+	if (tx_in_progress || z_staging.empty() || !socket.is_open())
+		return;
+
+	tx_in_progress = true;
+	z_writing.swap(z_staging);
+	z_staging.clear();
+
+	auto sthis = shared_from_this();
+	boost::asio::async_write(socket, buffer(z_writing),
+			strand.wrap([sthis] (error_code error, size_t bytes_transferred) {
+				if (error) {
+					logError(PFXd "write: %s", sthis->conn_id, error.message().c_str());
+					sthis->close();
+					return;
+				}
+
+				// wire bytes: the iostat delta vs. per-message
+				// counters is the compression saving
+				sthis->iostat_tx_add(bytes_transferred);
+
+				sthis->z_writing.clear();
+				sthis->tx_in_progress = false;
+				sthis->do_write();
+			}));
+}
+
+void MAVConnTCPZ::do_recv()
+{
+	auto sthis = shared_from_this();
+	socket.async_read_some(
+			buffer(rx_zbuf),
+			strand.wrap([sthis] (error_code error, size_t bytes_transferred) {
+				if (error) {
+					logError(PFXd "receive: %s", sthis->conn_id, error.message().c_str());
+					sthis->close();
+					return;
+				}
+
+				ZSTD_inBuffer in {sthis->rx_zbuf.data(), bytes_transferred, 0};
+				while (in.pos < in.size) {
+					ZSTD_outBuffer out {sthis->rx_plain.data(), sthis->rx_plain.size(), 0};
+
+					auto r = ZSTD_decompressStream(sthis->dctx, &out, &in);
+					if (ZSTD_isError(r)) {
+						logError(PFXd "decompress: %s", sthis->conn_id, ZSTD_getErrorName(r));
+						sthis->close();
+						return;
+					}
+
+					if (out.pos > 0)
+						sthis->parse_buffer(PFX, sthis->rx_plain.data(),
+								sthis->rx_plain.size(), out.pos);
+				}
+
+				sthis->do_recv();
+			}));
+}
+}	// namespace mavconn
@@ -16,8 +16,16 @@
  */
 
 #include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
 #include <console_bridge/console.h>
 
+#ifdef __linux__
+#include <sys/socket.h>
+#include <netinet/in.h>
+#endif
+
 #include <mavconn/thread_utils.h>
 #include <mavconn/udp.h>
 
@@ -63,23 +71,23 @@ MAVConnUDP::MAVConnUDP(uint8_t system_id, uint8_t component_id,
 		std::string remote_host, unsigned short remote_port) :
 	MAVConnInterface(system_id, component_id),
 	remote_exists(false),
+	socket_locked(false),
 	tx_in_progress(false),
 	tx_q {},
 	rx_buf {},
-	io_service(),
-	io_work(new io_service::work(io_service)),
-	socket(io_service)
+	strand(MAVConnInterface::io_service()),
+	socket(MAVConnInterface::io_service())
 {
 	using udps = boost::asio::ip::udp::socket;
 
-	if (!resolve_address_udp(io_service, conn_id, bind_host, bind_port, bind_ep))
+	if (!resolve_address_udp(MAVConnInterface::io_service(), conn_id, bind_host, bind_port, bind_ep))
 		throw DeviceError("udp: resolve", "Bind address resolve failed");
 
 	logInform(PFXd "Bind address: %s", conn_id, to_string_ss(bind_ep).c_str());
 
 	if (remote_host != "") {
 		if (remote_host != BROADCAST_REMOTE_HOST)
-			remote_exists = resolve_address_udp(io_service, conn_id, remote_host, remote_port, remote_ep);
+			remote_exists = resolve_address_udp(MAVConnInterface::io_service(), conn_id, remote_host, remote_port, remote_ep);
 		else {
 			remote_exists = true;
 			remote_ep = udp::endpoint(boost::asio::ip::address_v4::broadcast(), remote_port);
@@ -102,6 +110,25 @@ MAVConnUDP::MAVConnUDP(uint8_t system_id, uint8_t component_id,
 
 		if (remote_host == BROADCAST_REMOTE_HOST)
 			socket.set_option(udps::broadcast(true));
+
+#ifdef __linux__
+		// kernel rx timestamps: every datagram carries a
+		// SCM_TIMESTAMPNS control message, read out in recv_batch()
+		{
+			int on = 1;
+			if (::setsockopt(socket.native_handle(), SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) != 0)
+				logWarn(PFXd "SO_TIMESTAMPNS: %s", conn_id, ::strerror(errno));
+		}
+
+		// a priori known unicast peer: connect() the socket so the
+		// kernel demuxes per-association and sends skip the
+		// per-datagram destination lookup
+		if (remote_exists && remote_host != BROADCAST_REMOTE_HOST) {
+			socket.connect(remote_ep);
+			socket_locked = true;
+			logInform(PFXd "Locked to remote (connected socket)", conn_id);
+		}
+#endif
 	}
 	catch (boost::system::system_error &err) {
 		throw DeviceError("udp", err);
@@ -109,14 +136,8 @@ MAVConnUDP::MAVConnUDP(uint8_t system_id, uint8_t component_id,
 
 	// NOTE: shared_from_this() should not be used in constructors
 
-	// give some work to io_service before start
-	io_service.post(std::bind(&MAVConnUDP::do_recvfrom, this));
-
-	// run io_service for async io
-	io_thread = std::thread([this] () {
-				utils::set_this_thread_name("mudp%zu", conn_id);
-				io_service.run();
-			});
+	// start reading on the shared io pool
+	strand.post(std::bind(&MAVConnUDP::do_recvfrom, this));
 }
 
 MAVConnUDP::~MAVConnUDP()
@@ -130,18 +151,19 @@ void MAVConnUDP::close()
 	if (!is_open())
 		return;
 
-	io_work.reset();
-	io_service.stop();
 	socket.close();
 
-	if (io_thread.joinable())
-		io_thread.join();
+	// recycle buffers still queued at teardown
+	while (auto *bufp = tx_q.front()) {
+		tx_q.pop();
+		pool.release(bufp);
+	}
 
 	if (port_closed_cb)
 		port_closed_cb();
 }
 
-void MAVConnUDP::send_bytes(const uint8_t *bytes, size_t length)
+void MAVConnUDP::send_bytes(const uint8_t *bytes, size_t length, Priority prio)
 {
 	if (!is_open()) {
 		logError(PFXd "send: channel closed!", conn_id);
@@ -153,18 +175,17 @@ void MAVConnUDP::send_bytes(const uint8_t *bytes, size_t length)
 		return;
 	}
 
-	{
-		lock_guard lock(mutex);
-
-		if (tx_q.size() >= MAX_TXQ_SIZE)
-			throw std::length_error("MAVConnUDP::send_bytes: TX queue overflow");
-
-		tx_q.emplace_back(bytes, length);
+	auto *bufp = pool.make(bytes, length);
+	if (!tx_q.push(bufp, prio)) {
+		pool.release(bufp);
+		iostat_tx_drop();
+		throw std::length_error("MAVConnUDP::send_bytes: TX queue overflow");
 	}
-	io_service.post(std::bind(&MAVConnUDP::do_sendto, shared_from_this(), true));
+
+	strand.post(std::bind(&MAVConnUDP::do_sendto, shared_from_this(), true));
 }
 
-void MAVConnUDP::send_message(const mavlink_message_t *message)
+void MAVConnUDP::send_message(const mavlink_message_t *message, Priority prio)
 {
 	assert(message != nullptr);
 
@@ -180,18 +201,18 @@ void MAVConnUDP::send_message(const mavlink_message_t *message)
 
 	log_send(PFX, message);
 
-	{
-		lock_guard lock(mutex);
-
-		if (tx_q.size() >= MAX_TXQ_SIZE)
-			throw std::length_error("MAVConnUDP::send_message: TX queue overflow");
-
-		tx_q.emplace_back(message);
+	auto *bufp = pool.make(message);
+	iostat_tx_msg(message->msgid, bufp->len);
+	if (!tx_q.push(bufp, prio)) {
+		pool.release(bufp);
+		iostat_tx_drop();
+		throw std::length_error("MAVConnUDP::send_message: TX queue overflow");
 	}
-	io_service.post(std::bind(&MAVConnUDP::do_sendto, shared_from_this(), true));
+
+	strand.post(std::bind(&MAVConnUDP::do_sendto, shared_from_this(), true));
 }
 
-void MAVConnUDP::send_message(const mavlink::Message &message)
+void MAVConnUDP::send_message(const mavlink::Message &message, Priority prio)
 {
 	if (!is_open()) {
 		logError(PFXd "send: channel closed!", conn_id);
@@ -205,24 +226,48 @@ void MAVConnUDP::send_message(const mavlink::Message &message)
 
 	log_send_obj(PFX, message);
 
-	{
-		lock_guard lock(mutex);
+	auto *bufp = pool.make(message, get_status_p(), next_tx_seq(), sys_id, comp_id, auto_framing());
+	iostat_tx_msg(message.get_message_info().id, bufp->len);
+	if (!tx_q.push(bufp, prio)) {
+		pool.release(bufp);
+		iostat_tx_drop();
+		throw std::length_error("MAVConnUDP::send_message: TX queue overflow");
+	}
+
+	strand.post(std::bind(&MAVConnUDP::do_sendto, shared_from_this(), true));
+}
 
-		if (tx_q.size() >= MAX_TXQ_SIZE)
-			throw std::length_error("MAVConnUDP::send_message: TX queue overflow");
 
-		tx_q.emplace_back(message, get_status_p(), sys_id, comp_id);
-	}
-	io_service.post(std::bind(&MAVConnUDP::do_sendto, shared_from_this(), true));
+void MAVConnUDP::set_link_txbuf(uint8_t free_percent)
+{
+	tx_q.set_txbuf(free_percent);
+	iostat_tx_drop(tx_q.take_shed());
 }
 
 void MAVConnUDP::do_recvfrom()
 {
 	auto sthis = shared_from_this();
+#ifdef __linux__
+	// reactive read: wait for readiness, then drain all pending
+	// datagrams with a single recvmmsg() syscall
+	socket.async_receive(
+			boost::asio::null_buffers(),
+			strand.wrap([sthis] (error_code error, size_t) {
+				if (error) {
+					logError(PFXd "receive: %s", sthis->conn_id, error.message().c_str());
+					sthis->close();
+					return;
+				}
+
+				sthis->recv_batch();
+				sthis->busy_poll_recv();
+				sthis->do_recvfrom();
+			}));
+#else
 	socket.async_receive_from(
 			buffer(rx_buf),
 			remote_ep,
-			[sthis] (error_code error, size_t bytes_transferred) {
+			strand.wrap([sthis] (error_code error, size_t bytes_transferred) {
 				if (error) {
 					logError(PFXd "receive: %s", sthis->conn_id, error.message().c_str());
 					sthis->close();
@@ -237,26 +282,209 @@ void MAVConnUDP::do_recvfrom()
 
 				sthis->parse_buffer(PFX, sthis->rx_buf.data(), sthis->rx_buf.size(), bytes_transferred);
 				sthis->do_recvfrom();
-			});
+			}));
+#endif
+}
+
+#ifdef __linux__
+//! extract the SCM_TIMESTAMPNS receive stamp set up by SO_TIMESTAMPNS
+static uint64_t cmsg_rx_stamp_ns(struct msghdr &mhdr)
+{
+	for (auto *cmsg = CMSG_FIRSTHDR(&mhdr); cmsg != nullptr; cmsg = CMSG_NXTHDR(&mhdr, cmsg)) {
+		if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+			struct timespec ts;
+			std::memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+			return uint64_t(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+		}
+	}
+
+	return 0;
 }
 
+int MAVConnUDP::recv_batch()
+{
+	struct mmsghdr msgs[MAX_BATCH] = {};
+	struct iovec iov[MAX_BATCH];
+	struct sockaddr_in addrs[MAX_BATCH];
+	alignas(struct cmsghdr) uint8_t cmsg_buf[MAX_BATCH][CMSG_SPACE(sizeof(struct timespec))];
+
+	for (size_t i = 0; i < MAX_BATCH; i++) {
+		iov[i].iov_base = rx_batch[i].data();
+		iov[i].iov_len = rx_batch[i].size();
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_name = &addrs[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+		msgs[i].msg_hdr.msg_control = cmsg_buf[i];
+		msgs[i].msg_hdr.msg_controllen = sizeof(cmsg_buf[i]);
+	}
+
+	auto n = ::recvmmsg(socket.native_handle(), msgs, MAX_BATCH, MSG_DONTWAIT, nullptr);
+	if (n < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+			return 0;	// spurious wakeup: readiness already consumed
+
+		logError(PFXd "recvmmsg: %s", conn_id, ::strerror(errno));
+		return -1;
+	}
+
+	for (int i = 0; i < n; i++) {
+		// on a locked socket the kernel already filtered the peer
+		if (!socket_locked) {
+			udp::endpoint ep(
+					boost::asio::ip::address_v4(ntohl(addrs[i].sin_addr.s_addr)),
+					ntohs(addrs[i].sin_port));
+
+			if (ep != last_remote_ep) {
+				logInform(PFXd "Remote address: %s", conn_id, to_string_ss(ep).c_str());
+				remote_ep = ep;
+				remote_exists = true;
+				last_remote_ep = ep;
+			}
+		}
+
+		rx_kernel_stamp_ns.store(cmsg_rx_stamp_ns(msgs[i].msg_hdr), std::memory_order_relaxed);
+		parse_buffer(PFX, rx_batch[i].data(), rx_batch[i].size(), msgs[i].msg_len);
+	}
+
+	return n;
+}
+
+void MAVConnUDP::busy_poll_recv()
+{
+	unsigned window_us = get_busy_poll();
+	if (window_us == 0)
+		return;
+
+	// adaptive busy poll: spin on recvmmsg() for the window, every
+	// drained batch restarts it; fall back to the reactor when idle
+	auto deadline = steady_clock::now() + std::chrono::microseconds(window_us);
+	while (steady_clock::now() < deadline) {
+		int n = recv_batch();
+		if (n > 0) {
+			deadline = steady_clock::now() + std::chrono::microseconds(window_us);
+			continue;
+		}
+
+		if (n < 0)
+			return;
+
+		utils::cpu_relax();
+	}
+}
+
+void MAVConnUDP::unlock_remote()
+{
+	// AF_UNSPEC connect() dissolves the association; the link falls
+	// back to explicit destinations and re-learns the peer from rx
+	struct sockaddr sa {};
+	sa.sa_family = AF_UNSPEC;
+	::connect(socket.native_handle(), &sa, sizeof(sa));
+	socket_locked = false;
+	logInform(PFXd "Remote peer unreachable, falling back to roaming mode", conn_id);
+}
+
+bool MAVConnUDP::send_batch()
+{
+	struct mmsghdr msgs[MAX_BATCH] = {};
+	struct iovec iov[MAX_BATCH];
+
+	auto dest = remote_ep;
+
+	size_t count = 0;
+	while (count < MAX_BATCH) {
+		auto *bufp = tx_q.peek(count);
+		if (bufp == nullptr)
+			break;
+
+		iov[count].iov_base = bufp->dpos();
+		iov[count].iov_len = bufp->nbytes();
+		msgs[count].msg_hdr.msg_iov = &iov[count];
+		msgs[count].msg_hdr.msg_iovlen = 1;
+		msgs[count].msg_hdr.msg_name = socket_locked ? nullptr : dest.data();
+		msgs[count].msg_hdr.msg_namelen = socket_locked ? 0 : dest.size();
+		count++;
+	}
+	if (count == 0)
+		return true;
+
+	auto n = ::sendmmsg(socket.native_handle(), msgs, count, MSG_DONTWAIT);
+	if (n < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+			return true;	// kept queued, retried on next readiness
+
+		if (errno == ENETUNREACH) {
+			logWarn(PFXd "sendmmsg: %s, retrying", conn_id, ::strerror(errno));
+			return true;
+		}
+
+		// connected sockets get peer ICMP errors delivered here
+		if (errno == ECONNREFUSED && socket_locked) {
+			unlock_remote();
+			return true;
+		}
+
+		logError(PFXd "sendmmsg: %s", conn_id, ::strerror(errno));
+		close();
+		return false;
+	}
+
+	// datagram sends are all-or-nothing
+	for (int i = 0; i < n; i++) {
+		auto *bufp = tx_q.front();
+		assert(bufp != nullptr);
+
+		iostat_tx_add(msgs[i].msg_len);
+		iostat_tx_latency(bufp->stamp_ns);
+		tx_q.pop();
+		pool.release(bufp);
+	}
+
+	return true;
+}
+#endif
+
 void MAVConnUDP::do_sendto(bool check_tx_state)
 {
 	if (check_tx_state && tx_in_progress)
 		return;
 
-	lock_guard lock(mutex);
-	if (tx_q.empty())
+	// NOTE: tx_q consumer side is only touched from the connection
+	// strand, so no lock is needed here.
+	auto *bufp = tx_q.front();
+	if (bufp == nullptr)
 		return;
 
+	(void)bufp;	// only the non-batched path sends it directly
+
 	tx_in_progress = true;
 	auto sthis = shared_from_this();
-	auto &buf_ref = tx_q.front();
+#ifdef __linux__
+	// reactive write: wait for readiness, then push the whole batch
+	// with a single sendmmsg() syscall
+	socket.async_send(
+			boost::asio::null_buffers(),
+			strand.wrap([sthis] (error_code error, size_t) {
+				if (error) {
+					logError(PFXd "sendto: %s", sthis->conn_id, error.message().c_str());
+					sthis->close();
+					return;
+				}
+
+				if (!sthis->send_batch())
+					return;
+
+				if (!sthis->tx_q.empty())
+					sthis->do_sendto(false);
+				else
+					sthis->tx_in_progress = false;
+			}));
+#else
 	socket.async_send_to(
-			buffer(buf_ref.dpos(), buf_ref.nbytes()),
+			buffer(bufp->dpos(), bufp->nbytes()),
 			remote_ep,
-			[sthis, &buf_ref] (error_code error, size_t bytes_transferred) {
-				assert(bytes_transferred <= buf_ref.len);
+			strand.wrap([sthis, bufp] (error_code error, size_t bytes_transferred) {
+				assert(ssize_t(bytes_transferred) <= bufp->len);
 
 				if (error == boost::asio::error::network_unreachable) {
 					logWarn(PFXd "sendto: %s, retrying", sthis->conn_id, error.message().c_str());
@@ -269,22 +497,19 @@ void MAVConnUDP::do_sendto(bool check_tx_state)
 				}
 
 				sthis->iostat_tx_add(bytes_transferred);
-				lock_guard lock(sthis->mutex);
 
-				if (sthis->tx_q.empty()) {
-					sthis->tx_in_progress = false;
-					return;
-				}
-
-				buf_ref.pos += bytes_transferred;
-				if (buf_ref.nbytes() == 0) {
-					sthis->tx_q.pop_front();
+				bufp->pos += bytes_transferred;
+				if (bufp->nbytes() == 0) {
+					sthis->iostat_tx_latency(bufp->stamp_ns);
+					sthis->tx_q.pop();
+					sthis->pool.release(bufp);
 				}
 
 				if (!sthis->tx_q.empty())
 					sthis->do_sendto(false);
 				else
 					sthis->tx_in_progress = false;
-			});
+			}));
+#endif
 }
 }	// namespace mavconn
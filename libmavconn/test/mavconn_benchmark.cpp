@@ -0,0 +1,276 @@
+/**
+ * Micro-benchmarks for libmavconn hot paths.
+ *
+ * Measures:
+ *  - loopback UDP / TCP throughput [msg/s]
+ *  - parse_buffer() cost per byte on synthetic streams with noise
+ *  - transmit buffer serialization cost per message
+ *  - tx-enqueue-to-wire latency percentiles on loopback UDP
+ *
+ * Not a unit test: built on demand (catkin_make mavconn-benchmark)
+ * and run manually when evaluating transport changes.
+ *
+ * Usage: mavconn-benchmark [msg_count] [noise_percent]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <algorithm>
+#include <condition_variable>
+
+#include <mavconn/interface.h>
+#include <mavconn/udp.h>
+#include <mavconn/tcp.h>
+
+using namespace mavconn;
+using mavlink::mavlink_message_t;
+using steady_clock = std::chrono::steady_clock;
+
+static size_t msg_count = 100000;
+static unsigned noise_percent = 5;
+
+
+static double elapsed_sec(steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(steady_clock::now() - start).count();
+}
+
+static mavlink::common::msg::HEARTBEAT make_heartbeat()
+{
+	using mavlink::common::MAV_TYPE;
+	using mavlink::common::MAV_AUTOPILOT;
+	using mavlink::common::MAV_MODE;
+	using mavlink::common::MAV_STATE;
+
+	mavlink::common::msg::HEARTBEAT hb;
+	hb.type = int(MAV_TYPE::ONBOARD_CONTROLLER);
+	hb.autopilot = int(MAV_AUTOPILOT::INVALID);
+	hb.base_mode = int(MAV_MODE::MANUAL_ARMED);
+	hb.custom_mode = 0;
+	hb.system_status = int(MAV_STATE::ACTIVE);
+	return hb;
+}
+
+/**
+ * Gives benchmark access to the protected parser.
+ */
+class ParseHarness : public MAVConnInterface {
+public:
+	size_t received = 0;
+
+	ParseHarness() :
+		MAVConnInterface(1, 1)
+	{
+		message_received_cb = [this](const mavlink_message_t *, const Framing framing) {
+					if (framing == Framing::ok)
+						received++;
+				};
+	}
+
+	void parse(uint8_t *buf, size_t size)
+	{
+		parse_buffer("bench", buf, size, size);
+	}
+
+	void close() override {}
+	bool is_open() override {
+		return true;
+	}
+	void send_message(const mavlink_message_t *, Priority) override {}
+	void send_message(const mavlink::Message &, Priority) override {}
+	void send_bytes(const uint8_t *, size_t, Priority) override {}
+};
+
+
+/* -*- benchmarks -*- */
+
+static void bench_serialization()
+{
+	BufferPool pool;
+	mavlink::mavlink_status_t status {};
+	auto hb = make_heartbeat();
+
+	auto start = steady_clock::now();
+	for (size_t i = 0; i < msg_count; i++) {
+		auto *buf = pool.make(hb, &status, 1, 1);
+		pool.release(buf);
+	}
+	auto dt = elapsed_sec(start);
+
+	std::printf("serialize HEARTBEAT:  %8.0f msg/s  (%.1f ns/msg)\n",
+			msg_count / dt, dt / msg_count * 1e9);
+
+	// forward path: pre-built mavlink_message_t -> wire buffer
+	mavlink_message_t msg {};
+	mavlink::MsgMap map(msg);
+	auto mi = hb.get_message_info();
+	hb.serialize(map);
+	mavlink::mavlink_finalize_message_buffer(&msg, 1, 1, &status, mi.min_length, mi.length, mi.crc_extra);
+
+	start = steady_clock::now();
+	for (size_t i = 0; i < msg_count; i++) {
+		auto *buf = pool.make(&msg);
+		pool.release(buf);
+	}
+	dt = elapsed_sec(start);
+
+	std::printf("serialize forward:    %8.0f msg/s  (%.1f ns/msg)\n",
+			msg_count / dt, dt / msg_count * 1e9);
+}
+
+static void bench_parse()
+{
+	ParseHarness harness;
+	BufferPool pool;
+	mavlink::mavlink_status_t status {};
+	auto hb = make_heartbeat();
+
+	// build synthetic stream: heartbeats with injected noise bytes
+	std::vector<uint8_t> stream;
+	stream.reserve(msg_count * 32);
+
+	std::mt19937 rng(42);
+	std::uniform_int_distribution<unsigned> percent(0, 99);
+	std::uniform_int_distribution<unsigned> byte(0, 255);
+
+	for (size_t i = 0; i < msg_count; i++) {
+		auto *buf = pool.make(hb, &status, 1, 1);
+		stream.insert(stream.end(), buf->data, buf->data + buf->len);
+		pool.release(buf);
+
+		while (percent(rng) < noise_percent)
+			stream.push_back(byte(rng));
+	}
+
+	auto start = steady_clock::now();
+	harness.parse(stream.data(), stream.size());
+	auto dt = elapsed_sec(start);
+
+	std::printf("parse %2u%% noise:     %8.1f MB/s  (%.2f ns/byte, %zu/%zu msgs ok)\n",
+			noise_percent,
+			stream.size() / dt / 1e6, dt / stream.size() * 1e9,
+			harness.received, msg_count);
+}
+
+static void bench_throughput(const char *name, MAVConnInterface::Ptr server, MAVConnInterface::Ptr client)
+{
+	std::atomic<size_t> received {0};
+	server->message_received_cb = [&](const mavlink_message_t *, const Framing framing) {
+				if (framing == Framing::ok)
+					received++;
+			};
+
+	auto hb = make_heartbeat();
+
+	auto start = steady_clock::now();
+	for (size_t i = 0; i < msg_count; i++)
+		client->send_message_ignore_drop(hb);
+
+	// wait for the pipe to drain (1 s of no progress = done)
+	size_t last = 0;
+	do {
+		last = received;
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	} while (received != last && received < msg_count);
+	auto dt = elapsed_sec(start);
+
+	std::printf("%s loopback:         %8.0f msg/s  (%zu/%zu delivered)\n",
+			name, received / dt, received.load(), msg_count);
+}
+
+static void bench_latency()
+{
+	// tx enqueue-to-wire-to-rx latency over loopback UDP,
+	// enqueue timestamp carried in SYSTEM_TIME.time_unix_usec
+	auto server = std::make_shared<MAVConnUDP>(42, 200, "0.0.0.0", 45801);
+	auto client = std::make_shared<MAVConnUDP>(44, 200, "0.0.0.0", 45802, "localhost", 45801);
+
+	std::vector<double> samples;
+	samples.reserve(msg_count);
+
+	std::mutex mutex;
+	std::condition_variable cond;
+
+	server->message_received_cb = [&](const mavlink_message_t *msg, const Framing framing) {
+				if (framing != Framing::ok || msg->msgid != mavlink::common::msg::SYSTEM_TIME::MSG_ID)
+					return;
+
+				mavlink::MsgMap map(msg);
+				mavlink::common::msg::SYSTEM_TIME st;
+				st.deserialize(map);
+
+				auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+						steady_clock::now().time_since_epoch()).count();
+
+				std::lock_guard<std::mutex> lock(mutex);
+				samples.push_back((now - st.time_unix_usec) * 1e-3);	// [us]
+				cond.notify_one();
+			};
+
+	size_t count = std::min<size_t>(msg_count, 10000);
+	for (size_t i = 0; i < count; i++) {
+		mavlink::common::msg::SYSTEM_TIME st;
+		st.time_unix_usec = std::chrono::duration_cast<std::chrono::nanoseconds>(
+				steady_clock::now().time_since_epoch()).count();
+		st.time_boot_ms = i;
+		client->send_message_ignore_drop(st);
+
+		// pace at ~10 kHz so the queue does not just fill up
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		cond.wait_for(lock, std::chrono::seconds(2),
+				[&] () { return samples.size() >= count; });
+	}
+
+	if (samples.empty()) {
+		std::printf("latency:        no samples received!\n");
+		return;
+	}
+
+	std::sort(samples.begin(), samples.end());
+	auto pct = [&](double p) {
+				return samples[std::min(samples.size() - 1,
+						size_t(samples.size() * p))];
+			};
+
+	std::printf("enqueue-to-rx latency [us]: p50 %.1f  p90 %.1f  p99 %.1f  max %.1f  (%zu samples)\n",
+			pct(0.50), pct(0.90), pct(0.99), samples.back(), samples.size());
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 1)
+		msg_count = std::strtoul(argv[1], nullptr, 10);
+	if (argc > 2)
+		noise_percent = std::strtoul(argv[2], nullptr, 10);
+
+	std::printf("libmavconn benchmark: %zu messages, %u%% parse noise\n\n",
+			msg_count, noise_percent);
+
+	bench_serialization();
+	bench_parse();
+
+	{
+		auto server = std::make_shared<MAVConnUDP>(42, 200, "0.0.0.0", 45803);
+		auto client = std::make_shared<MAVConnUDP>(44, 200, "0.0.0.0", 45804, "localhost", 45803);
+		bench_throughput("UDP", server, client);
+	}
+	{
+		auto server = std::make_shared<MAVConnTCPServer>(42, 200, "0.0.0.0", 45805);
+		auto client = std::make_shared<MAVConnTCPClient>(44, 200, "localhost", 45805);
+		bench_throughput("TCP", server, client);
+	}
+
+	bench_latency();
+
+	return 0;
+}
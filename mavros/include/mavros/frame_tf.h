@@ -99,6 +99,12 @@ Covariance6d transform_frame(const Covariance6d &cov, const Eigen::Quaterniond &
  */
 Covariance9d transform_frame(const Covariance9d &cov, const Eigen::Quaterniond &q);
 
+/**
+ * @brief Transform an array of 6d covariances with one rotation setup
+ */
+void transform_frame_batch(const Covariance6d *cov_in, Covariance6d *cov_out, size_t count,
+		const Eigen::Quaterniond &q);
+
 /**
  * @brief Transform data experessed in one frame to another frame.
  *
@@ -260,6 +266,15 @@ inline T transform_frame_baselink_enu(const T &in,const Eigen::Quaterniond &q) {
 	return detail::transform_frame(in, q);
 }
 
+/**
+ * @brief Transform array of 6d covariances expressed in one frame to another.
+ * The rotation matrix is computed once for the whole batch.
+ */
+inline void transform_frame_batch(const Covariance6d *cov_in, Covariance6d *cov_out, size_t count,
+		const Eigen::Quaterniond &q) {
+	detail::transform_frame_batch(cov_in, cov_out, count, q);
+}
+
 /**
  * @brief Transform heading from ROS to FCU frame.
  */
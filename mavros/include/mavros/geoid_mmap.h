@@ -0,0 +1,167 @@
+/**
+ * @brief Memory-mapped Geoid dataset
+ * @file geoid_mmap.h
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup nodelib
+ * @{
+ */
+/*
+ * Copyright 2017 Vladimir Ermakov.
+ *
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+
+#pragma once
+
+#include <cmath>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <GeographicLib/Geoid.hpp>
+
+namespace mavros {
+/**
+ * @brief Geoid undulation lookup over a memory-mapped PGM dataset
+ *
+ * Reads the same .pgm grids GeographicLib installs, but maps the file
+ * read-only instead of caching it to RAM: the pages live in the OS
+ * page cache and are shared between every process using the dataset,
+ * so N mavros instances cost one copy and nothing is loaded up front.
+ *
+ * Lookups use bilinear interpolation (thread safe, no state). On the
+ * 5' grid that is within a few centimeters of GeographicLib's cubic
+ * result — far below GPS vertical accuracy.
+ */
+class GeoidMmap {
+public:
+	explicit GeoidMmap(const std::string &path) :
+		base(nullptr),
+		map_len(0),
+		offset_(-108.0),	// egm96 defaults, overridden by header
+		scale_(0.003)
+	{
+		std::ifstream f(path, std::ios::binary);
+		if (!f)
+			throw std::runtime_error("geoid: cannot open " + path);
+
+		std::string magic;
+		f >> magic;
+		if (magic != "P5")
+			throw std::runtime_error("geoid: not a PGM file: " + path);
+
+		// header: width, height, maxval; comments carry Offset/Scale
+		unsigned dims[3];
+		int ndim = 0;
+		while (ndim < 3) {
+			f >> std::ws;
+			if (f.peek() == '#') {
+				std::string comment;
+				std::getline(f, comment);
+
+				std::istringstream cs(comment);
+				std::string hash, key;
+				cs >> hash >> key;
+				if (key == "Offset")
+					cs >> offset_;
+				else if (key == "Scale")
+					cs >> scale_;
+
+				continue;
+			}
+
+			if (!(f >> dims[ndim]))
+				throw std::runtime_error("geoid: bad PGM header: " + path);
+			ndim++;
+		}
+		f.get();	// single whitespace before the raster
+
+		width_ = dims[0];
+		height_ = dims[1];
+		if (dims[2] != 65535 || width_ < 2 || height_ < 2)
+			throw std::runtime_error("geoid: unsupported PGM format: " + path);
+
+		data_off = f.tellg();
+
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			throw std::runtime_error("geoid: open failed: " + path);
+
+		struct stat st;
+		if (::fstat(fd, &st) != 0 ||
+				size_t(st.st_size) < data_off + 2 * size_t(width_) * height_) {
+			::close(fd);
+			throw std::runtime_error("geoid: truncated dataset: " + path);
+		}
+
+		map_len = st.st_size;
+		void *m = ::mmap(nullptr, map_len, PROT_READ, MAP_SHARED, fd, 0);
+		::close(fd);	// the mapping keeps the file
+		if (m == MAP_FAILED)
+			throw std::runtime_error("geoid: mmap failed: " + path);
+
+		base = static_cast<const uint8_t *>(m);
+	}
+
+	GeoidMmap(const GeoidMmap&) = delete;
+
+	~GeoidMmap()
+	{
+		if (base != nullptr)
+			::munmap(const_cast<uint8_t *>(base), map_len);
+	}
+
+	//! @return geoid height (undulation) in meters
+	double operator()(double lat, double lon) const
+	{
+		// grid: row 0 is 90N, column 0 is 0E, x wraps at 360
+		double fy = (90.0 - lat) * (height_ - 1) / 180.0;
+		double fx = (lon < 0.0 ? lon + 360.0 : lon) * width_ / 360.0;
+
+		unsigned iy = std::min(unsigned(std::max(fy, 0.0)), height_ - 2);
+		unsigned ix = unsigned(std::max(fx, 0.0)) % width_;
+		unsigned ix1 = (ix + 1) % width_;
+		double u = fx - std::floor(fx);
+		double v = std::min(std::max(fy - iy, 0.0), 1.0);
+
+		double a = (1.0 - u) * raw(ix, iy) + u * raw(ix1, iy);
+		double b = (1.0 - u) * raw(ix, iy + 1) + u * raw(ix1, iy + 1);
+		return (1.0 - v) * a + v * b;
+	}
+
+	//! Installed dataset location, e.g. default_path("egm96-5")
+	static std::string default_path(const std::string &name)
+	{
+		return GeographicLib::Geoid::DefaultGeoidPath() + "/" + name + ".pgm";
+	}
+
+	size_t file_size() const { return map_len; }
+
+private:
+	//! decode one big-endian grid sample
+	double raw(unsigned ix, unsigned iy) const
+	{
+		const uint8_t *p = base + data_off + 2 * (size_t(iy) * width_ + ix);
+		return offset_ + scale_ * ((p[0] << 8) | p[1]);
+	}
+
+	const uint8_t *base;
+	size_t map_len;
+	size_t data_off;
+	unsigned width_;
+	unsigned height_;
+	double offset_;
+	double scale_;
+};
+}	// namespace mavros
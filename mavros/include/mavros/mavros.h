@@ -18,11 +18,17 @@
 #pragma once
 
 #include <array>
+#include <bitset>
+#include <memory>
 #include <ros/ros.h>
 #include <pluginlib/class_loader.h>
 #include <mavconn/interface.h>
+#include <mavconn/ring.h>
 #include <mavros/mavros_plugin.h>
+#include <mavros/plugin_registry.h>
 #include <mavros/mavlink_diag.h>
+#include <mavros/plugin_executor.h>
+#include <mavros/tlog_recorder.h>
 #include <mavros/utils.h>
 
 namespace mavros {
@@ -34,8 +40,26 @@ namespace mavros {
 class MavRos
 {
 public:
-	MavRos();
-	~MavRos() {};
+	//! single-vehicle node: params under "~", bridge under "mavlink"
+	MavRos() : MavRos(ros::NodeHandle("~"), ros::NodeHandle("mavlink")) {}
+
+	/**
+	 * @brief Host the instance in explicit namespaces
+	 *
+	 * Lets one process construct several instances (params and the
+	 * mavlink bridge resolve under the given handles), sharing the
+	 * plugin libraries, the Geoid dataset and the process itself.
+	 *
+	 * @note plugins still advertise under the node-private namespace,
+	 * so instances must be separated by node namespace remapping.
+	 */
+	MavRos(const ros::NodeHandle &nh_in, const ros::NodeHandle &mavlink_nh_in);
+
+	~MavRos()
+	{
+		while (auto *m = from_msg_pool.pop())
+			delete m;
+	};
 
 	void spin();
 
@@ -44,9 +68,27 @@ private:
 	// fcu_link stored in mav_uas
 	mavconn::MAVConnInterface::Ptr gcs_link;
 
+	//! every GCS client (primary first); each owns its tx queue, so a
+	//! stalled spectator cannot slow the others
+	std::vector<mavconn::MAVConnInterface::Ptr> gcs_links;
+	//! per-client fan-out drop counters (rx thread only)
+	std::vector<size_t> gcs_drops;
+	//! diag tasks for the clients after the first
+	std::vector<std::unique_ptr<MavlinkDiag>> gcs_extra_diags;
+
 	ros::Publisher mavlink_pub;
 	ros::Subscriber mavlink_sub;
 
+	//! 0.5 s diagnostics tick; serviced by whatever spins our handles
+	//! (own spinner in spin(), manager threads in the nodelet)
+	ros::Timer diag_timer;
+
+	//! /mavlink/from message pool size (power of two)
+	static constexpr size_t FROM_MSG_POOL_SIZE = 32;
+
+	//! recycled /mavlink/from messages, keep payload64 capacity
+	mavconn::MPMCRing<mavros_msgs::Mavlink *> from_msg_pool;
+
 	diagnostic_updater::Updater gcs_diag_updater;
 	MavlinkDiag fcu_link_diag;
 	MavlinkDiag gcs_link_diag;
@@ -54,9 +96,54 @@ private:
 	pluginlib::ClassLoader<plugin::PluginBase> plugin_loader;
 	std::vector<plugin::PluginBase::Ptr> loaded_plugins;
 
-	//! FCU link -> router -> plugin handler
+	//! guards plugin_subscriptions + loaded_plugins during parallel load
+	std::mutex plugin_mutex;
+
+	//! FCU link -> router -> plugin handler (staging, frozen by build_routing_table())
 	std::unordered_map<mavlink::msgid_t, plugin::PluginBase::Subscriptions> plugin_subscriptions;
 
+	//! contiguous handler range of one msgid in route_handlers
+	struct RouteSpan {
+		uint16_t begin;
+		uint16_t count;
+		//! latency-critical handlers bypass the executor
+		bool run_inline;
+	};
+
+	//! direct-indexed routing covers every MAVLink v1 id
+	static constexpr size_t ROUTE_DIRECT_SIZE = 256;
+
+	//! frozen routing table: low msgid -> handler span
+	std::array<RouteSpan, ROUTE_DIRECT_SIZE> route_direct;
+	//! sorted spans for extended (v2, id >= 256) msgids
+	std::vector<std::pair<mavlink::msgid_t, RouteSpan>> route_ext;
+	//! handler callbacks packed in routing order
+	std::vector<plugin::PluginBase::HandlerCb> route_handlers;
+
+	//! msgids whose handlers run inline on the rx thread
+	std::vector<int> exec_inline_ids;
+
+	//! token bucket shaping one msgid on the GCS fan-out.
+	//! All state is touched from the FCU rx thread only.
+	struct GcsRateLimit {
+		float rate;		//!< tokens per second
+		float tokens;		//!< current credit, capped at rate
+		uint64_t last_ns;	//!< last refill [steady ns]
+		size_t dropped;		//!< messages withheld so far
+	};
+
+	//! ~gcs_rate_limits buckets; empty: no shaping
+	std::vector<GcsRateLimit> gcs_rate_limits;
+	//! low msgid -> bucket index + 1 (0: pass through)
+	std::array<uint16_t, ROUTE_DIRECT_SIZE> gcs_limit_direct;
+	//! sorted (msgid, bucket index + 1) pairs for extended ids
+	std::vector<std::pair<mavlink::msgid_t, uint16_t>> gcs_limit_ext;
+
+	//! accepted source ids, indexed (sysid << 8 | compid)
+	std::bitset<256 * 256> accept_filter;
+	//! no source_whitelist configured: pass every source
+	bool accept_all;
+
 	//! UAS object passed to all plugins
 	UAS mav_uas;
 
@@ -68,12 +155,29 @@ private:
 	//! message router
 	void plugin_route_cb(const mavlink::mavlink_message_t *mmsg, const mavconn::Framing framing);
 
-	//! load plugin
-	void add_plugin(std::string &pl_name, ros::V_string &blacklist, ros::V_string &whitelist);
+	//! fcu link -> every GCS client, one serialization
+	void gcs_fanout(const mavlink::mavlink_message_t *mmsg);
+
+	//! true when the ~gcs_rate_limits shaper admits the message
+	bool gcs_rate_admit(const mavlink::mavlink_message_t *mmsg);
+
+	//! instantiate plugin through the given factory (if not blacklisted)
+	void add_plugin(const std::string &pl_name, ros::V_string &blacklist, ros::V_string &whitelist,
+			const std::function<plugin::PluginBase::Ptr()> &make);
+
+	//! freeze plugin_subscriptions into the flat routing table
+	void build_routing_table();
+
+	//! raw-frame flight log (null: recording disabled)
+	std::unique_ptr<TlogRecorder> tlog;
 
 	//! start mavlink app on USB
 	void startup_px4_usb_quirk();
 	void log_connect_change(bool connected);
+
+	//! off-rx-thread handler executor (null: all handlers inline).
+	//! Last member: destroyed (joined) while the rest is still alive.
+	std::unique_ptr<PluginExecutor> plugin_exec;
 };
 }	// namespace mavros
 
@@ -18,10 +18,12 @@
 #pragma once
 
 #include <tuple>
+#include <atomic>
 #include <vector>
 #include <functional>
 #include <diagnostic_updater/diagnostic_updater.h>
 #include <mavconn/interface.h>
+#include <mavconn/ring.h>
 #include <mavros/mavros_uas.h>
 
 namespace mavros {
@@ -31,6 +33,112 @@ using mavros::UAS;
 typedef std::lock_guard<std::recursive_mutex> lock_guard;
 typedef std::unique_lock<std::recursive_mutex> unique_lock;
 
+/**
+ * @brief Publisher with a cached subscriber-presence flag
+ *
+ * High-rate handlers should not do frame transforms and message
+ * construction for topics nobody reads, and getNumSubscribers()
+ * locks the topic each call. The flag here is refreshed from the
+ * subscriber connect/disconnect callbacks, so gating a handler on
+ * active() costs one relaxed atomic load.
+ *
+ * @note do not move the object after advertise(): the roscpp
+ * callbacks keep its address.
+ */
+class LazyPublisher {
+public:
+	LazyPublisher() : subscribed(false) { }
+
+	LazyPublisher(const LazyPublisher &) = delete;
+	LazyPublisher &operator=(const LazyPublisher &) = delete;
+
+	template <class M>
+	void advertise(ros::NodeHandle &nh, const std::string &topic, uint32_t queue_size)
+	{
+		ros::SubscriberStatusCallback cb =
+			std::bind(&LazyPublisher::connection_cb, this, std::placeholders::_1);
+
+		auto ao = ros::AdvertiseOptions::create<M>(topic, queue_size,
+				cb, cb, ros::VoidConstPtr(), nullptr);
+		pub = nh.advertise(ao);
+
+		// a subscriber may connect while advertise() runs
+		subscribed.store(pub.getNumSubscribers() > 0, std::memory_order_relaxed);
+	}
+
+	//! true while at least one subscriber is connected
+	inline bool active() const {
+		return subscribed.load(std::memory_order_relaxed);
+	}
+
+	template <class M>
+	inline void publish(const M &message) const {
+		pub.publish(message);
+	}
+
+private:
+	ros::Publisher pub;
+	std::atomic<bool> subscribed;
+
+	void connection_cb(const ros::SingleSubscriberPublisher &) {
+		subscribed.store(pub.getNumSubscribers() > 0, std::memory_order_relaxed);
+	}
+};
+
+/**
+ * @brief Recycled message pool for high-rate publishers
+ *
+ * boost::make_shared per handler call shows up in profiles at kHz
+ * stream rates. Messages from this pool return to the ring when the
+ * last subscriber drops them, so the steady state runs without
+ * allocation and static fields (covariance templates et al.) survive
+ * between uses and are filled exactly once.
+ *
+ * @note the pool must outlive subscribers holding its messages —
+ * for plugin members both end at node shutdown.
+ *
+ * @param size  ring capacity, must be power of two
+ */
+template <class M>
+class MsgPool {
+public:
+	explicit MsgPool(size_t size) : ring(size) { }
+
+	MsgPool(const MsgPool &) = delete;
+	MsgPool &operator=(const MsgPool &) = delete;
+
+	~MsgPool()
+	{
+		while (auto *m = ring.pop())
+			delete m;
+	}
+
+	/**
+	 * Get recycled or freshly allocated message.
+	 *
+	 * @param init  called once per fresh allocation,
+	 *              use it for fields that never change
+	 */
+	template <class F>
+	boost::shared_ptr<M> make(F init)
+	{
+		auto *m = ring.pop();
+		if (m == nullptr) {
+			m = new M();
+			init(*m);
+		}
+
+		return boost::shared_ptr<M>(m,
+				[this](M *p) {
+					if (!ring.push(p))
+						delete p;
+				});
+	}
+
+private:
+	mavconn::MPMCRing<M *> ring;
+};
+
 /**
  * @brief MAVROS Plugin base class
  */
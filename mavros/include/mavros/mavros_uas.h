@@ -20,11 +20,18 @@
 #include <array>
 #include <mutex>
 #include <atomic>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <condition_variable>
 #include <tf2_ros/transform_listener.h>
 #include <tf2_ros/transform_broadcaster.h>
 #include <diagnostic_updater/diagnostic_updater.h>
 #include <mavconn/interface.h>
 #include <mavros/utils.h>
+#include <mavros/seqlock.h>
+#include <mavros/geoid_mmap.h>
 #include <mavros/frame_tf.h>
 
 #include <GeographicLib/Geoid.hpp>
@@ -75,7 +82,7 @@ public:
 	using timesync_mode = utils::timesync_mode;
 
 	UAS();
-	~UAS() {};
+	~UAS();
 
 	/**
 	 * @brief MAVLink FCU device conection
@@ -187,6 +194,16 @@ public:
 	 */
 	geometry_msgs::Vector3 get_attitude_angular_velocity();
 
+	/**
+	 * @brief Get orientation and angular velocity from one snapshot
+	 *
+	 * One seqlock read instead of two, and both values are guaranteed
+	 * to come from the same IMU sample — separate accessor calls may
+	 * straddle an update at sensor rates.
+	 */
+	void get_attitude(geometry_msgs::Quaternion &orientation,
+			geometry_msgs::Vector3 &angular_velocity);
+
 
 	/* -*- GPS data -*- */
 
@@ -206,9 +223,13 @@ public:
 	/**
 	 * @brief Geoid dataset used to convert between AMSL and WGS-84
 	 *
-	 * That class loads egm96_5 dataset to RAM, it is about 24 MiB.
+	 * Memory-mapped egm96_5: page cache shared between processes,
+	 * initialized lazily on the first height conversion.
 	 */
-	std::shared_ptr<GeographicLib::Geoid> egm96_5;
+	std::shared_ptr<GeoidMmap> egm96_5;
+
+	//! RAM-cached fallback when the dataset cannot be mapped
+	std::shared_ptr<GeographicLib::Geoid> egm96_5_fallback;
 
 	/**
 	 * @brief Conversion from height above geoid (AMSL)
@@ -217,8 +238,12 @@ public:
 	template <class T>
 	inline double geoid_to_ellipsoid_height(T lla)
 	{
+		std::call_once(geoid_init_flag, [this] { init_geoid(); });
+
 		if (egm96_5)
 			return GeographicLib::Geoid::GEOIDTOELLIPSOID * (*egm96_5)(lla->latitude, lla->longitude);
+		else if (egm96_5_fallback)
+			return GeographicLib::Geoid::GEOIDTOELLIPSOID * (*egm96_5_fallback)(lla->latitude, lla->longitude);
 		else
 			return 0.0;
 	}
@@ -230,8 +255,12 @@ public:
 	template <class T>
 	inline double ellipsoid_to_geoid_height(T lla)
 	{
+		std::call_once(geoid_init_flag, [this] { init_geoid(); });
+
 		if (egm96_5)
 			return GeographicLib::Geoid::ELLIPSOIDTOGEOID * (*egm96_5)(lla->latitude, lla->longitude);
+		else if (egm96_5_fallback)
+			return GeographicLib::Geoid::ELLIPSOIDTOGEOID * (*egm96_5_fallback)(lla->latitude, lla->longitude);
 		else
 			return 0.0;
 	}
@@ -242,8 +271,80 @@ public:
 	tf2_ros::TransformListener tf2_listener;
 	tf2_ros::TransformBroadcaster tf2_broadcaster;
 
+	/**
+	 * @brief Queue a transform for the coalesced /tf broadcast
+	 *
+	 * Transforms submitted within the coalescing window are sent as
+	 * one /tf message, so co-published frames (local position,
+	 * odometry, ...) cost one listener wakeup instead of one each.
+	 * With the window at 0 this is a direct sendTransform().
+	 */
+	void tf2_send_transform(const geometry_msgs::TransformStamped &transform);
+
+	//! set the /tf coalescing window [us]; 0 disables batching
+	void set_tf_coalesce_window(uint32_t window_us);
+
+	//! Transform watch callback, see add_tf_watch()
+	using TransformWatchCb = std::function<void (const geometry_msgs::TransformStamped &)>;
+
+	/**
+	 * @brief Register a transform watch
+	 *
+	 * All watches share one dispatch thread instead of a polling
+	 * thread per plugin; a (frame_id, child_frame_id) pair is looked
+	 * up once per tick and the result fans out to every watcher of
+	 * that pair. Shared pairs are polled at the fastest rate
+	 * requested for them.
+	 *
+	 * @note watches live until node shutdown, there is no removal.
+	 *       Callbacks run on the dispatch thread and must not call
+	 *       add_tf_watch().
+	 */
+	void add_tf_watch(const std::string &frame_id, const std::string &child_frame_id,
+			double rate, TransformWatchCb cb);
+
+	/**
+	 * @brief Resolve a transform that is static for the process lifetime
+	 *
+	 * The first call per (target, source) pair walks the TF tree;
+	 * later calls return the cached isometry without touching the
+	 * buffer. The whole cache drops whenever a new /tf_static
+	 * message arrives, so late-published static frames are
+	 * re-resolved on the next call.
+	 *
+	 * @return false while the pair cannot be resolved yet
+	 */
+	bool get_static_transform(const std::string &target, const std::string &source,
+			Eigen::Affine3d &out);
+
 	/* -*- time sync -*- */
 
+	//! Clock model estimated by sys_time from TIMESYNC exchanges
+	struct ClockModel {
+		int64_t offset_ns;	//!< remote to local offset at the reference point
+		double skew;		//!< offset drift, ns per remote ns
+		uint64_t ref_remote_ns;	//!< remote time of the reference point
+		bool valid;
+	};
+
+	/**
+	 * @brief Publish new clock model estimate
+	 *
+	 * Readers extrapolate the offset between exchanges from the skew,
+	 * lock-free via the seqlock snapshot.
+	 */
+	inline void update_clock_model(int64_t offset_ns, double skew, uint64_t ref_remote_ns) {
+		ClockModel cm;
+		cm.offset_ns = offset_ns;
+		cm.skew = skew;
+		cm.ref_remote_ns = ref_remote_ns;
+		cm.valid = true;
+		clock_model.store(cm);
+
+		// legacy single-offset view
+		time_offset = offset_ns;
+	}
+
 	inline void set_time_offset(uint64_t offset_ns) {
 		time_offset = offset_ns;
 	}
@@ -359,6 +460,42 @@ public:
 private:
 	std::recursive_mutex mutex;
 
+	std::once_flag geoid_init_flag;
+	void init_geoid();
+
+	/* -*- /tf coalescing -*- */
+	std::mutex tf_batch_mutex;
+	std::condition_variable tf_batch_cv;
+	std::vector<geometry_msgs::TransformStamped> tf_batch;
+	std::atomic<uint32_t> tf_coalesce_us;
+	bool tf_batch_exit;
+	std::thread tf_batch_thread;
+	void tf_batch_loop();
+
+	/* -*- transform watch dispatch -*- */
+	//! one watched (frame, child_frame) pair with its subscribers
+	struct TFWatch {
+		std::string frame_id;
+		std::string child_frame_id;
+		ros::Duration period;
+		ros::Time next_due;
+		std::vector<TransformWatchCb> cb_vec;
+	};
+
+	std::mutex tf_watch_mutex;
+	std::condition_variable tf_watch_cv;
+	std::vector<TFWatch> tf_watch_list;
+	bool tf_watch_exit;
+	std::thread tf_watch_thread;
+	void tf_watch_loop();
+
+	/* -*- static transform cache -*- */
+	std::mutex static_tf_mutex;
+	//! key: target + '\t' + source; see get_static_transform()
+	std::unordered_map<std::string, Eigen::Affine3d, std::hash<std::string>, std::equal_to<std::string>,
+			Eigen::aligned_allocator<std::pair<const std::string, Eigen::Affine3d>>> static_tf_cache;
+	ros::Subscriber tf_static_sub;	//!< invalidates the cache
+
 	std::atomic<uint8_t> type;
 	std::atomic<uint8_t> autopilot;
 	std::atomic<uint8_t> base_mode;
@@ -369,15 +506,32 @@ private:
 	std::atomic<bool> connected;
 	std::vector<ConnectionCb> connection_cb_vec;
 
+	//! hot attitude snapshot, read at sensor rates by several plugins
+	struct AttitudeState {
+		geometry_msgs::Quaternion orientation;
+		geometry_msgs::Vector3 angular_velocity;
+		bool valid;
+	};
+
+	//! hot GPS quality snapshot
+	struct GpsState {
+		float eph;
+		float epv;
+		int fix_type;
+		int satellites_visible;
+	};
+
+	// full messages kept under mutex for the Ptr accessors; the
+	// plain-data snapshots below are seqlocked so the 250 Hz writers
+	// never contend with polling readers
 	sensor_msgs::Imu::Ptr imu_data;
-
 	sensor_msgs::NavSatFix::Ptr gps_fix;
-	float gps_eph;
-	float gps_epv;
-	int gps_fix_type;
-	int gps_satellites_visible;
+
+	Seqlock<AttitudeState> attitude_state;
+	Seqlock<GpsState> gps_state;
 
 	std::atomic<uint64_t> time_offset;
+	Seqlock<ClockModel> clock_model;
 	timesync_mode tsync_mode;
 
 	std::atomic<bool> fcu_caps_known;
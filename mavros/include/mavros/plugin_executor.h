@@ -0,0 +1,70 @@
+/**
+ * @brief Plugin handler executor
+ * @file plugin_executor.h
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup nodelib
+ * @{
+ */
+/*
+ * Copyright 2017 Vladimir Ermakov.
+ *
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <condition_variable>
+#include <mavconn/mavlink_dialect.h>
+
+namespace mavros {
+/**
+ * @brief Thread pool running plugin handlers off the mavconn rx thread
+ *
+ * Tasks are grouped into per-msgid lanes. A lane is drained by one
+ * worker at a time, so handlers for the same msgid always run in
+ * arrival order, while any idle worker may pick up any ready lane —
+ * one slow handler (Geoid math, Eigen transforms) no longer delays
+ * parsing or handlers of other messages.
+ */
+class PluginExecutor {
+public:
+	using Task = std::function<void()>;
+
+	explicit PluginExecutor(size_t n_threads);
+	~PluginExecutor();
+	PluginExecutor(const PluginExecutor&) = delete;
+
+	/**
+	 * @brief Queue a routed-message task.
+	 *
+	 * Tasks posted with the same msgid execute in posting order.
+	 */
+	void post(mavlink::msgid_t msgid, Task task);
+
+private:
+	//! per-msgid FIFO, processed by one worker at a time
+	struct Lane {
+		std::deque<Task> q;
+		bool active = false;
+	};
+
+	void worker_thread(size_t idx);
+
+	std::mutex mtx;
+	std::condition_variable cv;
+	std::unordered_map<mavlink::msgid_t, Lane> lanes;
+	//! lanes with queued tasks and no worker on them
+	std::deque<Lane *> ready;
+	std::vector<std::thread> workers;
+	bool shutdown;
+};
+}	// namespace mavros
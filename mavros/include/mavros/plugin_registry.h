@@ -0,0 +1,73 @@
+/**
+ * @brief Static plugin factory registry
+ * @file plugin_registry.h
+ *
+ * @addtogroup nodelib
+ * @{
+ */
+/*
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+
+#pragma once
+
+#include <vector>
+#include <mavros/mavros_plugin.h>
+
+namespace mavros {
+namespace plugin {
+/**
+ * @brief In-binary plugin factory table
+ *
+ * With the MAVROS_STATIC_PLUGINS build option the standard plugin
+ * set is linked into mavros_node and registered here before main()
+ * runs: MavRos then instantiates plugins straight from the table,
+ * skipping pluginlib's manifest scan and dlopen entirely. With the
+ * option off the table stays empty and nothing changes.
+ *
+ * pluginlib remains available either way (~load_dynamic_plugins),
+ * so out-of-tree plugins keep working.
+ */
+class StaticRegistry {
+public:
+	using Factory = PluginBase::Ptr (*)();
+
+	struct Entry {
+		const char *name;	//!< pluginlib lookup name
+		Factory make;
+	};
+
+	static std::vector<Entry> &table()
+	{
+		static std::vector<Entry> t;
+		return t;
+	}
+
+	//! registers one factory from a static initializer
+	struct Register {
+		Register(const char *name, Factory make)
+		{
+			table().push_back(Entry{name, make});
+		}
+	};
+};
+}	// namespace plugin
+}	// namespace mavros
+
+/**
+ * Exports a plugin factory under a predictable symbol, next to the
+ * PLUGINLIB_EXPORT_CLASS of the same class. The static registry TU
+ * references these symbols by name, which also keeps the plugin
+ * library from being dropped by --as-needed.
+ *
+ * @param klass fully qualified plugin class
+ * @param ident identifier-safe plugin name (registry key comes from
+ *              the registry list, which may differ, e.g. "3dr_radio")
+ */
+#define MAVROS_PLUGIN_FACTORY(klass, ident)	\
+	mavros::plugin::PluginBase::Ptr mavros_plugin_make_ ## ident()	\
+	{	\
+		return mavros::plugin::PluginBase::Ptr(new klass());	\
+	}
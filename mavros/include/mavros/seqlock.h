@@ -0,0 +1,71 @@
+/**
+ * @brief Seqlock-protected snapshot storage
+ * @file seqlock.h
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup nodelib
+ * @{
+ */
+/*
+ * Copyright 2017 Vladimir Ermakov.
+ *
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace mavros {
+/**
+ * @brief Single-writer seqlock around a small trivially-copyable value
+ *
+ * The writer never blocks: store() is two sequence bumps around a
+ * plain copy. Readers retry while a write is in flight (odd sequence)
+ * or raced one, which for our update rates effectively never happens.
+ * T must be trivially copyable and must not contain pointers into
+ * writer-owned storage.
+ */
+template <typename T>
+class Seqlock {
+public:
+	Seqlock() :
+		seq(0),
+		value{}
+	{ }
+
+	Seqlock(const Seqlock&) = delete;
+
+	//! Publish new value. Single writer only.
+	void store(const T &v)
+	{
+		auto s = seq.load(std::memory_order_relaxed);
+		seq.store(s + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		value = v;
+		seq.store(s + 2, std::memory_order_release);
+	}
+
+	//! Read consistent snapshot. Any thread, never blocks the writer.
+	T load() const
+	{
+		for (;;) {
+			auto s1 = seq.load(std::memory_order_acquire);
+			if (s1 & 1)
+				continue;
+
+			T v = value;
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (seq.load(std::memory_order_relaxed) == s1)
+				return v;
+		}
+	}
+
+private:
+	std::atomic<uint32_t> seq;
+	T value;
+};
+}	// namespace mavros
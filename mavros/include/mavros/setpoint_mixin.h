@@ -17,6 +17,7 @@
 #pragma once
 
 #include <functional>
+#include <stdexcept>
 #include <mavros/utils.h>
 #include <mavros/mavros_plugin.h>
 
@@ -24,6 +25,21 @@
 
 namespace mavros {
 namespace plugin {
+/* Setpoint mixins keep their message object as a member skeleton
+ * instead of constructing it on the stack per call: at 250 Hz
+ * offboard rates re-zeroing the struct each send is measurable and
+ * pointless when the previous values are simply overwritten.
+ *
+ * Byte-level patching of the serialized frame would not be correct:
+ * the per-link sequence number lands in the CRC and MAVLink v2 trims
+ * trailing payload zeros, so the wire image changes shape with the
+ * content — (re)framing stays in mavconn.
+ *
+ * @note not thread safe; each mixin instance expects a single
+ * setpoint source (topic callback or TF thread), which is how all
+ * callers stream.
+ */
+
 /**
  * @brief This mixin adds set_position_target_local_ned()
  */
@@ -31,7 +47,8 @@ template <class D>
 class SetPositionTargetLocalNEDMixin {
 public:
 	//! Message specification: @p http://mavlink.org/messages/common#SET_POSITION_TARGET_LOCAL_NED
-	void set_position_target_local_ned(uint32_t time_boot_ms, uint8_t coordinate_frame,
+	//! @return false when the tx queue rejected the message
+	bool set_position_target_local_ned(uint32_t time_boot_ms, uint8_t coordinate_frame,
 			uint16_t type_mask,
 			Eigen::Vector3d p,
 			Eigen::Vector3d v,
@@ -39,8 +56,9 @@ public:
 			float yaw, float yaw_rate)
 	{
 		mavros::UAS *m_uas_ = static_cast<D *>(this)->m_uas;
-		mavlink::common::msg::SET_POSITION_TARGET_LOCAL_NED sp;
+		auto &sp = sp_tpl;
 
+		// target may change on heartbeat, cheap to refresh
 		m_uas_->msg_set_target(sp);
 
 		// [[[cog:
@@ -66,8 +84,22 @@ public:
 		sp.afz = af.z();
 		// [[[end]]] (checksum: 6a9b9dacbcf85c5d428d754c20afe110)
 
-		UAS_FCU(m_uas_)->send_message_ignore_drop(sp);
+		try {
+			UAS_FCU(m_uas_)->send_message(sp);
+		}
+		catch (std::length_error &) {
+			// queue full: streaming callers just send the next
+			// sample, coalescing callers keep theirs pending
+			ROS_WARN_THROTTLE_NAMED(10, "setpoint", "SP: tx queue full, setpoint dropped");
+			return false;
+		}
+
+		return true;
 	}
+
+private:
+	//! message skeleton, reused between sends
+	mavlink::common::msg::SET_POSITION_TARGET_LOCAL_NED sp_tpl {};
 };
 
 /**
@@ -77,7 +109,8 @@ template <class D>
 class SetPositionTargetGlobalIntMixin {
 public:
 	//! Message specification: @p http://mavlink.org/messages/common#SET_POSITION_TARGET_GLOBAL_INT
-	void set_position_target_global_int(uint32_t time_boot_ms, uint8_t coordinate_frame,
+	//! @return false when the tx queue rejected the message
+	bool set_position_target_global_int(uint32_t time_boot_ms, uint8_t coordinate_frame,
 			uint16_t type_mask,
 			int32_t lat_int, int32_t lon_int, float alt,
 			Eigen::Vector3d v,
@@ -85,7 +118,7 @@ public:
 			float yaw, float yaw_rate)
 	{
 		mavros::UAS *m_uas_ = static_cast<D *>(this)->m_uas;
-		mavlink::common::msg::SET_POSITION_TARGET_GLOBAL_INT sp;
+		auto &sp = sp_tpl;
 
 		m_uas_->msg_set_target(sp);
 
@@ -112,8 +145,22 @@ public:
 		sp.afz = af.z();
 		// [[[end]]] (checksum: 30c9629ad309d488df1f63b683dac6a4)
 
-		UAS_FCU(m_uas_)->send_message_ignore_drop(sp);
+		try {
+			UAS_FCU(m_uas_)->send_message(sp);
+		}
+		catch (std::length_error &) {
+			// queue full: streaming callers just send the next
+			// sample, coalescing callers keep theirs pending
+			ROS_WARN_THROTTLE_NAMED(10, "setpoint", "SP: tx queue full, setpoint dropped");
+			return false;
+		}
+
+		return true;
 	}
+
+private:
+	//! message skeleton, reused between sends
+	mavlink::common::msg::SET_POSITION_TARGET_GLOBAL_INT sp_tpl {};
 };
 
 /**
@@ -123,14 +170,15 @@ template <class D>
 class SetAttitudeTargetMixin {
 public:
 	//! Message sepecification: @p http://mavlink.org/messages/common#SET_ATTITIDE_TARGET
-	void set_attitude_target(uint32_t time_boot_ms,
+	//! @return false when the tx queue rejected the message
+	bool set_attitude_target(uint32_t time_boot_ms,
 			uint8_t type_mask,
 			Eigen::Quaterniond orientation,
 			Eigen::Vector3d body_rate,
 			float thrust)
 	{
 		mavros::UAS *m_uas_ = static_cast<D *>(this)->m_uas;
-		mavlink::common::msg::SET_ATTITUDE_TARGET sp;
+		auto &sp = sp_tpl;
 
 		m_uas_->msg_set_target(sp);
 		mavros::ftf::quaternion_to_mavlink(orientation, sp.q);
@@ -149,12 +197,26 @@ public:
 		sp.body_yaw_rate = body_rate.z();
 		// [[[end]]] (checksum: aa941484927bb7a7d39a2c31d08fcfc1)
 
-		UAS_FCU(m_uas_)->send_message_ignore_drop(sp);
+		try {
+			UAS_FCU(m_uas_)->send_message(sp);
+		}
+		catch (std::length_error &) {
+			// queue full: streaming callers just send the next
+			// sample, coalescing callers keep theirs pending
+			ROS_WARN_THROTTLE_NAMED(10, "setpoint", "SP: tx queue full, setpoint dropped");
+			return false;
+		}
+
+		return true;
 	}
+
+private:
+	//! message skeleton, reused between sends
+	mavlink::common::msg::SET_ATTITUDE_TARGET sp_tpl {};
 };
 
 /**
- * @brief This mixin adds TF2 listener thread to plugin
+ * @brief This mixin adds TF2 listening to plugin
  *
  * It requires tf_frame_id, tf_child_frame_id strings
  * tf_rate double and uas object pointer
@@ -162,13 +224,15 @@ public:
 template <class D>
 class TF2ListenerMixin {
 public:
-	std::thread tf_thread;
 	std::string tf_thd_name;
 
 	/**
-	 * @brief start tf listener
+	 * @brief register watch on the shared UAS transform dispatcher
 	 *
-	 * @param _thd_name  listener thread name
+	 * One UAS thread serves all plugin watches; lookups of the same
+	 * frame pair are shared. See UAS::add_tf_watch().
+	 *
+	 * @param _thd_name  watch name (kept from the per-plugin thread era)
 	 * @param cbp        plugin callback function
 	 */
 	void tf2_start(const char *_thd_name, void (D::*cbp)(const geometry_msgs::TransformStamped &) )
@@ -176,29 +240,12 @@ public:
 		tf_thd_name = _thd_name;
 		auto tf_transform_cb = std::bind(cbp, static_cast<D *>(this), std::placeholders::_1);
 
-		tf_thread = std::thread([this, tf_transform_cb]() {
-			mavconn::utils::set_this_thread_name("%s", tf_thd_name.c_str());
-
-			mavros::UAS *m_uas_ = static_cast<D *>(this)->m_uas;
-			std::string &_frame_id = static_cast<D *>(this)->tf_frame_id;
-			std::string &_child_frame_id = static_cast<D *>(this)->tf_child_frame_id;
-
-			ros::Rate rate(static_cast<D *>(this)->tf_rate);
-			while (ros::ok()) {
-				// Wait up to 3s for transform
-				if (m_uas_->tf2_buffer.canTransform(_frame_id, _child_frame_id, ros::Time(0), ros::Duration(3.0))) {
-					try {
-						auto transform = m_uas_->tf2_buffer.lookupTransform(
-								_frame_id, _child_frame_id, ros::Time(0), ros::Duration(3.0));
-						tf_transform_cb(transform);
-					}
-					catch (tf2::LookupException &ex) {
-						ROS_ERROR_NAMED("tf2_buffer", "%s: %s", tf_thd_name.c_str(), ex.what());
-					}
-				}
-				rate.sleep();
-			}
-		});
+		mavros::UAS *m_uas_ = static_cast<D *>(this)->m_uas;
+		m_uas_->add_tf_watch(
+				static_cast<D *>(this)->tf_frame_id,
+				static_cast<D *>(this)->tf_child_frame_id,
+				static_cast<D *>(this)->tf_rate,
+				tf_transform_cb);
 	}
 };
 }	// namespace plugin
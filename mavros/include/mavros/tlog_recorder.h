@@ -0,0 +1,80 @@
+/**
+ * @brief Memory-mapped tlog recorder
+ * @file tlog_recorder.h
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup nodelib
+ * @{
+ */
+/*
+ * Copyright 2017 Vladimir Ermakov.
+ *
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <mavconn/mavlink_dialect.h>
+
+namespace mavros {
+/**
+ * @brief Lossless raw-frame flight log
+ *
+ * Appends standard tlog records (8-byte big-endian epoch-microsecond
+ * timestamp + wire frame) into a size-preallocated memory-mapped
+ * segment: the per-message cost is one clock read and one frame
+ * serialization straight into the mapping — no allocation, no
+ * syscall. A background thread msync()s on a fixed cadence; when a
+ * segment fills, the recorder trims it and rotates to the next file.
+ *
+ * write() is single-producer: call it from the rx callback only.
+ */
+class TlogRecorder {
+public:
+	/**
+	 * @param prefix	segment path prefix, ".N.tlog" is appended
+	 * @param segment_mb	preallocated segment size [MiB]
+	 *
+	 * @throws std::runtime_error on segment creation failure
+	 */
+	TlogRecorder(const std::string &prefix, size_t segment_mb);
+	~TlogRecorder();
+
+	TlogRecorder(const TlogRecorder &) = delete;
+	TlogRecorder &operator=(const TlogRecorder &) = delete;
+
+	//! append one frame (rx thread only)
+	void write(const mavlink::mavlink_message_t *msg);
+
+private:
+	//! timestamp + worst-case v2 signed frame
+	static constexpr size_t MAX_RECORD_SIZE = 8 + MAVLINK_MAX_PACKET_LEN + 16;
+	static constexpr int SYNC_INTERVAL_MS = 500;
+
+	std::string prefix;
+	size_t map_size;
+	size_t file_no;
+
+	int fd;
+	uint8_t *map;
+	//! bytes written; the sync thread trails it
+	std::atomic<size_t> cursor;
+
+	//! serializes rotation against the background msync
+	std::mutex segment_mutex;
+	size_t synced;
+
+	std::atomic<bool> should_exit;
+	std::thread sync_thread;
+
+	void open_segment();
+	void close_segment();
+	void sync_loop();
+};
+}	// namespace mavros
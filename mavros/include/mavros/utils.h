@@ -74,6 +74,21 @@ std::string to_string(mavlink::common::MAV_ESTIMATOR_TYPE e);
 std::string to_string(mavlink::common::ADSB_ALTITUDE_TYPE e);
 std::string to_string(mavlink::common::ADSB_EMITTER_TYPE e);
 
+/**
+ * Allocation-free to_string() variants: a pointer into the constexpr
+ * string table, or nullptr when the value has no entry (where
+ * to_string() falls back to the numeric representation). For paths
+ * that stringify at telemetry rate.
+ */
+const char *to_cstring(timesync_mode e);
+const char *to_cstring(mavlink::common::MAV_SENSOR_ORIENTATION e);
+const char *to_cstring(mavlink::common::MAV_AUTOPILOT e);
+const char *to_cstring(mavlink::common::MAV_TYPE e);
+const char *to_cstring(mavlink::common::MAV_STATE e);
+const char *to_cstring(mavlink::common::MAV_ESTIMATOR_TYPE e);
+const char *to_cstring(mavlink::common::ADSB_ALTITUDE_TYPE e);
+const char *to_cstring(mavlink::common::ADSB_EMITTER_TYPE e);
+
 /**
  * Helper to call to_string() for enum _T
  */
@@ -11,6 +11,7 @@
  * https://github.com/mavlink/mavros/tree/master/LICENSE.md
  */
 
+#include <array>
 #include <ros/ros.h>
 #include <ros/console.h>
 
@@ -25,6 +26,10 @@ ros::Publisher mavlink_pub;
 ros::Subscriber mavlink_sub;
 MAVConnInterface::Ptr gcs_link;
 
+// splice mode only
+MAVConnInterface::Ptr fcu_link;
+ros::Publisher from_tap_pub;
+
 
 void mavlink_pub_cb(const mavlink::mavlink_message_t *mmsg, const mavconn::Framing framing)
 {
@@ -45,6 +50,33 @@ void mavlink_sub_cb(const mavros_msgs::Mavlink::ConstPtr &rmsg)
 		ROS_ERROR("Packet drop: convert error.");
 }
 
+/**
+ * Splice mode: forward the wire image straight to the other endpoint,
+ * no rosmsg conversion and no pub/sub hop. The optional ROS tap only
+ * pays the conversion while someone actually subscribes.
+ */
+void splice_cb(const MAVConnInterface::Ptr &dst, ros::Publisher &tap,
+		const mavlink::mavlink_message_t *mmsg, const mavconn::Framing framing)
+{
+	std::array<uint8_t, MAVLINK_MAX_PACKET_LEN + 16> buf;
+	auto len = mavlink::mavlink_msg_to_send_buffer(buf.data(), mmsg);
+
+	try {
+		dst->send_bytes(buf.data(), len);
+	}
+	catch (std::length_error &e) {
+		ROS_WARN_THROTTLE(10, "Packet drop: %s", e.what());
+	}
+
+	if (tap.getNumSubscribers() > 0) {
+		auto rmsg = boost::make_shared<mavros_msgs::Mavlink>();
+
+		rmsg->header.stamp = ros::Time::now();
+		mavros_msgs::mavlink::convert(*mmsg, *rmsg, mavros::utils::enum_value(framing));
+		tap.publish(rmsg);
+	}
+}
+
 int main(int argc, char *argv[])
 {
 	ros::init(argc, argv, "gcs_bridge");
@@ -52,9 +84,12 @@ int main(int argc, char *argv[])
 	ros::NodeHandle mavlink_nh("mavlink");
 	diagnostic_updater::Updater updater;
 	mavros::MavlinkDiag gcs_link_diag("GCS bridge");
+	mavros::MavlinkDiag fcu_link_diag("FCU splice");
 
-	std::string gcs_url;
+	std::string gcs_url, fcu_url;
 	priv_nh.param<std::string>("gcs_url", gcs_url, "udp://@");
+	// non-empty: open both endpoints here and splice them directly
+	priv_nh.param<std::string>("fcu_url", fcu_url, "");
 
 	try {
 		gcs_link = MAVConnInterface::open_url(gcs_url);
@@ -66,18 +101,45 @@ int main(int argc, char *argv[])
 		return 1;
 	}
 
-	mavlink_pub = mavlink_nh.advertise<mavros_msgs::Mavlink>("to", 10);
-	gcs_link->message_received_cb = mavlink_pub_cb;
-
-	// prefer UDPROS, but allow TCPROS too
-	mavlink_sub = mavlink_nh.subscribe("from", 10, mavlink_sub_cb,
-		ros::TransportHints()
-			.unreliable().maxDatagramSize(1024)
-			.reliable());
+	if (fcu_url != "") {
+		ROS_INFO_STREAM("Splice mode, FCU URL: " << fcu_url);
+		try {
+			fcu_link = MAVConnInterface::open_url(fcu_url);
+			fcu_link_diag.set_mavconn(fcu_link);
+			fcu_link_diag.set_connection_status(true);
+		}
+		catch (mavconn::DeviceError &ex) {
+			ROS_FATAL("FCU: %s", ex.what());
+			return 1;
+		}
+
+		// observability taps, same topics as the proxy mode
+		from_tap_pub = mavlink_nh.advertise<mavros_msgs::Mavlink>("from", 10);
+		mavlink_pub = mavlink_nh.advertise<mavros_msgs::Mavlink>("to", 10);
+
+		fcu_link->message_received_cb = [](const mavlink::mavlink_message_t *mmsg, const mavconn::Framing framing) {
+			splice_cb(gcs_link, from_tap_pub, mmsg, framing);
+		};
+		gcs_link->message_received_cb = [](const mavlink::mavlink_message_t *mmsg, const mavconn::Framing framing) {
+			splice_cb(fcu_link, mavlink_pub, mmsg, framing);
+		};
+	}
+	else {
+		mavlink_pub = mavlink_nh.advertise<mavros_msgs::Mavlink>("to", 10);
+		gcs_link->message_received_cb = mavlink_pub_cb;
+
+		// prefer UDPROS, but allow TCPROS too
+		mavlink_sub = mavlink_nh.subscribe("from", 10, mavlink_sub_cb,
+			ros::TransportHints()
+				.unreliable().maxDatagramSize(1024)
+				.reliable());
+	}
 
 	// setup updater
 	updater.setHardwareID(gcs_url);
 	updater.add(gcs_link_diag);
+	if (fcu_link)
+		updater.add(fcu_link_diag);
 
 	// updater spinner
 	auto diag_timer = priv_nh.createTimer(ros::Duration(0.5),
@@ -23,11 +23,13 @@ namespace utils {
 
 using mavlink::common::MAV_SENSOR_ORIENTATION;
 
-// internal type: name - rotation
-using OrientationPair = std::pair<const std::string, const Eigen::Quaterniond>;
+// internal type: name - rotation.
+// the name is a string literal: lookups hand out the pointer without
+// allocating (see to_cstring)
+using OrientationPair = std::pair<const char *, const Eigen::Quaterniond>;
 
 // internal data initializer
-static const OrientationPair make_orientation(const std::string &name,
+static const OrientationPair make_orientation(const char *name,
 	const double roll,
 	const double pitch,
 	const double yaw)
@@ -114,15 +116,25 @@ static const std::array<const OrientationPair, 39> sensor_orientations{{
 // [[[end]]] (checksum: aa58ff53a1c7ba31228319345c1145e3)
 
 
-std::string to_string(MAV_SENSOR_ORIENTATION orientation)
+const char *to_cstring(MAV_SENSOR_ORIENTATION orientation)
 {
 	const auto idx = enum_value(orientation);
-	if (idx >= sensor_orientations.size()) {
+	if (idx >= sensor_orientations.size())
+		return nullptr;
+
+	return sensor_orientations[idx].first;
+}
+
+std::string to_string(MAV_SENSOR_ORIENTATION orientation)
+{
+	const char *s = to_cstring(orientation);
+	if (s == nullptr) {
+		const auto idx = enum_value(orientation);
 		ROS_ERROR_NAMED("uas", "SENSOR: wrong orientation index: %d", idx);
 		return std::to_string(idx);
 	}
 
-	return sensor_orientations[idx].first;
+	return s;
 }
 
 Eigen::Quaterniond sensor_orientation_matching(MAV_SENSOR_ORIENTATION orientation)
@@ -53,18 +53,27 @@ using mavlink::common::ADSB_EMITTER_TYPE;
 // def array_outl(name, enum):
 //     array = ename_array_name(name)
 //     cog.outl("//! %s values" % name)
-//     cog.outl("static const std::array<const std::string, %s> %s{{" % (len(enum), array))
+//     cog.outl("static constexpr std::array<const char *, %s> %s{{" % (len(enum), array))
 //
 // def to_string_outl(ename):
 //     array = ename_array_name(ename)
-//     cog.outl("std::string to_string({ename} e)".format(**locals()))
+//     cog.outl("const char *to_cstring({ename} e)".format(**locals()))
 //     cog.outl("{")
 //     cog.outl("	size_t idx = enum_value(e);")
 //     cog.outl("	if (idx >= {array}.size())".format(**locals()))
-//     cog.outl("		return std::to_string(idx);")
+//     cog.outl("		return nullptr;")
 //     cog.outl()
 //     cog.outl("	return {array}[idx];".format(**locals()))
 //     cog.outl("}")
+//     cog.outl()
+//     cog.outl("std::string to_string({ename} e)".format(**locals()))
+//     cog.outl("{")
+//     cog.outl("	const char *s = to_cstring(e);")
+//     cog.outl("	if (s == nullptr)")
+//     cog.outl("		return std::to_string(enum_value(e));")
+//     cog.outl()
+//     cog.outl("	return s;")
+//     cog.outl("}")
 //
 // ename = 'MAV_AUTOPILOT'
 // enum = get_enum(ename)
@@ -80,7 +89,7 @@ using mavlink::common::ADSB_EMITTER_TYPE;
 // to_string_outl(ename)
 // ]]]
 //! MAV_AUTOPILOT values
-static const std::array<const std::string, 18> mav_autopilot_strings{{
+static constexpr std::array<const char *, 18> mav_autopilot_strings{{
 /*  0 */ "Generic autopilot",             // Generic autopilot, full support for everything
 /*  1 */ "Reserved for future use",       // Reserved for future use.
 /*  2 */ "SLUGS autopilot",               // SLUGS autopilot, http://slugsuav.soe.ucsc.edu
@@ -101,15 +110,24 @@ static const std::array<const std::string, 18> mav_autopilot_strings{{
 /* 17 */ "ASLUAV autopilot",              // ASLUAV autopilot -- http://www.asl.ethz.ch
 }};
 
-std::string to_string(MAV_AUTOPILOT e)
+const char *to_cstring(MAV_AUTOPILOT e)
 {
 	size_t idx = enum_value(e);
 	if (idx >= mav_autopilot_strings.size())
-		return std::to_string(idx);
+		return nullptr;
 
 	return mav_autopilot_strings[idx];
 }
-// [[[end]]] (checksum: c0f450ce84a31ce0f86d439c007cf805)
+
+std::string to_string(MAV_AUTOPILOT e)
+{
+	const char *s = to_cstring(e);
+	if (s == nullptr)
+		return std::to_string(enum_value(e));
+
+	return s;
+}
+// [[[end]]] (checksum: 38cdae55d72968d2a1a4f3ee33c4de2f)
 
 // [[[cog:
 // ename = 'MAV_TYPE'
@@ -126,7 +144,7 @@ std::string to_string(MAV_AUTOPILOT e)
 // to_string_outl(ename)
 // ]]]
 //! MAV_TYPE values
-static const std::array<const std::string, 28> mav_type_strings{{
+static constexpr std::array<const char *, 28> mav_type_strings{{
 /*  0 */ "Generic micro air vehicle",     // Generic micro air vehicle.
 /*  1 */ "Fixed wing aircraft",           // Fixed wing aircraft.
 /*  2 */ "Quadrotor",                     // Quadrotor
@@ -157,15 +175,24 @@ static const std::array<const std::string, 28> mav_type_strings{{
 /* 27 */ "Onboard ADSB peripheral",       // Onboard ADSB peripheral
 }};
 
-std::string to_string(MAV_TYPE e)
+const char *to_cstring(MAV_TYPE e)
 {
 	size_t idx = enum_value(e);
 	if (idx >= mav_type_strings.size())
-		return std::to_string(idx);
+		return nullptr;
 
 	return mav_type_strings[idx];
 }
-// [[[end]]] (checksum: ff3fd0c445310aef4a3cfb14a18178e0)
+
+std::string to_string(MAV_TYPE e)
+{
+	const char *s = to_cstring(e);
+	if (s == nullptr)
+		return std::to_string(enum_value(e));
+
+	return s;
+}
+// [[[end]]] (checksum: f4f9fc915a78c5db2902244866b94ac6)
 
 // [[[cog:
 // ename = 'MAV_STATE'
@@ -182,7 +209,7 @@ std::string to_string(MAV_TYPE e)
 // to_string_outl(ename)
 // ]]]
 //! MAV_STATE values
-static const std::array<const std::string, 8> mav_state_strings{{
+static constexpr std::array<const char *, 8> mav_state_strings{{
 /*  0 */ "Uninit",                        // Uninitialized system, state is unknown.
 /*  1 */ "Boot",                          // System is booting up.
 /*  2 */ "Calibrating",                   // System is calibrating and not flight-ready.
@@ -193,15 +220,24 @@ static const std::array<const std::string, 8> mav_state_strings{{
 /*  7 */ "Poweroff",                      // System just initialized its power-down sequence, will shut down now.
 }};
 
-std::string to_string(MAV_STATE e)
+const char *to_cstring(MAV_STATE e)
 {
 	size_t idx = enum_value(e);
 	if (idx >= mav_state_strings.size())
-		return std::to_string(idx);
+		return nullptr;
 
 	return mav_state_strings[idx];
 }
-// [[[end]]] (checksum: 47dea7c5bd6ab53dbc75a6c51b35d312)
+
+std::string to_string(MAV_STATE e)
+{
+	const char *s = to_cstring(e);
+	if (s == nullptr)
+		return std::to_string(enum_value(e));
+
+	return s;
+}
+// [[[end]]] (checksum: df2a4b928bda4a403a67215bd31204e1)
 
 // [[[cog:
 // ename = "timesync_mode"
@@ -216,22 +252,31 @@ std::string to_string(MAV_STATE e)
 // to_string_outl(ename)
 // ]]]
 //! timesync_mode values
-static const std::array<const std::string, 4> timesync_mode_strings{{
+static constexpr std::array<const char *, 4> timesync_mode_strings{{
 /*  0 */ "NONE",
 /*  1 */ "MAVLINK",
 /*  2 */ "ONBOARD",
 /*  3 */ "PASSTHROUGH",
 }};
 
-std::string to_string(timesync_mode e)
+const char *to_cstring(timesync_mode e)
 {
 	size_t idx = enum_value(e);
 	if (idx >= timesync_mode_strings.size())
-		return std::to_string(idx);
+		return nullptr;
 
 	return timesync_mode_strings[idx];
 }
-// [[[end]]] (checksum: 2796eaa4f9361c2d7ca87f63e0401d4d)
+
+std::string to_string(timesync_mode e)
+{
+	const char *s = to_cstring(e);
+	if (s == nullptr)
+		return std::to_string(enum_value(e));
+
+	return s;
+}
+// [[[end]]] (checksum: b1983347f15c91353e87262c0bc37ba3)
 
 timesync_mode timesync_mode_from_str(const std::string &mode)
 {
@@ -265,27 +310,36 @@ timesync_mode timesync_mode_from_str(const std::string &mode)
 // enum_name_is_value_outl(ename)
 // ]]]
 //! ADSB_ALTITUDE_TYPE values
-static const std::array<const std::string, 2> adsb_altitude_type_strings{{
+static constexpr std::array<const char *, 2> adsb_altitude_type_strings{{
 /*  0 */ "PRESSURE_QNH",                  // Altitude reported from a Baro source using QNH reference
 /*  1 */ "GEOMETRIC",                     // Altitude reported from a GNSS source
 }};
 
-std::string to_string(ADSB_ALTITUDE_TYPE e)
+const char *to_cstring(ADSB_ALTITUDE_TYPE e)
 {
 	size_t idx = enum_value(e);
 	if (idx >= adsb_altitude_type_strings.size())
-		return std::to_string(idx);
+		return nullptr;
 
 	return adsb_altitude_type_strings[idx];
 }
-// [[[end]]] (checksum: dc127bf29aefa513471d13c5a0e1e6ec)
+
+std::string to_string(ADSB_ALTITUDE_TYPE e)
+{
+	const char *s = to_cstring(e);
+	if (s == nullptr)
+		return std::to_string(enum_value(e));
+
+	return s;
+}
+// [[[end]]] (checksum: 27f4e0a4d6c4d4ed09a615af70019522)
 
 // [[[cog:
 // ename = 'ADSB_EMITTER_TYPE'
 // enum_name_is_value_outl(ename)
 // ]]]
 //! ADSB_EMITTER_TYPE values
-static const std::array<const std::string, 20> adsb_emitter_type_strings{{
+static constexpr std::array<const char *, 20> adsb_emitter_type_strings{{
 /*  0 */ "NO_INFO",                       // 
 /*  1 */ "LIGHT",                         // 
 /*  2 */ "SMALL",                         // 
@@ -308,22 +362,31 @@ static const std::array<const std::string, 20> adsb_emitter_type_strings{{
 /* 19 */ "POINT_OBSTACLE",                // 
 }};
 
-std::string to_string(ADSB_EMITTER_TYPE e)
+const char *to_cstring(ADSB_EMITTER_TYPE e)
 {
 	size_t idx = enum_value(e);
 	if (idx >= adsb_emitter_type_strings.size())
-		return std::to_string(idx);
+		return nullptr;
 
 	return adsb_emitter_type_strings[idx];
 }
-// [[[end]]] (checksum: ef0b869c7c1937e80b3e1297eda40e2c)
+
+std::string to_string(ADSB_EMITTER_TYPE e)
+{
+	const char *s = to_cstring(e);
+	if (s == nullptr)
+		return std::to_string(enum_value(e));
+
+	return s;
+}
+// [[[end]]] (checksum: c434f0830b3f978a55737e608bfc4316)
 
 // [[[cog:
 // ename = 'MAV_ESTIMATOR_TYPE'
 // enum_name_is_value_outl(ename)
 // ]]]
 //! MAV_ESTIMATOR_TYPE values
-static const std::array<const std::string, 5> mav_estimator_type_strings{{
+static constexpr std::array<const char *, 5> mav_estimator_type_strings{{
 /*  1 */ "NAIVE",                         // This is a naive estimator without any real covariance feedback.
 /*  2 */ "VISION",                        // Computer vision based estimate. Might be up to scale.
 /*  3 */ "VIO",                           // Visual-inertial estimate.
@@ -331,15 +394,24 @@ static const std::array<const std::string, 5> mav_estimator_type_strings{{
 /*  5 */ "GPS_INS",                       // Estimator integrating GPS and inertial sensing.
 }};
 
-std::string to_string(MAV_ESTIMATOR_TYPE e)
+const char *to_cstring(MAV_ESTIMATOR_TYPE e)
 {
 	size_t idx = enum_value(e);
 	if (idx >= mav_estimator_type_strings.size())
-		return std::to_string(idx);
+		return nullptr;
 
 	return mav_estimator_type_strings[idx];
 }
-// [[[end]]] (checksum: 47674f004bf6c515fdf999987b99e806)
+
+std::string to_string(MAV_ESTIMATOR_TYPE e)
+{
+	const char *s = to_cstring(e);
+	if (s == nullptr)
+		return std::to_string(enum_value(e));
+
+	return s;
+}
+// [[[end]]] (checksum: e340185c1174d929355db82b16d4a94f)
 
 }	// namespace utils
 }	// namespace mavros
@@ -58,10 +58,21 @@ static const auto NED_ENU_R = NED_ENU_Q.normalized().toRotationMatrix();
 static const auto AIRCRAFT_BASELINK_R = AIRCRAFT_BASELINK_Q.normalized().toRotationMatrix();
 
 /**
- * @brief Auxiliar matrices to Covariance transforms
+ * @brief Blockwise similarity transform of a block-rotated covariance
+ *
+ * The 6d/9d rotation is the 3x3 rotation repeated on the diagonal, so
+ * out(i,j) = R * in(i,j) * R^T per 3x3 block. All products are
+ * fixed-size: Eigen unrolls and vectorizes them, and no NxN rotation
+ * matrix is assembled per call.
  */
-using Matrix6d = Eigen::Matrix<double, 6, 6>;
-using Matrix9d = Eigen::Matrix<double, 9, 9>;
+template <typename OutMap, typename InMap>
+static inline void transform_cov_blockwise(OutMap cov_out, InMap cov_in, const Eigen::Matrix3d &R)
+{
+	for (int i = 0; i < InMap::RowsAtCompileTime; i += 3)
+		for (int j = 0; j < InMap::ColsAtCompileTime; j += 3)
+			cov_out.template block<3, 3>(i, j).noalias() =
+				R * cov_in.template block<3, 3>(i, j) * R.transpose();
+}
 
 
 Eigen::Quaterniond transform_orientation(const Eigen::Quaterniond &q, const StaticTF transform)
@@ -115,7 +126,6 @@ Covariance3d transform_static_frame(const Covariance3d &cov, const StaticTF tran
 Covariance6d transform_static_frame(const Covariance6d &cov, const StaticTF transform)
 {
 	Covariance6d cov_out_;
-	Matrix6d R = Matrix6d::Zero();	// not `auto` because Zero ret is const
 
 	EigenMapConstCovariance6d cov_in(cov.data());
 	EigenMapCovariance6d cov_out(cov_out_.data());
@@ -123,18 +133,12 @@ Covariance6d transform_static_frame(const Covariance6d &cov, const StaticTF tran
 	switch (transform) {
 	case StaticTF::NED_TO_ENU:
 	case StaticTF::ENU_TO_NED:
-		R.block<3, 3>(0, 0) =
-			R.block<3, 3>(3, 3) = NED_ENU_R;
-
-		cov_out = R * cov_in * R.transpose();
+		transform_cov_blockwise(cov_out, cov_in, NED_ENU_R);
 		return cov_out_;
 
 	case StaticTF::AIRCRAFT_TO_BASELINK:
 	case StaticTF::BASELINK_TO_AIRCRAFT:
-		R.block<3, 3>(0, 0) =
-			R.block<3, 3>(3, 3) = AIRCRAFT_BASELINK_R;
-
-		cov_out = R * cov_in * R.transpose();
+		transform_cov_blockwise(cov_out, cov_in, AIRCRAFT_BASELINK_R);
 		return cov_out_;
 	}
 }
@@ -142,7 +146,6 @@ Covariance6d transform_static_frame(const Covariance6d &cov, const StaticTF tran
 Covariance9d transform_static_frame(const Covariance9d &cov, const StaticTF transform)
 {
 	Covariance9d cov_out_;
-	Matrix9d R = Matrix9d::Zero();
 
 	EigenMapConstCovariance9d cov_in(cov.data());
 	EigenMapCovariance9d cov_out(cov_out_.data());
@@ -150,20 +153,12 @@ Covariance9d transform_static_frame(const Covariance9d &cov, const StaticTF tran
 	switch (transform) {
 	case StaticTF::NED_TO_ENU:
 	case StaticTF::ENU_TO_NED:
-		R.block<3, 3>(0, 0) =
-			R.block<3, 3>(3, 3) =
-				R.block<3, 3>(6, 6) = NED_ENU_R;
-
-		cov_out = R * cov_in * R.transpose();
+		transform_cov_blockwise(cov_out, cov_in, NED_ENU_R);
 		return cov_out_;
 
 	case StaticTF::AIRCRAFT_TO_BASELINK:
 	case StaticTF::BASELINK_TO_AIRCRAFT:
-		R.block<3, 3>(0, 0) =
-			R.block<3, 3>(3, 3) =
-				R.block<3, 3>(6, 6) = AIRCRAFT_BASELINK_R;
-
-		cov_out = R * cov_in * R.transpose();
+		transform_cov_blockwise(cov_out, cov_in, AIRCRAFT_BASELINK_R);
 		return cov_out_;
 	}
 }
@@ -187,34 +182,38 @@ Covariance3d transform_frame(const Covariance3d &cov, const Eigen::Quaterniond &
 Covariance6d transform_frame(const Covariance6d &cov, const Eigen::Quaterniond &q)
 {
 	Covariance6d cov_out_;
-	Matrix6d R = Matrix6d::Zero();
 
 	EigenMapConstCovariance6d cov_in(cov.data());
 	EigenMapCovariance6d cov_out(cov_out_.data());
 
-	R.block<3, 3>(0, 0) =
-		R.block<3, 3>(3, 3) = q.normalized().toRotationMatrix();
-
-	cov_out = R * cov_in * R.transpose();
+	transform_cov_blockwise(cov_out, cov_in, q.normalized().toRotationMatrix());
 	return cov_out_;
 }
 
 Covariance9d transform_frame(const Covariance9d &cov, const Eigen::Quaterniond &q)
 {
 	Covariance9d cov_out_;
-	Matrix9d R = Matrix9d::Zero();
 
 	EigenMapConstCovariance9d cov_in(cov.data());
 	EigenMapCovariance9d cov_out(cov_out_.data());
 
-	R.block<3, 3>(0, 0) =
-		R.block<3, 3>(3, 3) =
-			R.block<3, 3>(6, 6) = q.normalized().toRotationMatrix();
-
-	cov_out = R * cov_in * R.transpose();
+	transform_cov_blockwise(cov_out, cov_in, q.normalized().toRotationMatrix());
 	return cov_out_;
 }
 
+void transform_frame_batch(const Covariance6d *cov_in, Covariance6d *cov_out, size_t count,
+		const Eigen::Quaterniond &q)
+{
+	// one rotation setup for the whole array
+	const Eigen::Matrix3d R = q.normalized().toRotationMatrix();
+
+	for (size_t k = 0; k < count; k++) {
+		EigenMapConstCovariance6d in(cov_in[k].data());
+		EigenMapCovariance6d out(cov_out[k].data());
+		transform_cov_blockwise(out, in, R);
+	}
+}
+
 }	// namespace detail
 }	// namespace ftf
 }	// namespace mavros
@@ -24,31 +24,56 @@ MavlinkDiag::MavlinkDiag(std::string name) :
 void MavlinkDiag::run(diagnostic_updater::DiagnosticStatusWrapper &stat)
 {
 	if (auto link = weak_link.lock()) {
-		auto mav_status = link->get_status();
-		auto iostat = link->get_iostat();
-
-		stat.addf("Received packets:", "%u", mav_status.packet_rx_success_count);
-		stat.addf("Dropped packets:", "%u", mav_status.packet_rx_drop_count);
-		stat.addf("Buffer overruns:", "%u", mav_status.buffer_overrun);
-		stat.addf("Parse errors:", "%u", mav_status.parse_error);
-		stat.addf("Rx sequence number:", "%u", mav_status.current_rx_seq);
-		stat.addf("Tx sequence number:", "%u", mav_status.current_tx_seq);
-
-		stat.addf("Rx total bytes:", "%u", iostat.rx_total_bytes);
-		stat.addf("Tx total bytes:", "%u", iostat.tx_total_bytes);
-		stat.addf("Rx speed:", "%f", iostat.rx_speed);
-		stat.addf("Tx speed:", "%f", iostat.tx_speed);
-
-		if (mav_status.packet_rx_drop_count > last_drop_count)
+		// lock-free seqlocked snapshot published by the IO thread:
+		// the diag timer must never contend with the rx/tx hot path
+		mavconn::MAVConnInterface::StatSnapshot ss {};
+		if (!link->get_stat_snapshot(ss)) {
+			// nothing published yet (idle link): the locked path
+			// is harmless while no traffic flows
+			auto mav_status = link->get_status();
+			auto iostat = link->get_iostat();
+
+			ss.packet_rx_success_count = mav_status.packet_rx_success_count;
+			ss.packet_rx_drop_count = mav_status.packet_rx_drop_count;
+			ss.buffer_overrun = mav_status.buffer_overrun;
+			ss.parse_error = mav_status.parse_error;
+			ss.current_rx_seq = mav_status.current_rx_seq;
+			ss.current_tx_seq = mav_status.current_tx_seq;
+			ss.rx_total_bytes = iostat.rx_total_bytes;
+			ss.tx_total_bytes = iostat.tx_total_bytes;
+			ss.rx_speed = iostat.rx_speed;
+			ss.tx_speed = iostat.tx_speed;
+			ss.tx_dropped = iostat.tx_dropped;
+			ss.tx_latency_p50_us = iostat.tx_latency_p50_us;
+			ss.tx_latency_p90_us = iostat.tx_latency_p90_us;
+			ss.tx_latency_p99_us = iostat.tx_latency_p99_us;
+		}
+
+		stat.addf("Received packets:", "%u", ss.packet_rx_success_count);
+		stat.addf("Dropped packets:", "%u", ss.packet_rx_drop_count);
+		stat.addf("Buffer overruns:", "%u", ss.buffer_overrun);
+		stat.addf("Parse errors:", "%u", ss.parse_error);
+		stat.addf("Rx sequence number:", "%u", ss.current_rx_seq);
+		stat.addf("Tx sequence number:", "%u", ss.current_tx_seq);
+
+		stat.addf("Rx total bytes:", "%zu", ss.rx_total_bytes);
+		stat.addf("Tx total bytes:", "%zu", ss.tx_total_bytes);
+		stat.addf("Rx speed:", "%f", ss.rx_speed);
+		stat.addf("Tx speed:", "%f", ss.tx_speed);
+		stat.addf("Tx overflow drops:", "%zu", ss.tx_dropped);
+		stat.addf("Tx latency p50/p90/p99 [us]:", "%.1f / %.1f / %.1f",
+			ss.tx_latency_p50_us, ss.tx_latency_p90_us, ss.tx_latency_p99_us);
+
+		if (ss.packet_rx_drop_count > last_drop_count)
 			stat.summaryf(1, "%d packeges dropped since last report",
-				mav_status.packet_rx_drop_count - last_drop_count);
+				ss.packet_rx_drop_count - last_drop_count);
 		else if (is_connected)
 			stat.summary(0, "connected");
 		else
 			// link operational, but not connected
 			stat.summary(1, "not connected");
 
-		last_drop_count = mav_status.packet_rx_drop_count;
+		last_drop_count = ss.packet_rx_drop_count;
 	} else {
 		stat.summary(2, "not connected");
 	}
@@ -11,7 +11,13 @@
  * https://github.com/mavlink/mavros/tree/master/LICENSE.md
  */
 
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
 #include <ros/console.h>
+#include <mavconn/trace.h>
+#include <mavconn/bond.h>
 #include <mavros/mavros.h>
 #include <mavros/utils.h>
 #include <fnmatch.h>
@@ -27,22 +33,33 @@ using plugin::PluginBase;
 using utils::enum_value;
 
 
-MavRos::MavRos() :
-	mavlink_nh("mavlink"),		// allow to namespace it
+MavRos::MavRos(const ros::NodeHandle &nh_in, const ros::NodeHandle &mavlink_nh_in) :
+	mavlink_nh(mavlink_nh_in),	// allow to namespace it
+	from_msg_pool(FROM_MSG_POOL_SIZE),
 	fcu_link_diag("FCU connection"),
 	gcs_link_diag("GCS bridge"),
 	plugin_loader("mavros", "mavros::plugin::PluginBase"),
-	plugin_subscriptions{}
+	plugin_subscriptions{},
+	accept_all(true)
 {
 	std::string fcu_url, gcs_url;
 	std::string fcu_protocol;
+	std::string tlog_prefix;
 	int system_id, component_id;
 	int tgt_system_id, tgt_component_id;
+	int exec_threads;
+	int tlog_segment_mb;
+	int tf_coalesce_us;
+	int fcu_bond_bulk_link;
+	int fcu_bond_timeout_ms;
 	bool px4_usb_quirk;
 	ros::V_string plugin_blacklist{}, plugin_whitelist{};
+	ros::V_string source_whitelist{};
+	ros::V_string gcs_urls{};
+	ros::V_string fcu_urls{};
 	MAVConnInterface::Ptr fcu_link;
 
-	ros::NodeHandle nh("~");
+	ros::NodeHandle nh(nh_in);
 
 	nh.param<std::string>("fcu_url", fcu_url, "serial:///dev/ttyACM0");
 	nh.param<std::string>("gcs_url", gcs_url, "udp://@");
@@ -52,15 +69,118 @@ MavRos::MavRos() :
 	nh.param("target_system_id", tgt_system_id, 1);
 	nh.param("target_component_id", tgt_component_id, 1);
 	nh.param("startup_px4_usb_quirk", px4_usb_quirk, false);
+	nh.param("executor_threads", exec_threads, 2);
+	nh.param<std::string>("tlog_prefix", tlog_prefix, "");
+	nh.param("tlog_segment_mb", tlog_segment_mb, 64);
+	nh.param("tf_coalesce_us", tf_coalesce_us, 2000);
 	nh.getParam("plugin_blacklist", plugin_blacklist);
 	nh.getParam("plugin_whitelist", plugin_whitelist);
+	nh.getParam("source_whitelist", source_whitelist);
+	nh.getParam("gcs_urls", gcs_urls);
+	nh.getParam("fcu_urls", fcu_urls);
+	nh.param("fcu_bond_bulk_link", fcu_bond_bulk_link, -1);
+	nh.param("fcu_bond_timeout_ms", fcu_bond_timeout_ms, 500);
+
+	// handlers kept on the rx thread: TIMESYNC answer latency is the
+	// time offset estimation error
+	if (!nh.getParam("executor_inline_ids", exec_inline_ids))
+		exec_inline_ids = { int(mavlink::common::msg::TIMESYNC::MSG_ID) };
+
+	// shared multi-vehicle link: accept-list entries are "sysid" or
+	// "sysid.compid"; foreign traffic then costs one header compare
+	// instead of routing + handler dispatch
+	for (auto &entry : source_whitelist) {
+		try {
+			size_t dot = entry.find('.');
+			unsigned sysid = std::stoi(entry.substr(0, dot)) & 0xff;
+
+			if (dot == std::string::npos) {
+				// whole system: any component
+				for (size_t compid = 0; compid < 256; compid++)
+					accept_filter.set((sysid << 8) | compid);
+			}
+			else {
+				unsigned compid = std::stoi(entry.substr(dot + 1)) & 0xff;
+				accept_filter.set((sysid << 8) | compid);
+			}
+
+			accept_all = false;
+		}
+		catch (std::logic_error &ex) {
+			ROS_WARN_STREAM("Ignored source_whitelist entry: " << entry);
+		}
+	}
+
+	if (!accept_all)
+		ROS_INFO("Source whitelist: %zu id(s), other traffic is dropped before routing",
+				accept_filter.count());
+
+	// declarative FCU -> GCS bandwidth shaper: "msgid:hz" entries cap
+	// the forwarded rate of one msgid (mavros itself keeps consuming
+	// the full rate); unlisted ids pass through unchanged
+	ros::V_string gcs_rate_limit_conf{};
+	nh.getParam("gcs_rate_limits", gcs_rate_limit_conf);
+
+	gcs_limit_direct.fill(0);
+	for (auto &entry : gcs_rate_limit_conf) {
+		try {
+			size_t sep = entry.find(':');
+			if (sep == std::string::npos)
+				throw std::invalid_argument("no rate");
+
+			unsigned msgid = std::stoul(entry.substr(0, sep));
+			float rate = std::stof(entry.substr(sep + 1));
+			if (rate <= 0.0f)
+				throw std::invalid_argument("rate must be positive");
+
+			// bucket starts full: one second of credit
+			gcs_rate_limits.push_back(GcsRateLimit{rate, rate, 0, 0});
+			auto idx = uint16_t(gcs_rate_limits.size());	// index + 1
+
+			if (msgid < ROUTE_DIRECT_SIZE)
+				gcs_limit_direct[msgid] = idx;
+			else
+				gcs_limit_ext.emplace_back(msgid, idx);
+		}
+		catch (std::logic_error &ex) {
+			ROS_WARN_STREAM("Ignored gcs_rate_limits entry: " << entry);
+		}
+	}
+	std::sort(gcs_limit_ext.begin(), gcs_limit_ext.end());
+
+	if (!gcs_rate_limits.empty())
+		ROS_INFO("GCS bridge: rate limiting %zu msgid(s)", gcs_rate_limits.size());
+
+	// single-FCU config stays on ~fcu_url; ~fcu_urls overrides with a
+	// bonded link list (preferred path first)
+	if (fcu_urls.empty())
+		fcu_urls.emplace_back(fcu_url);
 
 	// Now we use FCU URL as a hardware Id
-	UAS_DIAG(&mav_uas).setHardwareID(fcu_url);
+	UAS_DIAG(&mav_uas).setHardwareID(fcu_urls.front());
 
-	ROS_INFO_STREAM("FCU URL: " << fcu_url);
 	try {
-		fcu_link = MAVConnInterface::open_url(fcu_url, system_id, component_id);
+		std::vector<MAVConnInterface::Ptr> fcu_members;
+		for (auto &url : fcu_urls) {
+			ROS_INFO_STREAM("FCU URL: " << url);
+			fcu_members.push_back(MAVConnInterface::open_url(url, system_id, component_id));
+		}
+
+		if (fcu_members.size() == 1)
+			fcu_link = fcu_members.front();
+		else {
+			// duplicates are suppressed across paths, tx fails over
+			// to the next member when rx traffic stops on the active
+			// one; BULK traffic (FTP) can be steered to a fat member
+			if (fcu_bond_bulk_link >= int(fcu_members.size())) {
+				ROS_WARN("FCU: ~fcu_bond_bulk_link %d out of range, steering disabled", fcu_bond_bulk_link);
+				fcu_bond_bulk_link = -1;
+			}
+
+			fcu_link = std::make_shared<mavconn::MAVConnBond>(fcu_members,
+					fcu_bond_bulk_link, std::max(1, fcu_bond_timeout_ms));
+		}
+
 		// may be overridden by URL
 		system_id = fcu_link->get_system_id();
 		component_id = fcu_link->get_component_id();
@@ -80,22 +200,40 @@ MavRos::MavRos() :
 	else if (fcu_protocol == "v2.0") {
 		fcu_link->set_protocol_version(mavconn::Protocol::V20);
 	}
-	//else if (fcu_protocol == "auto") {	// XXX TODO
-	//	fcu_link->set_protocol_version(mavconn::Protocol::V20);
-	//}
+	else if (fcu_protocol == "auto") {
+		// start on v1, upgrade when the FCU proves v2 capability
+		// (v2 rx framing or AUTOPILOT_VERSION flags); framing is
+		// then still chosen per message — v1 where smaller
+		fcu_link->set_protocol_auto(true);
+	}
 	else {
-		ROS_WARN("Unknown FCU protocol: \"%s\", should be: \"v1.0\" or \"v2.0\". Used default v1.0.", fcu_protocol.c_str());
+		ROS_WARN("Unknown FCU protocol: \"%s\", should be: \"v1.0\", \"v2.0\" or \"auto\". Used default v1.0.", fcu_protocol.c_str());
 		fcu_link->set_protocol_version(mavconn::Protocol::V10);
 	}
 
-	if (gcs_url != "") {
-		ROS_INFO_STREAM("GCS URL: " << gcs_url);
+	// single-GCS config stays on ~gcs_url; ~gcs_urls overrides with a
+	// client list (primary first)
+	if (gcs_urls.empty() && gcs_url != "")
+		gcs_urls.emplace_back(gcs_url);
+
+	for (auto &url : gcs_urls) {
+		ROS_INFO_STREAM("GCS URL: " << url);
 		try {
-			gcs_link = MAVConnInterface::open_url(gcs_url, system_id, component_id);
+			auto link = MAVConnInterface::open_url(url, system_id, component_id);
 
-			gcs_link_diag.set_mavconn(gcs_link);
-			gcs_diag_updater.setHardwareID(gcs_url);
-			gcs_diag_updater.add(gcs_link_diag);
+			if (!gcs_link) {
+				gcs_link = link;
+				gcs_link_diag.set_mavconn(link);
+				gcs_diag_updater.setHardwareID(url);
+				gcs_diag_updater.add(gcs_link_diag);
+			}
+			else {
+				gcs_extra_diags.emplace_back(new MavlinkDiag(utils::format("GCS bridge %zu", gcs_links.size())));
+				gcs_extra_diags.back()->set_mavconn(link);
+				gcs_diag_updater.add(*gcs_extra_diags.back());
+			}
+
+			gcs_links.push_back(link);
 		}
 		catch (mavconn::DeviceError &ex) {
 			ROS_FATAL("GCS: %s", ex.what());
@@ -103,9 +241,12 @@ MavRos::MavRos() :
 			return;
 		}
 	}
-	else
+
+	if (gcs_links.empty())
 		ROS_INFO("GCS bridge disabled");
 
+	gcs_drops.assign(gcs_links.size(), 0);
+
 	// ROS mavlink bridge
 	mavlink_pub = mavlink_nh.advertise<mavros_msgs::Mavlink>("from", 100);
 	mavlink_sub = mavlink_nh.subscribe("to", 100, &MavRos::mavlink_sub_cb, this,
@@ -115,6 +256,7 @@ MavRos::MavRos() :
 
 	// setup UAS and diag
 	mav_uas.set_tgt(tgt_system_id, tgt_component_id);
+	mav_uas.set_tf_coalesce_window(std::max(0, tf_coalesce_us));
 	UAS_FCU(&mav_uas) = fcu_link;
 
 	mav_uas.add_connection_change_handler(std::bind(&MavlinkDiag::set_connection_status, &fcu_link_diag, std::placeholders::_1));
@@ -125,18 +267,98 @@ MavRos::MavRos() :
 	if (plugin_blacklist.empty() and !plugin_whitelist.empty())
 		plugin_blacklist.emplace_back("*");
 
-	for (auto &name : plugin_loader.getDeclaredClasses())
-		add_plugin(name, plugin_blacklist, plugin_whitelist);
+	// load plugins in parallel: both instantiation (dlopen for the
+	// pluginlib path) and initialize() (topic/service advertising)
+	// dominate startup time and are independent between plugins
+	{
+		// the static registry (MAVROS_STATIC_PLUGINS builds) avoids
+		// the manifest scan and dlopen; pluginlib remains for
+		// out-of-tree plugins, opt-in when the registry is in use
+		auto &static_table = plugin::StaticRegistry::table();
+		bool load_dynamic;
+		nh.param("load_dynamic_plugins", load_dynamic, static_table.empty());
+
+		std::vector<std::pair<std::string, std::function<plugin::PluginBase::Ptr()>>> makers;
+
+		for (auto &e : static_table)
+			makers.emplace_back(e.name, e.make);
+
+		if (!static_table.empty())
+			ROS_INFO("Static plugin registry: %zu plugins", static_table.size());
+
+		if (load_dynamic) {
+			for (auto &pl_name : plugin_loader.getDeclaredClasses()) {
+				bool in_registry = false;
+				for (auto &e : static_table)
+					if (pl_name == e.name) {
+						in_registry = true;
+						break;
+					}
+
+				if (in_registry)
+					continue;
+
+				makers.emplace_back(pl_name, [this, pl_name]() {
+							return plugin_loader.createInstance(pl_name);
+						});
+			}
+		}
+
+		std::atomic<size_t> next_idx(0);
+
+		auto loader = [&]() {
+			for (;;) {
+				size_t i = next_idx.fetch_add(1);
+				if (i >= makers.size())
+					return;
+
+				add_plugin(makers[i].first, plugin_blacklist, plugin_whitelist, makers[i].second);
+			}
+		};
+
+		size_t n_loaders = std::min<size_t>(4, std::max<size_t>(1, makers.size()));
+		std::vector<std::thread> loaders;
+		for (size_t i = 1; i < n_loaders; i++)
+			loaders.emplace_back(loader);
+
+		loader();	// this thread works too
+		for (auto &t : loaders)
+			t.join();
+	}
+
+	// the populated msgid set is final now: freeze it before the
+	// receive callback is installed
+	build_routing_table();
+
+	if (exec_threads > 0)
+		plugin_exec.reset(new PluginExecutor(exec_threads));
+	else
+		ROS_INFO("Plugin executor disabled, handlers run on the rx thread");
+
+	// native recorder: no ROS serialization round-trip, no drops
+	// under load (see TlogRecorder)
+	if (!tlog_prefix.empty()) {
+		try {
+			tlog.reset(new TlogRecorder(tlog_prefix, tlog_segment_mb));
+		}
+		catch (std::runtime_error &ex) {
+			ROS_ERROR("tlog: recording disabled: %s", ex.what());
+		}
+	}
 
 	// connect FCU link
 
-	// XXX TODO: move workers to ROS Spinner, let mavconn threads to do only IO
+	// plugin handlers run on the executor so the mavconn thread does
+	// only IO, routing and bridging
 	fcu_link->message_received_cb = [this](const mavlink_message_t *msg, const Framing framing) {
+		if (tlog)
+			tlog->write(msg);
+
 		mavlink_pub_cb(msg, framing);
 		plugin_route_cb(msg, framing);
 
-		if (gcs_link)
-			gcs_link->send_message_ignore_drop(msg);
+		if (!gcs_links.empty())
+			gcs_fanout(msg);
 	};
 
 	fcu_link->port_closed_cb = []() {
@@ -144,14 +366,28 @@ MavRos::MavRos() :
 		ros::requestShutdown();
 	};
 
-	if (gcs_link) {
-		// setup GCS link bridge
-		gcs_link->message_received_cb = [this, fcu_link](const mavlink_message_t *msg, const Framing framing) {
+	// setup GCS link bridge: uplink from any client goes to the FCU
+	for (auto &link : gcs_links) {
+		link->message_received_cb = [this, fcu_link](const mavlink_message_t *msg, const Framing framing) {
 			fcu_link->send_message_ignore_drop(msg);
 		};
+	}
 
+	if (gcs_link)
 		gcs_link_diag.set_connection_status(true);
-	}
+	for (auto &diag : gcs_extra_diags)
+		diag->set_connection_status(true);
+
+	// member, not a spin() local: the nodelet build never calls spin()
+	diag_timer = mavlink_nh.createTimer(
+			ros::Duration(0.5),
+			[this](const ros::TimerEvent &) {
+				UAS_DIAG(&mav_uas).update();
+
+				if (gcs_link)
+					gcs_diag_updater.update();
+			});
+	diag_timer.start();
 
 	if (px4_usb_quirk)
 		startup_px4_usb_quirk();
@@ -172,16 +408,6 @@ void MavRos::spin()
 {
 	ros::AsyncSpinner spinner(4 /* threads */);
 
-	auto diag_timer = mavlink_nh.createTimer(
-			ros::Duration(0.5),
-			[&](const ros::TimerEvent &) {
-				UAS_DIAG(&mav_uas).update();
-
-				if (gcs_link)
-					gcs_diag_updater.update();
-			});
-	diag_timer.start();
-
 	spinner.start();
 	ros::waitForShutdown();
 
@@ -191,13 +417,28 @@ void MavRos::spin()
 
 void MavRos::mavlink_pub_cb(const mavlink_message_t *mmsg, Framing framing)
 {
-	auto rmsg = boost::make_shared<mavros_msgs::Mavlink>();
-
-	if  (mavlink_pub.getNumSubscribers() == 0)
+	// check first: the no-subscriber case must stay free.
+	// (the shared_ptr used to be allocated before this return)
+	if (mavlink_pub.getNumSubscribers() == 0)
 		return;
 
+	auto *pooled = from_msg_pool.pop();
+	if (pooled == nullptr)
+		pooled = new mavros_msgs::Mavlink();
+
+	// recycle when the last subscriber drops the message; the ring
+	// never shrinks below overflow, extras are simply freed.
+	// NOTE: pool must outlive subscribers holding messages — both end
+	// at node shutdown.
+	boost::shared_ptr<mavros_msgs::Mavlink> rmsg(pooled,
+			[this](mavros_msgs::Mavlink *m) {
+				if (!from_msg_pool.push(m))
+					delete m;
+			});
+
 	rmsg->header.stamp = ros::Time::now();
 	mavros_msgs::mavlink::convert(*mmsg, *rmsg, enum_value(framing));
+	MAVCONN_TRACE2(msg_publish, mmsg->msgid, mmsg->seq);
 	mavlink_pub.publish(rmsg);
 }
 
@@ -211,14 +452,164 @@ void MavRos::mavlink_sub_cb(const mavros_msgs::Mavlink::ConstPtr &rmsg)
 		ROS_ERROR("Drop mavlink packet: convert error.");
 }
 
+bool MavRos::gcs_rate_admit(const mavlink_message_t *mmsg)
+{
+	uint16_t idx = 0;
+
+	if (mmsg->msgid < ROUTE_DIRECT_SIZE) {
+		idx = gcs_limit_direct[mmsg->msgid];
+	}
+	else if (!gcs_limit_ext.empty()) {
+		auto it = std::lower_bound(gcs_limit_ext.begin(), gcs_limit_ext.end(),
+				std::make_pair(mavlink::msgid_t(mmsg->msgid), uint16_t(0)));
+		if (it != gcs_limit_ext.end() && it->first == mmsg->msgid)
+			idx = it->second;
+	}
+
+	if (idx == 0)
+		return true;	// unlisted: pass through
+
+	auto &b = gcs_rate_limits[idx - 1];
+	const uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+
+	// token bucket, capacity is one second of credit
+	b.tokens = std::min(b.rate, b.tokens + (now - b.last_ns) * 1e-9f * b.rate);
+	b.last_ns = now;
+
+	if (b.tokens < 1.0f) {
+		b.dropped++;
+		ROS_DEBUG_THROTTLE(10, "GCS bridge: msgid %u shaped to %.1f Hz, %zu withheld total",
+				mmsg->msgid, b.rate, b.dropped);
+		return false;
+	}
+
+	b.tokens -= 1.0f;
+	return true;
+}
+
+void MavRos::gcs_fanout(const mavlink_message_t *mmsg)
+{
+	// a shaped-out message is withheld from every client: the limits
+	// protect the ground link, not one slow consumer (see gcs_drops)
+	if (!gcs_rate_limits.empty() && !gcs_rate_admit(mmsg))
+		return;
+
+	// serialize once; every client queue copies the same wire image
+	std::array<uint8_t, MAVLINK_MAX_PACKET_LEN + 16> buf;
+	auto len = mavlink::mavlink_msg_to_send_buffer(buf.data(), mmsg);
+
+	for (size_t i = 0; i < gcs_links.size(); i++) {
+		try {
+			gcs_links[i]->send_bytes(buf.data(), len);
+		}
+		catch (std::length_error &e) {
+			// this client stalled: drop for it alone, the
+			// others keep their full rate
+			gcs_drops[i]++;
+			ROS_WARN_THROTTLE(10, "GCS %zu: tx congested, %zu drops total", i, gcs_drops[i]);
+		}
+	}
+}
+
 void MavRos::plugin_route_cb(const mavlink_message_t *mmsg, const Framing framing)
 {
-	auto it = plugin_subscriptions.find(mmsg->msgid);
-	if (it == plugin_subscriptions.end())
+	// messages from unlisted vehicles are not ours to handle
+	if (!accept_all && !accept_filter[(size_t(mmsg->sysid) << 8) | mmsg->compid])
+		return;
+
+	MAVCONN_TRACE2(msg_route, mmsg->msgid, mmsg->seq);
+
+	RouteSpan span{};
+
+	if (mmsg->msgid < ROUTE_DIRECT_SIZE) {
+		span = route_direct[mmsg->msgid];
+	}
+	else {
+		auto it = std::lower_bound(route_ext.begin(), route_ext.end(), mmsg->msgid,
+				[](const std::pair<mavlink::msgid_t, RouteSpan> &e, mavlink::msgid_t id) {
+					return e.first < id;
+				});
+		if (it == route_ext.end() || it->first != mmsg->msgid)
+			return;
+
+		span = it->second;
+	}
+
+	if (span.count == 0)
+		return;
+
+	if (!plugin_exec || span.run_inline) {
+		MAVCONN_TRACE2(handlers_begin, mmsg->msgid, mmsg->seq);
+		for (size_t i = span.begin; i < size_t(span.begin) + span.count; i++)
+			route_handlers[i](mmsg, framing);
+		MAVCONN_TRACE2(handlers_end, mmsg->msgid, mmsg->seq);
 		return;
+	}
+
+	// hand off to the executor; borrow the pooled rx slot so no copy
+	// is made on the hot path
+	auto ref = UAS_FCU(&mav_uas)->borrow_rx_message();
+	if (ref) {
+		plugin_exec->post(mmsg->msgid, [this, ref, span, framing]() {
+			MAVCONN_TRACE2(handlers_begin, ref->msgid, ref->seq);
+			for (size_t i = span.begin; i < size_t(span.begin) + span.count; i++)
+				route_handlers[i](ref.get(), framing);
+			MAVCONN_TRACE2(handlers_end, ref->msgid, ref->seq);
+		});
+	}
+	else {
+		// rx pool exhausted (handlers hold too many borrows): copy
+		auto copy = std::make_shared<mavlink_message_t>(*mmsg);
+		plugin_exec->post(mmsg->msgid, [this, copy, span, framing]() {
+			MAVCONN_TRACE2(handlers_begin, copy->msgid, copy->seq);
+			for (size_t i = span.begin; i < size_t(span.begin) + span.count; i++)
+				route_handlers[i](copy.get(), framing);
+			MAVCONN_TRACE2(handlers_end, copy->msgid, copy->seq);
+		});
+	}
+}
+
+/**
+ * @brief Freeze plugin_subscriptions into the flat routing table
+ *
+ * Called once, after plugin loading and before the receive callback
+ * is installed. Routing then costs one array index (binary search for
+ * v2 extended ids) plus a linear walk over contiguous callbacks,
+ * instead of a hash lookup and a tuple-vector traversal per message.
+ */
+void MavRos::build_routing_table()
+{
+	std::vector<mavlink::msgid_t> ids;
+	ids.reserve(plugin_subscriptions.size());
+	for (auto &p : plugin_subscriptions)
+		ids.push_back(p.first);
+
+	std::sort(ids.begin(), ids.end());
+
+	route_direct.fill(RouteSpan{});
+	route_ext.clear();
+	route_handlers.clear();
+
+	for (auto id : ids) {
+		RouteSpan span;
+		span.begin = route_handlers.size();
+		span.count = 0;
+		span.run_inline = std::find(exec_inline_ids.begin(), exec_inline_ids.end(), int(id))
+				!= exec_inline_ids.end();
+
+		for (auto &info : plugin_subscriptions[id]) {
+			route_handlers.push_back(std::get<3>(info));
+			span.count++;
+		}
+
+		if (id < ROUTE_DIRECT_SIZE)
+			route_direct[id] = span;
+		else
+			route_ext.emplace_back(id, span);
+	}
 
-	for (auto &info : it->second)
-		std::get<3>(info)(mmsg, framing);
+	ROS_DEBUG("Routing table: %zu msgids, %zu handlers", ids.size(), route_handlers.size());
 }
 
 static bool pattern_match(std::string &pattern, std::string &pl_name)
@@ -273,7 +664,8 @@ inline bool is_mavlink_message_t(const size_t rt)
 /**
  * @brief Loads plugin (if not blacklisted)
  */
-void MavRos::add_plugin(std::string &pl_name, ros::V_string &blacklist, ros::V_string &whitelist)
+void MavRos::add_plugin(const std::string &pl_name, ros::V_string &blacklist, ros::V_string &whitelist,
+		const std::function<plugin::PluginBase::Ptr()> &make)
 {
 	if (is_blacklisted(pl_name, blacklist, whitelist)) {
 		ROS_INFO_STREAM("Plugin " << pl_name << " blacklisted");
@@ -281,10 +673,11 @@ void MavRos::add_plugin(std::string &pl_name, ros::V_string &blacklist, ros::V_s
 	}
 
 	try {
-		auto plugin = plugin_loader.createInstance(pl_name);
+		auto plugin = make();
 
 		ROS_INFO_STREAM("Plugin " << pl_name << " loaded");
 
+		std::unique_lock<std::mutex> lock(plugin_mutex);
 		for (auto &info : plugin->get_subscriptions()) {
 			auto msgid = std::get<0>(info);
 			auto msgname = std::get<1>(info);
@@ -330,11 +723,17 @@ void MavRos::add_plugin(std::string &pl_name, ros::V_string &blacklist, ros::V_s
 			}
 		}
 
+		// initialize() is the slow part: run it unlocked, loaders
+		// only serialize on the routing bookkeeping
+		lock.unlock();
 		plugin->initialize(mav_uas);
+
+		lock.lock();
 		loaded_plugins.push_back(plugin);
+		lock.unlock();
 
 		ROS_INFO_STREAM("Plugin " << pl_name << " initialized");
-	} catch (pluginlib::PluginlibException &ex) {
+	} catch (std::exception &ex) {
 		ROS_ERROR_STREAM("Plugin " << pl_name << " load exception: " << ex.what());
 	}
 }
@@ -0,0 +1,85 @@
+/**
+ * @brief Plugin handler executor
+ * @file plugin_executor.cpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ */
+/*
+ * Copyright 2017 Vladimir Ermakov.
+ *
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+
+#include <ros/console.h>
+#include <mavconn/thread_utils.h>
+#include <mavros/plugin_executor.h>
+
+using namespace mavros;
+
+
+PluginExecutor::PluginExecutor(size_t n_threads) :
+	shutdown(false)
+{
+	for (size_t i = 0; i < n_threads; i++)
+		workers.emplace_back(&PluginExecutor::worker_thread, this, i);
+}
+
+PluginExecutor::~PluginExecutor()
+{
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		shutdown = true;
+	}
+	cv.notify_all();
+
+	for (auto &w : workers)
+		w.join();
+}
+
+void PluginExecutor::post(mavlink::msgid_t msgid, Task task)
+{
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		auto &lane = lanes[msgid];
+
+		lane.q.push_back(std::move(task));
+
+		// an active lane is rechecked by its worker after each task;
+		// a lane already in ready keeps its single slot
+		if (!lane.active && lane.q.size() == 1)
+			ready.push_back(&lane);
+		else
+			return;
+	}
+	cv.notify_one();
+}
+
+void PluginExecutor::worker_thread(size_t idx)
+{
+	mavconn::utils::set_this_thread_name("plexec%zu", idx);
+
+	std::unique_lock<std::mutex> lock(mtx);
+	for (;;) {
+		cv.wait(lock, [&] { return shutdown || !ready.empty(); });
+		if (shutdown)
+			return;
+
+		auto *lane = ready.front();
+		ready.pop_front();
+		lane->active = true;
+
+		// drain the lane: same-msgid ordering holds because no other
+		// worker may take it while active
+		while (!lane->q.empty()) {
+			auto task = std::move(lane->q.front());
+			lane->q.pop_front();
+
+			lock.unlock();
+			task();
+			lock.lock();
+		}
+
+		lane->active = false;
+	}
+}
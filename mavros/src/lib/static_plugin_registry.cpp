@@ -0,0 +1,56 @@
+/**
+ * @brief Static registry of the standard plugin set
+ * @file static_plugin_registry.cpp
+ *
+ * Compiled into mavros_node only with the MAVROS_STATIC_PLUGINS
+ * build option: it references every MAVROS_PLUGIN_FACTORY symbol of
+ * the standard set and registers them before main(), so MavRos can
+ * skip pluginlib discovery. The list must match mavros_plugins.xml.
+ */
+/*
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+
+#include <mavros/plugin_registry.h>
+
+//! registry name, factory identifier (see MAVROS_PLUGIN_FACTORY)
+#define MAVROS_STD_PLUGINS(ENTRY)	\
+	ENTRY("sys_status", sys_status)	\
+	ENTRY("imu_pub", imu_pub)	\
+	ENTRY("param", param)	\
+	ENTRY("waypoint", waypoint)	\
+	ENTRY("rc_io", rc_io)	\
+	ENTRY("command", command)	\
+	ENTRY("local_position", local_position)	\
+	ENTRY("global_position", global_position)	\
+	ENTRY("setpoint_position", setpoint_position)	\
+	ENTRY("safety_area", safety_area)	\
+	ENTRY("3dr_radio", tdr_radio)	\
+	ENTRY("setpoint_velocity", setpoint_velocity)	\
+	ENTRY("setpoint_accel", setpoint_accel)	\
+	ENTRY("setpoint_attitude", setpoint_attitude)	\
+	ENTRY("setpoint_raw", setpoint_raw)	\
+	ENTRY("vfr_hud", vfr_hud)	\
+	ENTRY("ftp", ftp)	\
+	ENTRY("sys_time", sys_time)	\
+	ENTRY("actuator_control", actuator_control)	\
+	ENTRY("message_interval", message_interval)	\
+	ENTRY("manual_control", manual_control)	\
+	ENTRY("altitude", altitude)	\
+	ENTRY("hil_controls", hil_controls)	\
+	ENTRY("hil_actuator_controls", hil_actuator_controls)	\
+	ENTRY("home_position", home_position)
+
+// factory declarations (defined next to each plugin class)
+#define DECLARE_FACTORY(name, ident)	\
+	mavros::plugin::PluginBase::Ptr mavros_plugin_make_ ## ident();
+MAVROS_STD_PLUGINS(DECLARE_FACTORY)
+#undef DECLARE_FACTORY
+
+// one static Register per plugin fills the table before main()
+#define REGISTER_FACTORY(name, ident)	\
+	static mavros::plugin::StaticRegistry::Register reg_ ## ident(name, &mavros_plugin_make_ ## ident);
+MAVROS_STD_PLUGINS(REGISTER_FACTORY)
+#undef REGISTER_FACTORY
@@ -0,0 +1,143 @@
+/**
+ * @brief Memory-mapped tlog recorder
+ * @file tlog_recorder.cpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ */
+/*
+ * Copyright 2017 Vladimir Ermakov.
+ *
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+
+#include <chrono>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <ros/console.h>
+#include <mavros/tlog_recorder.h>
+#include <mavconn/thread_utils.h>
+
+using namespace mavros;
+
+TlogRecorder::TlogRecorder(const std::string &prefix_, size_t segment_mb) :
+	prefix(prefix_),
+	map_size(segment_mb * 1024 * 1024),
+	file_no(0),
+	fd(-1),
+	map(nullptr),
+	cursor(0),
+	synced(0),
+	should_exit(false)
+{
+	if (map_size < MAX_RECORD_SIZE)
+		throw std::runtime_error("tlog: segment size too small");
+
+	open_segment();
+	sync_thread = std::thread(&TlogRecorder::sync_loop, this);
+}
+
+TlogRecorder::~TlogRecorder()
+{
+	should_exit = true;
+	if (sync_thread.joinable())
+		sync_thread.join();
+
+	close_segment();
+}
+
+void TlogRecorder::open_segment()
+{
+	auto path = mavconn::utils::format("%s.%zu.tlog", prefix.c_str(), file_no++);
+
+	fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		throw std::runtime_error("tlog: open: " + path);
+
+	// preallocate: later appends never extend the file
+	if (::ftruncate(fd, map_size) < 0) {
+		::close(fd); fd = -1;
+		throw std::runtime_error("tlog: ftruncate: " + path);
+	}
+
+	void *m = ::mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (m == MAP_FAILED) {
+		::close(fd); fd = -1;
+		throw std::runtime_error("tlog: mmap: " + path);
+	}
+
+	map = static_cast<uint8_t *>(m);
+	cursor.store(0, std::memory_order_relaxed);
+	synced = 0;
+
+	ROS_INFO("tlog: recording to %s (%zu MiB preallocated)", path.c_str(), map_size / 1024 / 1024);
+}
+
+void TlogRecorder::close_segment()
+{
+	if (map == nullptr)
+		return;
+
+	size_t end = cursor.load(std::memory_order_acquire);
+
+	::msync(map, map_size, MS_SYNC);
+	::munmap(map, map_size);
+	map = nullptr;
+
+	// trim the unused preallocation
+	if (::ftruncate(fd, end) < 0)
+		ROS_WARN("tlog: segment trim failed");
+
+	::close(fd);
+	fd = -1;
+}
+
+void TlogRecorder::write(const mavlink::mavlink_message_t *msg)
+{
+	size_t pos = cursor.load(std::memory_order_relaxed);
+	if (pos + MAX_RECORD_SIZE > map_size) {
+		// segment boundary: the only write path that syscalls
+		std::lock_guard<std::mutex> lock(segment_mutex);
+		close_segment();
+		open_segment();
+		pos = 0;
+	}
+
+	uint8_t *rec = map + pos;
+
+	auto now = std::chrono::system_clock::now().time_since_epoch();
+	uint64_t usec = std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+
+	// tlog timestamps are big-endian
+	for (size_t i = 0; i < 8; i++)
+		rec[i] = usec >> (56 - 8 * i);
+
+	size_t len = mavlink::mavlink_msg_to_send_buffer(rec + 8, msg);
+	cursor.store(pos + 8 + len, std::memory_order_release);
+}
+
+void TlogRecorder::sync_loop()
+{
+	mavconn::utils::set_this_thread_name("tlogsync");
+
+	long page = ::sysconf(_SC_PAGESIZE);
+
+	while (!should_exit) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(SYNC_INTERVAL_MS));
+
+		std::lock_guard<std::mutex> lock(segment_mutex);
+		if (map == nullptr)
+			continue;
+
+		size_t cur = cursor.load(std::memory_order_acquire);
+		if (cur <= synced)
+			continue;
+
+		// page-align the dirty range
+		size_t begin = synced & ~size_t(page - 1);
+		::msync(map + begin, cur - begin, MS_ASYNC);
+		synced = cur;
+	}
+}
@@ -12,8 +12,12 @@
  */
 
 #include <array>
+#include <chrono>
 #include <unordered_map>
 #include <stdexcept>
+#include <eigen_conversions/eigen_msg.h>
+#include <tf2_msgs/TFMessage.h>
+#include <mavconn/thread_utils.h>
 #include <mavros/mavros_uas.h>
 #include <mavros/utils.h>
 #include <mavros/px4_custom_mode.h>
@@ -24,26 +28,256 @@ using utils::enum_value;
 
 UAS::UAS() :
 	tf2_listener(tf2_buffer, true),
+	tf_coalesce_us(0),
+	tf_batch_exit(false),
+	tf_watch_exit(false),
 	type(enum_value(MAV_TYPE::GENERIC)),
 	autopilot(enum_value(MAV_AUTOPILOT::GENERIC)),
 	base_mode(0),
 	target_system(1),
 	target_component(1),
 	connected(false),
-	gps_eph(NAN),
-	gps_epv(NAN),
-	gps_fix_type(0),
-	gps_satellites_visible(0),
 	time_offset(0),
 	tsync_mode(UAS::timesync_mode::NONE),
 	fcu_caps_known(false),
 	fcu_capabilities(0)
 {
+	// no fix yet: keep the old NAN accuracy defaults
+	gps_state.store(GpsState{NAN, NAN, 0, 0});
+
+	// new static frames invalidate the resolved-transform cache
+	ros::NodeHandle nh;
+	tf_static_sub = nh.subscribe<tf2_msgs::TFMessage>("/tf_static", 10,
+			boost::function<void (const tf2_msgs::TFMessage::ConstPtr &)>(
+				[this](const tf2_msgs::TFMessage::ConstPtr &) {
+					std::lock_guard<std::mutex> lock(static_tf_mutex);
+					static_tf_cache.clear();
+				}));
+
+	// NOTE: geoid dataset loads lazily, see init_geoid()
+}
+
+UAS::~UAS()
+{
+	{
+		std::lock_guard<std::mutex> lock(tf_batch_mutex);
+		tf_batch_exit = true;
+	}
+	tf_batch_cv.notify_all();
+
+	if (tf_batch_thread.joinable())
+		tf_batch_thread.join();
+
+	{
+		std::lock_guard<std::mutex> lock(tf_watch_mutex);
+		tf_watch_exit = true;
+	}
+	tf_watch_cv.notify_all();
+
+	if (tf_watch_thread.joinable())
+		tf_watch_thread.join();
+}
+
+/* -*- /tf coalescing -*- */
+
+void UAS::set_tf_coalesce_window(uint32_t window_us)
+{
+	tf_coalesce_us = window_us;
+
+	if (window_us > 0 && !tf_batch_thread.joinable())
+		tf_batch_thread = std::thread(&UAS::tf_batch_loop, this);
+}
+
+void UAS::tf2_send_transform(const geometry_msgs::TransformStamped &transform)
+{
+	if (tf_coalesce_us == 0 || !tf_batch_thread.joinable()) {
+		tf2_broadcaster.sendTransform(transform);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(tf_batch_mutex);
+		tf_batch.push_back(transform);
+
+		// the first transform arms the window, the rest ride along
+		if (tf_batch.size() > 1)
+			return;
+	}
+	tf_batch_cv.notify_one();
+}
+
+void UAS::tf_batch_loop()
+{
+	mavconn::utils::set_this_thread_name("tfbatch");
+
+	std::unique_lock<std::mutex> lock(tf_batch_mutex);
+	while (!tf_batch_exit) {
+		tf_batch_cv.wait(lock, [this] { return tf_batch_exit || !tf_batch.empty(); });
+		if (tf_batch_exit)
+			return;
+
+		// let the transforms published together actually meet
+		auto deadline = std::chrono::steady_clock::now() +
+			std::chrono::microseconds(tf_coalesce_us.load());
+		tf_batch_cv.wait_until(lock, deadline, [this] { return tf_batch_exit; });
+		if (tf_batch_exit)
+			return;
+
+		auto batch = std::move(tf_batch);
+		tf_batch.clear();
+
+		lock.unlock();
+		tf2_broadcaster.sendTransform(batch);
+		lock.lock();
+	}
+}
+
+/* -*- transform watch dispatch -*- */
+
+void UAS::add_tf_watch(const std::string &frame_id, const std::string &child_frame_id,
+		double rate, TransformWatchCb cb)
+{
+	ros::Duration period((rate > 0.0) ? 1.0 / rate : 1.0);
+
+	std::lock_guard<std::mutex> lock(tf_watch_mutex);
+
+	for (auto &w : tf_watch_list) {
+		if (w.frame_id == frame_id && w.child_frame_id == child_frame_id) {
+			// shared pair: one lookup feeds all watchers,
+			// polled at the fastest requested rate
+			if (period < w.period)
+				w.period = period;
+
+			w.cb_vec.push_back(cb);
+			return;
+		}
+	}
+
+	TFWatch w;
+	w.frame_id = frame_id;
+	w.child_frame_id = child_frame_id;
+	w.period = period;
+	w.next_due = ros::Time(0);
+	w.cb_vec.push_back(cb);
+	tf_watch_list.push_back(std::move(w));
+
+	if (!tf_watch_thread.joinable())
+		tf_watch_thread = std::thread(&UAS::tf_watch_loop, this);
+	else
+		tf_watch_cv.notify_one();
+}
+
+bool UAS::get_static_transform(const std::string &target, const std::string &source,
+		Eigen::Affine3d &out)
+{
+	const auto key = target + '\t' + source;
+
+	{
+		std::lock_guard<std::mutex> lock(static_tf_mutex);
+		auto it = static_tf_cache.find(key);
+		if (it != static_tf_cache.end()) {
+			out = it->second;
+			return true;
+		}
+	}
+
+	geometry_msgs::TransformStamped transform;
+	try {
+		transform = tf2_buffer.lookupTransform(target, source, ros::Time(0));
+	}
+	catch (tf2::TransformException &ex) {
+		ROS_WARN_THROTTLE_NAMED(10, "uas", "STATIC TF: %s", ex.what());
+		return false;
+	}
+
+	tf::transformMsgToEigen(transform.transform, out);
+
+	std::lock_guard<std::mutex> lock(static_tf_mutex);
+	static_tf_cache.emplace(key, out);
+	return true;
+}
+
+void UAS::tf_watch_loop()
+{
+	mavconn::utils::set_this_thread_name("tfwatch");
+
+	std::unique_lock<std::mutex> lock(tf_watch_mutex);
+	while (!tf_watch_exit) {
+		auto now = ros::Time::now();
+		auto wakeup = now + ros::Duration(1.0);
+
+		for (auto &w : tf_watch_list) {
+			if (now < w.next_due) {
+				wakeup = std::min(wakeup, w.next_due);
+				continue;
+			}
+
+			w.next_due = now + w.period;
+			wakeup = std::min(wakeup, w.next_due);
+
+			// non-blocking probe: a missing transform costs
+			// nothing until it appears in the buffer
+			if (!tf2_buffer.canTransform(w.frame_id, w.child_frame_id, ros::Time(0)))
+				continue;
+
+			geometry_msgs::TransformStamped transform;
+			try {
+				transform = tf2_buffer.lookupTransform(
+						w.frame_id, w.child_frame_id, ros::Time(0));
+			}
+			catch (tf2::TransformException &ex) {
+				ROS_ERROR_THROTTLE_NAMED(10, "uas", "TFWATCH: %s", ex.what());
+				continue;
+			}
+
+			for (auto &cb : w.cb_vec)
+				cb(transform);
+		}
+
+		auto sleep_ns = (wakeup - ros::Time::now()).toNSec();
+		if (sleep_ns > 0 && !tf_watch_exit)
+			tf_watch_cv.wait_for(lock, std::chrono::nanoseconds(sleep_ns));
+	}
+}
+
+/**
+ * Deferred until the first height conversion: nodes that never touch
+ * global position pay neither the load time nor the memory.
+ *
+ * The dataset is cached process-wide: with several UAS instances in
+ * one process (multi-vehicle simulation) all of them share one
+ * mapping / one RAM cache.
+ */
+void UAS::init_geoid()
+{
+	static std::mutex geoid_mutex;
+	static std::weak_ptr<GeoidMmap> geoid_cache;
+	static std::weak_ptr<GeographicLib::Geoid> geoid_fallback_cache;
+
+	std::lock_guard<std::mutex> lock(geoid_mutex);
+
+	egm96_5 = geoid_cache.lock();
+	egm96_5_fallback = geoid_fallback_cache.lock();
+	if (egm96_5 || egm96_5_fallback)
+		return;
+
 	try {
 		// Using smakkest dataset with 5' grid,
+		// memory-mapped: the page cache is shared between processes
+		egm96_5 = std::make_shared<GeoidMmap>(GeoidMmap::default_path("egm96-5"));
+		geoid_cache = egm96_5;
+		ROS_INFO("UAS: Geoid egm96-5 memory-mapped (%zu KiB, shared)", egm96_5->file_size() / 1024);
+		return;
+	}
+	catch (const std::exception &e) {
+		ROS_WARN_STREAM("UAS: Geoid mmap failed, falling back to RAM cache: " << e.what());
+	}
+
+	try {
 		// From default location,
 		// Use cubic interpolation, Thread safe
-		egm96_5 = std::make_shared<GeographicLib::Geoid>("egm96-5", "", true, true);
+		egm96_5_fallback = std::make_shared<GeographicLib::Geoid>("egm96-5", "", true, true);
+		geoid_fallback_cache = egm96_5_fallback;
 	}
 	catch (const std::exception &e) {
 		ROS_ERROR_STREAM("UAS: GeographicLib exception: " << e.what());
@@ -106,6 +340,13 @@ void UAS::update_capabilities(bool known, uint64_t caps)
 
 void UAS::update_attitude_imu(sensor_msgs::Imu::Ptr &imu)
 {
+	AttitudeState state;
+	state.orientation = imu->orientation;
+	state.angular_velocity = imu->angular_velocity;
+	state.valid = true;
+	attitude_state.store(state);
+
+	// full message kept for get_attitude_imu() only
 	lock_guard lock(mutex);
 	imu_data = imu;
 }
@@ -118,9 +359,9 @@ sensor_msgs::Imu::Ptr UAS::get_attitude_imu()
 
 geometry_msgs::Quaternion UAS::get_attitude_orientation()
 {
-	lock_guard lock(mutex);
-	if (imu_data)
-		return imu_data->orientation;
+	auto state = attitude_state.load();
+	if (state.valid)
+		return state.orientation;
 	else {
 		// fallback - return identity
 		geometry_msgs::Quaternion q;
@@ -131,9 +372,9 @@ geometry_msgs::Quaternion UAS::get_attitude_orientation()
 
 geometry_msgs::Vector3 UAS::get_attitude_angular_velocity()
 {
-	lock_guard lock(mutex);
-	if (imu_data)
-		return imu_data->angular_velocity;
+	auto state = attitude_state.load();
+	if (state.valid)
+		return state.angular_velocity;
 	else {
 		// fallback
 		geometry_msgs::Vector3 v;
@@ -142,6 +383,22 @@ geometry_msgs::Vector3 UAS::get_attitude_angular_velocity()
 	}
 }
 
+void UAS::get_attitude(geometry_msgs::Quaternion &orientation,
+		geometry_msgs::Vector3 &angular_velocity)
+{
+	auto state = attitude_state.load();
+	if (state.valid) {
+		orientation = state.orientation;
+		angular_velocity = state.angular_velocity;
+	}
+	else {
+		// fallback - identity, no rotation
+		orientation.w = 1.0;
+		orientation.x = orientation.y = orientation.z = 0.0;
+		angular_velocity.x = angular_velocity.y = angular_velocity.z = 0.0;
+	}
+}
+
 
 /* -*- GPS data -*- */
 
@@ -149,24 +406,21 @@ void UAS::update_gps_fix_epts(sensor_msgs::NavSatFix::Ptr &fix,
 		float eph, float epv,
 		int fix_type, int satellites_visible)
 {
-	lock_guard lock(mutex);
+	gps_state.store(GpsState{eph, epv, fix_type, satellites_visible});
 
+	lock_guard lock(mutex);
 	gps_fix = fix;
-	gps_eph = eph;
-	gps_epv = epv;
-	gps_fix_type = fix_type;
-	gps_satellites_visible = satellites_visible;
 }
 
 //! Returns EPH, EPV, Fix type and satellites visible
 void UAS::get_gps_epts(float &eph, float &epv, int &fix_type, int &satellites_visible)
 {
-	lock_guard lock(mutex);
+	auto state = gps_state.load();
 
-	eph = gps_eph;
-	epv = gps_epv;
-	fix_type = gps_fix_type;
-	satellites_visible = gps_satellites_visible;
+	eph = state.eph;
+	epv = state.epv;
+	fix_type = state.fix_type;
+	satellites_visible = state.satellites_visible;
 }
 
 //! Retunrs last GPS RAW message
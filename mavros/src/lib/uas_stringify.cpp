@@ -12,6 +12,8 @@
  */
 
 #include <array>
+#include <vector>
+#include <algorithm>
 #include <unordered_map>
 #include <stdexcept>
 #include <mavros/mavros_uas.h>
@@ -23,13 +25,75 @@ using mavros::utils::enum_value;
 
 /* -*- mode stringify functions -*- */
 
-typedef std::unordered_map<uint32_t, const std::string> cmode_map;
+//! Flat custom mode table entry: tables are constexpr data, no
+//! per-process map construction for the forward direction.
+struct CModeEntry {
+	uint32_t mode;
+	const char *name;
+};
+
+/**
+ * @brief Lookup indexes built once over a flat mode table
+ *
+ * mode -> name goes through a mode-sorted copy (binary search, no
+ * allocation per query); name -> mode through a hash map built at
+ * static-init time. Hot queries never build strings for the tables.
+ */
+class CModeLookup {
+public:
+	CModeLookup(const CModeEntry *table_, size_t len_) :
+		table(table_),
+		len(len_),
+		by_mode(table_, table_ + len_)
+	{
+		std::sort(by_mode.begin(), by_mode.end(),
+				[](const CModeEntry &a, const CModeEntry &b) {
+					return a.mode < b.mode;
+				});
+
+		by_name.reserve(len);
+		for (size_t i = 0; i < len; i++)
+			by_name.emplace(table[i].name, table[i].mode);
+	}
+
+	//! @return nullptr if mode is not known
+	const char *find_name(uint32_t mode) const
+	{
+		auto it = std::lower_bound(by_mode.begin(), by_mode.end(), mode,
+				[](const CModeEntry &e, uint32_t m) {
+					return e.mode < m;
+				});
+		if (it != by_mode.end() && it->mode == mode)
+			return it->name;
+
+		return nullptr;
+	}
+
+	bool find_mode(const std::string &name, uint32_t &mode) const
+	{
+		auto it = by_name.find(name);
+		if (it == by_name.end())
+			return false;
+
+		mode = it->second;
+		return true;
+	}
+
+	const CModeEntry *begin() const { return table; }
+	const CModeEntry *end() const { return table + len; }
+
+private:
+	const CModeEntry *table;
+	size_t len;
+	std::vector<CModeEntry> by_mode;
+	std::unordered_map<std::string, uint32_t> by_name;
+};
 
 /** APM:Plane custom mode -> string
  *
  * ArduPlane/defines.h
  */
-static const cmode_map arduplane_cmode_map{{
+static constexpr CModeEntry arduplane_cmode_table[] = {
 	{ 0, "MANUAL" },
 	{ 1, "CIRCLE" },
 	{ 2, "STABILIZE" },
@@ -50,13 +114,13 @@ static const cmode_map arduplane_cmode_map{{
 	{ 19, "QLOITER" },
 	{ 20, "QLAND" },
 	{ 21, "QRTL" }
-}};
+};
 
 /** APM:Copter custom mode -> string
  *
  * ArduCopter/defines.h
  */
-static const cmode_map arducopter_cmode_map{{
+static constexpr CModeEntry arducopter_cmode_table[] = {
 	{ 0, "STABILIZE" },
 	{ 1, "ACRO" },
 	{ 2, "ALT_HOLD" },
@@ -77,13 +141,13 @@ static const cmode_map arducopter_cmode_map{{
 	{ 18, "THROW" },
 	{ 19, "AVOID_ADSB" },
 	{ 20, "GUIDED_NOGPS" }
-}};
+};
 
 /** APM:Rover custom mode -> string
  *
  * APMrover2/defines.h
  */
-static const cmode_map apmrover2_cmode_map{{
+static constexpr CModeEntry apmrover2_cmode_table[] = {
 	{ 0, "MANUAL" },
 	{ 2, "LEARNING" },
 	{ 3, "STEERING" },
@@ -92,7 +156,7 @@ static const cmode_map apmrover2_cmode_map{{
 	{ 11, "RTL" },
 	{ 15, "GUIDED" },
 	{ 16, "INITIALISING" }
-}};
+};
 
 /** ArduSub custom mode -> string
  *
@@ -100,7 +164,7 @@ static const cmode_map apmrover2_cmode_map{{
  *
  * ArduSub/defines.h
  */
-static const cmode_map ardusub_cmode_map{{
+static constexpr CModeEntry ardusub_cmode_table[] = {
 	{ 0, "STABILIZE" },
 	{ 1, "ACRO" },
 	{ 2, "ALT_HOLD" },
@@ -119,10 +183,10 @@ static const cmode_map ardusub_cmode_map{{
 	{ 17, "BRAKE" },	// n/a
 	{ 18, "THROW" },
 	{ 19, "MANUAL" }
-}};
+};
 
 //! PX4 custom mode -> string
-static const cmode_map px4_cmode_map{{
+static constexpr CModeEntry px4_cmode_table[] = {
 	{ px4::define_mode(px4::custom_mode::MAIN_MODE_MANUAL),           "MANUAL" },
 	{ px4::define_mode(px4::custom_mode::MAIN_MODE_ACRO),             "ACRO" },
 	{ px4::define_mode(px4::custom_mode::MAIN_MODE_ALTCTL),           "ALTCTL" },
@@ -138,7 +202,15 @@ static const cmode_map px4_cmode_map{{
 	{ px4::define_mode_auto(px4::custom_mode::SUB_MODE_AUTO_READY),   "AUTO.READY" },
 	{ px4::define_mode_auto(px4::custom_mode::SUB_MODE_AUTO_TAKEOFF), "AUTO.TAKEOFF" },
 	{ px4::define_mode_auto(px4::custom_mode::SUB_MODE_AUTO_FOLLOW_TARGET), "AUTO.FOLLOW_TARGET" },
-}};
+};
+
+#define CMODE_LOOKUP(table)	CModeLookup(table, sizeof(table) / sizeof(table[0]))
+
+static const auto arduplane_cmode_lookup = CMODE_LOOKUP(arduplane_cmode_table);
+static const auto arducopter_cmode_lookup = CMODE_LOOKUP(arducopter_cmode_table);
+static const auto apmrover2_cmode_lookup = CMODE_LOOKUP(apmrover2_cmode_table);
+static const auto ardusub_cmode_lookup = CMODE_LOOKUP(ardusub_cmode_table);
+static const auto px4_cmode_lookup = CMODE_LOOKUP(px4_cmode_table);
 
 static inline std::string str_base_mode(int base_mode) {
 	return utils::format("MODE(0x%2X)", base_mode);
@@ -148,11 +220,11 @@ static std::string str_custom_mode(uint32_t custom_mode) {
 	return utils::format("CMODE(%u)", custom_mode);
 }
 
-static std::string str_mode_cmap(const cmode_map &cmap, uint32_t custom_mode)
+static std::string str_mode_cmap(const CModeLookup &cmap, uint32_t custom_mode)
 {
-	auto it = cmap.find(custom_mode);
-	if (it != cmap.end())
-		return it->second;
+	const char *name = cmap.find_name(custom_mode);
+	if (name != nullptr)
+		return name;
 	else
 		return str_custom_mode(custom_mode);
 }
@@ -169,7 +241,7 @@ static inline std::string str_mode_px4(uint32_t custom_mode_int)
 		custom_mode.sub_mode = 0;
 	}
 
-	return str_mode_cmap(px4_cmode_map, custom_mode.data);
+	return str_mode_cmap(px4_cmode_lookup, custom_mode.data);
 }
 
 static inline bool is_apm_copter(UAS::MAV_TYPE type)
@@ -190,13 +262,13 @@ std::string UAS::str_mode_v10(uint8_t base_mode, uint32_t custom_mode)
 	auto ap = get_autopilot();
 	if (MAV_AUTOPILOT::ARDUPILOTMEGA == ap) {
 		if (is_apm_copter(type))
-			return str_mode_cmap(arducopter_cmode_map, custom_mode);
+			return str_mode_cmap(arducopter_cmode_lookup, custom_mode);
 		else if (type == MAV_TYPE::FIXED_WING)
-			return str_mode_cmap(arduplane_cmode_map, custom_mode);
+			return str_mode_cmap(arduplane_cmode_lookup, custom_mode);
 		else if (type == MAV_TYPE::GROUND_ROVER)
-			return str_mode_cmap(apmrover2_cmode_map, custom_mode);
+			return str_mode_cmap(apmrover2_cmode_lookup, custom_mode);
 		else if (type == MAV_TYPE::SUBMARINE)
-			return str_mode_cmap(ardusub_cmode_map, custom_mode);
+			return str_mode_cmap(ardusub_cmode_lookup, custom_mode);
 		else {
 			ROS_WARN_THROTTLE_NAMED(30, "uas", "MODE: Unknown APM based FCU! Type: %d", enum_value(type));
 			return str_custom_mode(custom_mode);
@@ -213,15 +285,11 @@ std::string UAS::str_mode_v10(uint8_t base_mode, uint32_t custom_mode)
  * Add a fallback CMODE(dec) decoder for unknown FCU's
  */
 
-static bool cmode_find_cmap(const cmode_map &cmap, std::string &cmode_str, uint32_t &cmode)
+static bool cmode_find_cmap(const CModeLookup &cmap, std::string &cmode_str, uint32_t &cmode)
 {
 	// 1. try find by name
-	for (auto &mode : cmap) {
-		if (mode.second == cmode_str) {
-			cmode = mode.first;
-			return true;
-		}
-	}
+	if (cmap.find_mode(cmode_str, cmode))
+		return true;
 
 	// 2. try convert integer
 	//! @todo parse CMODE(dec)
@@ -236,7 +304,7 @@ static bool cmode_find_cmap(const cmode_map &cmap, std::string &cmode_str, uint3
 	// Debugging output.
 	std::ostringstream os;
 	for (auto &mode : cmap)
-		os << " " << mode.second;
+		os << " " << mode.name;
 
 	ROS_ERROR_STREAM_NAMED("uas", "MODE: Unknown mode: " << cmode_str);
 	ROS_INFO_STREAM_NAMED("uas", "MODE: Known modes are:" << os.str());
@@ -253,16 +321,16 @@ bool UAS::cmode_from_str(std::string cmode_str, uint32_t &custom_mode)
 	auto ap = get_autopilot();
 	if (MAV_AUTOPILOT::ARDUPILOTMEGA == ap) {
 		if (is_apm_copter(type))
-			return cmode_find_cmap(arducopter_cmode_map, cmode_str, custom_mode);
+			return cmode_find_cmap(arducopter_cmode_lookup, cmode_str, custom_mode);
 		else if (type == MAV_TYPE::FIXED_WING)
-			return cmode_find_cmap(arduplane_cmode_map, cmode_str, custom_mode);
+			return cmode_find_cmap(arduplane_cmode_lookup, cmode_str, custom_mode);
 		else if (type == MAV_TYPE::GROUND_ROVER)
-			return cmode_find_cmap(apmrover2_cmode_map, cmode_str, custom_mode);
+			return cmode_find_cmap(apmrover2_cmode_lookup, cmode_str, custom_mode);
 		else if (type == MAV_TYPE::SUBMARINE)
-			return cmode_find_cmap(ardusub_cmode_map, cmode_str, custom_mode);
+			return cmode_find_cmap(ardusub_cmode_lookup, cmode_str, custom_mode);
 	}
 	else if (MAV_AUTOPILOT::PX4 == ap)
-		return cmode_find_cmap(px4_cmode_map, cmode_str, custom_mode);
+		return cmode_find_cmap(px4_cmode_lookup, cmode_str, custom_mode);
 
 	ROS_ERROR_NAMED("uas", "MODE: Unsupported FCU");
 	return false;
@@ -29,8 +29,20 @@ static inline ros::Time ros_time_from_ns(const uint64_t stamp_ns) {
 		stamp_ns % 1000000000UL);		// t_nsec
 }
 
+//! Map remote (FCU) nanoseconds to local time through the clock model
+static inline uint64_t clock_model_map_ns(const UAS::ClockModel &cm, const uint64_t remote_ns) {
+	// extrapolate between exchanges: the offset drifts with the
+	// estimated skew of the remote clock
+	int64_t drift = cm.skew * (int64_t(remote_ns) - int64_t(cm.ref_remote_ns));
+	return remote_ns + cm.offset_ns + drift;
+}
+
 ros::Time UAS::synchronise_stamp(uint32_t time_boot_ms) {
-	// copy offset from atomic var
+	auto cm = clock_model.load();
+	if (cm.valid)
+		return ros_time_from_ns(clock_model_map_ns(cm, static_cast<uint64_t>(time_boot_ms) * 1000000UL));
+
+	// no model yet: old single-offset behavior
 	uint64_t offset_ns = time_offset;
 
 	if (offset_ns > 0 || tsync_mode == timesync_mode::PASSTHROUGH) {
@@ -42,6 +54,10 @@ ros::Time UAS::synchronise_stamp(uint32_t time_boot_ms) {
 }
 
 ros::Time UAS::synchronise_stamp(uint64_t time_usec) {
+	auto cm = clock_model.load();
+	if (cm.valid)
+		return ros_time_from_ns(clock_model_map_ns(cm, time_usec * 1000UL));
+
 	uint64_t offset_ns = time_offset;
 
 	if (offset_ns > 0 || tsync_mode == timesync_mode::PASSTHROUGH) {
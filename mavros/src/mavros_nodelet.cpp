@@ -0,0 +1,53 @@
+/**
+ * @brief MAVROS Nodelet
+ * @file mavros_nodelet.cpp
+ *
+ * @addtogroup nodelib
+ * @{
+ */
+/*
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+
+#include <memory>
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+#include <mavros/mavros.h>
+
+namespace mavros {
+/**
+ * @brief MavRos hosted as a nodelet
+ *
+ * Loading mavros into the same nodelet manager as the estimator and
+ * planner consumers replaces the TCPROS serialization and socket hop
+ * of every high-rate topic (imu, local_position, /mavlink/from) with
+ * intra-process boost::shared_ptr passing; together with the pooled
+ * /mavlink/from publisher the mavros to consumer path is copy-free.
+ *
+ * Node handles come from the manager, so subscriptions and timers
+ * are serviced by the manager's callback threads instead of a
+ * private spinner. Parameters resolve under the nodelet name, the
+ * mavlink bridge under <manager namespace>/mavlink — same layout as
+ * the standalone node.
+ *
+ * @note plugins still advertise under the private namespace of the
+ * manager process: load one mavros per manager and place the manager
+ * in the desired namespace.
+ */
+class MavRosNodelet : public nodelet::Nodelet
+{
+public:
+	void onInit() override
+	{
+		mavros.reset(new MavRos(getMTPrivateNodeHandle(),
+				ros::NodeHandle(getMTNodeHandle(), "mavlink")));
+	}
+
+private:
+	std::unique_ptr<MavRos> mavros;
+};
+}	// namespace mavros
+
+PLUGINLIB_EXPORT_CLASS(mavros::MavRosNodelet, nodelet::Nodelet)
@@ -117,6 +117,10 @@ private:
 		}
 
 		status_pub.publish(msg);
+
+		// feed the radio buffer fill level back into the link
+		// tx scheduler, so bulk traffic cannot overrun the radio
+		UAS_FCU(m_uas)->set_link_txbuf(rst.txbuf);
 	}
 
 
@@ -157,4 +161,6 @@ private:
 }	// namespace mavros
 
 #include <pluginlib/class_list_macros.h>
+#include <mavros/plugin_registry.h>
 PLUGINLIB_EXPORT_CLASS(mavros::std_plugins::TDRRadioPlugin, mavros::plugin::PluginBase)
+MAVROS_PLUGIN_FACTORY(mavros::std_plugins::TDRRadioPlugin, tdr_radio)
@@ -66,4 +66,6 @@ private:
 }	// namespace mavros
 
 #include <pluginlib/class_list_macros.h>
+#include <mavros/plugin_registry.h>
 PLUGINLIB_EXPORT_CLASS(mavros::std_plugins::ActuatorControlPlugin, mavros::plugin::PluginBase)
+MAVROS_PLUGIN_FACTORY(mavros::std_plugins::ActuatorControlPlugin, actuator_control)
@@ -72,4 +72,6 @@ private:
 }	// namespace mavros
 
 #include <pluginlib/class_list_macros.h>
+#include <mavros/plugin_registry.h>
 PLUGINLIB_EXPORT_CLASS(mavros::std_plugins::AltitudePlugin, mavros::plugin::PluginBase)
+MAVROS_PLUGIN_FACTORY(mavros::std_plugins::AltitudePlugin, altitude)
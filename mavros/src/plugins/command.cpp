@@ -14,11 +14,14 @@
  * https://github.com/mavlink/mavros/tree/master/LICENSE.md
  */
 
+#include <array>
 #include <chrono>
 #include <condition_variable>
 #include <mavros/mavros_plugin.h>
 
 #include <mavros_msgs/CommandLong.h>
+#include <mavros_msgs/CommandAsync.h>
+#include <mavros_msgs/CommandResult.h>
 #include <mavros_msgs/CommandInt.h>
 #include <mavros_msgs/CommandBool.h>
 #include <mavros_msgs/CommandHome.h>
@@ -55,6 +58,8 @@ public:
 	CommandPlugin() : PluginBase(),
 		cmd_nh("~cmd"),
 		use_comp_id_system_control(false),
+		async_next_id(0),
+		async_retries(3),
 		ACK_TIMEOUT_DT(ACK_TIMEOUT_MS / 1000.0)
 	{ }
 
@@ -71,6 +76,14 @@ public:
 		takeoff_srv = cmd_nh.advertiseService("takeoff", &CommandPlugin::takeoff_cb, this);
 		land_srv = cmd_nh.advertiseService("land", &CommandPlugin::land_cb, this);
 		trigger_srv = cmd_nh.advertiseService("trigger_control", &CommandPlugin::trigger_control_cb, this);
+
+		// async interface: fire-and-correlate, result on topic
+		cmd_nh.param("async_retries", async_retries, 3);
+		command_async_srv = cmd_nh.advertiseService("command_async", &CommandPlugin::command_async_cb, this);
+		result_pub = cmd_nh.advertise<mavros_msgs::CommandResult>("result", 10);
+		retry_timer = cmd_nh.createTimer(ros::Duration(RETRY_TICK_MS / 1000.0),
+				&CommandPlugin::async_retry_cb, this,
+				false /* oneshot */, false /* autostart */);
 	}
 
 	Subscriptions get_subscriptions()
@@ -91,11 +104,31 @@ private:
 	ros::ServiceServer takeoff_srv;
 	ros::ServiceServer land_srv;
 	ros::ServiceServer trigger_srv;
+	ros::ServiceServer command_async_srv;
+	ros::Publisher result_pub;
+	ros::Timer retry_timer;
 
 	bool use_comp_id_system_control;
 
+	//! one in-flight async command
+	struct AsyncCommand {
+		uint32_t id;
+		uint16_t command;
+		uint8_t confirmation;
+		std::array<float, 7> param;
+		int retries_left;
+		ros::Time next_retry;
+		ros::Duration backoff;
+	};
+
+	std::list<AsyncCommand> async_list;
+	uint32_t async_next_id;
+	int async_retries;
+
 	std::list<CommandTransaction *> ack_waiting_list;
 	static constexpr int ACK_TIMEOUT_MS = 5000;
+	static constexpr int RETRY_TICK_MS = 100;
+	static constexpr int RETRY_BACKOFF_MS = 500;
 
 	const ros::Duration ACK_TIMEOUT_DT;
 
@@ -112,10 +145,76 @@ private:
 				return;
 			}
 
+		// async commands: oldest entry for that command wins
+		for (auto it = async_list.begin(); it != async_list.end(); it++)
+			if (it->command == ack.command) {
+				publish_result(*it, ack.result);
+				async_list.erase(it);
+				if (async_list.empty())
+					retry_timer.stop();
+				return;
+			}
+
 		ROS_WARN_THROTTLE_NAMED(10, "cmd", "CMD: Unexpected command %u, result %u",
 				ack.command, ack.result);
 	}
 
+	/* -*- async engine -*- */
+
+	void publish_result(const AsyncCommand &ac, uint8_t result)
+	{
+		using mavlink::common::MAV_RESULT;
+
+		auto msg = boost::make_shared<mavros_msgs::CommandResult>();
+
+		msg->header.stamp = ros::Time::now();
+		msg->id = ac.id;
+		msg->command = ac.command;
+		msg->result = result;
+		msg->success = result == enum_value(MAV_RESULT::ACCEPTED);
+
+		result_pub.publish(msg);
+	}
+
+	void async_retry_cb(const ros::TimerEvent &event)
+	{
+		using mavlink::common::MAV_RESULT;
+
+		lock_guard lock(mutex);
+
+		for (auto it = async_list.begin(); it != async_list.end(); ) {
+			if (event.current_real < it->next_retry) {
+				it++;
+				continue;
+			}
+
+			if (it->retries_left <= 0) {
+				ROS_ERROR_NAMED("cmd", "CMD: Async command %u (id %u) timed out",
+						it->command, it->id);
+				publish_result(*it, enum_value(MAV_RESULT::FAILED));
+				it = async_list.erase(it);
+				continue;
+			}
+
+			// confirmation counts retransmissions of the same command
+			it->confirmation++;
+			it->retries_left--;
+			it->backoff += it->backoff;	// exponential backoff
+			it->next_retry = event.current_real + it->backoff;
+
+			command_long(false,
+					it->command, it->confirmation,
+					it->param[0], it->param[1],
+					it->param[2], it->param[3],
+					it->param[4], it->param[5],
+					it->param[6]);
+			it++;
+		}
+
+		if (async_list.empty())
+			retry_timer.stop();
+	}
+
 	/* -*- mid-level functions -*- */
 
 	bool wait_ack_for(CommandTransaction *tr) {
@@ -299,6 +398,38 @@ private:
 				res.success, res.result);
 	}
 
+	bool command_async_cb(mavros_msgs::CommandAsync::Request &req,
+			mavros_msgs::CommandAsync::Response &res)
+	{
+		lock_guard lock(mutex);
+
+		AsyncCommand ac;
+		ac.id = ++async_next_id;
+		ac.command = req.command;
+		ac.confirmation = req.confirmation;
+		ac.param = { {
+			req.param1, req.param2, req.param3, req.param4,
+			req.param5, req.param6, req.param7
+		} };
+		ac.retries_left = async_retries;
+		ac.backoff = ros::Duration(RETRY_BACKOFF_MS / 1000.0);
+		ac.next_retry = ros::Time::now() + ac.backoff;
+
+		async_list.push_back(ac);
+		retry_timer.start();
+
+		command_long(false,
+				req.command, req.confirmation,
+				req.param1, req.param2,
+				req.param3, req.param4,
+				req.param5, req.param6,
+				req.param7);
+
+		res.success = true;
+		res.id = ac.id;
+		return true;
+	}
+
 	bool command_int_cb(mavros_msgs::CommandInt::Request &req,
 			mavros_msgs::CommandInt::Response &res)
 	{
@@ -374,4 +505,6 @@ private:
 }	// namespace mavros
 
 #include <pluginlib/class_list_macros.h>
+#include <mavros/plugin_registry.h>
 PLUGINLIB_EXPORT_CLASS(mavros::std_plugins::CommandPlugin, mavros::plugin::PluginBase)
+MAVROS_PLUGIN_FACTORY(mavros::std_plugins::CommandPlugin, command)
@@ -14,11 +14,16 @@
  * https://github.com/mavlink/mavros/tree/master/LICENSE.md
  */
 
+#include <mutex>
 #include <chrono>
 #include <cerrno>
+#include <fstream>
 #include <condition_variable>
 #include <mavros/mavros_plugin.h>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 #include <std_srvs/Empty.h>
 #include <mavros_msgs/FileEntry.h>
 #include <mavros_msgs/FileList.h>
@@ -26,6 +31,9 @@
 #include <mavros_msgs/FileClose.h>
 #include <mavros_msgs/FileRead.h>
 #include <mavros_msgs/FileWrite.h>
+#include <mavros_msgs/FileDownload.h>
+#include <mavros_msgs/FileUpload.h>
+#include <mavros_msgs/FileTransferProgress.h>
 #include <mavros_msgs/FileRemove.h>
 #include <mavros_msgs/FileMakeDir.h>
 #include <mavros_msgs/FileRemoveDir.h>
@@ -191,6 +199,141 @@ public:
 };
 
 
+/**
+ * Incremental CRC-32 over downloaded content.
+ *
+ * Matches the FCU FTP kCmdCalcFileCRC32 variant (reflected
+ * polynomial 0xEDB88320, zero init, no final xor, as in the PX4 /
+ * NuttX crc32part()). SSE4.2 CRC32 instructions implement the
+ * Castagnoli polynomial and can't verify against the FCU, so the
+ * fast portable path is a slice-by-8 table folded once per chunk.
+ */
+class Crc32 {
+public:
+	Crc32() : state(0)
+	{ }
+
+	void reset() {
+		state = 0;
+	}
+
+	uint32_t digest() const {
+		return state;
+	}
+
+	void update(const uint8_t *data, size_t len)
+	{
+		auto t = tables();
+		uint32_t crc = state;
+
+		while (len >= 8) {
+			crc ^= uint32_t(data[0]) | uint32_t(data[1]) << 8 |
+			       uint32_t(data[2]) << 16 | uint32_t(data[3]) << 24;
+			crc = t[7][crc & 0xff] ^ t[6][(crc >> 8) & 0xff] ^
+			      t[5][(crc >> 16) & 0xff] ^ t[4][crc >> 24] ^
+			      t[3][data[4]] ^ t[2][data[5]] ^
+			      t[1][data[6]] ^ t[0][data[7]];
+			data += 8;
+			len -= 8;
+		}
+
+		while (len--)
+			crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xff];
+
+		state = crc;
+	}
+
+private:
+	uint32_t state;
+
+	using Table = uint32_t (*)[256];
+
+	static Table tables()
+	{
+		static uint32_t t[8][256];
+		static std::once_flag once;
+
+		std::call_once(once, []() {
+			for (uint32_t i = 0; i < 256; i++) {
+				uint32_t c = i;
+				for (int k = 0; k < 8; k++)
+					c = (c & 1) ? 0xedb88320U ^ (c >> 1) : c >> 1;
+				t[0][i] = c;
+			}
+
+			for (uint32_t i = 0; i < 256; i++)
+				for (int k = 1; k < 8; k++)
+					t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xff];
+		});
+
+		return t;
+	}
+};
+
+
+/**
+ * Download goodput and retransmit diagnostics
+ */
+class FTPDownloadDiag : public diagnostic_updater::DiagnosticTask
+{
+public:
+	explicit FTPDownloadDiag(const std::string &name) :
+		diagnostic_updater::DiagnosticTask(name),
+		cur_retries(0),
+		last_bytes(0),
+		last_retries(0),
+		total_retries(0),
+		last_dt(0.0)
+	{ }
+
+	void start()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		cur_retries = 0;
+		start_stamp = ros::Time::now();
+	}
+
+	void retry()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		cur_retries++;
+		total_retries++;
+	}
+
+	void finish(size_t bytes)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		last_bytes = bytes;
+		last_retries = cur_retries;
+		last_dt = (ros::Time::now() - start_stamp).toSec();
+	}
+
+	void run(diagnostic_updater::DiagnosticStatusWrapper &stat)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (last_dt > 0.0)
+			stat.summary(0, utils::format("%.1f KiB/s", last_bytes / last_dt / 1024.0));
+		else
+			stat.summary(0, "no transfer yet");
+
+		stat.addf("Last read (bytes)", "%zu", last_bytes);
+		stat.addf("Last duration (s)", "%.3f", last_dt);
+		stat.addf("Last retransmits", "%zu", last_retries);
+		stat.addf("Total retransmits", "%zu", total_retries);
+	}
+
+private:
+	std::mutex mutex;
+	ros::Time start_stamp;
+	size_t cur_retries;
+	size_t last_bytes;
+	size_t last_retries;
+	size_t total_retries;
+	double last_dt;
+};
+
+
 /**
  * @brief FTP plugin.
  */
@@ -205,11 +348,19 @@ public:
 		r_errno(0),
 		list_offset(0),
 		read_offset(0),
+		read_next_req(0),
+		read_window(1),
 		write_offset(0),
 		open_size(0),
 		read_size(0),
 		read_buffer {},
-		checksum_crc32(0)
+		checksum_crc32(0),
+		stream_fd(-1),
+		stream_done(0),
+		stream_total(0),
+		stream_errno(0),
+		stream_direction(0),
+		dl_diag("FTP download")
 	{ }
 
 	void initialize(UAS &uas_)
@@ -220,6 +371,12 @@ public:
 		FTPRequest r;
 		ROS_ASSERT(r.payload.size() - sizeof(FTPRequest::PayloadHeader) == r.DATA_MAXSZ);
 
+		ftp_nh.param("read_window", read_window, 1);
+		if (read_window < 1)
+			read_window = 1;
+
+		m_uas->diag_updater.add(dl_diag);
+
 		list_srv = ftp_nh.advertiseService("list", &FTPPlugin::list_cb, this);
 		open_srv = ftp_nh.advertiseService("open", &FTPPlugin::open_cb, this);
 		close_srv = ftp_nh.advertiseService("close", &FTPPlugin::close_cb, this);
@@ -232,6 +389,9 @@ public:
 		reset_srv = ftp_nh.advertiseService("reset", &FTPPlugin::reset_cb, this);
 		rename_srv = ftp_nh.advertiseService("rename", &FTPPlugin::rename_cb, this);
 		checksum_srv = ftp_nh.advertiseService("checksum", &FTPPlugin::checksum_cb, this);
+		download_srv = ftp_nh.advertiseService("download", &FTPPlugin::download_cb, this);
+		upload_srv = ftp_nh.advertiseService("upload", &FTPPlugin::upload_cb, this);
+		progress_pub = ftp_nh.advertise<mavros_msgs::FileTransferProgress>("transfer_progress", 10);
 	}
 
 	Subscriptions get_subscriptions()
@@ -255,6 +415,9 @@ private:
 	ros::ServiceServer truncate_srv;
 	ros::ServiceServer reset_srv;
 	ros::ServiceServer checksum_srv;
+	ros::ServiceServer download_srv;
+	ros::ServiceServer upload_srv;
+	ros::Publisher progress_pub;
 
 	//! This type used in servicies to store 'data' fileds.
 	typedef std::vector<uint8_t> V_FileData;
@@ -291,6 +454,10 @@ private:
 	// FTP:Read
 	size_t read_size;
 	uint32_t read_offset;
+	uint32_t read_next_req;		//!< pipelined read: next offset to request
+	int read_window;		//!< read requests kept in flight
+	//! pipelined read: chunks received ahead of a lost one
+	std::map<uint32_t, V_FileData> read_stash;
 	V_FileData read_buffer;
 
 	// FTP:Write
@@ -301,6 +468,18 @@ private:
 	// FTP:CalcCRC32
 	uint32_t checksum_crc32;
 
+	// FTP:Download / FTP:Upload streaming state
+	int stream_fd;			//!< local file descriptor, -1 when inactive
+	size_t stream_done;		//!< bytes transferred so far
+	size_t stream_total;
+	int stream_errno;		//!< deferred local write error
+	uint8_t stream_direction;
+	std::string stream_path;	//!< remote path, for progress reports
+	ros::Time stream_progress_stamp;
+	Crc32 stream_crc;		//!< folded per chunk during download
+
+	FTPDownloadDiag dl_diag;
+
 	// Timeouts,
 	// computed as x4 time that needed for transmission of
 	// one message at 57600 baud rate
@@ -310,6 +489,8 @@ private:
 
 	//! Maximum difference between allocated space and used
 	static constexpr size_t MAX_RESERVE_DIFF = 0x10000;
+	//! Upload streaming slice: file never loaded whole into memory
+	static constexpr size_t UPLOAD_SLICE = 0x8000;
 
 	//! @todo exchange speed calculation
 	//! @todo diagnostics
@@ -328,7 +509,10 @@ private:
 
 		const uint16_t incoming_seqnr = req.header()->seqNumber;
 		const uint16_t expected_seqnr = last_send_seqnr + 1;
-		if (incoming_seqnr != expected_seqnr) {
+		if (incoming_seqnr != expected_seqnr &&
+				!(op_state == OP::READ && read_window > 1)) {
+			/* pipelined reads share the seq space,
+			 * their chunks are matched by offset instead */
 			ROS_WARN_NAMED("ftp", "FTP: Lost sync! seqnr: %u != %u",
 					incoming_seqnr, expected_seqnr);
 			go_idle(true, EILSEQ);
@@ -488,28 +672,103 @@ private:
 		}
 
 		if (hdr->offset != read_offset) {
+			if (read_window > 1 && hdr->offset > read_offset &&
+					hdr->offset < read_next_req) {
+				/* a chunk before this one was lost:
+				 * stash it and re-request only the gap */
+				read_stash[hdr->offset].assign(req.data(), req.data() + hdr->size);
+				dl_diag.retry();
+				send_read_command_at(read_offset);
+				return;
+			}
+
 			ROS_ERROR_NAMED("ftp", "FTP:Read different offset");
 			go_idle(true, EBADE);
 			return;
 		}
 
-		// kCmdReadFile return cunks of DATA_MAXSZ or smaller (last chunk)
-		// We requested specific amount of data, that can be smaller,
-		// but not larger.
-		const size_t bytes_left = read_size - read_buffer.size();
-		const size_t bytes_to_copy = std::min<size_t>(bytes_left, hdr->size);
+		bool more = read_append_chunk(req.data(), hdr->size);
 
-		read_buffer.insert(read_buffer.end(), req.data(), req.data() + bytes_to_copy);
+		/* the gap is closed: merge stashed chunks that are now in order */
+		while (more && !read_stash.empty() &&
+				read_stash.begin()->first == read_offset) {
+			auto &chunk = read_stash.begin()->second;
+			more = read_append_chunk(chunk.data(), chunk.size());
+			read_stash.erase(read_stash.begin());
+		}
 
-		if (bytes_to_copy == FTPRequest::DATA_MAXSZ) {
-			// Possibly more data
-			read_offset += bytes_to_copy;
-			send_read_command();
+		if (more) {
+			/* keep up to read_window requests in flight */
+			const uint32_t read_end = read_offset + (read_size - read_bytes_done());
+			while (read_next_req < read_end &&
+					read_next_req < read_offset + uint32_t(read_window) * FTPRequest::DATA_MAXSZ) {
+				send_read_command_at(read_next_req);
+				read_next_req += FTPRequest::DATA_MAXSZ;
+			}
 		}
 		else
 			read_file_end();
 	}
 
+	/**
+	 * Append read chunk at read_offset.
+	 *
+	 * kCmdReadFile return cunks of DATA_MAXSZ or smaller (last chunk).
+	 * We requested specific amount of data, that can be smaller,
+	 * but not larger.
+	 *
+	 * @return true while more chunks expected
+	 */
+	bool read_append_chunk(const uint8_t *data, size_t size)
+	{
+		const size_t bytes_left = read_size - read_bytes_done();
+		const size_t bytes_to_copy = std::min<size_t>(bytes_left, size);
+
+		if (stream_fd != -1) {
+			/* straight to the preallocated local file, no buffer */
+			if (stream_errno == 0 &&
+					pwrite(stream_fd, data, bytes_to_copy, read_offset) < 0)
+				stream_errno = errno;
+
+			/* the in-order cursor guarantees digest order
+			 * even with the pipelined window */
+			stream_crc.update(data, bytes_to_copy);
+
+			stream_done += bytes_to_copy;
+			publish_stream_progress();
+		}
+		else
+			read_buffer.insert(read_buffer.end(), data, data + bytes_to_copy);
+
+		read_offset += bytes_to_copy;
+
+		return bytes_to_copy == FTPRequest::DATA_MAXSZ;
+	}
+
+	inline size_t read_bytes_done() {
+		return (stream_fd != -1) ? stream_done : read_buffer.size();
+	}
+
+	//! throttled ~ftp/transfer_progress report
+	void publish_stream_progress()
+	{
+		auto now = ros::Time::now();
+		if (stream_done < stream_total &&
+				(now - stream_progress_stamp).toSec() < 0.25)
+			return;
+
+		stream_progress_stamp = now;
+
+		auto msg = boost::make_shared<mavros_msgs::FileTransferProgress>();
+		msg->header.stamp = now;
+		msg->file_path = stream_path;
+		msg->direction = stream_direction;
+		msg->offset = stream_done;
+		msg->size = stream_total;
+
+		progress_pub.publish(msg);
+	}
+
 	void handle_ack_write(FTPRequest &req)
 	{
 		auto hdr = req.header();
@@ -626,16 +885,20 @@ private:
 		req.send(m_uas, last_send_seqnr);
 	}
 
-	void send_read_command()
+	void send_read_command_at(uint32_t offset)
 	{
 		// read operation always try read DATA_MAXSZ block (hdr->size ignored)
-		ROS_DEBUG_STREAM_NAMED("ftp", "FTP:m: kCmdReadFile: " << active_session << " off: " << read_offset);
+		ROS_DEBUG_STREAM_NAMED("ftp", "FTP:m: kCmdReadFile: " << active_session << " off: " << offset);
 		FTPRequest req(FTPRequest::kCmdReadFile, active_session);
-		req.header()->offset = read_offset;
+		req.header()->offset = offset;
 		req.header()->size = 0 /* FTPRequest::DATA_MAXSZ */;
 		req.send(m_uas, last_send_seqnr);
 	}
 
+	void send_read_command() {
+		send_read_command_at(read_offset);
+	}
+
 	void send_write_command(const size_t bytes_to_copy)
 	{
 		// write chunk from write_buffer [write_it..bytes_to_copy]
@@ -772,6 +1035,15 @@ private:
 
 	void read_file_end() {
 		ROS_DEBUG_NAMED("ftp", "FTP:Read done");
+		read_stash.clear();
+		dl_diag.finish(read_bytes_done());
+
+		if (stream_fd != -1 && stream_errno != 0) {
+			/* remote side is fine, but the local write failed */
+			go_idle(true, stream_errno);
+			return;
+		}
+
 		go_idle(false);
 	}
 
@@ -788,14 +1060,26 @@ private:
 		active_session = it->second;
 		read_size = len;
 		read_offset = off;
+		read_next_req = off;
+		read_stash.clear();
 		read_buffer.clear();
-		if (read_buffer.capacity() < len ||
-				read_buffer.capacity() > len + MAX_RESERVE_DIFF) {
+		if (stream_fd == -1 &&
+				(read_buffer.capacity() < len ||
+				 read_buffer.capacity() > len + MAX_RESERVE_DIFF)) {
 			// reserve memory
 			read_buffer.reserve(len);
 		}
 
-		send_read_command();
+		dl_diag.start();
+
+		/* fill the request window */
+		const uint32_t read_end = read_offset + read_size;
+		do {
+			send_read_command_at(read_next_req);
+			read_next_req += FTPRequest::DATA_MAXSZ;
+		} while (read_next_req < read_end &&
+				read_next_req < read_offset + uint32_t(read_window) * FTPRequest::DATA_MAXSZ);
+
 		return true;
 	}
 
@@ -978,6 +1262,153 @@ private:
 		return true;
 	}
 
+	/**
+	 * Streaming FCU -> local file download.
+	 *
+	 * Unlike read_cb the content never passes a service payload:
+	 * chunks land in the local file as they arrive.
+	 */
+	bool download_cb(mavros_msgs::FileDownload::Request &req,
+			mavros_msgs::FileDownload::Response &res)
+	{
+		SERVICE_IDLE_CHECK();
+
+		if (session_file_map.find(req.file_path) != session_file_map.end()) {
+			ROS_ERROR_NAMED("ftp", "FTP: File %s: already opened",
+					req.file_path.c_str());
+			res.r_errno = EBUSY;
+			return true;
+		}
+
+		res.success = open_file(req.file_path, mavros_msgs::FileOpenRequest::MODE_READ);
+		if (res.success)
+			res.success = wait_completion(OPEN_TIMEOUT_MS);
+		if (!res.success) {
+			res.r_errno = r_errno;
+			return true;
+		}
+
+		const size_t fsize = open_size;
+
+		int fd = ::open(req.local_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd == -1 || ftruncate(fd, fsize) != 0) {
+			res.r_errno = errno;
+			ROS_ERROR_NAMED("ftp", "FTP:Download can't create %s: %s",
+					req.local_path.c_str(), strerror(res.r_errno));
+			if (fd != -1)
+				::close(fd);
+			res.success = false;
+		}
+		else {
+			stream_fd = fd;
+			stream_done = 0;
+			stream_total = fsize;
+			stream_errno = 0;
+			stream_direction = mavros_msgs::FileTransferProgress::DIRECTION_DOWNLOAD;
+			stream_path = req.file_path;
+			stream_progress_stamp = ros::Time();
+			stream_crc.reset();
+
+			res.success = read_file(req.file_path, 0, fsize);
+			if (res.success)
+				res.success = wait_completion(compute_rw_timeout(fsize));
+
+			res.size = stream_done;
+			res.crc32 = stream_crc.digest();
+			res.r_errno = r_errno;
+
+			stream_fd = -1;
+			::close(fd);
+
+			if (res.success && req.verify) {
+				/* local digest was folded in-line with the
+				 * transfer: only the FCU side needs a pass */
+				checksum_crc32_file(req.file_path);
+
+				if (!wait_completion(LIST_TIMEOUT_MS) ||
+						checksum_crc32 != res.crc32) {
+					ROS_ERROR_NAMED("ftp", "FTP:Download %s: CRC mismatch (local 0x%08x, remote 0x%08x)",
+							req.file_path.c_str(), res.crc32, checksum_crc32);
+					res.success = false;
+					res.r_errno = EBADMSG;
+				}
+			}
+		}
+
+		if (close_file(req.file_path))
+			wait_completion(OPEN_TIMEOUT_MS);
+
+		return true;
+	}
+
+	/**
+	 * Streaming local file -> FCU upload.
+	 */
+	bool upload_cb(mavros_msgs::FileUpload::Request &req,
+			mavros_msgs::FileUpload::Response &res)
+	{
+		SERVICE_IDLE_CHECK();
+
+		std::ifstream file(req.local_path, std::ios::binary | std::ios::ate);
+		if (!file) {
+			ROS_ERROR_NAMED("ftp", "FTP:Upload can't open %s", req.local_path.c_str());
+			res.r_errno = ENOENT;
+			return true;
+		}
+
+		const size_t fsize = file.tellg();
+		file.seekg(0);
+
+		res.success = open_file(req.file_path, mavros_msgs::FileOpenRequest::MODE_CREATE);
+		if (res.success)
+			res.success = wait_completion(OPEN_TIMEOUT_MS);
+		if (!res.success) {
+			res.r_errno = r_errno;
+			return true;
+		}
+
+		stream_done = 0;
+		stream_total = fsize;
+		stream_direction = mavros_msgs::FileTransferProgress::DIRECTION_UPLOAD;
+		stream_path = req.file_path;
+		stream_progress_stamp = ros::Time();
+
+		V_FileData slice;
+		size_t off = 0;
+		res.success = true;
+		while (off < fsize && res.success) {
+			const size_t n = std::min(UPLOAD_SLICE, fsize - off);
+
+			slice.resize(n);
+			if (!file.read(reinterpret_cast<char *>(slice.data()), n)) {
+				res.r_errno = EIO;
+				res.success = false;
+				break;
+			}
+
+			res.success = write_file(req.file_path, off, slice);
+			if (res.success)
+				res.success = wait_completion(compute_rw_timeout(n));
+			write_buffer.clear();
+
+			if (!res.success) {
+				res.r_errno = r_errno;
+				break;
+			}
+
+			off += n;
+			stream_done = off;
+			publish_stream_progress();
+		}
+
+		res.size = off;
+
+		if (close_file(req.file_path))
+			wait_completion(OPEN_TIMEOUT_MS);
+
+		return true;
+	}
+
 	bool remove_cb(mavros_msgs::FileRemove::Request &req,
 			mavros_msgs::FileRemove::Response &res)
 	{
@@ -1072,4 +1503,6 @@ private:
 }	// namespace mavros
 
 #include <pluginlib/class_list_macros.h>
+#include <mavros/plugin_registry.h>
 PLUGINLIB_EXPORT_CLASS(mavros::std_plugins::FTPPlugin, mavros::plugin::PluginBase)
+MAVROS_PLUGIN_FACTORY(mavros::std_plugins::FTPPlugin, ftp)
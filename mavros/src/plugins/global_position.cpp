@@ -16,6 +16,8 @@
  * https://github.com/mavlink/mavros/tree/master/LICENSE.md
  */
 
+#include <cmath>
+#include <mutex>
 #include <angles/angles.h>
 #include <mavros/mavros_plugin.h>
 #include <eigen_conversions/eigen_msg.h>
@@ -48,7 +50,10 @@ public:
 		tf_send(false),
 		rot_cov(99999.0),
 		use_relative_alt(true),
-		is_map_init(false)
+		is_map_init(false),
+		geo_cache_threshold(0.0),
+		geoid_cache_valid(false),
+		ecef_cache_valid(false)
 	{ }
 
 	void initialize(UAS &uas_)
@@ -59,6 +64,8 @@ public:
 		gp_nh.param<std::string>("frame_id", frame_id, "map");
 		gp_nh.param("rot_covariance", rot_cov, 99999.0);
 		gp_nh.param("use_relative_alt", use_relative_alt, true);
+		// radius of the geodetic memoization caches [m], 0 disables
+		gp_nh.param("geo_cache_threshold", geo_cache_threshold, 50.0);
 		// tf subsection
 		gp_nh.param("tf/send", tf_send, true);
 		gp_nh.param<std::string>("tf/frame_id", tf_frame_id, "map");
@@ -129,12 +136,116 @@ private:
 	Eigen::Vector3d map_origin {};	//!< origin of map frame
 	Eigen::Vector3d local_ecef {};	//!< local ECEF coordinates on map frame
 
+	/**
+	 * Geodetic memoization: at 10-50 Hz the vehicle moves meters
+	 * between fixes while the geoid interpolation and the exact
+	 * LLA->ECEF conversion are recomputed from scratch every time.
+	 * Both are cached around the last exact query point and refreshed
+	 * only once the fix leaves a geo_cache_threshold box.
+	 */
+	double geo_cache_threshold;	//!< [m], 0 disables the caches
+	std::mutex geo_cache_mutex;	//!< raw and fused handlers share the caches
+
+	bool geoid_cache_valid;
+	double geoid_cache_lat;		//!< [deg]
+	double geoid_cache_lon;		//!< [deg]
+	double geoid_cache_sep;		//!< [m]
+
+	bool ecef_cache_valid;
+	double ecef_ref_lat;		//!< [deg]
+	double ecef_ref_lon;		//!< [deg]
+	double ecef_ref_alt;		//!< [m]
+	double ecef_ref_rm;		//!< meridian curvature radius + alt [m]
+	double ecef_ref_rn_cos;		//!< (prime vertical radius + alt) * cos(lat) [m]
+	Eigen::Vector3d ecef_ref;	//!< exact ECEF at the reference point
+	Eigen::Matrix3d ecef_ref_R;	//!< local ENU -> ECEF rotation at the reference
+
 	template<typename MsgT>
 	inline void fill_lla(MsgT &msg, sensor_msgs::NavSatFix::Ptr fix)
 	{
 		fix->latitude = msg.lat / 1E7;		// deg
 		fix->longitude = msg.lon / 1E7;		// deg
-		fix->altitude = msg.alt / 1E3 + m_uas->geoid_to_ellipsoid_height(fix);	// in meters
+		fix->altitude = msg.alt / 1E3 + geoid_separation(fix);	// in meters
+	}
+
+	/**
+	 * Memoized geoid separation: the geoid gradient is tiny against
+	 * the 5' dataset grid, one interpolation serves until the vehicle
+	 * moves geo_cache_threshold meters from the sampled point.
+	 */
+	template <typename T>
+	double geoid_separation(T fix)
+	{
+		if (geo_cache_threshold <= 0.0)
+			return m_uas->geoid_to_ellipsoid_height(fix);
+
+		// small-angle degrees per meter on the WGS-84 sphere
+		const double thr_deg = geo_cache_threshold *
+			180.0 / (M_PI * GeographicLib::Constants::WGS84_a());
+
+		std::lock_guard<std::mutex> lock(geo_cache_mutex);
+
+		if (!geoid_cache_valid ||
+				std::fabs(fix->latitude - geoid_cache_lat) > thr_deg ||
+				std::fabs(fix->longitude - geoid_cache_lon) > thr_deg) {
+			geoid_cache_sep = m_uas->geoid_to_ellipsoid_height(fix);
+			geoid_cache_lat = fix->latitude;
+			geoid_cache_lon = fix->longitude;
+			geoid_cache_valid = true;
+		}
+
+		return geoid_cache_sep;
+	}
+
+	/**
+	 * LLA -> ECEF with local linearization: the exact GeographicLib
+	 * Forward runs only when the fix leaves the geo_cache_threshold
+	 * box around the reference; inside it the fix is propagated with
+	 * the cached ENU->ECEF rotation and radii of curvature. The
+	 * linearization error is second order — millimeters at 100 m.
+	 */
+	void lla_to_ecef(double lat, double lon, double alt, Eigen::Vector3d &out)
+	{
+		static const GeographicLib::Geocentric earth(
+				GeographicLib::Constants::WGS84_a(),
+				GeographicLib::Constants::WGS84_f());
+
+		std::lock_guard<std::mutex> lock(geo_cache_mutex);
+
+		if (geo_cache_threshold > 0.0 && ecef_cache_valid) {
+			const double dn = angles::from_degrees(lat - ecef_ref_lat) * ecef_ref_rm;
+			const double de = angles::from_degrees(lon - ecef_ref_lon) * ecef_ref_rn_cos;
+			const double du = alt - ecef_ref_alt;
+
+			if (std::fabs(dn) < geo_cache_threshold &&
+					std::fabs(de) < geo_cache_threshold &&
+					std::fabs(du) < geo_cache_threshold) {
+				out = ecef_ref + ecef_ref_R * Eigen::Vector3d(de, dn, du);
+				return;
+			}
+		}
+
+		std::vector<double> R(9);	// row-major ENU->ECEF rotation
+		earth.Forward(lat, lon, alt, out.x(), out.y(), out.z(), R);
+
+		if (geo_cache_threshold > 0.0) {
+			const double a = GeographicLib::Constants::WGS84_a();
+			const double f = GeographicLib::Constants::WGS84_f();
+			const double e2 = f * (2.0 - f);
+			const double s = std::sin(angles::from_degrees(lat));
+			const double w = std::sqrt(1.0 - e2 * s * s);
+
+			ecef_ref_lat = lat;
+			ecef_ref_lon = lon;
+			ecef_ref_alt = alt;
+			ecef_ref_rm = a * (1.0 - e2) / (w * w * w) + alt;
+			ecef_ref_rn_cos = (a / w + alt) * std::cos(angles::from_degrees(lat));
+			ecef_ref = out;
+			for (int r = 0; r < 3; r++)
+				for (int c = 0; c < 3; c++)
+					ecef_ref_R(r, c) = R[r * 3 + c];
+			ecef_cache_valid = true;
+		}
 	}
 
 	inline void fill_unknown_cov(sensor_msgs::NavSatFix::Ptr fix)
@@ -245,7 +356,7 @@ private:
 			 * @brief Conversion from geodetic coordinates (LLA) to ECEF (Earth-Centered, Earth-Fixed)
 			 * Note: "earth" frame, in ECEF, of the global origin
 			 */
-			GeographicLib::Geocentric earth(GeographicLib::Constants::WGS84_a(),
+			static const GeographicLib::Geocentric earth(GeographicLib::Constants::WGS84_a(),
 					GeographicLib::Constants::WGS84_f());
 
 			earth.Forward(glob_orig.latitude / 1E7, glob_orig.longitude / 1E7, glob_orig.altitude / 1E3,
@@ -331,10 +442,9 @@ private:
 			 *
 			 * Note: "map_origin" is the origin of "map" frame, in ECEF, and the local coordinates are
 			 * in spherical coordinates, with the orientation in ENU (just like what is applied
-			 * on Gazebo)
+			 * on Gazebo). Conversion goes through the linearization
+			 * cache, see lla_to_ecef().
 			 */
-			GeographicLib::Geocentric map(GeographicLib::Constants::WGS84_a(),
-						GeographicLib::Constants::WGS84_f());
 
 			/**
 			 * @brief Checks if the "map" origin is set.
@@ -344,16 +454,16 @@ private:
 			 * and the current local geocentric coordinates.
 			 */
 			if (!is_map_init) {
-				map.Forward(fix->latitude, fix->longitude, fix->altitude,
-							map_origin.x(), map_origin.y(), map_origin.z());
+				lla_to_ecef(fix->latitude, fix->longitude, fix->altitude,
+							map_origin);
 
 				local_ecef = map_origin;
 				is_map_init = true;
 			}
 			// If origin is set, compute the local coordinates in ENU
 			else {
-				map.Forward(fix->latitude, fix->longitude, fix->altitude,
-							map_point.x(), map_point.y(), map_point.z());
+				lla_to_ecef(fix->latitude, fix->longitude, fix->altitude,
+							map_point);
 
 				local_ecef = map_origin - map_point;
 			}
@@ -405,7 +515,7 @@ private:
 			transform.transform.translation.y = odom->pose.pose.position.y;
 			transform.transform.translation.z = odom->pose.pose.position.z;
 
-			m_uas->tf2_broadcaster.sendTransform(transform);
+			m_uas->tf2_send_transform(transform);
 		}
 	}
 
@@ -440,7 +550,7 @@ private:
 			transform.transform.translation.y = global_offset->pose.position.y;
 			transform.transform.translation.z = global_offset->pose.position.z;
 
-			m_uas->tf2_broadcaster.sendTransform(transform);
+			m_uas->tf2_send_transform(transform);
 		}
 	}
 
@@ -506,4 +616,6 @@ private:
 }	// namespace mavros
 
 #include <pluginlib/class_list_macros.h>
+#include <mavros/plugin_registry.h>
 PLUGINLIB_EXPORT_CLASS(mavros::std_plugins::GlobalPositionPlugin, mavros::plugin::PluginBase)
+MAVROS_PLUGIN_FACTORY(mavros::std_plugins::GlobalPositionPlugin, global_position)
@@ -14,32 +14,54 @@
  * https://github.com/mavlink/mavros/tree/master/LICENSE.md
  */
 
+#include <mutex>
 #include <mavros/mavros_plugin.h>
 
 #include <mavros_msgs/HilControls.h>
+#include <mavros_msgs/HilSensor.h>
 
 namespace mavros {
 namespace std_plugins {
 /**
  * @brief Hil Control plugin
+ *
+ * Besides republishing HIL_CONTROLS, the plugin closes the HIL loop:
+ * samples from ~hil_controls/hil_sensor go out as HIL_SENSOR straight
+ * from the subscriber callback, and with ~hil_controls/lockstep the
+ * exchange is gated one-in-one-out — the next sample is held until
+ * the FCU returned controls (HIL_CONTROLS or HIL_ACTUATOR_CONTROLS)
+ * for the cycle in flight, so neither side can run ahead.
+ *
+ * For kHz loop rates add the controls msgids to ~executor_inline_ids
+ * so the release happens on the rx thread instead of an executor lane.
  */
 class HilControlsPlugin : public plugin::PluginBase {
 public:
 	HilControlsPlugin() : PluginBase(),
-		hil_controls_nh("~hil_controls")
+		hil_controls_nh("~hil_controls"),
+		lockstep(false),
+		max_outstanding(1),
+		outstanding(0),
+		cycles_in(0),
+		cycles_out(0)
 	{ }
 
 	void initialize(UAS &uas_)
 	{
 		PluginBase::initialize(uas_);
 
+		hil_controls_nh.param("lockstep", lockstep, false);
+		hil_controls_nh.param("max_outstanding", max_outstanding, 1);
+
 		hil_controls_pub = hil_controls_nh.advertise<mavros_msgs::HilControls>("hil_controls", 10);
+		hil_sensor_sub = hil_controls_nh.subscribe("hil_sensor", 10, &HilControlsPlugin::hil_sensor_cb, this);
 	}
 
 	Subscriptions get_subscriptions()
 	{
 		return {
 			       make_handler(&HilControlsPlugin::handle_hil_controls),
+			       make_handler(&HilControlsPlugin::handle_hil_actuator_controls),
 		};
 	}
 
@@ -47,6 +69,91 @@ private:
 	ros::NodeHandle hil_controls_nh;
 
 	ros::Publisher hil_controls_pub;
+	ros::Subscriber hil_sensor_sub;
+
+	bool lockstep;
+	int max_outstanding;
+
+	std::mutex lockstep_mutex;
+	int outstanding;			//!< cycles sent, controls not yet back
+	mavros_msgs::HilSensor::ConstPtr pending;	//!< latest held sample
+	uint64_t cycles_in;
+	uint64_t cycles_out;
+
+	/* -*- mid-level helpers -*- */
+
+	void send_hil_sensor(const mavros_msgs::HilSensor::ConstPtr &req)
+	{
+		mavlink::common::msg::HIL_SENSOR sensor {};
+
+		sensor.time_usec = req->header.stamp.toNSec() / 1000;
+		sensor.xacc = req->acc.x;
+		sensor.yacc = req->acc.y;
+		sensor.zacc = req->acc.z;
+		sensor.xgyro = req->gyro.x;
+		sensor.ygyro = req->gyro.y;
+		sensor.zgyro = req->gyro.z;
+		sensor.xmag = req->mag.x;
+		sensor.ymag = req->mag.y;
+		sensor.zmag = req->mag.z;
+		sensor.abs_pressure = req->abs_pressure;
+		sensor.diff_pressure = req->diff_pressure;
+		sensor.pressure_alt = req->pressure_alt;
+		sensor.temperature = req->temperature;
+		sensor.fields_updated = req->fields_updated;
+
+		// inner-loop message: jumps the tx queue ahead of telemetry
+		UAS_FCU(m_uas)->send_message_ignore_drop(sensor, mavconn::Priority::REALTIME);
+	}
+
+	//! FCU returned controls: account the cycle and release the held sample
+	void lockstep_release()
+	{
+		if (!lockstep)
+			return;
+
+		mavros_msgs::HilSensor::ConstPtr next;
+		{
+			std::lock_guard<std::mutex> lock(lockstep_mutex);
+
+			cycles_out++;
+			if (pending) {
+				// the freed slot goes straight to the held sample
+				next = pending;
+				pending.reset();
+				cycles_in++;
+			}
+			else if (outstanding > 0)
+				outstanding--;
+		}
+
+		if (next)
+			send_hil_sensor(next);
+	}
+
+	/* -*- callbacks -*- */
+
+	void hil_sensor_cb(const mavros_msgs::HilSensor::ConstPtr &req)
+	{
+		if (!lockstep) {
+			send_hil_sensor(req);
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(lockstep_mutex);
+		if (outstanding < max_outstanding) {
+			outstanding++;
+			cycles_in++;
+			send_hil_sensor(req);
+		}
+		else {
+			// one-in-one-out: hold (latest wins) until the FCU
+			// returns controls for the cycle in flight
+			if (pending)
+				ROS_DEBUG_THROTTLE_NAMED(10, "hil", "HIL: lockstep sample superseded");
+			pending = req;
+		}
+	}
 
 	/* -*- rx handlers -*- */
 
@@ -74,11 +181,21 @@ private:
 		// [[[end]]] (checksum: a2c87ee8f36e7a32b08be5e0fe665b5a)
 
 		hil_controls_pub.publish(hil_controls_msg);
+		lockstep_release();
+	}
+
+	//! republishing is left to hil_actuator_controls plugin,
+	//! this handler only closes the lockstep cycle
+	void handle_hil_actuator_controls(const mavlink::mavlink_message_t *msg, mavlink::common::msg::HIL_ACTUATOR_CONTROLS &ctrl)
+	{
+		lockstep_release();
 	}
 };
 }	// namespace std_plugins
 }	// namespace mavros
 
 #include <pluginlib/class_list_macros.h>
+#include <mavros/plugin_registry.h>
 PLUGINLIB_EXPORT_CLASS(mavros::std_plugins::HilControlsPlugin, mavros::plugin::PluginBase)
+MAVROS_PLUGIN_FACTORY(mavros::std_plugins::HilControlsPlugin, hil_controls)
 
@@ -15,6 +15,7 @@
  */
 
 #include <cmath>
+#include <mutex>
 #include <mavros/mavros_plugin.h>
 #include <eigen_conversions/eigen_msg.h>
 
@@ -23,6 +24,7 @@
 #include <sensor_msgs/Temperature.h>
 #include <sensor_msgs/FluidPressure.h>
 #include <geometry_msgs/Vector3.h>
+#include <mavros_msgs/ImuBatch.h>
 
 namespace mavros {
 namespace std_plugins {
@@ -55,6 +57,12 @@ class IMUPubPlugin : public plugin::PluginBase {
 public:
 	IMUPubPlugin() : PluginBase(),
 		imu_nh("~imu"),
+		imu_pool(POOL_SIZE),
+		imu_raw_pool(POOL_SIZE),
+		magn_pool(POOL_SIZE),
+		temp_pool(POOL_SIZE),
+		press_pool(POOL_SIZE),
+		batch_size(0),
 		has_hr_imu(false),
 		has_scaled_imu(false),
 		has_att_quat(false)
@@ -82,11 +90,24 @@ public:
 		setup_covariance(magnetic_cov, mag_stdev);
 		setup_covariance(unk_orientation_cov, 0.0);
 
-		imu_pub = imu_nh.advertise<sensor_msgs::Imu>("data", 10);
-		magn_pub = imu_nh.advertise<sensor_msgs::MagneticField>("mag", 10);
-		temp_pub = imu_nh.advertise<sensor_msgs::Temperature>("temperature", 10);
-		press_pub = imu_nh.advertise<sensor_msgs::FluidPressure>("atm_pressure", 10);
-		imu_raw_pub = imu_nh.advertise<sensor_msgs::Imu>("data_raw", 10);
+		imu_pub.advertise<sensor_msgs::Imu>(imu_nh, "data", 10);
+		magn_pub.advertise<sensor_msgs::MagneticField>(imu_nh, "mag", 10);
+		temp_pub.advertise<sensor_msgs::Temperature>(imu_nh, "temperature", 10);
+		press_pub.advertise<sensor_msgs::FluidPressure>(imu_nh, "atm_pressure", 10);
+		imu_raw_pub.advertise<sensor_msgs::Imu>(imu_nh, "data_raw", 10);
+
+		// optional batching mode: ship raw samples as 1/batch_size rate
+		// array messages, for consumers that can't afford per-sample
+		// pub/sub overhead at kHz stream rates (e.g. VIO)
+		imu_nh.param("batch_size", batch_size, 0);
+		if (batch_size > 0) {
+			double batch_flush_ms;
+			imu_nh.param("batch_flush_ms", batch_flush_ms, 100.0);
+
+			batch_pub.advertise<mavros_msgs::ImuBatch>(imu_nh, "data_batch", 10);
+			batch_flush_timer = imu_nh.createTimer(ros::Duration(batch_flush_ms / 1000.0),
+					&IMUPubPlugin::batch_flush_cb, this);
+		}
 
 		// reset has_* flags on connection change
 		enable_connection_cb();
@@ -107,11 +128,26 @@ private:
 	ros::NodeHandle imu_nh;
 	std::string frame_id;
 
-	ros::Publisher imu_pub;
-	ros::Publisher imu_raw_pub;
-	ros::Publisher magn_pub;
-	ros::Publisher temp_pub;
-	ros::Publisher press_pub;
+	plugin::LazyPublisher imu_pub;
+	plugin::LazyPublisher imu_raw_pub;
+	plugin::LazyPublisher magn_pub;
+	plugin::LazyPublisher temp_pub;
+	plugin::LazyPublisher press_pub;
+
+	//! recycled messages: power-of-two ring per topic
+	static constexpr size_t POOL_SIZE = 4;
+	plugin::MsgPool<sensor_msgs::Imu> imu_pool;
+	plugin::MsgPool<sensor_msgs::Imu> imu_raw_pool;
+	plugin::MsgPool<sensor_msgs::MagneticField> magn_pool;
+	plugin::MsgPool<sensor_msgs::Temperature> temp_pool;
+	plugin::MsgPool<sensor_msgs::FluidPressure> press_pool;
+
+	//! sample batching (enabled when batch_size > 0)
+	plugin::LazyPublisher batch_pub;
+	int batch_size;
+	ros::Timer batch_flush_timer;
+	std::mutex batch_mutex;
+	mavros_msgs::ImuBatch::Ptr batch_msg;
 
 	bool has_hr_imu;
 	bool has_scaled_imu;
@@ -141,7 +177,13 @@ private:
 			Eigen::Quaterniond &orientation,
 			Eigen::Vector3d &gyro)
 	{
-		auto imu_msg = boost::make_shared<sensor_msgs::Imu>();
+		// covariance template lands once per pooled message,
+		// the steady state writes only the changing fields
+		auto imu_msg = imu_pool.make([this](sensor_msgs::Imu &m) {
+			m.orientation_covariance = orientation_cov;
+			m.angular_velocity_covariance = angular_velocity_cov;
+			m.linear_acceleration_covariance = linear_acceleration_cov;
+		});
 
 		// fill
 		imu_msg->header = m_uas->synchronized_header(frame_id, time_boot_ms);
@@ -152,13 +194,11 @@ private:
 		// vector from HIGHRES_IMU or RAW_IMU
 		tf::vectorEigenToMsg(linear_accel_vec, imu_msg->linear_acceleration);
 
-		imu_msg->orientation_covariance = orientation_cov;
-		imu_msg->angular_velocity_covariance = angular_velocity_cov;
-		imu_msg->linear_acceleration_covariance = linear_acceleration_cov;
-
-		// publish
+		// publish; attitude state always feeds the UAS snapshot,
+		// other plugins read it regardless of our subscribers
 		m_uas->update_attitude_imu(imu_msg);
-		imu_pub.publish(imu_msg);
+		if (imu_pub.active())
+			imu_pub.publish(imu_msg);
 	}
 
 	//! fill and publish imu/data_raw message, store linear acceleration for imu/data
@@ -167,7 +207,20 @@ private:
 			Eigen::Vector3d &gyro,
 			Eigen::Vector3d &accel)
 	{
-		auto imu_msg = boost::make_shared<sensor_msgs::Imu>();
+		// save readings: imu/data needs them even while data_raw idles
+		linear_accel_vec = accel;
+
+		if (batch_size > 0 && batch_pub.active())
+			batch_append(header, gyro, accel);
+
+		if (!imu_raw_pub.active())
+			return;
+
+		auto imu_msg = imu_raw_pool.make([this](sensor_msgs::Imu &m) {
+			m.orientation_covariance = unk_orientation_cov;
+			m.angular_velocity_covariance = angular_velocity_cov;
+			m.linear_acceleration_covariance = linear_acceleration_cov;
+		});
 
 		// fill
 		imu_msg->header = header;
@@ -175,25 +228,68 @@ private:
 		tf::vectorEigenToMsg(gyro, imu_msg->angular_velocity);
 		tf::vectorEigenToMsg(accel, imu_msg->linear_acceleration);
 
-		// save readings
-		linear_accel_vec = accel;
-
-		imu_msg->orientation_covariance = unk_orientation_cov;
-		imu_msg->angular_velocity_covariance = angular_velocity_cov;
-		imu_msg->linear_acceleration_covariance = linear_acceleration_cov;
-
 		// publish
 		imu_raw_pub.publish(imu_msg);
 	}
 
+	//! append one raw sample, publish when the batch fills up.
+	//! raw samples arrive from different msgid handler lanes and the
+	//! flush timer, hence the lock.
+	void batch_append(const std_msgs::Header &header,
+			const Eigen::Vector3d &gyro,
+			const Eigen::Vector3d &accel)
+	{
+		std::lock_guard<std::mutex> lock(batch_mutex);
+
+		if (!batch_msg) {
+			batch_msg = boost::make_shared<mavros_msgs::ImuBatch>();
+			batch_msg->header.frame_id = header.frame_id;
+			batch_msg->stamps.reserve(batch_size);
+			batch_msg->angular_velocities.reserve(batch_size);
+			batch_msg->linear_accelerations.reserve(batch_size);
+		}
+
+		geometry_msgs::Vector3 v;
+
+		batch_msg->stamps.push_back(header.stamp);
+		tf::vectorEigenToMsg(gyro, v);
+		batch_msg->angular_velocities.push_back(v);
+		tf::vectorEigenToMsg(accel, v);
+		batch_msg->linear_accelerations.push_back(v);
+
+		if (batch_msg->stamps.size() >= size_t(batch_size))
+			batch_publish();
+	}
+
+	//! publish and drop current batch. batch_mutex must be held.
+	void batch_publish()
+	{
+		batch_msg->header.stamp = batch_msg->stamps.back();
+		batch_pub.publish(batch_msg);
+		batch_msg.reset();
+	}
+
+	//! time bound: a partial batch never waits longer than batch_flush_ms
+	void batch_flush_cb(const ros::TimerEvent &event)
+	{
+		std::lock_guard<std::mutex> lock(batch_mutex);
+
+		if (batch_msg && !batch_msg->stamps.empty())
+			batch_publish();
+	}
+
 	void publish_mag(std_msgs::Header &header,
 			Eigen::Vector3d &mag_field)
 	{
-		auto magn_msg = boost::make_shared<sensor_msgs::MagneticField>();
+		if (!magn_pub.active())
+			return;
+
+		auto magn_msg = magn_pool.make([this](sensor_msgs::MagneticField &m) {
+			m.magnetic_field_covariance = magnetic_cov;
+		});
 
 		magn_msg->header = header;
 		tf::vectorEigenToMsg(mag_field, magn_msg->magnetic_field);
-		magn_msg->magnetic_field_covariance = magnetic_cov;
 
 		magn_pub.publish(magn_msg);
 	}
@@ -268,8 +364,8 @@ private:
 		}
 
 		// pressure data available
-		if (imu_hr.fields_updated & (1 << 9)) {
-			auto atmp_msg = boost::make_shared<sensor_msgs::FluidPressure>();
+		if ((imu_hr.fields_updated & (1 << 9)) && press_pub.active()) {
+			auto atmp_msg = press_pool.make([](sensor_msgs::FluidPressure &) { });
 
 			atmp_msg->header = header;
 			atmp_msg->fluid_pressure = imu_hr.abs_pressure * MILLIBAR_TO_PASCAL;
@@ -277,8 +373,8 @@ private:
 			press_pub.publish(atmp_msg);
 		}
 
-		if (imu_hr.fields_updated & (1 << 12)) {
-			auto temp_msg = boost::make_shared<sensor_msgs::Temperature>();
+		if ((imu_hr.fields_updated & (1 << 12)) && temp_pub.active()) {
+			auto temp_msg = temp_pool.make([](sensor_msgs::Temperature &) { });
 
 			temp_msg->header = header;
 			temp_msg->temperature = imu_hr.temperature;
@@ -292,7 +388,6 @@ private:
 		if (has_hr_imu || has_scaled_imu)
 			return;
 
-		auto imu_msg = boost::make_shared<sensor_msgs::Imu>();
 		auto header = m_uas->synchronized_header(frame_id, imu_raw.time_usec);
 
 		//! @note APM send SCALED_IMU data as RAW_IMU
@@ -327,7 +422,6 @@ private:
 		ROS_INFO_COND_NAMED(!has_scaled_imu, "imu", "IMU: Scaled IMU message used.");
 		has_scaled_imu = true;
 
-		auto imu_msg = boost::make_shared<sensor_msgs::Imu>();
 		auto header = m_uas->synchronized_header(frame_id, imu_raw.time_boot_ms);
 
 		auto gyro = ftf::transform_frame_aircraft_baselink<Eigen::Vector3d>(
@@ -351,15 +445,19 @@ private:
 
 		auto header = m_uas->synchronized_header(frame_id, press.time_boot_ms);
 
-		auto temp_msg = boost::make_shared<sensor_msgs::Temperature>();
-		temp_msg->header = header;
-		temp_msg->temperature = press.temperature / 100.0;
-		temp_pub.publish(temp_msg);
+		if (temp_pub.active()) {
+			auto temp_msg = temp_pool.make([](sensor_msgs::Temperature &) { });
+			temp_msg->header = header;
+			temp_msg->temperature = press.temperature / 100.0;
+			temp_pub.publish(temp_msg);
+		}
 
-		auto atmp_msg = boost::make_shared<sensor_msgs::FluidPressure>();
-		atmp_msg->header = header;
-		atmp_msg->fluid_pressure = press.press_abs * 100.0;
-		press_pub.publish(atmp_msg);
+		if (press_pub.active()) {
+			auto atmp_msg = press_pool.make([](sensor_msgs::FluidPressure &) { });
+			atmp_msg->header = header;
+			atmp_msg->fluid_pressure = press.press_abs * 100.0;
+			press_pub.publish(atmp_msg);
+		}
 	}
 
 	void connection_cb(bool connected) override
@@ -373,5 +471,7 @@ private:
 }	// namespace mavros
 
 #include <pluginlib/class_list_macros.h>
+#include <mavros/plugin_registry.h>
 PLUGINLIB_EXPORT_CLASS(mavros::std_plugins::IMUPubPlugin, mavros::plugin::PluginBase)
+MAVROS_PLUGIN_FACTORY(mavros::std_plugins::IMUPubPlugin, imu_pub)
 
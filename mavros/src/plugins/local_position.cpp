@@ -56,9 +56,9 @@ public:
 		// NED -> aircraft
 		lp_nh.param("tf/send_fcu",tf_send_fcu,false);
 
-		local_position = lp_nh.advertise<geometry_msgs::PoseStamped>("pose", 10);
-		local_velocity = lp_nh.advertise<geometry_msgs::TwistStamped>("velocity", 10);
-		local_odom = lp_nh.advertise<nav_msgs::Odometry>("odom",10);
+		local_position.advertise<geometry_msgs::PoseStamped>(lp_nh, "pose", 10);
+		local_velocity.advertise<geometry_msgs::TwistStamped>(lp_nh, "velocity", 10);
+		local_odom.advertise<nav_msgs::Odometry>(lp_nh, "odom", 10);
 	}
 
 	Subscriptions get_subscriptions() {
@@ -70,9 +70,9 @@ public:
 private:
 	ros::NodeHandle lp_nh;
 
-	ros::Publisher local_position;
-	ros::Publisher local_velocity;
-	ros::Publisher local_odom;
+	plugin::LazyPublisher local_position;
+	plugin::LazyPublisher local_velocity;
+	plugin::LazyPublisher local_odom;
 
 	std::string frame_id;		//!< frame for Pose
 	std::string tf_frame_id;	//!< origin for TF
@@ -82,61 +82,90 @@ private:
 
 	void handle_local_position_ned(const mavlink::mavlink_message_t *msg, mavlink::common::msg::LOCAL_POSITION_NED &pos_ned)
 	{
+		bool pub_pose = local_position.active();
+		bool pub_twist = local_velocity.active();
+		bool pub_odom = local_odom.active();
+
+		// no products wanted: the whole handler is one branch
+		if (!pub_pose && !pub_twist && !pub_odom && !tf_send && !tf_send_fcu)
+			return;
+
 		//--------------- Transform FCU position and Velocity Data ---------------//
 		auto enu_position = ftf::transform_frame_ned_enu(Eigen::Vector3d(pos_ned.x, pos_ned.y, pos_ned.z));
 		auto enu_velocity = ftf::transform_frame_ned_enu(Eigen::Vector3d(pos_ned.vx, pos_ned.vy, pos_ned.vz));
 
 		//--------------- Get Odom Information ---------------//
-		// Note this orientation describes baselink->ENU transform
-		auto enu_orientation_msg = m_uas->get_attitude_orientation();
-		auto baselink_angular_msg = m_uas->get_attitude_angular_velocity();
-		Eigen::Quaterniond enu_orientation;
-		tf::quaternionMsgToEigen(enu_orientation_msg, enu_orientation);
-		auto baselink_linear = ftf::transform_frame_enu_baselink(enu_velocity, enu_orientation.inverse());
-
-		//--------------- Generate Message Pointers ---------------//
-		auto pose = boost::make_shared<geometry_msgs::PoseStamped>();
-		auto twist = boost::make_shared<geometry_msgs::TwistStamped>();
-		auto odom = boost::make_shared<nav_msgs::Odometry>();
-
-		pose->header = m_uas->synchronized_header(frame_id, pos_ned.time_boot_ms);
-		twist->header = pose->header;
-
-		tf::pointEigenToMsg(enu_position, pose->pose.position);
-		pose->pose.orientation = enu_orientation_msg;
-
-		tf::vectorEigenToMsg(enu_velocity, twist->twist.linear);
-		twist->twist.angular = baselink_angular_msg;
-
-		odom->header.stamp = pose->header.stamp;
-		odom->header.frame_id = tf_frame_id;
-		odom->child_frame_id = tf_child_frame_id;
-		tf::vectorEigenToMsg(baselink_linear, odom->twist.twist.linear);
-		odom->twist.twist.angular = baselink_angular_msg;
-		odom->pose.pose = pose->pose;
-
-		//--------------- Publish Data ---------------//
-		local_odom.publish(odom);
-		local_position.publish(pose);
-		local_velocity.publish(twist);
+		// Note this orientation describes baselink->ENU transform.
+		// One attitude snapshot keeps orientation and rates from the
+		// same IMU sample across every product of this handler.
+		geometry_msgs::Quaternion enu_orientation_msg;
+		geometry_msgs::Vector3 baselink_angular_msg;
+		m_uas->get_attitude(enu_orientation_msg, baselink_angular_msg);
+
+		auto header = m_uas->synchronized_header(frame_id, pos_ned.time_boot_ms);
+
+		//--------------- Publish wanted products only ---------------//
+		if (pub_pose) {
+			auto pose = boost::make_shared<geometry_msgs::PoseStamped>();
+
+			pose->header = header;
+			tf::pointEigenToMsg(enu_position, pose->pose.position);
+			pose->pose.orientation = enu_orientation_msg;
+
+			local_position.publish(pose);
+		}
+
+		if (pub_twist) {
+			auto twist = boost::make_shared<geometry_msgs::TwistStamped>();
+
+			twist->header = header;
+			tf::vectorEigenToMsg(enu_velocity, twist->twist.linear);
+			twist->twist.angular = baselink_angular_msg;
+
+			local_velocity.publish(twist);
+		}
+
+		if (pub_odom) {
+			auto odom = boost::make_shared<nav_msgs::Odometry>();
+
+			// body-frame twist needs the attitude applied;
+			// only the odometry consumers pay for it
+			Eigen::Quaterniond enu_orientation;
+			tf::quaternionMsgToEigen(enu_orientation_msg, enu_orientation);
+			auto baselink_linear = ftf::transform_frame_enu_baselink(
+					enu_velocity, enu_orientation.inverse());
+
+			odom->header.stamp = header.stamp;
+			odom->header.frame_id = tf_frame_id;
+			odom->child_frame_id = tf_child_frame_id;
+			tf::pointEigenToMsg(enu_position, odom->pose.pose.position);
+			odom->pose.pose.orientation = enu_orientation_msg;
+			tf::vectorEigenToMsg(baselink_linear, odom->twist.twist.linear);
+			odom->twist.twist.angular = baselink_angular_msg;
+
+			local_odom.publish(odom);
+		}
 
 		if (tf_send) {
 			geometry_msgs::TransformStamped transform;
 
-			transform.header.stamp = pose->header.stamp;
+			transform.header.stamp = header.stamp;
 			transform.header.frame_id = tf_frame_id;
 			transform.child_frame_id = tf_child_frame_id;
 
 			transform.transform.rotation = enu_orientation_msg;
 			tf::vectorEigenToMsg(enu_position, transform.transform.translation);
 
-			m_uas->tf2_broadcaster.sendTransform(transform);
+			m_uas->tf2_send_transform(transform);
 		}
 		if (tf_send_fcu) {
 			//--------------- Report NED->aircraft transform ---------------//
 			geometry_msgs::TransformStamped ned_aircraft_tf;
 
-			ned_aircraft_tf.header.stamp = pose->header.stamp;
+			Eigen::Quaterniond enu_orientation;
+			tf::quaternionMsgToEigen(enu_orientation_msg, enu_orientation);
+
+			ned_aircraft_tf.header.stamp = header.stamp;
 			ned_aircraft_tf.header.frame_id = "NED";
 			ned_aircraft_tf.child_frame_id = "aircraft";
 
@@ -149,7 +178,7 @@ private:
 			auto ned_orientation = ftf::transform_orientation_enu_ned(
 						ftf::transform_orientation_baselink_aircraft(enu_orientation));
 			tf::quaternionEigenToMsg(ned_orientation,ned_aircraft_tf.transform.rotation);
-			m_uas->tf2_broadcaster.sendTransform(ned_aircraft_tf);
+			m_uas->tf2_send_transform(ned_aircraft_tf);
 		}
 	}
 };
@@ -157,6 +186,8 @@ private:
 }	// namespace mavros
 
 #include <pluginlib/class_list_macros.h>
+#include <mavros/plugin_registry.h>
 PLUGINLIB_EXPORT_CLASS(mavros::std_plugins::LocalPositionPlugin, mavros::plugin::PluginBase)
+MAVROS_PLUGIN_FACTORY(mavros::std_plugins::LocalPositionPlugin, local_position)
 
 
@@ -0,0 +1,191 @@
+/**
+ * @brief MessageInterval plugin
+ * @file message_interval.cpp
+ * @author Vladimir Ermakov <vooon341@gmail.com>
+ *
+ * @addtogroup plugin
+ * @{
+ */
+/*
+ * Copyright 2017 Vladimir Ermakov.
+ *
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+
+#include <algorithm>
+#include <stdexcept>
+#include <mavros/mavros_plugin.h>
+
+namespace mavros {
+namespace std_plugins {
+/**
+ * @brief Message interval manager plugin
+ *
+ * Pushes a declarative stream-rate table (msgid -> Hz) to the FCU
+ * with MAV_CMD_SET_MESSAGE_INTERVAL on every connect, then verifies
+ * the commanded rates against the rx-side per-msgid counters and
+ * re-commands when the FCU drifts. Replaces hand-issued commands and
+ * external rate-tuning scripts.
+ *
+ * Example configuration:
+ *
+ *     message_interval:
+ *       rates:
+ *         '105': 50.0   # HIGHRES_IMU
+ *         '147': 0.5    # BATTERY_STATUS
+ */
+class MessageIntervalPlugin : public plugin::PluginBase {
+public:
+	MessageIntervalPlugin() : PluginBase(),
+		mi_nh("~message_interval"),
+		verify_period(5.0),
+		rate_tolerance(0.2),
+		have_baseline(false)
+	{ }
+
+	void initialize(UAS &uas_)
+	{
+		PluginBase::initialize(uas_);
+
+		mi_nh.param("verify_period", verify_period, 5.0);
+		mi_nh.param("rate_tolerance", rate_tolerance, 0.2);
+
+		XmlRpc::XmlRpcValue rates;
+		if (mi_nh.getParam("rates", rates) &&
+				rates.getType() == XmlRpc::XmlRpcValue::TypeStruct) {
+			for (auto &entry : rates) {
+				RateEntry re{};
+
+				try {
+					re.msgid = std::stoul(entry.first);
+				}
+				catch (std::logic_error &ex) {
+					ROS_WARN_NAMED("mi", "MI: ignored rate key: %s", entry.first.c_str());
+					continue;
+				}
+
+				if (entry.second.getType() == XmlRpc::XmlRpcValue::TypeDouble)
+					re.rate_hz = static_cast<double>(entry.second);
+				else if (entry.second.getType() == XmlRpc::XmlRpcValue::TypeInt)
+					re.rate_hz = static_cast<int>(entry.second);
+				else {
+					ROS_WARN_NAMED("mi", "MI: ignored rate value for msgid %u", re.msgid);
+					continue;
+				}
+
+				table.push_back(re);
+			}
+		}
+
+		if (table.empty())
+			return;
+
+		ROS_INFO_NAMED("mi", "MI: managing %zu message interval(s)", table.size());
+
+		verify_timer = mi_nh.createTimer(ros::Duration(verify_period),
+				&MessageIntervalPlugin::verify_cb, this,
+				false /* oneshot */, false /* autostart */);
+
+		enable_connection_cb();
+	}
+
+	Subscriptions get_subscriptions()
+	{
+		return { /* rx counters come from the link iostat */ };
+	}
+
+private:
+	ros::NodeHandle mi_nh;
+
+	//! one commanded stream rate
+	struct RateEntry {
+		uint32_t msgid;
+		double rate_hz;		//!< commanded rate, 0 disables the stream
+		size_t last_count;	//!< rx count at the previous verify tick
+	};
+
+	std::vector<RateEntry> table;
+	ros::Timer verify_timer;
+
+	double verify_period;
+	double rate_tolerance;
+	bool have_baseline;
+
+	void send_interval(uint32_t msgid, double rate_hz)
+	{
+		using mavlink::common::MAV_CMD;
+
+		mavlink::common::msg::COMMAND_LONG cmd {};
+		cmd.target_system = m_uas->get_tgt_system();
+		cmd.target_component = m_uas->get_tgt_component();
+		cmd.command = utils::enum_value(MAV_CMD::SET_MESSAGE_INTERVAL);
+		cmd.confirmation = 0;
+		cmd.param1 = msgid;
+		cmd.param2 = (rate_hz > 0.0) ? 1e6 / rate_hz : -1.0;	// interval [us], -1 disables
+
+		UAS_FCU(m_uas)->send_message_ignore_drop(cmd);
+	}
+
+	//! pipelined burst: all intervals go out back to back, the tx
+	//! queue serializes them
+	void push_intervals()
+	{
+		for (auto &re : table)
+			send_interval(re.msgid, re.rate_hz);
+	}
+
+	void verify_cb(const ros::TimerEvent &event)
+	{
+		auto stat = UAS_FCU(m_uas)->get_iostat();
+
+		double dt = (event.current_real - event.last_real).toSec();
+		bool check = have_baseline && dt > 0.0;
+
+		for (auto &re : table) {
+			auto it = std::lower_bound(stat.message_stat.begin(), stat.message_stat.end(),
+					re.msgid,
+					[](const mavconn::MAVConnInterface::MsgStat &ms, uint32_t id) {
+						return ms.msgid < id;
+					});
+
+			size_t count = (it != stat.message_stat.end() && it->msgid == re.msgid) ?
+					it->rx_count : 0;
+
+			if (check && re.rate_hz > 0.0) {
+				double hz = (count - re.last_count) / dt;
+
+				if (hz < re.rate_hz * (1.0 - rate_tolerance) ||
+						hz > re.rate_hz * (1.0 + rate_tolerance)) {
+					ROS_WARN_NAMED("mi", "MI: msgid %u at %.1f Hz, want %.1f Hz, re-commanding",
+							re.msgid, hz, re.rate_hz);
+					send_interval(re.msgid, re.rate_hz);
+				}
+			}
+
+			re.last_count = count;
+		}
+
+		have_baseline = true;
+	}
+
+	void connection_cb(bool connected) override
+	{
+		if (connected) {
+			push_intervals();
+			have_baseline = false;
+			verify_timer.start();
+		}
+		else {
+			verify_timer.stop();
+		}
+	}
+};
+}	// namespace std_plugins
+}	// namespace mavros
+
+#include <pluginlib/class_list_macros.h>
+#include <mavros/plugin_registry.h>
+PLUGINLIB_EXPORT_CLASS(mavros::std_plugins::MessageIntervalPlugin, mavros::plugin::PluginBase)
+MAVROS_PLUGIN_FACTORY(mavros::std_plugins::MessageIntervalPlugin, message_interval)
@@ -15,9 +15,17 @@
  */
 
 #include <chrono>
+#include <cstring>
+#include <fstream>
+#include <vector>
 #include <condition_variable>
 #include <mavros/mavros_plugin.h>
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 #include <mavros_msgs/ParamSet.h>
 #include <mavros_msgs/ParamGet.h>
 #include <mavros_msgs/ParamPull.h>
@@ -340,6 +348,7 @@ public:
 		param_count(-1),
 		param_state(PR::IDLE),
 		is_timedout(false),
+		rx_window(10),
 		RETRIES_COUNT(_RETRIES_COUNT),
 		param_rx_retries(RETRIES_COUNT),
 		BOOTUP_TIME_DT(BOOTUP_TIME_MS / 1000.0),
@@ -351,6 +360,12 @@ public:
 	{
 		PluginBase::initialize(uas_);
 
+		param_nh.param("rx_window", rx_window, 10);
+		if (rx_window < 1)
+			rx_window = 1;
+
+		param_nh.param<std::string>("cache_dir", cache_dir, "");
+
 		pull_srv = param_nh.advertiseService("pull", &ParamPlugin::pull_cb, this);
 		push_srv = param_nh.advertiseService("push", &ParamPlugin::push_cb, this);
 		set_srv = param_nh.advertiseService("set", &ParamPlugin::set_cb, this);
@@ -397,6 +412,10 @@ private:
 
 	std::unordered_map<std::string, Parameter> parameters;
 	std::list<uint16_t> parameters_missing_idx;
+	//! rerequest window: missing index -> retries left
+	std::unordered_map<uint16_t, size_t> rx_inflight;
+	int rx_window;
+	std::string cache_dir;
 	std::unordered_map<std::string, std::shared_ptr<ParamSetOpt>> set_parameters;
 	ssize_t param_count;
 	enum class PR {
@@ -480,16 +499,13 @@ private:
 							"Param list may be truncated.");
 			}
 
-			// trying to avoid endless rerequest loop
-			// Issue #276
-			bool it_is_first_requested = parameters_missing_idx.front() == pmsg.param_index;
-
 			// remove idx for that message
 			parameters_missing_idx.remove(pmsg.param_index);
+			rx_inflight.erase(pmsg.param_index);
 
-			// in receiving mode we use param_rx_retries for LIST and PARAM
-			if (it_is_first_requested)
-				param_rx_retries = RETRIES_COUNT;
+			// when the rerequest window is active, keep it full
+			if (!rx_inflight.empty())
+				fill_rx_window();
 
 			restart_timeout_timer();
 
@@ -500,6 +516,10 @@ private:
 				ROS_WARN_COND_NAMED(missed > 0, "param",
 						"PR: parameters list received, but %zd parametars are missed",
 						missed);
+
+				if (!cache_dir.empty() && missed == 0)
+					cache_save();
+
 				go_idle();
 				list_receiving.notify_all();
 			}
@@ -558,6 +578,9 @@ private:
 	{
 		lock_guard lock(mutex);
 		if (connected) {
+			if (!cache_dir.empty() && parameters.empty())
+				cache_load();
+
 			shedule_pull(BOOTUP_TIME_DT);
 		}
 		else {
@@ -610,27 +633,35 @@ private:
 				return;
 			}
 
-			uint16_t first_miss_idx = parameters_missing_idx.front();
-			if (param_rx_retries > 0) {
-				param_rx_retries--;
-				ROS_WARN_NAMED("param", "PR: request param #%u timeout, retries left %zu, and %zu params still missing",
-						first_miss_idx, param_rx_retries, parameters_missing_idx.size());
-				restart_timeout_timer();
-				param_request_read("", first_miss_idx);
+			// SACK-style rerequest: every in-flight request shares
+			// this timeout tick but keeps its own retry budget
+			for (auto it = rx_inflight.begin(); it != rx_inflight.end(); ) {
+				if (it->second == 0) {
+					ROS_ERROR_NAMED("param", "PR: request param #%u completely missing.", it->first);
+					parameters_missing_idx.remove(it->first);
+					it = rx_inflight.erase(it);
+				}
+				else {
+					it->second--;
+					param_request_read("", it->first);
+					++it;
+				}
 			}
-			else {
-				ROS_ERROR_NAMED("param", "PR: request param #%u completely missing.", first_miss_idx);
-				parameters_missing_idx.pop_front();
-				restart_timeout_timer();
-				if (!parameters_missing_idx.empty()) {
-					param_rx_retries = RETRIES_COUNT;
-					first_miss_idx = parameters_missing_idx.front();
 
-					ROS_WARN_NAMED("param", "PR: %zu params still missing, trying to request next: #%u",
-							parameters_missing_idx.size(), first_miss_idx);
-					param_request_read("", first_miss_idx);
-				}
+			fill_rx_window();
+
+			if (parameters_missing_idx.empty()) {
+				// everything left was dropped as missing
+				ROS_WARN_NAMED("param", "PR: parameters list received, but %zd parametars are missed",
+						param_count - parameters.size());
+				go_idle();
+				list_receiving.notify_all();
+				return;
 			}
+
+			ROS_WARN_NAMED("param", "PR: rerequest window: %zu in flight, %zu still missing",
+					rx_inflight.size(), parameters_missing_idx.size());
+			restart_timeout_timer();
 		}
 		else if (param_state == PR::TXPARAM) {
 			auto it = set_parameters.begin();
@@ -660,6 +691,22 @@ private:
 		}
 	}
 
+	//! keep up to rx_window PARAM_REQUEST_READ in flight: a lossy
+	//! link fills in one RTT-bound window instead of serial retries
+	void fill_rx_window()
+	{
+		for (auto idx : parameters_missing_idx) {
+			if (rx_inflight.size() >= size_t(rx_window))
+				break;
+
+			if (rx_inflight.find(idx) != rx_inflight.end())
+				continue;
+
+			rx_inflight.emplace(idx, RETRIES_COUNT);
+			param_request_read("", idx);
+		}
+	}
+
 	void restart_timeout_timer()
 	{
 		is_timedout = false;
@@ -670,9 +717,149 @@ private:
 	void go_idle()
 	{
 		param_state = PR::IDLE;
+		rx_inflight.clear();
 		timeout_timer.stop();
 	}
 
+	/* -*- parameter cache -*- */
+
+	//! fixed-size on-disk record, so the cache is mmap-loadable
+	struct CacheRecord {
+		char param_id[17];	//!< zero-padded
+		uint8_t is_float;
+		uint16_t param_index;
+		union {
+			int32_t i;
+			float f;
+		} value;
+	};
+
+	struct CacheHeader {
+		char magic[4];
+		uint16_t version;
+		uint16_t param_count;
+	};
+
+	static constexpr uint16_t CACHE_VERSION = 1;
+
+	//! cache is keyed by FCU identity: one file per (sysid, autopilot)
+	std::string cache_file_path()
+	{
+		return utils::format("%s/mavparm-%u-%u.cache", cache_dir.c_str(),
+				static_cast<unsigned>(m_uas->get_tgt_system()),
+				static_cast<unsigned>(enum_value(m_uas->get_autopilot())));
+	}
+
+	/**
+	 * Load cached parameters, so ~param/get answers right after
+	 * HEARTBEAT. The regular pull still runs and reconciles the
+	 * cache against the FCU in background.
+	 */
+	void cache_load()
+	{
+		auto path = cache_file_path();
+
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd == -1)
+			return;
+
+		struct stat st;
+		if (fstat(fd, &st) != 0) {
+			close(fd);
+			return;
+		}
+
+		auto map = static_cast<uint8_t *>(mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0));
+		close(fd);
+		if (map == MAP_FAILED)
+			return;
+
+		auto hdr = reinterpret_cast<CacheHeader *>(map);
+		if (size_t(st.st_size) < sizeof(CacheHeader) ||
+				memcmp(hdr->magic, "MVPC", sizeof(hdr->magic)) != 0 ||
+				hdr->version != CACHE_VERSION ||
+				size_t(st.st_size) != sizeof(CacheHeader) +
+					size_t(hdr->param_count) * sizeof(CacheRecord)) {
+			ROS_WARN_NAMED("param", "PR: damaged cache ignored: %s", path.c_str());
+			munmap(map, st.st_size);
+			return;
+		}
+
+		auto rec = reinterpret_cast<CacheRecord *>(map + sizeof(CacheHeader));
+		for (uint16_t i = 0; i < hdr->param_count; i++) {
+			Parameter p{};
+			p.param_id.assign(rec[i].param_id,
+					strnlen(rec[i].param_id, sizeof(rec[i].param_id)));
+			p.param_index = rec[i].param_index;
+			p.param_count = hdr->param_count;
+
+			if (rec[i].is_float)
+				p.param_value = double(rec[i].value.f);
+			else
+				p.param_value = int(rec[i].value.i);
+
+			parameters.emplace(p.param_id, p);
+		}
+
+		munmap(map, st.st_size);
+		ROS_INFO_NAMED("param", "PR: %u parameters loaded from cache, reconcile scheduled",
+				hdr->param_count);
+	}
+
+	//! atomically rewrite the cache after a complete pull
+	void cache_save()
+	{
+		auto path = cache_file_path();
+		auto tmp = path + ".tmp";
+
+		std::vector<CacheRecord> recs;
+		recs.reserve(parameters.size());
+
+		for (auto &pp : parameters) {
+			auto &p = pp.second;
+			CacheRecord rec{};
+
+			strncpy(rec.param_id, p.param_id.c_str(), sizeof(rec.param_id) - 1);
+			rec.param_index = p.param_index;
+
+			switch (p.param_value.getType()) {
+			case XmlRpc::XmlRpcValue::TypeBoolean:
+				rec.value.i = static_cast<bool>(p.param_value);
+				break;
+			case XmlRpc::XmlRpcValue::TypeInt:
+				rec.value.i = static_cast<int32_t>(p.param_value);
+				break;
+			case XmlRpc::XmlRpcValue::TypeDouble:
+				rec.is_float = 1;
+				rec.value.f = static_cast<double>(p.param_value);
+				break;
+			default:
+				continue;
+			}
+
+			recs.push_back(rec);
+		}
+
+		CacheHeader hdr{};
+		memcpy(hdr.magic, "MVPC", sizeof(hdr.magic));
+		hdr.version = CACHE_VERSION;
+		hdr.param_count = recs.size();
+
+		std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<char *>(&hdr), sizeof(hdr));
+		file.write(reinterpret_cast<char *>(recs.data()), recs.size() * sizeof(CacheRecord));
+		file.close();
+
+		if (!file) {
+			ROS_WARN_NAMED("param", "PR: can't write cache: %s", tmp.c_str());
+			unlink(tmp.c_str());
+			return;
+		}
+
+		rename(tmp.c_str(), path.c_str());
+		ROS_DEBUG_NAMED("param", "PR: %zu parameters cached to %s", recs.size(), path.c_str());
+	}
+
 	bool wait_fetch_all()
 	{
 		std::unique_lock<std::mutex> lock(list_cond_mutex);
@@ -896,4 +1083,6 @@ private:
 }	// namespace mavros
 
 #include <pluginlib/class_list_macros.h>
+#include <mavros/plugin_registry.h>
 PLUGINLIB_EXPORT_CLASS(mavros::std_plugins::ParamPlugin, mavros::plugin::PluginBase)
+MAVROS_PLUGIN_FACTORY(mavros::std_plugins::ParamPlugin, param)
@@ -14,6 +14,7 @@
  * https://github.com/mavlink/mavros/tree/master/LICENSE.md
  */
 
+#include <cstdlib>
 #include <mavros/mavros_plugin.h>
 
 #include <mavros_msgs/RCIn.h>
@@ -24,6 +25,12 @@ namespace mavros {
 namespace std_plugins {
 /**
  * @brief RC IO plugin
+ *
+ * With ~rc/publish_on_change enabled the in/out topics are
+ * change-gated: identical channel arrays (within ~rc/deadband raw
+ * units) are not republished except for a low-rate keepalive
+ * (~rc/keepalive_rate), so idle sticks stop burning bandwidth on
+ * bagging and telemetry pipelines.
  */
 class RCIOPlugin : public plugin::PluginBase {
 public:
@@ -31,15 +38,25 @@ public:
 		rc_nh("~rc"),
 		raw_rc_in(0),
 		raw_rc_out(0),
-		has_rc_channels_msg(false)
+		has_rc_channels_msg(false),
+		publish_on_change(false),
+		deadband(0)
 	{ }
 
 	void initialize(UAS &uas_)
 	{
 		PluginBase::initialize(uas_);
 
-		rc_in_pub = rc_nh.advertise<mavros_msgs::RCIn>("in", 10);
-		rc_out_pub = rc_nh.advertise<mavros_msgs::RCOut>("out", 10);
+		double keepalive_rate;
+
+		rc_nh.param("publish_on_change", publish_on_change, false);
+		rc_nh.param("deadband", deadband, 0);
+		rc_nh.param("keepalive_rate", keepalive_rate, 1.0);
+		keepalive_period = (keepalive_rate > 0.0) ?
+			ros::Duration(1.0 / keepalive_rate) : ros::DURATION_MAX;
+
+		rc_in_pub.advertise<mavros_msgs::RCIn>(rc_nh, "in", 10);
+		rc_out_pub.advertise<mavros_msgs::RCOut>(rc_nh, "out", 10);
 		override_sub = rc_nh.subscribe("override", 10, &RCIOPlugin::override_cb, this);
 
 		enable_connection_cb();
@@ -62,10 +79,49 @@ private:
 	std::vector<uint16_t> raw_rc_out;
 	std::atomic<bool> has_rc_channels_msg;
 
-	ros::Publisher rc_in_pub;
-	ros::Publisher rc_out_pub;
+	plugin::LazyPublisher rc_in_pub;
+	plugin::LazyPublisher rc_out_pub;
 	ros::Subscriber override_sub;
 
+	//! change gating state (see class doc)
+	bool publish_on_change;
+	int deadband;
+	ros::Duration keepalive_period;
+	std::vector<uint16_t> last_rc_in;
+	std::vector<uint16_t> last_rc_out;
+	ros::Time last_rc_in_stamp;
+	ros::Time last_rc_out_stamp;
+
+	/* -*- helpers -*- */
+
+	/**
+	 * Change gate: pass when gating is off, any channel moved beyond
+	 * the deadband, or the keepalive expired. Updates the last
+	 * published state on pass. Called with the plugin mutex held.
+	 */
+	bool should_publish(const std::vector<uint16_t> &cur, std::vector<uint16_t> &last,
+			ros::Time &last_stamp, const ros::Time &now)
+	{
+		if (!publish_on_change)
+			return true;
+
+		bool changed = cur.size() != last.size();
+		if (!changed) {
+			for (size_t i = 0; i < cur.size(); i++)
+				if (std::abs(int(cur[i]) - int(last[i])) > deadband) {
+					changed = true;
+					break;
+				}
+		}
+
+		if (!changed && (now - last_stamp) < keepalive_period)
+			return false;
+
+		last = cur;
+		last_stamp = now;
+		return true;
+	}
+
 	/* -*- rx handlers -*- */
 
 	void handle_rc_channels_raw(const mavlink::mavlink_message_t *msg, mavlink::common::msg::RC_CHANNELS_RAW &port)
@@ -95,9 +151,17 @@ private:
 		raw_rc_in[offset + 7] = port.chan8_raw;
 		// [[[end]]] (checksum: fcb14b1ddfff9ce7dd02f5bd03825cff)
 
+		// raw_rc_in is kept fresh above even without subscribers
+		if (!rc_in_pub.active())
+			return;
+
+		auto stamp = m_uas->synchronise_stamp(port.time_boot_ms);
+		if (!should_publish(raw_rc_in, last_rc_in, last_rc_in_stamp, stamp))
+			return;
+
 		auto rcin_msg = boost::make_shared<mavros_msgs::RCIn>();
 
-		rcin_msg->header.stamp = m_uas->synchronise_stamp(port.time_boot_ms);
+		rcin_msg->header.stamp = stamp;
 		rcin_msg->rssi = port.rssi;
 		rcin_msg->channels = raw_rc_in;
 
@@ -150,9 +214,16 @@ private:
 		case  0: break;
 		}
 
+		if (!rc_in_pub.active())
+			return;
+
+		auto stamp = m_uas->synchronise_stamp(channels.time_boot_ms);
+		if (!should_publish(raw_rc_in, last_rc_in, last_rc_in_stamp, stamp))
+			return;
+
 		auto rcin_msg = boost::make_shared<mavros_msgs::RCIn>();
 
-		rcin_msg->header.stamp = m_uas->synchronise_stamp(channels.time_boot_ms);
+		rcin_msg->header.stamp = stamp;
 		rcin_msg->rssi = channels.rssi;
 		rcin_msg->channels = raw_rc_in;
 
@@ -181,12 +252,19 @@ private:
 		raw_rc_out[offset + 7] = port.servo8_raw;
 		// [[[end]]] (checksum: 946d524fe9fbaa3e52fbdf8a905fbf0f)
 
-		auto rcout_msg = boost::make_shared<mavros_msgs::RCOut>();
+		if (!rc_out_pub.active())
+			return;
 
 		// XXX: Why time_usec is 32 bit? We should test that.
 		uint64_t time_usec = port.time_usec;
 
-		rcout_msg->header.stamp = m_uas->synchronise_stamp(time_usec);
+		auto stamp = m_uas->synchronise_stamp(time_usec);
+		if (!should_publish(raw_rc_out, last_rc_out, last_rc_out_stamp, stamp))
+			return;
+
+		auto rcout_msg = boost::make_shared<mavros_msgs::RCOut>();
+
+		rcout_msg->header.stamp = stamp;
 		rcout_msg->channels = raw_rc_out;
 
 		rc_out_pub.publish(rcout_msg);
@@ -199,6 +277,8 @@ private:
 		lock_guard lock(mutex);
 		raw_rc_in.clear();
 		raw_rc_out.clear();
+		last_rc_in.clear();
+		last_rc_out.clear();
 		has_rc_channels_msg = false;
 	}
 
@@ -232,4 +312,6 @@ private:
 }	// namespace mavros
 
 #include <pluginlib/class_list_macros.h>
+#include <mavros/plugin_registry.h>
 PLUGINLIB_EXPORT_CLASS(mavros::std_plugins::RCIOPlugin, mavros::plugin::PluginBase)
+MAVROS_PLUGIN_FACTORY(mavros::std_plugins::RCIOPlugin, rc_io)
@@ -14,6 +14,7 @@
  * https://github.com/mavlink/mavros/tree/master/LICENSE.md
  */
 
+#include <mutex>
 #include <mavros/mavros_plugin.h>
 #include <mavros/setpoint_mixin.h>
 #include <eigen_conversions/eigen_msg.h>
@@ -29,6 +30,11 @@ namespace std_plugins {
  *
  * Send position setpoints and publish current state (return loop).
  * User can decide what set of filed needed for operation via IGNORE bits.
+ *
+ * Outgoing setpoints are coalesced latest-wins: when the tx queue
+ * rejects a send, the freshest value stays in a per-stream slot and
+ * newer setpoints overwrite it, so the link never drains stale
+ * control inputs no matter how far the radio backs up.
  */
 class SetpointRawPlugin : public plugin::PluginBase,
 	private plugin::SetPositionTargetLocalNEDMixin<SetpointRawPlugin>,
@@ -36,7 +42,8 @@ class SetpointRawPlugin : public plugin::PluginBase,
 	private plugin::SetAttitudeTargetMixin<SetpointRawPlugin> {
 public:
 	SetpointRawPlugin() : PluginBase(),
-		sp_nh("~setpoint_raw")
+		sp_nh("~setpoint_raw"),
+		superseded_count(0)
 	{ }
 
 	void initialize(UAS &uas_)
@@ -51,6 +58,12 @@ public:
 		target_local_pub = sp_nh.advertise<mavros_msgs::PositionTarget>("target_local", 10);
 		target_global_pub = sp_nh.advertise<mavros_msgs::GlobalPositionTarget>("target_global", 10);
 		target_attitude_pub = sp_nh.advertise<mavros_msgs::AttitudeTarget>("target_attitude", 10);
+
+		// retries pending slots when the stream pauses while the
+		// tx queue was full; runs only while something is pending
+		flush_timer = sp_nh.createTimer(ros::Duration(0.010),
+				&SetpointRawPlugin::flush_cb, this,
+				false /* oneshot */, false /* autostart */);
 	}
 
 	Subscriptions get_subscriptions()
@@ -71,6 +84,20 @@ private:
 	ros::Subscriber local_sub, global_sub, attitude_sub;
 	ros::Publisher target_local_pub, target_global_pub, target_attitude_pub;
 
+	//! latest-wins send slot, one per setpoint stream
+	template <typename T>
+	struct SendSlot {
+		typename T::ConstPtr msg;
+		bool pending = false;
+	};
+
+	std::mutex slot_mutex;
+	SendSlot<mavros_msgs::PositionTarget> local_slot;
+	SendSlot<mavros_msgs::GlobalPositionTarget> global_slot;
+	SendSlot<mavros_msgs::AttitudeTarget> attitude_slot;
+	size_t superseded_count;
+	ros::Timer flush_timer;
+
 	/* -*- message handlers -*- */
 	void handle_position_target_local_ned(const mavlink::mavlink_message_t *msg, mavlink::common::msg::POSITION_TARGET_LOCAL_NED &tgt)
 	{
@@ -140,9 +167,46 @@ private:
 		target_attitude_pub.publish(target);
 	}
 
-	/* -*- callbacks -*- */
+	/* -*- latest-wins coalescing -*- */
 
-	void local_cb(const mavros_msgs::PositionTarget::ConstPtr &req)
+	template <typename T>
+	void stash(SendSlot<T> &slot, const typename T::ConstPtr &req)
+	{
+		if (slot.pending) {
+			superseded_count++;
+			ROS_DEBUG_THROTTLE_NAMED(10, "setpoint", "SPR: %zu stale setpoint(s) superseded",
+					superseded_count);
+		}
+
+		slot.msg = req;
+		slot.pending = true;
+	}
+
+	//! try to push every pending slot to the link. slot_mutex must be held.
+	void drain_slots()
+	{
+		if (local_slot.pending && send_local(local_slot.msg))
+			local_slot.pending = false;
+		if (global_slot.pending && send_global(global_slot.msg))
+			global_slot.pending = false;
+		if (attitude_slot.pending && send_attitude(attitude_slot.msg))
+			attitude_slot.pending = false;
+
+		if (local_slot.pending || global_slot.pending || attitude_slot.pending)
+			flush_timer.start();
+		else
+			flush_timer.stop();
+	}
+
+	void flush_cb(const ros::TimerEvent &event)
+	{
+		std::lock_guard<std::mutex> lock(slot_mutex);
+		drain_slots();
+	}
+
+	/* -*- low-level send -*- */
+
+	bool send_local(const mavros_msgs::PositionTarget::ConstPtr &req)
 	{
 		Eigen::Vector3d position, velocity, af;
 		float yaw, yaw_rate;
@@ -158,7 +222,7 @@ private:
 		yaw = ftf::transform_frame_yaw_enu_ned(req->yaw);
 		yaw_rate = ftf::transform_frame_yaw_enu_ned(req->yaw_rate);
 
-		set_position_target_local_ned(
+		return set_position_target_local_ned(
 				req->header.stamp.toNSec() / 1000000,
 				req->coordinate_frame,
 				req->type_mask,
@@ -168,7 +232,7 @@ private:
 				yaw, yaw_rate);
 	}
 
-	void global_cb(const mavros_msgs::GlobalPositionTarget::ConstPtr &req)
+	bool send_global(const mavros_msgs::GlobalPositionTarget::ConstPtr &req)
 	{
 		Eigen::Vector3d velocity, af;
 		float yaw, yaw_rate;
@@ -182,7 +246,7 @@ private:
 		yaw = ftf::transform_frame_yaw_enu_ned(req->yaw);
 		yaw_rate = ftf::transform_frame_yaw_enu_ned(req->yaw_rate);
 
-		set_position_target_global_int(
+		return set_position_target_global_int(
 				req->header.stamp.toNSec() / 1000000,
 				req->coordinate_frame,
 				req->type_mask,
@@ -194,7 +258,7 @@ private:
 				yaw, yaw_rate);
 	}
 
-	void attitude_cb(const mavros_msgs::AttitudeTarget::ConstPtr &req)
+	bool send_attitude(const mavros_msgs::AttitudeTarget::ConstPtr &req)
 	{
 		Eigen::Quaterniond desired_orientation;
 		Eigen::Vector3d baselink_angular_rate;
@@ -210,16 +274,44 @@ private:
 
 		tf::vectorMsgToEigen(req->body_rate, body_rate);
 
-		set_attitude_target(
+		return set_attitude_target(
 				req->header.stamp.toNSec() / 1000000,
 				req->type_mask,
 				ned_desired_orientation,
 				body_rate,
 				req->thrust);
 	}
+
+	/* -*- callbacks -*- */
+
+	void local_cb(const mavros_msgs::PositionTarget::ConstPtr &req)
+	{
+		std::lock_guard<std::mutex> lock(slot_mutex);
+
+		stash(local_slot, req);
+		drain_slots();
+	}
+
+	void global_cb(const mavros_msgs::GlobalPositionTarget::ConstPtr &req)
+	{
+		std::lock_guard<std::mutex> lock(slot_mutex);
+
+		stash(global_slot, req);
+		drain_slots();
+	}
+
+	void attitude_cb(const mavros_msgs::AttitudeTarget::ConstPtr &req)
+	{
+		std::lock_guard<std::mutex> lock(slot_mutex);
+
+		stash(attitude_slot, req);
+		drain_slots();
+	}
 };
 }	// namespace std_plugins
 }	// namespace mavros
 
 #include <pluginlib/class_list_macros.h>
+#include <mavros/plugin_registry.h>
 PLUGINLIB_EXPORT_CLASS(mavros::std_plugins::SetpointRawPlugin, mavros::plugin::PluginBase)
+MAVROS_PLUGIN_FACTORY(mavros::std_plugins::SetpointRawPlugin, setpoint_raw)
@@ -14,7 +14,9 @@
  * https://github.com/mavlink/mavros/tree/master/LICENSE.md
  */
 
+#include <atomic>
 #include <mavros/mavros_plugin.h>
+#include <mavros/seqlock.h>
 
 #include <mavros_msgs/State.h>
 #include <mavros_msgs/ExtendedState.h>
@@ -65,6 +67,7 @@ public:
 		std::lock_guard<std::mutex> lock(mutex);
 		ros::Time curtime = ros::Time::now();
 		count_ = 0;
+		/* history below is mutex-protected, the counter is atomic */
 
 		for (size_t i = 0; i < window_size_; i++) {
 			times_[i] = curtime;
@@ -74,16 +77,28 @@ public:
 		hist_indx_ = 0;
 	}
 
+	/**
+	 * Per-heartbeat tick, lock-free: the counter and enums are
+	 * atomics, the mode string (the only non-trivial field) is
+	 * written under the mutex only when it actually changes.
+	 */
 	void tick(uint8_t type_, uint8_t autopilot_,
-			std::string &mode_, uint8_t system_status_)
+			const std::string &mode_, uint8_t system_status_)
 	{
-		std::lock_guard<std::mutex> lock(mutex);
-		count_++;
+		count_.fetch_add(1, std::memory_order_relaxed);
 
 		type = static_cast<MAV_TYPE>(type_);
 		autopilot = static_cast<MAV_AUTOPILOT>(autopilot_);
-		mode = mode_;
 		system_status = static_cast<MAV_STATE>(system_status_);
+
+		// tick runs on a single handler lane, the tick-side cache
+		// needs no lock
+		if (mode_ != mode_tick_cache) {
+			mode_tick_cache = mode_;
+
+			std::lock_guard<std::mutex> lock(mutex);
+			mode = mode_;
+		}
 	}
 
 	void run(diagnostic_updater::DiagnosticStatusWrapper &stat)
@@ -91,7 +106,7 @@ public:
 		std::lock_guard<std::mutex> lock(mutex);
 
 		ros::Time curtime = ros::Time::now();
-		int curseq = count_;
+		int curseq = count_.load(std::memory_order_relaxed);
 		int events = curseq - seq_nums_[hist_indx_];
 		double window = (curtime - times_[hist_indx_]).toSec();
 		double freq = events / window;
@@ -112,16 +127,16 @@ public:
 			stat.summary(0, "Normal");
 		}
 
-		stat.addf("Heartbeats since startup", "%d", count_);
+		stat.addf("Heartbeats since startup", "%d", curseq);
 		stat.addf("Frequency (Hz)", "%f", freq);
-		stat.add("Vehicle type", utils::to_string(type));
-		stat.add("Autopilot type", utils::to_string(autopilot));
+		stat.add("Vehicle type", utils::to_string(type.load()));
+		stat.add("Autopilot type", utils::to_string(autopilot.load()));
 		stat.add("Mode", mode);
-		stat.add("System status", utils::to_string(system_status));
+		stat.add("System status", utils::to_string(system_status.load()));
 	}
 
 private:
-	int count_;
+	std::atomic<int> count_;
 	std::vector<ros::Time> times_;
 	std::vector<int> seq_nums_;
 	int hist_indx_;
@@ -131,10 +146,11 @@ private:
 	const double max_freq_;
 	const double tolerance_;
 
-	MAV_AUTOPILOT autopilot;
-	MAV_TYPE type;
-	std::string mode;
-	MAV_STATE system_status;
+	std::atomic<MAV_AUTOPILOT> autopilot;
+	std::atomic<MAV_TYPE> type;
+	std::string mode;		//!< under mutex
+	std::string mode_tick_cache;	//!< tick thread only
+	std::atomic<MAV_STATE> system_status;
 };
 
 
@@ -145,18 +161,30 @@ class SystemStatusDiag : public diagnostic_updater::DiagnosticTask
 {
 public:
 	SystemStatusDiag(const std::string &name) :
-		diagnostic_updater::DiagnosticTask(name),
-		last_st {}
+		diagnostic_updater::DiagnosticTask(name)
 	{ }
 
 	void set(mavlink::common::msg::SYS_STATUS &st)
 	{
-		std::lock_guard<std::mutex> lock(mutex);
-		last_st = st;
+		// plain-data snapshot: the handler never blocks on the
+		// 2 Hz diag updater run
+		Status s;
+		s.onboard_control_sensors_present = st.onboard_control_sensors_present;
+		s.onboard_control_sensors_enabled = st.onboard_control_sensors_enabled;
+		s.onboard_control_sensors_health = st.onboard_control_sensors_health;
+		s.load = st.load;
+		s.drop_rate_comm = st.drop_rate_comm;
+		s.errors_comm = st.errors_comm;
+		s.errors_count1 = st.errors_count1;
+		s.errors_count2 = st.errors_count2;
+		s.errors_count3 = st.errors_count3;
+		s.errors_count4 = st.errors_count4;
+
+		st_.store(s);
 	}
 
 	void run(diagnostic_updater::DiagnosticStatusWrapper &stat) {
-		std::lock_guard<std::mutex> lock(mutex);
+		auto last_st = st_.load();
 
 		if ((last_st.onboard_control_sensors_health & last_st.onboard_control_sensors_enabled)
 				!= last_st.onboard_control_sensors_enabled)
@@ -254,8 +282,21 @@ public:
 	}
 
 private:
-	std::mutex mutex;
-	mavlink::common::msg::SYS_STATUS last_st;
+	//! SYS_STATUS fields shown in diag, trivially copyable for the seqlock
+	struct Status {
+		uint32_t onboard_control_sensors_present;
+		uint32_t onboard_control_sensors_enabled;
+		uint32_t onboard_control_sensors_health;
+		uint16_t load;
+		uint16_t drop_rate_comm;
+		uint16_t errors_comm;
+		uint16_t errors_count1;
+		uint16_t errors_count2;
+		uint16_t errors_count3;
+		uint16_t errors_count4;
+	};
+
+	Seqlock<Status> st_;
 };
 
 
@@ -274,12 +315,10 @@ public:
 	{ }
 
 	void set_min_voltage(float volt) {
-		std::lock_guard<std::mutex> lock(mutex);
 		min_voltage = volt;
 	}
 
 	void set(float volt, float curr, float rem) {
-		std::lock_guard<std::mutex> lock(mutex);
 		voltage = volt;
 		current = curr;
 		remaining = rem;
@@ -287,26 +326,25 @@ public:
 
 	void run(diagnostic_updater::DiagnosticStatusWrapper &stat)
 	{
-		std::lock_guard<std::mutex> lock(mutex);
+		float voltage_ = voltage;
 
-		if (voltage < 0)
+		if (voltage_ < 0)
 			stat.summary(2, "No data");
-		else if (voltage < min_voltage)
+		else if (voltage_ < min_voltage)
 			stat.summary(1, "Low voltage");
 		else
 			stat.summary(0, "Normal");
 
-		stat.addf("Voltage", "%.2f", voltage);
-		stat.addf("Current", "%.1f", current);
+		stat.addf("Voltage", "%.2f", voltage_);
+		stat.addf("Current", "%.1f", current.load());
 		stat.addf("Remaining", "%.1f", remaining * 100);
 	}
 
 private:
-	std::mutex mutex;
-	float voltage;
-	float current;
-	float remaining;
-	float min_voltage;
+	std::atomic<float> voltage;
+	std::atomic<float> current;
+	std::atomic<float> remaining;
+	std::atomic<float> min_voltage;
 };
 
 
@@ -363,35 +401,34 @@ public:
 	{ }
 
 	void set(uint16_t v, uint8_t e) {
-		std::lock_guard<std::mutex> lock(mutex);
-		vcc = v / 1000.0;
+		vcc = v / 1000.0f;
 		i2cerr = e;
 	}
 
 	void run(diagnostic_updater::DiagnosticStatusWrapper &stat)
 	{
-		std::lock_guard<std::mutex> lock(mutex);
+		float vcc_ = vcc;
+		size_t i2cerr_ = i2cerr;
 
-		if (vcc < 0)
+		if (vcc_ < 0)
 			stat.summary(2, "No data");
-		else if (vcc < 4.5)
+		else if (vcc_ < 4.5)
 			stat.summary(1, "Low voltage");
-		else if (i2cerr != i2cerr_last) {
-			i2cerr_last = i2cerr;
+		else if (i2cerr_ != i2cerr_last) {
+			i2cerr_last = i2cerr_;
 			stat.summary(1, "New I2C error");
 		}
 		else
 			stat.summary(0, "Normal");
 
-		stat.addf("Core voltage", "%f", vcc);
-		stat.addf("I2C errors", "%zu", i2cerr);
+		stat.addf("Core voltage", "%f", vcc_);
+		stat.addf("I2C errors", "%zu", i2cerr_);
 	}
 
 private:
-	std::mutex mutex;
-	float vcc;
-	size_t i2cerr;
-	size_t i2cerr_last;
+	std::atomic<float> vcc;
+	std::atomic<size_t> i2cerr;
+	size_t i2cerr_last;	//!< run() only
 };
 
 
@@ -413,26 +450,42 @@ public:
 		version_retries(RETRIES_COUNT),
 		disable_diag(false),
 		has_battery_status(false),
-		battery_voltage(0.0)
+		battery_voltage(0.0),
+		state_valid(false),
+		last_armed(false),
+		last_guided(false),
+		last_system_status(0),
+		last_base_mode(0),
+		last_custom_mode(0)
 	{ }
 
 	void initialize(UAS &uas_)
 	{
 		PluginBase::initialize(uas_);
 
-		ros::Duration conn_heartbeat;
-
 		double conn_timeout_d;
 		double conn_heartbeat_d;
 		double min_voltage;
 
+		double state_keepalive_d;
+
 		nh.param("conn/timeout", conn_timeout_d, 30.0);
 		nh.param("sys/min_voltage", min_voltage, 6.0);
 		nh.param("sys/disable_diag", disable_diag, false);
+		// ~/state is published on transitions; keepalive bounds the
+		// republish interval for rate-watching tools (0: only on change)
+		nh.param("sys/state_keepalive_rate", state_keepalive_d, 1.0);
+		state_keepalive_period = (state_keepalive_d > 0.0) ?
+			ros::Duration(ros::Rate(state_keepalive_d)) :
+			ros::DURATION_MAX;
 
 		// rate parameter
 		if (nh.getParam("conn/heartbeat_rate", conn_heartbeat_d) && conn_heartbeat_d != 0.0) {
-			conn_heartbeat = ros::Duration(ros::Rate(conn_heartbeat_d));
+			// our HEARTBEAT is fully constant: retain it in the link
+			// once and let the IO thread beat it out, immune to ROS
+			// callback starvation — exactly when a missed heartbeat
+			// would trip GCS failsafe
+			UAS_FCU(m_uas)->register_periodic_tx(make_heartbeat(), conn_heartbeat_d);
 		}
 
 		// heartbeat diag always enabled
@@ -450,12 +503,6 @@ public:
 				&SystemStatusPlugin::timeout_cb, this, true);
 		//timeout_timer.start();
 
-		if (!conn_heartbeat.isZero()) {
-			heartbeat_timer = nh.createTimer(conn_heartbeat,
-					&SystemStatusPlugin::heartbeat_cb, this);
-			//heartbeat_timer.start();
-		}
-
 		// version request timer
 		autopilot_version_timer = nh.createTimer(ros::Duration(1.0),
 				&SystemStatusPlugin::autopilot_version_cb, this);
@@ -494,7 +541,6 @@ private:
 	SystemStatusDiag sys_diag;
 	BatteryStatusDiag batt_diag;
 	ros::Timer timeout_timer;
-	ros::Timer heartbeat_timer;
 	ros::Timer autopilot_version_timer;
 
 	ros::Publisher state_pub;
@@ -509,6 +555,17 @@ private:
 	bool has_battery_status;
 	float battery_voltage;
 
+	/* change-driven ~/state (heartbeat lane only) */
+	bool state_valid;		//!< false forces publish + mode reformat
+	bool last_armed;
+	bool last_guided;
+	uint8_t last_system_status;
+	uint8_t last_base_mode;		//!< key of the cached mode string
+	uint32_t last_custom_mode;
+	std::string last_mode;
+	ros::Time last_state_stamp;
+	ros::Duration state_keepalive_period;
+
 	/* -*- mid-level helpers -*- */
 
 	/**
@@ -624,6 +681,8 @@ private:
 		state_msg->system_status = enum_value(MAV_STATE::UNINIT);
 
 		state_pub.publish(state_msg);
+		// first heartbeat after reconnect must publish again
+		state_valid = false;
 	}
 
 	/* -*- message handlers -*- */
@@ -643,17 +702,46 @@ private:
 		timeout_timer.stop();
 		timeout_timer.start();
 
-		// build state message after updating uas
+		// mode strings change orders of magnitude less often than
+		// heartbeats arrive: reformat only on mode bit transitions
+		if (!state_valid || hb.base_mode != last_base_mode || hb.custom_mode != last_custom_mode)
+			last_mode = m_uas->str_mode_v10(hb.base_mode, hb.custom_mode);
+
+		hb_diag.tick(hb.type, hb.autopilot, last_mode, hb.system_status);
+
+		bool armed = hb.base_mode & enum_value(MAV_MODE_FLAG::SAFETY_ARMED);
+		bool guided = hb.base_mode & enum_value(MAV_MODE_FLAG::GUIDED_ENABLED);
+
+		bool changed = !state_valid ||
+			armed != last_armed ||
+			guided != last_guided ||
+			hb.base_mode != last_base_mode ||
+			hb.custom_mode != last_custom_mode ||
+			hb.system_status != last_system_status;
+
+		auto stamp = ros::Time::now();
+		if (!changed && stamp - last_state_stamp < state_keepalive_period)
+			return;
+
+		// ~/state is latched: late subscribers get the last
+		// transition even between keepalives
 		auto state_msg = boost::make_shared<mavros_msgs::State>();
-		state_msg->header.stamp = ros::Time::now();
+		state_msg->header.stamp = stamp;
 		state_msg->connected = true;
-		state_msg->armed = hb.base_mode & enum_value(MAV_MODE_FLAG::SAFETY_ARMED);
-		state_msg->guided = hb.base_mode & enum_value(MAV_MODE_FLAG::GUIDED_ENABLED);
-		state_msg->mode = m_uas->str_mode_v10(hb.base_mode, hb.custom_mode);
+		state_msg->armed = armed;
+		state_msg->guided = guided;
+		state_msg->mode = last_mode;
 		state_msg->system_status = hb.system_status;
 
 		state_pub.publish(state_msg);
-		hb_diag.tick(hb.type, hb.autopilot, state_msg->mode, hb.system_status);
+
+		last_armed = armed;
+		last_guided = guided;
+		last_base_mode = hb.base_mode;
+		last_custom_mode = hb.custom_mode;
+		last_system_status = hb.system_status;
+		last_state_stamp = stamp;
+		state_valid = true;
 	}
 
 	void handle_extended_sys_state(const mavlink::mavlink_message_t *msg, mavlink::common::msg::EXTENDED_SYS_STATE &state)
@@ -728,6 +816,11 @@ private:
 		if (m_uas->is_my_target(msg->sysid, msg->compid)) {
 			autopilot_version_timer.stop();
 			m_uas->update_capabilities(true, apv.capabilities);
+
+			// upgrade auto-negotiated links: some FCUs keep
+			// answering in v1 framing until spoken to in v2
+			if (apv.capabilities & enum_value(mavlink::common::MAV_PROTOCOL_CAPABILITY::MAVLINK2))
+				UAS_FCU(m_uas)->set_peer_mavlink2(true);
 		}
 
 		// but print all version responses
@@ -815,7 +908,8 @@ private:
 		m_uas->update_connection_status(false);
 	}
 
-	void heartbeat_cb(const ros::TimerEvent &event)
+	//! our periodic heartbeat, sent pre-serialized by the link itself
+	static mavlink::common::msg::HEARTBEAT make_heartbeat()
 	{
 		using mavlink::common::MAV_MODE;
 
@@ -827,7 +921,7 @@ private:
 		hb.custom_mode = 0;
 		hb.system_status = enum_value(MAV_STATE::ACTIVE);
 
-		UAS_FCU(m_uas)->send_message_ignore_drop(hb);
+		return hb;
 	}
 
 	void autopilot_version_cb(const ros::TimerEvent &event)
@@ -956,4 +1050,6 @@ private:
 }	// namespace mavros
 
 #include <pluginlib/class_list_macros.h>
+#include <mavros/plugin_registry.h>
 PLUGINLIB_EXPORT_CLASS(mavros::std_plugins::SystemStatusPlugin, mavros::plugin::PluginBase)
+MAVROS_PLUGIN_FACTORY(mavros::std_plugins::SystemStatusPlugin, sys_status)
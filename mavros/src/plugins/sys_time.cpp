@@ -14,6 +14,8 @@
  * https://github.com/mavlink/mavros/tree/master/LICENSE.md
  */
 
+#include <array>
+#include <algorithm>
 #include <mavros/mavros_plugin.h>
 
 #include <sensor_msgs/TimeReference.h>
@@ -139,7 +141,12 @@ public:
 		nh("~"),
 		dt_diag("Time Sync", 10),
 		time_offset_ns(0),
-		offset_avg_alpha(0)
+		offset_avg_alpha(0),
+		skew_beta(0),
+		skew(0.0),
+		last_obs_remote_ns(0),
+		model_valid(false),
+		rtt_count(0)
 	{ }
 
 	using TSM = UAS::timesync_mode;
@@ -171,6 +178,11 @@ public:
 		 * the faster the moving average updates in response to new offset samples (more jitter)
 		 * We need a significant amount of smoothing , more so for lower message rates like 1Hz
 		 */
+		nh.param("time/timesync_skew_beta", skew_beta, 0.02);
+		/*
+		 * beta gain of the alpha-beta tracker: how fast the skew
+		 * (clock frequency error) estimate follows the residuals
+		 */
 
 		// Set timesync mode
 		auto ts_mode = utils::timesync_mode_from_str(ts_mode_str);
@@ -217,6 +229,17 @@ private:
 	std::string time_ref_source;
 	int64_t time_offset_ns;
 	double offset_avg_alpha;
+	double skew_beta;
+
+	//! alpha-beta clock model state
+	double skew;
+	uint64_t last_obs_remote_ns;
+	bool model_valid;
+
+	//! recent round-trip times for the median spike gate
+	static constexpr size_t RTT_WINDOW = 9;
+	std::array<int64_t, RTT_WINDOW> rtt_hist;
+	size_t rtt_count;
 
 	void handle_system_time(const mavlink::mavlink_message_t *msg, mavlink::common::msg::SYSTEM_TIME &mtime)
 	{
@@ -243,15 +266,23 @@ private:
 
 	void handle_timesync(const mavlink::mavlink_message_t *msg, mavlink::common::msg::TIMESYNC &tsync)
 	{
-		uint64_t now_ns = ros::Time::now().toNSec();
+		// TIMESYNC is routed inline (~executor_inline_ids), so the
+		// link still holds the kernel rx stamp of the datagram that
+		// carried this message; it predates asio and rx-thread
+		// scheduling, which otherwise becomes clock error.
+		uint64_t now_ns = UAS_FCU(m_uas)->get_rx_kernel_stamp_ns();
+		if (now_ns == 0)
+			now_ns = ros::Time::now().toNSec();
 
 		if (tsync.tc1 == 0) {
 			send_timesync_msg(now_ns, tsync.ts1);
 			return;
 		}
 		else if (tsync.tc1 > 0) {
-			// observation is the offset in nanoseconds
-			add_timesync_observation((tsync.ts1 + now_ns - tsync.tc1 * 2) / 2, tsync.tc1);
+			// observation is the offset in nanoseconds,
+			// poisoned by half of any round-trip asymmetry
+			add_timesync_observation((tsync.ts1 + now_ns - tsync.tc1 * 2) / 2, tsync.tc1,
+					now_ns - tsync.ts1);
 		}
 	}
 
@@ -276,7 +307,8 @@ private:
 			uint64_t realtime_now_ns = ros::Time::now().toNSec();
 			uint64_t monotonic_now_ns = get_monotonic_now();
 
-			add_timesync_observation(realtime_now_ns - monotonic_now_ns, realtime_now_ns);
+			// no transport involved: no RTT to gate on
+			add_timesync_observation(realtime_now_ns - monotonic_now_ns, realtime_now_ns, 0);
 		}
 	}
 
@@ -289,13 +321,45 @@ private:
 		UAS_FCU(m_uas)->send_message_ignore_drop(tsync);
 	}
 
-	void add_timesync_observation(int64_t offset_ns, uint64_t observation_time)
+	/**
+	 * @brief Reject observations taken over RTT spikes
+	 *
+	 * Keeps a small window of recent round-trips; a sample costing
+	 * well over the median got delayed asymmetrically and would step
+	 * the offset. Fixed window, O(1) per exchange.
+	 */
+	bool rtt_gate_reject(int64_t rtt_ns)
 	{
+		if (rtt_ns <= 0)
+			return false;
+
+		rtt_hist[rtt_count % RTT_WINDOW] = rtt_ns;
+		rtt_count++;
+		if (rtt_count < RTT_WINDOW)
+			return false;	// not enough history to judge
+
+		auto sorted = rtt_hist;
+		std::nth_element(sorted.begin(), sorted.begin() + RTT_WINDOW / 2, sorted.end());
+		int64_t median = sorted[RTT_WINDOW / 2];
+
+		// 1 ms floor keeps very clean links from gating on noise
+		return rtt_ns > 2 * median + 1000000;
+	}
+
+	void add_timesync_observation(int64_t offset_ns, uint64_t observation_time, int64_t rtt_ns)
+	{
+		if (rtt_gate_reject(rtt_ns)) {
+			ROS_DEBUG_THROTTLE_NAMED(10, "time", "TM: RTT spike (%0.3f ms), observation dropped",
+						rtt_ns / 1e6);
+			return;
+		}
+
 		int64_t dt = time_offset_ns - offset_ns;
 
-		if (std::abs(dt) > 10000000) {		// 10 millisecond skew
+		if (!model_valid || std::abs(dt) > 10000000) {	// 10 millisecond skew
 			time_offset_ns = offset_ns;	// hard-set it.
-			m_uas->set_time_offset(time_offset_ns);
+			skew = 0.0;
+			model_valid = true;
 
 			dt_diag.clear();
 			dt_diag.set_timestamp(observation_time);
@@ -304,15 +368,21 @@ private:
 						"Hard syncing clocks.", dt / 1e9);
 		}
 		else {
-			average_offset(offset_ns);
+			// alpha-beta tracker: predict this exchange's offset
+			// from the skew estimate, blend in the residual
+			int64_t pred_dt = observation_time - last_obs_remote_ns;
+			int64_t predicted = time_offset_ns + int64_t(skew * pred_dt);
+			int64_t residual = offset_ns - predicted;
+
+			time_offset_ns = predicted + int64_t(offset_avg_alpha * residual);
+			if (pred_dt > 0)
+				skew += skew_beta * double(residual) / double(pred_dt);
+
 			dt_diag.tick(dt, observation_time, time_offset_ns);
-			m_uas->set_time_offset(time_offset_ns);
 		}
-	}
 
-	inline void average_offset(int64_t offset_ns)
-	{
-		time_offset_ns = (offset_avg_alpha * offset_ns) + (1.0 - offset_avg_alpha) * time_offset_ns;
+		last_obs_remote_ns = observation_time;
+		m_uas->update_clock_model(time_offset_ns, skew, observation_time);
 	}
 
 	uint64_t get_monotonic_now(void)
@@ -327,4 +397,6 @@ private:
 }	// namespace mavros
 
 #include <pluginlib/class_list_macros.h>
+#include <mavros/plugin_registry.h>
 PLUGINLIB_EXPORT_CLASS(mavros::std_plugins::SystemTimePlugin, mavros::plugin::PluginBase)
+MAVROS_PLUGIN_FACTORY(mavros::std_plugins::SystemTimePlugin, sys_time)
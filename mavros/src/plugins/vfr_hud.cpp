@@ -38,8 +38,8 @@ public:
 	{
 		PluginBase::initialize(uas_);
 
-		vfr_pub = nh.advertise<mavros_msgs::VFR_HUD>("vfr_hud", 10);
-		wind_pub = nh.advertise<geometry_msgs::TwistStamped>("wind_estimation", 10);
+		vfr_pub.advertise<mavros_msgs::VFR_HUD>(nh, "vfr_hud", 10);
+		wind_pub.advertise<geometry_msgs::TwistStamped>(nh, "wind_estimation", 10);
 	}
 
 	Subscriptions get_subscriptions()
@@ -53,11 +53,14 @@ public:
 private:
 	ros::NodeHandle nh;
 
-	ros::Publisher vfr_pub;
-	ros::Publisher wind_pub;
+	plugin::LazyPublisher vfr_pub;
+	plugin::LazyPublisher wind_pub;
 
 	void handle_vfr_hud(const mavlink::mavlink_message_t *msg, mavlink::common::msg::VFR_HUD &vfr_hud)
 	{
+		if (!vfr_pub.active())
+			return;
+
 		auto vmsg = boost::make_shared<mavros_msgs::VFR_HUD>();
 		vmsg->header.stamp = ros::Time::now();
 		vmsg->airspeed = vfr_hud.airspeed;
@@ -75,6 +78,9 @@ private:
 	 */
 	void handle_wind(const mavlink::mavlink_message_t *msg, mavlink::ardupilotmega::msg::WIND &wind)
 	{
+		if (!wind_pub.active())
+			return;
+
 		const double speed = wind.speed;
 		const double course = angles::from_degrees(wind.direction);
 
@@ -92,4 +98,6 @@ private:
 }	// namespace mavros
 
 #include <pluginlib/class_list_macros.h>
+#include <mavros/plugin_registry.h>
 PLUGINLIB_EXPORT_CLASS(mavros::std_plugins::VfrHudPlugin, mavros::plugin::PluginBase)
+MAVROS_PLUGIN_FACTORY(mavros::std_plugins::VfrHudPlugin, vfr_hud)
@@ -14,7 +14,9 @@
  * https://github.com/mavlink/mavros/tree/master/LICENSE.md
  */
 
+#include <map>
 #include <chrono>
+#include <algorithm>
 #include <condition_variable>
 #include <mavros/mavros_plugin.h>
 
@@ -104,6 +106,21 @@ public:
 		return ret;
 	}
 
+	//! compare mission definition, "current" flag intentionally skipped
+	bool same_definition(const WaypointItem &o) const
+	{
+		return frame == o.frame &&
+		       command == o.command &&
+		       autocontinue == o.autocontinue &&
+		       param1 == o.param1 &&
+		       param2 == o.param2 &&
+		       param3 == o.param3 &&
+		       param4 == o.param4 &&
+		       x_lat == o.x_lat &&
+		       y_long == o.y_long &&
+		       z_alt == o.z_alt;
+	}
+
 	std::string to_string()
 	{
 		//return to_yaml();
@@ -118,6 +135,76 @@ public:
 };
 
 
+/**
+ * Mission transfer diagnostics: rate of the last pull/push and
+ * retransmit counters
+ */
+class MissionTransferDiag : public diagnostic_updater::DiagnosticTask
+{
+public:
+	explicit MissionTransferDiag(const std::string &name) :
+		diagnostic_updater::DiagnosticTask(name),
+		cur_retries(0),
+		last_items(0),
+		last_retries(0),
+		total_retries(0),
+		last_dt(0.0)
+	{ }
+
+	void start(const std::string &op_)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		op = op_;
+		cur_retries = 0;
+		start_stamp = ros::Time::now();
+	}
+
+	void retry()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		cur_retries++;
+		total_retries++;
+	}
+
+	void finish(size_t items)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		last_op = op;
+		last_items = items;
+		last_retries = cur_retries;
+		last_dt = (ros::Time::now() - start_stamp).toSec();
+	}
+
+	void run(diagnostic_updater::DiagnosticStatusWrapper &stat)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (last_dt > 0.0)
+			stat.summary(0, utils::format("%s: %zu items in %.1f s (%.1f items/s)",
+					last_op.c_str(), last_items, last_dt,
+					last_items / last_dt));
+		else
+			stat.summary(0, "no transfer yet");
+
+		stat.addf("Last items", "%zu", last_items);
+		stat.addf("Last duration (s)", "%.3f", last_dt);
+		stat.addf("Last retransmits", "%zu", last_retries);
+		stat.addf("Total retransmits", "%zu", total_retries);
+	}
+
+private:
+	std::mutex mutex;
+	std::string op;
+	std::string last_op;
+	ros::Time start_stamp;
+	size_t cur_retries;
+	size_t last_items;
+	size_t last_retries;
+	size_t total_retries;
+	double last_dt;
+};
+
+
 /**
  * @brief Mission manupulation plugin
  */
@@ -129,11 +216,19 @@ public:
 		wp_count(0),
 		wp_retries(RETRIES_COUNT),
 		wp_cur_id(0),
+		wp_rx_requested(0),
+		wp_tx_sent(0),
+		wp_tx_start(0),
+		wp_tx_end(0),
+		wp_is_partial(false),
 		wp_cur_active(0),
 		wp_set_active(0),
 		is_timedout(false),
 		do_pull_after_gcs(false),
 		reshedule_pull(false),
+		wp_window(1),
+		enable_partial_push(true),
+		trans_diag("Mission transfer"),
 		BOOTUP_TIME_DT(BOOTUP_TIME_MS / 1000.0),
 		LIST_TIMEOUT_DT(LIST_TIMEOUT_MS / 1000.0),
 		WP_TIMEOUT_DT(WP_TIMEOUT_MS / 1000.0),
@@ -147,6 +242,12 @@ public:
 		wp_state = WP::IDLE;
 
 		wp_nh.param("pull_after_gcs", do_pull_after_gcs, false);
+		wp_nh.param("window", wp_window, 1);
+		if (wp_window < 1)
+			wp_window = 1;
+		wp_nh.param("enable_partial_push", enable_partial_push, true);
+
+		m_uas->diag_updater.add(trans_diag);
 
 		wp_list_pub = wp_nh.advertise<mavros_msgs::WaypointList>("waypoints", 2, true);
 		pull_srv = wp_nh.advertiseService("pull", &WaypointPlugin::pull_cb, this);
@@ -200,6 +301,11 @@ private:
 
 	size_t wp_count;
 	size_t wp_cur_id;
+	size_t wp_rx_requested;		//!< pull: next seq to request
+	size_t wp_tx_sent;		//!< push: next seq to send ahead
+	size_t wp_tx_start;		//!< push: first seq of this transfer
+	size_t wp_tx_end;		//!< push: last seq of this transfer
+	bool wp_is_partial;		//!< push uses MISSION_WRITE_PARTIAL_LIST
 	size_t wp_cur_active;
 	size_t wp_set_active;
 	size_t wp_retries;
@@ -209,10 +315,16 @@ private:
 	std::condition_variable list_receiving;
 	std::condition_variable list_sending;
 
+	//! pull: items received ahead of the in-order cursor
+	std::map<uint16_t, WaypointItem> rx_stash;
+
 	ros::Timer wp_timer;
 	ros::Timer shedule_timer;
 	bool do_pull_after_gcs;
 	bool reshedule_pull;
+	int wp_window;			//!< requests/items kept in flight
+	bool enable_partial_push;
+	MissionTransferDiag trans_diag;
 
 	static constexpr int BOOTUP_TIME_MS = 15000;	//! system startup delay before start pull
 	static constexpr int LIST_TIMEOUT_MS = 30000;	//! Timeout for pull/push operations
@@ -245,18 +357,39 @@ private:
 
 		/* receive item only in RX state */
 		if (wp_state == WP::RXWP) {
-			if (wpi.seq != wp_cur_id) {
+			if (wpi.seq < wp_cur_id || wpi.seq >= wp_count) {
 				ROS_WARN_NAMED("wp", "WP: Seq mismatch, dropping item (%d != %zu)",
 						wpi.seq, wp_cur_id);
 				return;
 			}
+			else if (wpi.seq != wp_cur_id) {
+				/* arrived ahead of a gap: stash it,
+				 * timeout does selective retry of the gap */
+				ROS_DEBUG_NAMED("wp", "WP: stash item #%d, waiting #%zu",
+						wpi.seq, wp_cur_id);
+				rx_stash[wpi.seq] = wpi;
+				restart_timeout_timer();
+				return;
+			}
 
 			ROS_INFO_STREAM_NAMED("wp", "WP: item " << wpi.to_string());
 
 			waypoints.push_back(wpi);
-			if (++wp_cur_id < wp_count) {
+			wp_cur_id++;
+
+			/* the gap is closed: drain consecutive stashed items */
+			while (!rx_stash.empty() && rx_stash.begin()->first == wp_cur_id) {
+				waypoints.push_back(rx_stash.begin()->second);
+				rx_stash.erase(rx_stash.begin());
+				wp_cur_id++;
+			}
+
+			if (wp_cur_id < wp_count) {
 				restart_timeout_timer();
-				mission_request(wp_cur_id);
+				/* keep up to wp_window requests in flight */
+				while (wp_rx_requested < wp_count &&
+						wp_rx_requested < wp_cur_id + wp_window)
+					mission_request(wp_rx_requested++);
 			}
 			else {
 				request_mission_done();
@@ -277,21 +410,36 @@ private:
 	{
 		lock_guard lock(mutex);
 
-		if ((wp_state == WP::TXLIST && mreq.seq == 0) || (wp_state == WP::TXWP)) {
-			if (mreq.seq != wp_cur_id && mreq.seq != wp_cur_id + 1) {
+		if ((wp_state == WP::TXLIST && mreq.seq == wp_tx_start) || (wp_state == WP::TXWP)) {
+			if (mreq.seq >= send_waypoints.size()) {
+				ROS_ERROR_NAMED("wp", "WP: FCU require seq out of range");
+				return;
+			}
+			else if (mreq.seq > wp_tx_sent) {
 				ROS_WARN_NAMED("wp", "WP: Seq mismatch, dropping request (%d != %zu)",
-						mreq.seq, wp_cur_id);
+						mreq.seq, wp_tx_sent);
 				return;
 			}
 
+			/* same seq twice: the FCU lost an item we sent ahead */
+			bool is_repeat = (wp_state == WP::TXWP && mreq.seq == wp_cur_id);
+
 			restart_timeout_timer();
-			if (mreq.seq < send_waypoints.size()) {
-				wp_state = WP::TXWP;
-				wp_cur_id = mreq.seq;
-				send_waypoint(wp_cur_id);
+			wp_state = WP::TXWP;
+			wp_cur_id = mreq.seq;
+
+			if (is_repeat || mreq.seq >= wp_tx_sent) {
+				if (is_repeat)
+					trans_diag.retry();
+
+				send_waypoint(mreq.seq);
+				wp_tx_sent = std::max(wp_tx_sent, size_t(mreq.seq) + 1);
 			}
-			else
-				ROS_ERROR_NAMED("wp", "WP: FCU require seq out of range");
+
+			/* keep up to wp_window items in flight */
+			while (wp_tx_sent <= wp_tx_end &&
+					wp_tx_sent < wp_cur_id + wp_window)
+				send_waypoint(wp_tx_sent++);
 		}
 		else
 			ROS_DEBUG_NAMED("wp", "WP: rejecting request, wrong state %d", enum_value(wp_state));
@@ -333,14 +481,19 @@ private:
 
 			wp_count = mcnt.count;
 			wp_cur_id = 0;
+			wp_rx_requested = 0;
+			rx_stash.clear();
 
 			waypoints.clear();
 			waypoints.reserve(wp_count);
 
 			if (wp_count > 0) {
 				wp_state = WP::RXWP;
+				trans_diag.start("pull");
 				restart_timeout_timer();
-				mission_request(wp_cur_id);
+				while (wp_rx_requested < wp_count &&
+						wp_rx_requested < size_t(wp_window))
+					mission_request(wp_rx_requested++);
 			}
 			else {
 				request_mission_done();
@@ -370,9 +523,10 @@ private:
 		unique_lock lock(mutex);
 
 		if ((wp_state == WP::TXLIST || wp_state == WP::TXWP)
-				&& (wp_cur_id == send_waypoints.size() - 1)
+				&& (wp_cur_id == wp_tx_end)
 				&& (mack.type == enum_value(MRES::ACCEPTED))) {
 			go_idle();
+			trans_diag.finish(wp_tx_end - wp_tx_start + 1);
 			waypoints = send_waypoints;
 			send_waypoints.clear();
 
@@ -381,6 +535,22 @@ private:
 			publish_waypoints();
 			ROS_INFO_NAMED("wp", "WP: mission sended");
 		}
+		else if ((wp_state == WP::TXLIST || wp_state == WP::TXWP)
+				&& wp_is_partial) {
+			/* FCU rejected the partial write: retry as full push */
+			ROS_WARN_NAMED("wp", "WP: partial push rejected (%d), falling back to full push",
+					mack.type);
+
+			wp_is_partial = false;
+			wp_tx_start = 0;
+			wp_tx_end = wp_count - 1;
+			wp_tx_sent = 0;
+			wp_cur_id = 0;
+			wp_state = WP::TXLIST;
+
+			restart_timeout_timer();
+			mission_count(wp_count);
+		}
 		else if (wp_state == WP::TXLIST || wp_state == WP::TXWP) {
 			go_idle();
 			/* use this flag for failure report */
@@ -459,12 +629,22 @@ private:
 				mission_request_list();
 				break;
 			case WP::RXWP:
-				mission_request(wp_cur_id);
+				/* selective retry: only gaps inside the window */
+				for (size_t seq = wp_cur_id; seq < wp_rx_requested; seq++) {
+					if (rx_stash.find(seq) == rx_stash.end()) {
+						trans_diag.retry();
+						mission_request(seq);
+					}
+				}
 				break;
 			case WP::TXLIST:
-				mission_count(wp_count);
+				if (wp_is_partial)
+					mission_write_partial_list(wp_tx_start, wp_tx_end);
+				else
+					mission_count(wp_count);
 				break;
 			case WP::TXWP:
+				trans_diag.retry();
 				send_waypoint(wp_cur_id);
 				break;
 			case WP::CLEAR:
@@ -522,6 +702,7 @@ private:
 		/* possibly not needed if count == 0 (QGC impl) */
 		mission_ack(MRES::ACCEPTED);
 
+		trans_diag.finish(waypoints.size());
 		go_idle();
 		list_receiving.notify_all();
 		ROS_INFO_NAMED("wp", "WP: mission received");
@@ -530,6 +711,7 @@ private:
 	void go_idle(void)
 	{
 		reshedule_pull = false;
+		rx_stash.clear();
 		wp_state = WP::IDLE;
 		wp_timer.stop();
 	}
@@ -635,6 +817,18 @@ private:
 		UAS_FCU(m_uas)->send_message_ignore_drop(msc);
 	}
 
+	void mission_write_partial_list(uint16_t start_index, uint16_t end_index)
+	{
+		ROS_DEBUG_NAMED("wp", "WP:m: write partial list %u..%u", start_index, end_index);
+
+		mavlink::common::msg::MISSION_WRITE_PARTIAL_LIST mwp{};
+		m_uas->msg_set_target(mwp);
+		mwp.start_index = start_index;
+		mwp.end_index = end_index;
+
+		UAS_FCU(m_uas)->send_message_ignore_drop(mwp);
+	}
+
 	void mission_request_list()
 	{
 		ROS_DEBUG_NAMED("wp", "WP:m: request list");
@@ -720,15 +914,51 @@ private:
 		}
 
 		wp_count = send_waypoints.size();
-		wp_cur_id = 0;
+		wp_tx_start = 0;
+		wp_tx_end = (wp_count > 0) ? wp_count - 1 : 0;
+		wp_is_partial = false;
+
+		if (enable_partial_push && !waypoints.empty() &&
+				waypoints.size() == send_waypoints.size()) {
+			/* diff against the last known table:
+			 * transfer only the changed index range */
+			size_t lo = wp_count, hi = 0;
+			for (size_t i = 0; i < wp_count; i++) {
+				if (!send_waypoints[i].same_definition(waypoints[i])) {
+					lo = std::min(lo, i);
+					hi = std::max(hi, i);
+				}
+			}
+
+			if (lo > hi) {
+				/* nothing changed */
+				go_idle();
+				res.success = true;
+				res.wp_transfered = 0;
+				return true;
+			}
+			else if (lo > 0 || hi + 1 < wp_count) {
+				wp_is_partial = true;
+				wp_tx_start = lo;
+				wp_tx_end = hi;
+				ROS_INFO_NAMED("wp", "WP: partial push of items %zu..%zu", lo, hi);
+			}
+		}
+
+		wp_cur_id = wp_tx_start;
+		wp_tx_sent = wp_tx_start;
+		trans_diag.start("push");
 		restart_timeout_timer();
 
 		lock.unlock();
-		mission_count(wp_count);
+		if (wp_is_partial)
+			mission_write_partial_list(wp_tx_start, wp_tx_end);
+		else
+			mission_count(wp_count);
 		res.success = wait_push_all();
 		lock.lock();
 
-		res.wp_transfered = wp_cur_id + 1;
+		res.wp_transfered = wp_cur_id + 1 - wp_tx_start;
 		go_idle();	// same as in pull_cb
 		return true;
 	}
@@ -778,4 +1008,6 @@ private:
 }	// namespace mavros
 
 #include <pluginlib/class_list_macros.h>
+#include <mavros/plugin_registry.h>
 PLUGINLIB_EXPORT_CLASS(mavros::std_plugins::WaypointPlugin, mavros::plugin::PluginBase)
+MAVROS_PLUGIN_FACTORY(mavros::std_plugins::WaypointPlugin, waypoint)
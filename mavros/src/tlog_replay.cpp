@@ -0,0 +1,205 @@
+/**
+ * @brief Tlog replay tool
+ * @file tlog_replay.cpp
+ *
+ * Replays a recorded tlog byte stream into a running mavros instance
+ * at a configurable time-acceleration factor, so routing and plugin
+ * performance can be validated against real flight data without a
+ * vehicle.
+ *
+ * Point mavros at a listening TCP endpoint and connect the replay to
+ * it — TCP gives a lossless, backpressured byte stream, so "zero
+ * drops" is a property of the pipeline under test, not of the replay
+ * transport:
+ *
+ *     roslaunch mavros px4.launch fcu_url:=tcp-l://0.0.0.0:5760
+ *     rosrun mavros tlog_replay _file:=flight.tlog _speed:=0 \
+ *             _url:=tcp://localhost:5760
+ *
+ * ~speed scales replay time (2.0 = twice as fast); 0 replays as fast
+ * as the link accepts. Frames are carved out of the log with the
+ * regular frame headers, and every record is pushed through
+ * MAVConnInterface::send_bytes(), i.e. the receiving side runs its
+ * normal parse_buffer() -> router -> plugin chain.
+ *
+ * Per-plugin handler timing comes from the handlers_begin/end USDT
+ * tracepoints mavros already carries; attach during the replay, e.g.:
+ *
+ *     bpftrace -e 'usdt:*:mavros:handlers_begin { @t[arg1] = nsecs }
+ *         usdt:*:mavros:handlers_end /@t[arg1]/
+ *         { @lat[arg0] = hist(nsecs - @t[arg1]); delete(@t[arg1]); }'
+ */
+/*
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <fstream>
+#include <ros/ros.h>
+#include <mavconn/interface.h>
+
+using namespace mavconn;
+using steady_clock = std::chrono::steady_clock;
+
+//! one tlog record: 8-byte big-endian epoch microseconds + wire frame
+struct TlogRecord {
+	uint64_t stamp_usec;
+	size_t offset;	//!< frame start in the file image
+	size_t size;
+};
+
+static uint64_t be64(const uint8_t *p)
+{
+	uint64_t v = 0;
+	for (int i = 0; i < 8; i++)
+		v = (v << 8) | p[i];
+	return v;
+}
+
+/**
+ * Carve records out of the log image. Frame length comes from the
+ * magic + payload-length header; a record that does not parse aborts
+ * the scan — tlogs are append-only, so a bad record means truncation.
+ */
+static std::vector<TlogRecord> index_tlog(const std::vector<uint8_t> &image)
+{
+	std::vector<TlogRecord> records;
+	size_t pos = 0;
+
+	while (pos + 8 + 8 <= image.size()) {
+		uint64_t stamp = be64(image.data() + pos);
+		size_t frame = pos + 8;
+		size_t len;
+
+		const uint8_t magic = image[frame];
+		if (magic == MAVLINK_STX) {	// v2
+			len = 10 + image[frame + 1] + 2;
+			if (image[frame + 2] & MAVLINK_IFLAG_SIGNED)
+				len += MAVLINK_SIGNATURE_BLOCK_LEN;
+		}
+		else if (magic == MAVLINK_STX_MAVLINK1) {
+			len = 6 + image[frame + 1] + 2;
+		}
+		else {
+			ROS_WARN("Replay: bad frame magic 0x%02x at offset %zu, stopping scan", magic, pos);
+			break;
+		}
+
+		if (frame + len > image.size())
+			break;	// truncated tail record
+
+		records.push_back({stamp, frame, len});
+		pos = frame + len;
+	}
+
+	return records;
+}
+
+int main(int argc, char *argv[])
+{
+	ros::init(argc, argv, "tlog_replay");
+	ros::NodeHandle priv_nh("~");
+
+	std::string file;
+	std::string url;
+	double speed;
+
+	priv_nh.param<std::string>("file", file, "");
+	priv_nh.param<std::string>("url", url, "tcp://localhost:5760");
+	priv_nh.param("speed", speed, 1.0);	// 0: as fast as possible
+
+	if (file.empty()) {
+		ROS_FATAL("Replay: ~file is required");
+		return 1;
+	}
+
+	std::ifstream f(file, std::ios::binary);
+	if (!f) {
+		ROS_FATAL("Replay: can't open %s", file.c_str());
+		return 1;
+	}
+
+	std::vector<uint8_t> image((std::istreambuf_iterator<char>(f)),
+			std::istreambuf_iterator<char>());
+
+	auto records = index_tlog(image);
+	if (records.empty()) {
+		ROS_FATAL("Replay: no records in %s", file.c_str());
+		return 1;
+	}
+
+	double log_span = (records.back().stamp_usec - records.front().stamp_usec) / 1e6;
+	ROS_INFO("Replay: %zu records, %.1f s of flight, speed x%s",
+			records.size(), log_span,
+			speed > 0.0 ? std::to_string(speed).c_str() : "max");
+
+	MAVConnInterface::Ptr link;
+	try {
+		link = MAVConnInterface::open_url(url);
+	}
+	catch (DeviceError &e) {
+		ROS_FATAL("Replay: %s", e.what());
+		return 1;
+	}
+
+	size_t rx_count = 0;
+	link->message_received_cb = [&rx_count](const mavlink::mavlink_message_t *, const Framing framing) {
+				if (framing == Framing::ok)
+					rx_count++;	// FCU->GCS direction of the log, ignored
+			};
+
+	const auto t0 = steady_clock::now();
+	const uint64_t log_t0 = records.front().stamp_usec;
+	size_t sent_bytes = 0;
+	auto last_report = t0;
+	size_t last_count = 0, count = 0;
+
+	for (auto &rec : records) {
+		if (!ros::ok())
+			break;
+
+		if (speed > 0.0) {
+			auto due = t0 + std::chrono::microseconds(
+					uint64_t((rec.stamp_usec - log_t0) / speed));
+			std::this_thread::sleep_until(due);
+		}
+
+		// send_bytes blocks the tx queue, not the kernel: on a full
+		// queue it throws instead of silently losing the record
+		for (;;) {
+			try {
+				link->send_bytes(image.data() + rec.offset, rec.size);
+				break;
+			}
+			catch (std::length_error &e) {
+				// tx queue full: the link is the bottleneck,
+				// yield and retry — a replay must not drop
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		}
+
+		count++;
+		sent_bytes += rec.size;
+
+		auto now = steady_clock::now();
+		if (now - last_report >= std::chrono::seconds(5)) {
+			double dt = std::chrono::duration<double>(now - last_report).count();
+			ROS_INFO("Replay: %zu/%zu records, %.0f msg/s",
+					count, records.size(), (count - last_count) / dt);
+			last_report = now;
+			last_count = count;
+		}
+	}
+
+	double wall = std::chrono::duration<double>(steady_clock::now() - t0).count();
+	ROS_INFO("Replay: done, %zu records (%zu bytes) in %.1f s (x%.1f real time)",
+			count, sent_bytes, wall, wall > 0.0 ? log_span / wall : 0.0);
+
+	// let the tx queue drain before closing the link
+	std::this_thread::sleep_for(std::chrono::seconds(1));
+	return 0;
+}
@@ -27,6 +27,12 @@ static std::string fixed_frame_id;
 static std::string child_frame_id;
 static double marker_scale;
 static int max_track_size = 100;
+static double publish_rate;		//!< marker output rate, decoupled from pose rate
+static double update_threshold;		//!< min pose change worth republishing [m]
+
+static ros::Duration publish_period;
+static ros::Time last_track_pub;
+static ros::Time last_vehicle_pub;
 
 // merker publishers
 ros::Publisher track_marker_pub;
@@ -59,12 +65,27 @@ static void publish_track_marker(const geometry_msgs::PoseStamped::ConstPtr &pos
 	}
 
 	static int marker_idx = 0;
+	static geometry_msgs::Point last_point;
+	static bool has_last_point = false;
+
+	// delta update: extend the track only after real movement
+	double dx = pose->pose.position.x - last_point.x;
+	double dy = pose->pose.position.y - last_point.y;
+	double dz = pose->pose.position.z - last_point.z;
+	if (!has_last_point || dx * dx + dy * dy + dz * dz >= update_threshold * update_threshold) {
+		if ( track_marker->points.size() < max_track_size )
+			track_marker->points.push_back(pose->pose.position);
+		else track_marker->points[marker_idx] = pose->pose.position;
+
+		marker_idx = ++marker_idx % max_track_size;
+		last_point = pose->pose.position;
+		has_last_point = true;
+	}
 
-	if ( track_marker->points.size() < max_track_size )
-		track_marker->points.push_back(pose->pose.position);
-	else track_marker->points[marker_idx] = pose->pose.position;
-
-	marker_idx = ++marker_idx % max_track_size;
+	// decimate output: RViz does not need the input pose rate
+	if (pose->header.stamp - last_track_pub < publish_period)
+		return;
+	last_track_pub = pose->header.stamp;
 
 	track_marker->header = pose->header;
 	track_marker_pub.publish(track_marker);
@@ -73,6 +94,8 @@ static void publish_track_marker(const geometry_msgs::PoseStamped::ConstPtr &pos
 static void publish_wp_marker(const geometry_msgs::PoseStamped::ConstPtr &wp)
 {
 	static boost::shared_ptr<visualization_msgs::Marker> marker;
+	static geometry_msgs::Pose last_pose;
+	static bool has_last_pose = false;
 
 	if ( !marker )	// only instantiate marker once
 	{
@@ -93,6 +116,21 @@ static void publish_wp_marker(const geometry_msgs::PoseStamped::ConstPtr &wp)
 		marker->color.b = 0.0;
 	}
 
+	// the setpoint rarely moves: republish only real changes
+	double dx = wp->pose.position.x - last_pose.position.x;
+	double dy = wp->pose.position.y - last_pose.position.y;
+	double dz = wp->pose.position.z - last_pose.position.z;
+	if (has_last_pose &&
+			dx * dx + dy * dy + dz * dz < update_threshold * update_threshold &&
+			wp->pose.orientation.x == last_pose.orientation.x &&
+			wp->pose.orientation.y == last_pose.orientation.y &&
+			wp->pose.orientation.z == last_pose.orientation.z &&
+			wp->pose.orientation.w == last_pose.orientation.w)
+		return;
+
+	last_pose = wp->pose;
+	has_last_pose = true;
+
 	marker->pose = wp->pose;
 	wp_marker_pub.publish(marker);
 }
@@ -188,13 +226,21 @@ static void create_vehicle_markers( int num_rotors, float arm_len, float body_wi
 
 static void local_position_sub_cb(const geometry_msgs::PoseStamped::ConstPtr &pose)
 {
-	publish_track_marker(pose);
-	if (vehicle_marker) vehicle_marker_pub.publish(vehicle_marker);
+	if (track_marker_pub.getNumSubscribers() > 0)
+		publish_track_marker(pose);
+
+	// static geometry: a periodic refresh keeps late RViz sessions fed
+	if (vehicle_marker && vehicle_marker_pub.getNumSubscribers() > 0 &&
+			pose->header.stamp - last_vehicle_pub >= publish_period) {
+		last_vehicle_pub = pose->header.stamp;
+		vehicle_marker_pub.publish(vehicle_marker);
+	}
 }
 
 void setpoint_local_pos_sub_cb(const geometry_msgs::PoseStamped::ConstPtr &wp)
 {
-	publish_wp_marker(wp);
+	if (wp_marker_pub.getNumSubscribers() > 0)
+		publish_wp_marker(wp);
 }
 
 int main(int argc, char *argv[])
@@ -215,6 +261,11 @@ int main(int argc, char *argv[])
 	priv_nh.param("body_width", body_width, 0.15 );
 	priv_nh.param("body_height", body_height, 0.10 );
 	priv_nh.param("max_track_size", max_track_size, 1000 );
+	priv_nh.param("publish_rate", publish_rate, 10.0 );
+	priv_nh.param("update_threshold", update_threshold, 0.01 );
+
+	publish_period = (publish_rate > 0.0) ?
+		ros::Duration(1.0 / publish_rate) : ros::Duration(0, 0);
 
 	create_vehicle_markers( num_rotors, arm_len, body_width, body_height );
 
@@ -14,9 +14,12 @@
  * https://github.com/mavlink/mavros/tree/master/LICENSE.md
  */
 
+#include <mutex>
+#include <memory>
 #include <mavros/mavros_plugin.h>
 
 #include <mavros_msgs/ADSBVehicle.h>
+#include <mavros_msgs/ADSBVehicleArray.h>
 
 namespace mavros {
 namespace extra_plugins {
@@ -27,19 +30,39 @@ using mavlink::common::ADSB_ALTITUDE_TYPE;
  * @brief ADS-B Vehicle plugin
  *
  * Publish/subscribe Automatic dependent surveillance-broadcast data to/from a vehicle.
+ *
+ * Incoming reports land in a fixed-arena track table (open addressing
+ * over the ICAO address, updated in place, no per-update allocation);
+ * ~adsb/tracks periodically snapshots the whole table as one message
+ * and evicts stale tracks. The per-report ~adsb/vehicle topic stays.
  */
 class ADSBPlugin : public plugin::PluginBase {
 public:
 	ADSBPlugin() : PluginBase(),
-		adsb_nh("~adsb")
+		adsb_nh("~adsb"),
+		track_table(new Track[TRACK_TABLE_SIZE])
 	{ }
 
 	void initialize(UAS &uas_)
 	{
 		PluginBase::initialize(uas_);
 
+		double track_rate;
+		double track_timeout_d;
+
+		// snapshot rate of the track table; 0 disables ~adsb/tracks
+		adsb_nh.param("track_rate", track_rate, 1.0);
+		adsb_nh.param("track_timeout", track_timeout_d, 10.0);
+		track_timeout = ros::Duration(track_timeout_d);
+
 		adsb_pub = adsb_nh.advertise<mavros_msgs::ADSBVehicle>("vehicle", 10);
 		adsb_sub = adsb_nh.subscribe("send", 10, &ADSBPlugin::adsb_cb, this);
+
+		if (track_rate > 0.0) {
+			tracks_pub = adsb_nh.advertise<mavros_msgs::ADSBVehicleArray>("tracks", 10);
+			track_timer = adsb_nh.createTimer(ros::Duration(1.0 / track_rate),
+					&ADSBPlugin::track_timer_cb, this);
+		}
 	}
 
 	Subscriptions get_subscriptions()
@@ -53,11 +76,88 @@ private:
 	ros::NodeHandle adsb_nh;
 
 	ros::Publisher adsb_pub;
+	ros::Publisher tracks_pub;
 	ros::Subscriber adsb_sub;
+	ros::Timer track_timer;
+
+	//! one aircraft in the fixed track arena
+	struct Track {
+		uint32_t icao_p1 = 0;	//!< ICAO address + 1; 0 marks a free slot
+		ros::Time last_seen;
+		mavros_msgs::ADSBVehicle data;
+	};
+
+	//! power of two; 200+ aircraft keep the load factor comfortable
+	static constexpr size_t TRACK_TABLE_SIZE = 512;
+	static constexpr size_t MAX_PROBE = 16;
+
+	std::mutex track_mutex;
+	std::unique_ptr<Track[]> track_table;
+	ros::Duration track_timeout;
+
+	/**
+	 * Find or claim the table slot of an aircraft.
+	 *
+	 * Open addressing with linear probing; when the probe window is
+	 * exhausted the stalest entry in it is recycled. Call with
+	 * track_mutex held.
+	 */
+	Track &track_slot(uint32_t icao)
+	{
+		const uint32_t key = icao + 1;
+		const size_t home = (icao * 2654435761u) & (TRACK_TABLE_SIZE - 1);
+
+		Track *stalest = nullptr;
+		for (size_t probe = 0; probe < MAX_PROBE; probe++) {
+			auto &t = track_table[(home + probe) & (TRACK_TABLE_SIZE - 1)];
+
+			if (t.icao_p1 == key)
+				return t;
+			if (t.icao_p1 == 0) {
+				t.icao_p1 = key;
+				return t;
+			}
+			if (stalest == nullptr || t.last_seen < stalest->last_seen)
+				stalest = &t;
+		}
+
+		stalest->icao_p1 = key;
+		return stalest;
+	}
+
+	void track_timer_cb(const ros::TimerEvent &event)
+	{
+		auto now = ros::Time::now();
+		auto list_msg = boost::make_shared<mavros_msgs::ADSBVehicleArray>();
+		list_msg->header.stamp = now;
+
+		std::lock_guard<std::mutex> lock(track_mutex);
+		for (size_t i = 0; i < TRACK_TABLE_SIZE; i++) {
+			auto &t = track_table[i];
+
+			if (t.icao_p1 == 0)
+				continue;
+
+			if (now - t.last_seen > track_timeout) {
+				t.icao_p1 = 0;	// stale: evict
+				continue;
+			}
+
+			list_msg->vehicles.push_back(t.data);
+		}
+
+		tracks_pub.publish(list_msg);
+	}
 
 	void handle_adsb(const mavlink::mavlink_message_t *msg, mavlink::common::msg::ADSB_VEHICLE &adsb)
 	{
-		auto adsb_msg = boost::make_shared<mavros_msgs::ADSBVehicle>();
+		std::lock_guard<std::mutex> lock(track_mutex);
+
+		// the translation table below writes straight into the
+		// pooled track entry; strings (callsign) are stable per
+		// aircraft, so updates do not reallocate
+		Track &track = track_slot(adsb.ICAO_address);
+		mavros_msgs::ADSBVehicle *adsb_msg = &track.data;
 
 		adsb_msg->header.stamp = ros::Time::now();	//TODO: request add time_boot_ms to msg definition
 		// [[[cog:
@@ -108,7 +208,11 @@ private:
 				<< " emitter: " << utils::to_string_enum<ADSB_EMITTER_TYPE>(adsb.emitter_type)
 				<< " flags: 0x" << std::hex << adsb.flags);
 
-		adsb_pub.publish(adsb_msg);
+		track.last_seen = adsb_msg->header.stamp;
+
+		// per-report topic: copy out only when somebody listens
+		if (adsb_pub.getNumSubscribers() > 0)
+			adsb_pub.publish(boost::make_shared<mavros_msgs::ADSBVehicle>(track.data));
 	}
 
 	void adsb_cb(const mavros_msgs::ADSBVehicle::ConstPtr &req)
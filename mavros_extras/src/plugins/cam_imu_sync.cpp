@@ -14,9 +14,14 @@
  * https://github.com/mavlink/mavros/tree/master/LICENSE.md
  */
 
+#include <array>
+#include <algorithm>
 #include <mavros/mavros_plugin.h>
+#include <mavros/seqlock.h>
 
 #include <mavros_msgs/CamIMUStamp.h>
+#include <mavros_msgs/CamIMUStampArray.h>
+#include <mavros_msgs/CamIMUStampQuery.h>
 
 namespace mavros {
 namespace extra_plugins{
@@ -26,6 +31,13 @@ namespace extra_plugins{
  * This plugin publishes a timestamp for when a external camera system was
  * triggered by the FCU. Sequence ID from the message and the image sequence from
  * camera can be corellated to get the exact shutter trigger time.
+ *
+ * Besides the per-trigger topic it keeps a lock-free ring of recent
+ * (seq, stamp) pairs: the clock model is applied once on reception,
+ * and consumers look stamps up by sequence through the
+ * ~cam_imu_sync/stamp_query service or the latched
+ * ~cam_imu_sync/stamp_history array instead of each keeping its own
+ * mutex-guarded history.
  */
 class CamIMUSyncPlugin : public plugin::PluginBase {
 public:
@@ -37,7 +49,17 @@ public:
 	{
 		PluginBase::initialize(uas_);
 
+		double history_rate;
+
+		cam_imu_sync_nh.param("history_rate", history_rate, 1.0);
+
 		cam_imu_pub = cam_imu_sync_nh.advertise<mavros_msgs::CamIMUStamp>("cam_imu_stamp", 10);
+		history_pub = cam_imu_sync_nh.advertise<mavros_msgs::CamIMUStampArray>("stamp_history", 1, true);
+		query_srv = cam_imu_sync_nh.advertiseService("stamp_query", &CamIMUSyncPlugin::stamp_query_cb, this);
+
+		if (history_rate > 0.0)
+			history_timer = cam_imu_sync_nh.createTimer(ros::Duration(1.0 / history_rate),
+					&CamIMUSyncPlugin::history_timer_cb, this);
 	}
 
 	Subscriptions get_subscriptions()
@@ -51,14 +73,87 @@ private:
 	ros::NodeHandle cam_imu_sync_nh;
 
 	ros::Publisher cam_imu_pub;
+	ros::Publisher history_pub;
+	ros::ServiceServer query_srv;
+	ros::Timer history_timer;
+
+	//! one trigger in the history ring; POD for Seqlock
+	struct Entry {
+		int32_t seq;
+		bool valid;
+		uint64_t stamp_ns;
+	};
+
+	//! power of two; covers several seconds of trigger stream
+	static constexpr size_t RING_SIZE = 64;
+
+	/**
+	 * Sequence-indexed trigger history. Slot = seq % RING_SIZE, so
+	 * lookup is O(1); the single writer is the CAMERA_TRIGGER
+	 * handler lane, readers (service, timer) never block it.
+	 */
+	std::array<Seqlock<Entry>, RING_SIZE> ring;
+
+	bool lookup(int32_t seq, ros::Time &stamp)
+	{
+		auto e = ring[seq & (RING_SIZE - 1)].load();
+		if (!e.valid || e.seq != seq)
+			return false;
+
+		stamp.fromNSec(e.stamp_ns);
+		return true;
+	}
+
+	bool stamp_query_cb(mavros_msgs::CamIMUStampQuery::Request &req,
+			mavros_msgs::CamIMUStampQuery::Response &res)
+	{
+		res.success = lookup(req.frame_seq_id, res.frame_stamp);
+		return true;
+	}
+
+	void history_timer_cb(const ros::TimerEvent &event)
+	{
+		auto hist_msg = boost::make_shared<mavros_msgs::CamIMUStampArray>();
+		hist_msg->header.stamp = ros::Time::now();
+		hist_msg->stamps.reserve(RING_SIZE);
+
+		for (auto &slot : ring) {
+			auto e = slot.load();
+			if (!e.valid)
+				continue;
+
+			mavros_msgs::CamIMUStamp st;
+			st.frame_seq_id = e.seq;
+			st.frame_stamp.fromNSec(e.stamp_ns);
+			hist_msg->stamps.push_back(st);
+		}
+
+		if (hist_msg->stamps.empty())
+			return;
+
+		std::sort(hist_msg->stamps.begin(), hist_msg->stamps.end(),
+				[](const mavros_msgs::CamIMUStamp &a, const mavros_msgs::CamIMUStamp &b) {
+					return a.frame_seq_id < b.frame_seq_id;
+				});
+
+		history_pub.publish(hist_msg);
+	}
 
 	void handle_cam_trig(const mavlink::mavlink_message_t *msg, mavlink::common::msg::CAMERA_TRIGGER &ctrig)
 	{
 		auto sync_msg = boost::make_shared<mavros_msgs::CamIMUStamp>();
 
+		// the clock model (offset + skew) is applied exactly once,
+		// here; everything downstream reads the converted stamp
 		sync_msg->frame_stamp = m_uas->synchronise_stamp(ctrig.time_usec);
 		sync_msg->frame_seq_id = ctrig.seq;
 
+		Entry e;
+		e.seq = sync_msg->frame_seq_id;
+		e.valid = true;
+		e.stamp_ns = sync_msg->frame_stamp.toNSec();
+		ring[e.seq & (RING_SIZE - 1)].store(e);
+
 		cam_imu_pub.publish(sync_msg);
 	}
 };
@@ -13,12 +13,14 @@
  * in the top-level LICENSE file of the mavros repository.
  * https://github.com/mavlink/mavros/tree/master/LICENSE.md
  */
+#include <algorithm>
 #include <unordered_map>
 #include <mavros/utils.h>
 #include <mavros/mavros_plugin.h>
 #include <eigen_conversions/eigen_msg.h>
 
 #include <sensor_msgs/Range.h>
+#include <mavros_msgs/MultiRange.h>
 
 namespace mavros {
 namespace extra_plugins{
@@ -39,6 +41,7 @@ public:
 		field_of_view(0),
 		orientation(-1),
 		covariance(0),
+		tf_orientation(-1),
 		owner(nullptr),
 		data_index(0)
 	{ }
@@ -53,6 +56,12 @@ public:
 	int covariance;		//!< in centimeters, current specification
 	std::string frame_id;	//!< frame id for send
 
+	// per-sensor cache, resolved at configuration time so the
+	// handler does not redo it for every message of the ring
+	geometry_msgs::Quaternion tf_rotation;		//!< cached for tf_orientation
+	geometry_msgs::Vector3 tf_translation;		//!< position as message
+	int tf_orientation;	//!< orientation tf_rotation was resolved for
+
 	// topic handle
 	ros::Publisher pub;
 	ros::Subscriber sub;
@@ -111,7 +120,8 @@ private:
 class DistanceSensorPlugin : public plugin::PluginBase {
 public:
 	DistanceSensorPlugin() : PluginBase(),
-		dist_nh("~distance_sensor")
+		dist_nh("~distance_sensor"),
+		pub_sensor_count(0)
 	{ }
 
 	void initialize(UAS &uas_)
@@ -130,11 +140,19 @@ public:
 			ROS_DEBUG_NAMED("distance_sensor", "DS: initializing mapping for %s", pair.first.c_str());
 			auto it = DistanceSensorItem::create_item(this, pair.first);
 
-			if (it)
+			if (it) {
 				sensor_map[it->sensor_id] = it;
+				if (!it->is_subscriber)
+					pub_sensor_count++;
+			}
 			else
 				ROS_ERROR_NAMED("distance_sensor", "DS: bad config for %s", pair.first.c_str());
 		}
+
+		bool aggregate;
+		dist_nh.param("aggregate", aggregate, false);
+		if (aggregate && pub_sensor_count > 0)
+			batch_pub = dist_nh.advertise<mavros_msgs::MultiRange>("ranges", 10);
 	}
 
 	Subscriptions get_subscriptions()
@@ -148,9 +166,13 @@ private:
 	friend class DistanceSensorItem;
 
 	ros::NodeHandle dist_nh;
+	ros::Publisher batch_pub;
 
 	std::unordered_map<uint8_t, DistanceSensorItem::Ptr> sensor_map;
 
+	size_t pub_sensor_count;			//!< publisher (rx) sensors configured
+	mavros_msgs::MultiRange::Ptr batch_msg;	//!< scan cycle being collected
+
 	/* -*- low-level send -*- */
 	void distance_sensor(uint32_t time_boot_ms,
 			uint32_t min_distance,
@@ -243,23 +265,70 @@ private:
 		range->range = dist_sen.current_distance * 1E-2;	// in meters
 
 		if (sensor->send_tf) {
-			/* variables init */
-			auto q = utils::sensor_orientation_matching(static_cast<MAV_SENSOR_ORIENTATION>(dist_sen.orientation));
+			// normally resolved once at config; redone only if the
+			// FCU reports an unexpected orientation
+			if (sensor->tf_orientation != dist_sen.orientation) {
+				auto q = utils::sensor_orientation_matching(static_cast<MAV_SENSOR_ORIENTATION>(dist_sen.orientation));
+				tf::quaternionEigenToMsg(q, sensor->tf_rotation);
+				sensor->tf_orientation = dist_sen.orientation;
+			}
 
 			geometry_msgs::TransformStamped transform;
 
 			transform.header = m_uas->synchronized_header("fcu", dist_sen.time_boot_ms);
 			transform.child_frame_id = sensor->frame_id;
 
-			/* rotation and position set */
-			tf::quaternionEigenToMsg(q, transform.transform.rotation);
-			tf::vectorEigenToMsg(sensor->position, transform.transform.translation);
+			/* rotation and position from the per-sensor cache */
+			transform.transform.rotation = sensor->tf_rotation;
+			transform.transform.translation = sensor->tf_translation;
 
 			/* transform broadcast */
-			m_uas->tf2_broadcaster.sendTransform(transform);
+			m_uas->tf2_send_transform(transform);
 		}
 
 		sensor->pub.publish(range);
+
+		if (batch_pub)
+			batch_append(dist_sen.id, range->header.stamp, range->range);
+	}
+
+	/* -*- scan cycle aggregation -*- */
+
+	/**
+	 * Collect one scan cycle into a MultiRange message.
+	 *
+	 * Runs only on the DISTANCE_SENSOR handler lane, so no locking.
+	 * A cycle ends when a sensor id repeats or all configured
+	 * publisher sensors have reported.
+	 */
+	void batch_append(uint8_t id, const ros::Time &stamp, float range)
+	{
+		if (batch_msg &&
+				std::find(batch_msg->ids.begin(), batch_msg->ids.end(), id) != batch_msg->ids.end())
+			batch_publish();
+
+		if (!batch_msg) {
+			batch_msg = boost::make_shared<mavros_msgs::MultiRange>();
+			batch_msg->ids.reserve(pub_sensor_count);
+			batch_msg->ranges.reserve(pub_sensor_count);
+			batch_msg->stamps.reserve(pub_sensor_count);
+		}
+
+		batch_msg->ids.push_back(id);
+		batch_msg->ranges.push_back(range);
+		batch_msg->stamps.push_back(stamp);
+
+		if (batch_msg->ids.size() >= pub_sensor_count)
+			batch_publish();
+	}
+
+	void batch_publish()
+	{
+		batch_msg->header.stamp = batch_msg->stamps.back();
+		batch_msg->header.frame_id = "fcu";
+
+		batch_pub.publish(batch_msg);
+		batch_msg.reset();
 	}
 };
 
@@ -270,11 +339,16 @@ void DistanceSensorItem::range_cb(const sensor_msgs::Range::ConstPtr &msg)
 	uint8_t type = 0;
 	uint8_t covariance_ = 0;
 
-	if (covariance > 0) covariance_ = covariance;
-	else covariance_ = uint8_t(calculate_variance(msg->range) * 1E2);	// in cm
+	if (covariance > 0) {
+		covariance_ = covariance;	// configured: no estimation needed
+	}
+	else {
+		float variance_cm = calculate_variance(msg->range) * 1E2;	// in cm
 
-	/** @todo Propose changing covarince from uint8_t to float */
-	ROS_DEBUG_NAMED("distance_sensor", "DS: %d: sensor variance: %f", sensor_id, calculate_variance(msg->range) * 1E2);
+		/** @todo Propose changing covarince from uint8_t to float */
+		covariance_ = uint8_t(variance_cm);
+		ROS_DEBUG_NAMED("distance_sensor", "DS: %d: sensor variance: %f", sensor_id, variance_cm);
+	}
 
 	// current mapping, may change later
 	if (msg->radiation_type == sensor_msgs::Range::INFRARED)
@@ -351,6 +425,15 @@ DistanceSensorItem::Ptr DistanceSensorItem::create_item(DistanceSensorPlugin *ow
 			pnh.param("sensor_position/z", p->position.z(), 0.0);
 			ROS_DEBUG_NAMED("sensor_position", "DS: %s: Sensor position at: %f, %f, %f", topic_name.c_str(),
 					p->position.x(), p->position.y(), p->position.z());
+
+			// resolve the transform once here instead of per message
+			tf::vectorEigenToMsg(p->position, p->tf_translation);
+			if (p->orientation >= 0) {
+				auto q = utils::sensor_orientation_matching(
+						static_cast<mavlink::common::MAV_SENSOR_ORIENTATION>(p->orientation));
+				tf::quaternionEigenToMsg(q, p->tf_rotation);
+				p->tf_orientation = p->orientation;
+			}
 		}
 	}
 	else {
@@ -26,13 +26,28 @@ namespace extra_plugins {
  * @brief MocapFakeGPS plugin
  *
  * Sends fake GPS from motion capture data to FCU.
+ *
+ * The geodetic math runs as a linear local-tangent-plane
+ * approximation around a cached reference; the exact
+ * azimuthal-equidistant inverse is solved only when the vehicle
+ * leaves the trusted box around it. Inside a mocap volume that is
+ * exactly once.
  */
 
 class MocapFakeGPSPlugin : public plugin::PluginBase
 {
 public:
 	MocapFakeGPSPlugin() : PluginBase(),
-		mp_nh("~fake_gps")
+		mp_nh("~fake_gps"),
+		origin_lat(0.0),
+		origin_lon(0.0),
+		origin_alt(0.0),
+		linear_threshold(0.0),
+		ref_north(0.0),
+		ref_east(0.0),
+		ref_lat(0.0),
+		ref_lon(0.0),
+		ref_cos_lat(1.0)
 	{ }
 
 	void initialize(UAS &uas_)
@@ -40,6 +55,22 @@ public:
 		PluginBase::initialize(uas_);
 		last_pos_time = ros::Time(0.0);
 		gps_period = ros::Duration(0.2);	// 5hz
+
+		// mocap volume origin; defaults keep the old Zurich location
+		double lat_deg, lon_deg;
+		mp_nh.param("geo_origin/lat", lat_deg, 47.3667);
+		mp_nh.param("geo_origin/lon", lon_deg, 8.5500);
+		mp_nh.param("geo_origin/alt", origin_alt, 408.0);
+		// max distance from the linearization point [m]
+		mp_nh.param("linear_threshold", linear_threshold, 100.0);
+
+		origin_lat = lat_deg * M_PI / 180;
+		origin_lon = lon_deg * M_PI / 180;
+
+		ref_lat = origin_lat;
+		ref_lon = origin_lon;
+		ref_cos_lat = cos(ref_lat);
+
 		mocap_tf_d_sub = mp_nh.subscribe("fix", 1, &MocapFakeGPSPlugin::mocap_tf_d_cb, this);
 	}
 
@@ -61,6 +92,38 @@ private:
 	ros::Time last_pos_time;
 	ros::Duration gps_period;
 
+	static constexpr double EARTH_RADIUS = 6371000.0;	// [m]
+
+	double origin_lat;	//!< volume origin [rad]
+	double origin_lon;	//!< volume origin [rad]
+	double origin_alt;	//!< volume origin AMSL [m]
+	double linear_threshold;
+
+	// LTP linearization reference, exact LLA precomputed
+	double ref_north, ref_east;	//!< NED offset of the reference [m]
+	double ref_lat, ref_lon;	//!< exact LLA of the reference [rad]
+	double ref_cos_lat;
+
+	//! exact azimuthal-equidistant inverse from the volume origin
+	void exact_lla(double north, double east, double &lat_rad, double &lon_rad)
+	{
+		double n_rad = north / EARTH_RADIUS;
+		double e_rad = east / EARTH_RADIUS;
+		double c = sqrt(n_rad * n_rad + e_rad * e_rad);
+
+		if (c == 0.0) {
+			lat_rad = origin_lat;
+			lon_rad = origin_lon;
+			return;
+		}
+
+		double sin_c = sin(c);
+		double cos_c = cos(c);
+		lat_rad = asin(cos_c * sin(origin_lat) + (n_rad * sin_c * cos(origin_lat)) / c);
+		lon_rad = origin_lon + atan2(e_rad * sin_c,
+				c * cos(origin_lat) * cos_c - n_rad * sin(origin_lat) * sin_c);
+	}
+
 	void mocap_tf_d_cb(const geometry_msgs::TransformStamped::ConstPtr &trans)
 	{
 		// Throttle incoming messages to 5hz
@@ -69,10 +132,6 @@ private:
 		}
 		last_pos_time = ros::Time::now();
 
-		const double lat_zurich = 47.3667 * M_PI / 180;	// rad
-		const double lon_zurich = 8.5500 * M_PI / 180;	// rad
-		const float earth_radius = 6371000;		// m
-
 		Eigen::Quaterniond q_enu;
 
 		tf::quaternionMsgToEigen(trans->transform.rotation, q_enu);
@@ -86,25 +145,26 @@ private:
 		double north = position.x();	//[m]
 		double east = position.y();	//[m]
 		double down = position.z();	//[m]
-		double n_rad = north / earth_radius;
-		double e_rad = east / earth_radius;
-		double c = sqrt(n_rad * n_rad + e_rad * e_rad);
-		double sin_c = sin(c);
-		double cos_c = cos(c);
-		double lat_rad;
-		double lon_rad;
-		if (c != 0.0) {
-			lat_rad = asin(cos_c * sin(lat_zurich) + (n_rad * sin_c * cos(lat_zurich)) / c);
-			lon_rad = (lon_zurich + atan2(e_rad * sin_c, c * cos(lat_zurich) * cos_c - n_rad * sin(lat_zurich) * sin_c));
-		}
-		else {
-			lat_rad = lat_zurich;
-			lon_rad = lon_zurich;
+
+		// cheap linear step from the cached reference; recenter with
+		// the exact solve only when the trusted box is left
+		double dn = north - ref_north;
+		double de = east - ref_east;
+		if (sqrt(dn * dn + de * de) > linear_threshold) {
+			exact_lla(north, east, ref_lat, ref_lon);
+			ref_north = north;
+			ref_east = east;
+			ref_cos_lat = cos(ref_lat);
+			dn = 0.0;
+			de = 0.0;
 		}
 
-		double dn = north - old_north;	//[m]
-		double de = east - old_east;	//[m]
-		double dd = down - old_down;	//[m]
+		double lat_rad = ref_lat + dn / EARTH_RADIUS;
+		double lon_rad = ref_lon + de / (EARTH_RADIUS * ref_cos_lat);
+
+		double vel_dn = north - old_north;	//[m]
+		double vel_de = east - old_east;	//[m]
+		double vel_dd = down - old_down;	//[m]
 		double dt = trans->header.stamp.toSec() - old_stamp;	//[s]
 
 		//store old values
@@ -114,9 +174,9 @@ private:
 		old_stamp = trans->header.stamp.toSec();
 
 		//calculate velocities
-		double vn = 100 * dn / dt;	//[cm/s]
-		double ve = 100 * de / dt;	//[cm/s]
-		double vd = 100 * dd / dt;	//[cm/s]
+		double vn = 100 * vel_dn / dt;	//[cm/s]
+		double ve = 100 * vel_de / dt;	//[cm/s]
+		double vd = 100 * vel_dd / dt;	//[cm/s]
 
 		//calculate course over ground
 		double cog_rad;
@@ -136,7 +196,7 @@ private:
 		pos.time_usec = trans->header.stamp.toNSec() / 1000;
 		pos.lat = (lat_rad * 180 / M_PI) * 10000000;	// [degrees * 1E7]
 		pos.lon = (lon_rad * 180 / M_PI) * 10000000;	// [degrees * 1E7]
-		pos.alt = (408 - down) * 1000;			// [m * 1000] AMSL
+		pos.alt = (origin_alt - down) * 1000;		// [m * 1000] AMSL
 		pos.vel = sqrt(vn * vn + ve * ve);		// [cm/s]
 		pos.vn = vn;					// [cm/s]
 		pos.ve = ve;					// [cm/s]
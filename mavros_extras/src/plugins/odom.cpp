@@ -28,6 +28,11 @@ using mavlink::common::MAV_ESTIMATOR_TYPE;
  *
  * Send odometry info
  * to FCU position and attitude estimators
+ *
+ * With ~odometry/sensor_frame_id set the input may be expressed for a
+ * sensor frame (e.g. the VIO camera); the static sensor-to-vehicle
+ * transform is then taken from UAS::get_static_transform(), which
+ * resolves the TF pair once instead of walking the tree per message.
  */
 class OdometryPlugin : public plugin::PluginBase {
 public:
@@ -47,6 +52,10 @@ public:
 
 		ROS_DEBUG_STREAM_NAMED("odom", "Odometry: estimator type: " << utils::to_string(estimator_type));
 
+		// frame of the incoming odometry; empty means vehicle frame
+		odom_nh.param<std::string>("sensor_frame_id", sensor_frame_id, "");
+		odom_nh.param<std::string>("base_frame_id", base_frame_id, "fcu");
+
 		// subscribers
 		odom_sub = odom_nh.subscribe("odom", 10, &OdometryPlugin::odom_cb, this);
 	}
@@ -62,6 +71,9 @@ private:
 
 	MAV_ESTIMATOR_TYPE estimator_type;
 
+	std::string sensor_frame_id;
+	std::string base_frame_id;
+
 	/* -*- callbacks -*- */
 
 	void odom_cb(const nav_msgs::Odometry::ConstPtr &odom)
@@ -74,6 +86,22 @@ private:
 		tf::vectorMsgToEigen(odom->twist.twist.linear, lin_vel_enu);
 		tf::vectorMsgToEigen(odom->twist.twist.angular, ang_vel_enu);
 
+		// sensor-frame input: remap to the vehicle frame through the
+		// cached static transform before the ENU->NED math below
+		if (!sensor_frame_id.empty()) {
+			Eigen::Affine3d sensor_tf;
+			if (!m_uas->get_static_transform(base_frame_id, sensor_frame_id, sensor_tf)) {
+				ROS_WARN_THROTTLE_NAMED(10, "odom", "Odometry: static transform %s -> %s not available yet",
+						sensor_frame_id.c_str(), base_frame_id.c_str());
+				return;
+			}
+
+			// pose: T_world_base = T_world_sensor * T_base_sensor^-1
+			tr = tr * sensor_tf.inverse();
+			// velocity of the vehicle origin: drop the lever-arm term
+			lin_vel_enu -= ang_vel_enu.cross(tr.rotation() * sensor_tf.translation());
+		}
+
 		// get current ENU FCU orientation
 		Eigen::Quaterniond enu_orientation;
 		tf::quaternionMsgToEigen(m_uas->get_attitude_orientation(), enu_orientation);
@@ -110,9 +138,11 @@ private:
 		auto cov_full_tf = ftf::transform_frame_enu_ned(cov_full);
 
 		ftf::EigenMapConstCovariance9d cov_tf_map(cov_full_tf.data());
-		auto urt_view = Eigen::Matrix<double, 9, 9>(cov_full_map.triangularView<Eigen::Upper>());
 		ROS_DEBUG_STREAM_NAMED("odom", "Odometry: pose+accel covariance matrix: " << std::endl << cov_tf_map);
-		ROS_DEBUG_STREAM_NAMED("odom", "Odometry: Cov URT: " << std::endl << urt_view);
+		// the URT copy is debug-only: keep it inside the macro so the
+		// 9x9 materialization is skipped when the logger is off
+		ROS_DEBUG_STREAM_NAMED("odom", "Odometry: Cov URT: " << std::endl
+				<< Eigen::Matrix<double, 9, 9>(cov_full_map.triangularView<Eigen::Upper>()));
 
 		/**
 		 * @brief Velocity 6-D Covariance matrix
@@ -16,6 +16,7 @@
  * https://github.com/mavlink/mavros/tree/master/LICENSE.md
  */
 
+#include <algorithm>
 #include <mavros/mavros_plugin.h>
 
 #include <mavros_msgs/OpticalFlowRad.h>
@@ -28,6 +29,12 @@ namespace extra_plugins{
  * @brief PX4 Optical Flow plugin
  *
  * This plugin can publish data from PX4Flow camera to ROS
+ *
+ * For high-rate multi-sensor rigs an optional accumulation mode
+ * integrates flow over ~px4flow/window_time and publishes the summed
+ * displacement as one message on ~px4flow/raw/optical_flow_rad_window:
+ * fewer, richer samples for the estimator. The raw per-message topics
+ * are subscriber-gated, so unused conversions are skipped entirely.
  */
 class PX4FlowPlugin : public plugin::PluginBase {
 public:
@@ -35,7 +42,8 @@ public:
 		flow_nh("~px4flow"),
 		ranger_fov(0.0),
 		ranger_min_range(0.3),
-		ranger_max_range(5.0)
+		ranger_max_range(5.0),
+		window_time(0.0)
 	{ }
 
 	void initialize(UAS &uas_)
@@ -49,9 +57,21 @@ public:
 		flow_nh.param("ranger_min_range", ranger_min_range, 0.3);
 		flow_nh.param("ranger_max_range", ranger_max_range, 5.0);
 
+		// accumulation window; 0 disables the integrated topic
+		flow_nh.param("window_time", window_time, 0.0);
+
+		// the aircraft -> baselink rotation is static: resolve it
+		// once instead of routing every vector through ftf
+		rot_ab.col(0) = ftf::transform_frame_aircraft_baselink(Eigen::Vector3d::UnitX());
+		rot_ab.col(1) = ftf::transform_frame_aircraft_baselink(Eigen::Vector3d::UnitY());
+		rot_ab.col(2) = ftf::transform_frame_aircraft_baselink(Eigen::Vector3d::UnitZ());
+
 		flow_rad_pub = flow_nh.advertise<mavros_msgs::OpticalFlowRad>("raw/optical_flow_rad", 10);
 		range_pub = flow_nh.advertise<sensor_msgs::Range>("ground_distance", 10);
 		temp_pub = flow_nh.advertise<sensor_msgs::Temperature>("temperature", 10);
+
+		if (window_time > 0.0)
+			flow_window_pub = flow_nh.advertise<mavros_msgs::OpticalFlowRad>("raw/optical_flow_rad_window", 10);
 	}
 
 	Subscriptions get_subscriptions()
@@ -70,10 +90,57 @@ private:
 	double ranger_min_range;
 	double ranger_max_range;
 
+	double window_time;	//!< accumulation window [s]
+
+	Eigen::Matrix3d rot_ab;	//!< cached aircraft -> baselink rotation
+
 	ros::Publisher flow_rad_pub;
+	ros::Publisher flow_window_pub;
 	ros::Publisher range_pub;
 	ros::Publisher temp_pub;
 
+	//! accumulator state; touched only on the OPTICAL_FLOW_RAD lane
+	mavros_msgs::OpticalFlowRad window_acc;
+	ros::Time window_start;
+
+	/**
+	 * Fold one converted sample into the accumulation window; flow
+	 * and gyro integrals add, quality composes as the weakest sample.
+	 * Runs only on the OPTICAL_FLOW_RAD lane, so no locking needed.
+	 */
+	void window_append(const std_msgs::Header &header,
+			const Eigen::Vector3d &int_xy, const Eigen::Vector3d &int_gyro,
+			const mavlink::common::msg::OPTICAL_FLOW_RAD &flow_rad)
+	{
+		if (window_start.isZero()) {
+			window_acc = mavros_msgs::OpticalFlowRad();
+			window_acc.quality = 255;
+			window_start = header.stamp;
+		}
+
+		window_acc.integration_time_us += flow_rad.integration_time_us;
+		window_acc.integrated_x += int_xy.x();
+		window_acc.integrated_y += int_xy.y();
+		window_acc.integrated_xgyro += int_gyro.x();
+		window_acc.integrated_ygyro += int_gyro.y();
+		window_acc.integrated_zgyro += int_gyro.z();
+		window_acc.quality = std::min<uint8_t>(window_acc.quality, flow_rad.quality);
+
+		// latest-sample fields
+		window_acc.temperature = flow_rad.temperature / 100.0f;
+		window_acc.time_delta_distance_us = flow_rad.time_delta_distance_us;
+		window_acc.distance = flow_rad.distance;
+
+		if ((header.stamp - window_start).toSec() < window_time)
+			return;
+
+		auto window_msg = boost::make_shared<mavros_msgs::OpticalFlowRad>(window_acc);
+		window_msg->header = header;	// stamp of the closing sample
+
+		flow_window_pub.publish(window_msg);
+		window_start = ros::Time();
+	}
+
 	void handle_optical_flow_rad(const mavlink::mavlink_message_t *msg, mavlink::common::msg::OPTICAL_FLOW_RAD &flow_rad)
 	{
 		auto header = m_uas->synchronized_header(frame_id, flow_rad.time_usec);
@@ -84,43 +151,50 @@ private:
 		 * The optical flow camera is essentially an angular sensor, so conversion is like
 		 * gyroscope. (aircraft -> baselink)
 		 */
-		auto int_xy = ftf::transform_frame_aircraft_baselink(
+		Eigen::Vector3d int_xy = rot_ab *
 				Eigen::Vector3d(
 					flow_rad.integrated_x,
 					flow_rad.integrated_y,
-					0.0));
-		auto int_gyro = ftf::transform_frame_aircraft_baselink(
+					0.0);
+		Eigen::Vector3d int_gyro = rot_ab *
 				Eigen::Vector3d(
 					flow_rad.integrated_xgyro,
 					flow_rad.integrated_ygyro,
-					flow_rad.integrated_zgyro));
+					flow_rad.integrated_zgyro);
+
+		if (flow_rad_pub.getNumSubscribers() > 0) {
+			auto flow_rad_msg = boost::make_shared<mavros_msgs::OpticalFlowRad>();
 
-		auto flow_rad_msg = boost::make_shared<mavros_msgs::OpticalFlowRad>();
+			flow_rad_msg->header = header;
+			flow_rad_msg->integration_time_us = flow_rad.integration_time_us;
 
-		flow_rad_msg->header = header;
-		flow_rad_msg->integration_time_us = flow_rad.integration_time_us;
+			flow_rad_msg->integrated_x = int_xy.x();
+			flow_rad_msg->integrated_y = int_xy.y();
 
-		flow_rad_msg->integrated_x = int_xy.x();
-		flow_rad_msg->integrated_y = int_xy.y();
+			flow_rad_msg->integrated_xgyro = int_gyro.x();
+			flow_rad_msg->integrated_ygyro = int_gyro.y();
+			flow_rad_msg->integrated_zgyro = int_gyro.z();
 
-		flow_rad_msg->integrated_xgyro = int_gyro.x();
-		flow_rad_msg->integrated_ygyro = int_gyro.y();
-		flow_rad_msg->integrated_zgyro = int_gyro.z();
+			flow_rad_msg->temperature = flow_rad.temperature / 100.0f;	// in degrees celsius
+			flow_rad_msg->time_delta_distance_us = flow_rad.time_delta_distance_us;
+			flow_rad_msg->distance = flow_rad.distance;
+			flow_rad_msg->quality = flow_rad.quality;
 
-		flow_rad_msg->temperature = flow_rad.temperature / 100.0f;	// in degrees celsius
-		flow_rad_msg->time_delta_distance_us = flow_rad.time_delta_distance_us;
-		flow_rad_msg->distance = flow_rad.distance;
-		flow_rad_msg->quality = flow_rad.quality;
+			flow_rad_pub.publish(flow_rad_msg);
+		}
 
-		flow_rad_pub.publish(flow_rad_msg);
+		if (window_time > 0.0)
+			window_append(header, int_xy, int_gyro, flow_rad);
 
 		// Temperature
-		auto temp_msg = boost::make_shared<sensor_msgs::Temperature>();
+		if (temp_pub.getNumSubscribers() > 0) {
+			auto temp_msg = boost::make_shared<sensor_msgs::Temperature>();
 
-		temp_msg->header = header;
-		temp_msg->temperature = flow_rad_msg->temperature;
+			temp_msg->header = header;
+			temp_msg->temperature = flow_rad.temperature / 100.0f;
 
-		temp_pub.publish(temp_msg);
+			temp_pub.publish(temp_msg);
+		}
 
 		// Rangefinder
 		/**
@@ -131,17 +205,19 @@ private:
 		 * @todo: suggest modification on MAVLink OPTICAL_FLOW_RAD msg
 		 * which removes sonar data fields from it
 		 */
-		auto range_msg = boost::make_shared<sensor_msgs::Range>();
+		if (range_pub.getNumSubscribers() > 0) {
+			auto range_msg = boost::make_shared<sensor_msgs::Range>();
 
-		range_msg->header = header;
+			range_msg->header = header;
 
-		range_msg->radiation_type = sensor_msgs::Range::ULTRASOUND;
-		range_msg->field_of_view = ranger_fov;
-		range_msg->min_range = ranger_min_range;
-		range_msg->max_range = ranger_max_range;
-		range_msg->range = flow_rad.distance;
+			range_msg->radiation_type = sensor_msgs::Range::ULTRASOUND;
+			range_msg->field_of_view = ranger_fov;
+			range_msg->min_range = ranger_min_range;
+			range_msg->max_range = ranger_max_range;
+			range_msg->range = flow_rad.distance;
 
-		range_pub.publish(range_msg);
+			range_pub.publish(range_msg);
+		}
 	}
 };
 }	// namespace extra_plugins
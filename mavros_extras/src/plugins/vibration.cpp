@@ -14,10 +14,15 @@
  * https://github.com/mavlink/mavros/tree/master/LICENSE.md
  */
 
+#include <cmath>
+#include <mutex>
+#include <algorithm>
+#include <vector>
 #include <mavros/mavros_plugin.h>
 #include <eigen_conversions/eigen_msg.h>
 
 #include <mavros_msgs/Vibration.h>
+#include <mavros_msgs/VibrationSpectrum.h>
 
 namespace mavros {
 namespace extra_plugins {
@@ -25,26 +30,75 @@ namespace extra_plugins {
  * @brief Vibration plugin
  *
  * This plugin is intended to publish MAV vibration levels and accelerometer clipping from FCU.
+ *
+ * With ~vibration/spectrum_rate set it additionally buffers raw
+ * HIGHRES_IMU accelerometer samples and publishes per-axis band
+ * energies of a Hann-windowed FFT on ~vibration/spectrum, so spectral
+ * content is available without shipping the raw IMU stream down the
+ * telemetry link.
  */
 class VibrationPlugin : public plugin::PluginBase {
 public:
 	VibrationPlugin() : PluginBase(),
-		vibe_nh("~vibration")
+		vibe_nh("~vibration"),
+		fft_size(256),
+		band_count(16),
+		ring_head(0),
+		ring_fill(0),
+		sample_rate(0.0),
+		last_sample_usec(0)
 	{ }
 
 	void initialize(UAS &uas_)
 	{
 		PluginBase::initialize(uas_);
 
+		double spectrum_rate;
+		int fft_size_;
+
 		vibe_nh.param<std::string>("frame_id", frame_id, "vibration");
 
+		// spectral analysis; 0 keeps only the raw VIBRATION relay
+		vibe_nh.param("spectrum_rate", spectrum_rate, 0.0);
+		vibe_nh.param("fft_size", fft_size_, 256);
+		vibe_nh.param("bands", band_count, 16);
+
 		vibration_pub = vibe_nh.advertise<mavros_msgs::Vibration>("raw/vibration", 10);
+
+		if (spectrum_rate > 0.0) {
+			fft_size = fft_size_;
+			if (fft_size & (fft_size - 1)) {
+				ROS_ERROR_NAMED("vibration", "VIBE: fft_size must be a power of two, using 256");
+				fft_size = 256;
+			}
+
+			for (auto &r : ring)
+				r.resize(fft_size);
+			for (auto &st : stage)
+				st.resize(fft_size);
+
+			// Hann window: the ring is analyzed mid-stream, so
+			// rectangular leakage would smear the rotor lines
+			window.resize(fft_size);
+			for (size_t i = 0; i < fft_size; i++)
+				window[i] = 0.5 - 0.5 * std::cos(2.0 * M_PI * i / fft_size);
+
+			re.resize(fft_size);
+			im.resize(fft_size);
+			tw_re.resize(fft_size / 2);
+			tw_im.resize(fft_size / 2);
+
+			spectrum_pub = vibe_nh.advertise<mavros_msgs::VibrationSpectrum>("spectrum", 10);
+			spectrum_timer = vibe_nh.createTimer(ros::Duration(1.0 / spectrum_rate),
+					&VibrationPlugin::spectrum_timer_cb, this);
+		}
 	}
 
 	Subscriptions get_subscriptions()
 	{
 		return {
-			       make_handler(&VibrationPlugin::handle_vibration)
+			       make_handler(&VibrationPlugin::handle_vibration),
+			       make_handler(&VibrationPlugin::handle_highres_imu)
 		};
 	}
 
@@ -54,6 +108,142 @@ private:
 	std::string frame_id;
 
 	ros::Publisher vibration_pub;
+	ros::Publisher spectrum_pub;
+	ros::Timer spectrum_timer;
+
+	size_t fft_size;
+	int band_count;
+
+	//! per-axis accelerometer sample rings, fed by HIGHRES_IMU
+	std::mutex ring_mutex;
+	std::vector<float> ring[3];
+	size_t ring_head;
+	size_t ring_fill;
+	double sample_rate;	//!< EWMA of the IMU stream rate [Hz]
+	uint64_t last_sample_usec;
+
+	std::vector<float> stage[3];	//!< windowed snapshot of the rings
+	std::vector<float> window;	//!< precomputed Hann window
+	std::vector<float> re, im;	//!< FFT work buffers
+	std::vector<float> tw_re, tw_im;	//!< per-stage twiddle factors
+
+	/**
+	 * In-place iterative radix-2 FFT over split re/im arrays.
+	 *
+	 * The planar layout keeps the butterfly inner loop a pair of
+	 * contiguous float streams the compiler can auto-vectorize,
+	 * which is what makes the per-axis transform affordable on a
+	 * Pi-class companion; explicit intrinsics are not worth the
+	 * portability cost.
+	 */
+	void fft(float *re_, float *im_, size_t n)
+	{
+		// bit-reversal permutation
+		for (size_t i = 1, j = 0; i < n; i++) {
+			size_t bit = n >> 1;
+			for (; j & bit; bit >>= 1)
+				j ^= bit;
+			j ^= bit;
+			if (i < j) {
+				std::swap(re_[i], re_[j]);
+				std::swap(im_[i], im_[j]);
+			}
+		}
+
+		for (size_t len = 2; len <= n; len <<= 1) {
+			const size_t half = len / 2;
+			const double ang = -2.0 * M_PI / len;
+			for (size_t i = 0; i < half; i++) {
+				tw_re[i] = std::cos(ang * i);
+				tw_im[i] = std::sin(ang * i);
+			}
+
+			for (size_t base = 0; base < n; base += len) {
+				float *ar = re_ + base, *ai = im_ + base;
+				float *br = ar + half, *bi = ai + half;
+				for (size_t i = 0; i < half; i++) {
+					float xr = br[i] * tw_re[i] - bi[i] * tw_im[i];
+					float xi = br[i] * tw_im[i] + bi[i] * tw_re[i];
+					br[i] = ar[i] - xr;
+					bi[i] = ai[i] - xi;
+					ar[i] += xr;
+					ai[i] += xi;
+				}
+			}
+		}
+	}
+
+	void spectrum_timer_cb(const ros::TimerEvent &event)
+	{
+		auto sp_msg = boost::make_shared<mavros_msgs::VibrationSpectrum>();
+
+		{
+			std::lock_guard<std::mutex> lock(ring_mutex);
+
+			if (ring_fill < fft_size || sample_rate <= 0.0)
+				return;
+
+			sp_msg->sample_rate = sample_rate;
+
+			// one snapshot for all axes: linearize oldest-first
+			// and window in the same pass
+			for (size_t axis = 0; axis < 3; axis++)
+				for (size_t i = 0; i < fft_size; i++)
+					stage[axis][i] = ring[axis][(ring_head + i) % fft_size] * window[i];
+		}
+
+		sp_msg->header.stamp = ros::Time::now();
+		sp_msg->header.frame_id = frame_id;
+		sp_msg->bandwidth = sp_msg->sample_rate / 2 / band_count;
+		sp_msg->energy_x.resize(band_count);
+		sp_msg->energy_y.resize(band_count);
+		sp_msg->energy_z.resize(band_count);
+
+		float *energy[3] = {
+			sp_msg->energy_x.data(),
+			sp_msg->energy_y.data(),
+			sp_msg->energy_z.data()
+		};
+
+		// bins 1..n/2 folded into band_count equal-width bands;
+		// bin 0 (DC, gravity) is dropped
+		const size_t bins = fft_size / 2;
+		for (size_t axis = 0; axis < 3; axis++) {
+			std::copy(stage[axis].begin(), stage[axis].end(), re.begin());
+			std::fill(im.begin(), im.end(), 0.0f);
+
+			fft(re.data(), im.data(), fft_size);
+
+			for (size_t k = 1; k < bins; k++) {
+				size_t band = k * band_count / bins;
+				energy[axis][band] += re[k] * re[k] + im[k] * im[k];
+			}
+		}
+
+		spectrum_pub.publish(sp_msg);
+	}
+
+	void handle_highres_imu(const mavlink::mavlink_message_t *msg, mavlink::common::msg::HIGHRES_IMU &imu_hr)
+	{
+		if (!spectrum_pub)
+			return;
+
+		std::lock_guard<std::mutex> lock(ring_mutex);
+
+		if (last_sample_usec != 0 && imu_hr.time_usec > last_sample_usec) {
+			double rate = 1e6 / (imu_hr.time_usec - last_sample_usec);
+			sample_rate = (sample_rate > 0.0) ?
+				0.95 * sample_rate + 0.05 * rate : rate;
+		}
+		last_sample_usec = imu_hr.time_usec;
+
+		ring[0][ring_head] = imu_hr.xacc;
+		ring[1][ring_head] = imu_hr.yacc;
+		ring[2][ring_head] = imu_hr.zacc;
+		ring_head = (ring_head + 1) % fft_size;
+		if (ring_fill < fft_size)
+			ring_fill++;
+	}
 
 	void handle_vibration(const mavlink::mavlink_message_t *msg, mavlink::common::msg::VIBRATION &vibration)
 	{
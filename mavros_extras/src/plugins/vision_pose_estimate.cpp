@@ -15,6 +15,7 @@
  * https://github.com/mavlink/mavros/tree/master/LICENSE.md
  */
 
+#include <mutex>
 #include <mavros/mavros_plugin.h>
 #include <mavros/setpoint_mixin.h>
 #include <eigen_conversions/eigen_msg.h>
@@ -30,13 +31,22 @@ namespace extra_plugins{
  * Send pose estimation from various vision estimators
  * to FCU position and attitude estimators.
  *
+ * With ~vision_pose/fcu_rate set the delivery is rate-governed: a
+ * one-slot jitter buffer keeps the freshest sample and a timer drains
+ * it at the configured FCU-facing rate, so bursty estimator output
+ * neither aliases against the EKF fusion rate nor overruns the link.
+ * Samples keep their own measurement stamp when sent.
  */
 class VisionPoseEstimatePlugin : public plugin::PluginBase,
 	private plugin::TF2ListenerMixin<VisionPoseEstimatePlugin> {
 public:
 	VisionPoseEstimatePlugin() : PluginBase(),
 		sp_nh("~vision_pose"),
-		tf_rate(10.0)
+		tf_rate(10.0),
+		fcu_rate(0.0),
+		slot_pending(false),
+		superseded_count(0),
+		sent_count(0)
 	{ }
 
 	void initialize(UAS &uas_)
@@ -51,6 +61,12 @@ public:
 		sp_nh.param<std::string>("tf/child_frame_id", tf_child_frame_id, "vision");
 		sp_nh.param("tf/rate_limit", tf_rate, 50.0);
 
+		// FCU-facing delivery rate; 0 forwards every sample directly
+		sp_nh.param("fcu_rate", fcu_rate, 0.0);
+		if (fcu_rate > 0.0)
+			send_timer = sp_nh.createTimer(ros::Duration(1.0 / fcu_rate),
+					&VisionPoseEstimatePlugin::send_timer_cb, this);
+
 		if (tf_listen) {
 			ROS_INFO_STREAM_NAMED("vision_pose", "Listen to vision transform " << tf_frame_id
 						<< " -> " << tf_child_frame_id);
@@ -79,6 +95,17 @@ private:
 	double tf_rate;
 	ros::Time last_transform_stamp;
 
+	double fcu_rate;
+	ros::Timer send_timer;
+
+	//! one-slot jitter buffer, freshest sample wins
+	std::mutex slot_mutex;
+	geometry_msgs::Pose slot_pose;
+	ros::Time slot_stamp;
+	bool slot_pending;
+	size_t superseded_count;	//!< samples dropped by resampling
+	size_t sent_count;
+
 	/* -*- low-level send -*- */
 
 	void vision_position_estimate(uint64_t usec,
@@ -131,12 +158,67 @@ private:
 		vision_position_estimate(stamp.toNSec() / 1000, position, rpy);
 	}
 
+	//! store the freshest sample for the next delivery slot
+	void stash(const ros::Time &stamp, const geometry_msgs::Pose &pose)
+	{
+		std::lock_guard<std::mutex> lock(slot_mutex);
+
+		if (slot_pending) {
+			superseded_count++;
+			ROS_DEBUG_THROTTLE_NAMED(10, "vision_pose",
+					"Vision: %zu samples decimated, %zu sent",
+					superseded_count, sent_count);
+		}
+
+		slot_pose = pose;
+		slot_stamp = stamp;
+		slot_pending = true;
+	}
+
 	/* -*- callbacks -*- */
 
 	/* common TF listener moved to mixin */
 
+	void send_timer_cb(const ros::TimerEvent &event)
+	{
+		geometry_msgs::Pose pose;
+		ros::Time stamp;
+
+		{
+			std::lock_guard<std::mutex> lock(slot_mutex);
+			if (!slot_pending)
+				return;
+
+			pose = slot_pose;
+			stamp = slot_stamp;
+			slot_pending = false;
+			sent_count++;
+		}
+
+		ROS_DEBUG_THROTTLE_NAMED(10, "vision_pose", "Vision: jitter buffer delay %.1f ms",
+				(ros::Time::now() - stamp).toSec() * 1e3);
+
+		Eigen::Affine3d tr;
+		tf::poseMsgToEigen(pose, tr);
+
+		// the sample keeps its measurement stamp: the EKF needs the
+		// capture time, not the delivery time
+		send_vision_estimate(stamp, tr);
+	}
+
 	void transform_cb(const geometry_msgs::TransformStamped &transform)
 	{
+		if (fcu_rate > 0.0) {
+			geometry_msgs::Pose pose;
+			pose.position.x = transform.transform.translation.x;
+			pose.position.y = transform.transform.translation.y;
+			pose.position.z = transform.transform.translation.z;
+			pose.orientation = transform.transform.rotation;
+
+			stash(transform.header.stamp, pose);
+			return;
+		}
+
 		Eigen::Affine3d tr;
 		tf::transformMsgToEigen(transform.transform, tr);
 
@@ -145,6 +227,11 @@ private:
 
 	void vision_cb(const geometry_msgs::PoseStamped::ConstPtr &req)
 	{
+		if (fcu_rate > 0.0) {
+			stash(req->header.stamp, req->pose);
+			return;
+		}
+
 		Eigen::Affine3d tr;
 		tf::poseMsgToEigen(req->pose, tr);
 
@@ -153,6 +240,11 @@ private:
 
 	void vision_cov_cb(const geometry_msgs::PoseWithCovarianceStamped::ConstPtr &req)
 	{
+		if (fcu_rate > 0.0) {
+			stash(req->header.stamp, req->pose.pose);
+			return;
+		}
+
 		Eigen::Affine3d tr;
 		tf::poseMsgToEigen(req->pose.pose, tr);
 
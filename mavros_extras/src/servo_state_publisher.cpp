@@ -158,6 +158,16 @@ public:
 			ROS_INFO("SSP: joint '%s' (RC%d) loaded", pair.first.c_str(), rc_channel);
 		}
 
+		// preallocate the message: joint names are fixed after the
+		// URDF parse, only positions change per RCOut
+		states_msg = boost::make_shared<sensor_msgs::JointState>();
+		states_msg->name.reserve(servos.size());
+		states_msg->position.reserve(servos.size());
+		for (auto &desc : servos) {
+			states_msg->name.push_back(desc.joint_name);
+			states_msg->position.push_back(desc.calculate_position(desc.rc_trim));
+		}
+
 		rc_out_sub = nh.subscribe("rc_out", 10, &ServoStatePublisher::rc_out_cb, this);
 		joint_states_pub = nh.advertise<sensor_msgs::JointState>("joint_states", 10);
 	}
@@ -178,27 +188,38 @@ private:
 	ros::Publisher joint_states_pub;
 
 	std::list<ServoDescription> servos;
+	sensor_msgs::JointState::Ptr states_msg;	//!< recycled between publishes
 
 	void rc_out_cb(const mavros_msgs::RCOut::ConstPtr &msg) {
 		if (msg->channels.empty())
 			return;		// nothing to do
 
-		auto states = boost::make_shared<sensor_msgs::JointState>();
-		states->header.stamp = msg->header.stamp;
+		// nobody listens: skip the whole conversion
+		if (joint_states_pub.getNumSubscribers() == 0)
+			return;
 
+		// reuse the last message when no subscriber still holds it;
+		// else continue on a copy so held positions stay intact
+		if (!states_msg.unique())
+			states_msg = boost::make_shared<sensor_msgs::JointState>(*states_msg);
+
+		states_msg->header.stamp = msg->header.stamp;
+
+		size_t idx = 0;
 		for (auto &desc : servos) {
+			auto &position = states_msg->position[idx++];
+
 			if (!(desc.rc_channel != 0 && desc.rc_channel <= msg->channels.size()))
-				continue;	// prevent crash on servos not in that message
+				continue;	// channel not in that message: hold position
 
 			uint16_t pwm = msg->channels[desc.rc_channel - 1];
 			if (pwm == 0 || pwm == UINT16_MAX)
-				continue;	// exclude unset channels
+				continue;	// unset channel: hold position
 
-			states->name.emplace_back(desc.joint_name);
-			states->position.emplace_back(desc.calculate_position(pwm));
+			position = desc.calculate_position(pwm);
 		}
 
-		joint_states_pub.publish(states);
+		joint_states_pub.publish(states_msg);
 	}
 };
 
@@ -0,0 +1,344 @@
+/**
+ * @brief Mavros overhead benchmark
+ * @file benchmark.h
+ *
+ * @addtogroup sitl_test
+ * @{
+ */
+/*
+ * This file is part of the mavros package and subject to the license terms
+ * in the top-level LICENSE file of the mavros repository.
+ * https://github.com/mavlink/mavros/tree/master/LICENSE.md
+ */
+
+#pragma once
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <unistd.h>
+#include <dirent.h>
+#include <test_mavros/sitl_test/sitl_test.h>
+
+#include <sensor_msgs/Imu.h>
+#include <geometry_msgs/PoseStamped.h>
+#include <mavros_msgs/ParamPull.h>
+#include <mavros_msgs/WaypointPush.h>
+#include <mavros_msgs/WaypointClear.h>
+
+namespace testsetup {
+/**
+ * @brief Mavros performance benchmark
+ *
+ * Quantifies mavros overhead against a running SITL stack and emits
+ * one machine-readable JSON record per stage, so results can be
+ * charted across releases:
+ *
+ * - telemetry latency: wire-to-topic delay of the IMU stream,
+ *   measured as arrival time minus synchronised header stamp;
+ * - setpoint rate ramp: achieved vs requested publish rate over a
+ *   series of steps, which drives the tx queue towards saturation;
+ * - param pull and mission push wall time;
+ * - CPU time and RSS of the mavros node per stage, from /proc.
+ *
+ * Results go to stdout and, with ~results_file set, to that file.
+ */
+class Benchmark {
+public:
+	Benchmark() :
+		nh_bm(test.nh)
+	{ }
+
+	void spin(int argc, char *argv[])
+	{
+		init();
+
+		ros::NodeHandle nh;
+
+		stage_telemetry_latency(nh);
+		stage_setpoint_rate(nh);
+		stage_param_pull(nh);
+		stage_mission_push(nh);
+
+		ROS_INFO("Benchmark finished, %zu stages recorded", stage_count);
+	}
+
+private:
+	TestSetup test;
+	ros::NodeHandle nh_bm;
+
+	std::string results_file;
+	double stage_time;
+	size_t stage_count = 0;
+
+	/* -*- /proc sampling of the mavros node -*- */
+
+	pid_t mavros_pid = -1;
+
+	struct ProcSample {
+		double cpu_sec;	//!< utime + stime
+		long rss_kb;
+	};
+
+	//! find the mavros node by command name; -1 when not local
+	pid_t find_mavros_pid()
+	{
+		DIR *proc = opendir("/proc");
+		if (proc == nullptr)
+			return -1;
+
+		pid_t found = -1;
+		struct dirent *ent;
+		while ((ent = readdir(proc)) != nullptr) {
+			pid_t pid = atoi(ent->d_name);
+			if (pid <= 0)
+				continue;
+
+			std::ifstream comm("/proc/" + std::string(ent->d_name) + "/comm");
+			std::string name;
+			if (comm >> name && name == "mavros_node") {
+				found = pid;
+				break;
+			}
+		}
+
+		closedir(proc);
+		return found;
+	}
+
+	bool proc_sample(ProcSample &out)
+	{
+		if (mavros_pid < 0)
+			return false;
+
+		std::ifstream stat("/proc/" + std::to_string(mavros_pid) + "/stat");
+		std::string tok;
+
+		// fields 14 (utime) and 15 (stime); field 2 (comm) may
+		// contain spaces, so skip to its closing paren first
+		std::string line;
+		if (!std::getline(stat, line))
+			return false;
+		auto paren = line.rfind(')');
+		std::istringstream rest(line.substr(paren + 2));
+
+		unsigned long utime = 0, stime = 0;
+		for (int field = 3; field <= 15 && rest >> tok; field++) {
+			if (field == 14)
+				utime = std::stoul(tok);
+			else if (field == 15)
+				stime = std::stoul(tok);
+		}
+
+		long rss_pages = 0;
+		std::ifstream statm("/proc/" + std::to_string(mavros_pid) + "/statm");
+		statm >> tok >> rss_pages;	// size, resident
+
+		out.cpu_sec = double(utime + stime) / sysconf(_SC_CLK_TCK);
+		out.rss_kb = rss_pages * sysconf(_SC_PAGESIZE) / 1024;
+		return true;
+	}
+
+	/* -*- result emission -*- */
+
+	void emit(const std::string &stage, const std::string &kpi_json,
+			const ProcSample &before, const ProcSample &after, double wall)
+	{
+		std::ostringstream os;
+		os << "{\"stage\": \"" << stage << "\", " << kpi_json;
+
+		if (mavros_pid >= 0 && wall > 0.0) {
+			os << ", \"mavros_cpu_pct\": " << 100.0 * (after.cpu_sec - before.cpu_sec) / wall
+			   << ", \"mavros_rss_kb\": " << after.rss_kb;
+		}
+		os << "}";
+
+		ROS_INFO_STREAM("BENCH " << os.str());
+		std::cout << os.str() << std::endl;
+
+		if (!results_file.empty()) {
+			std::ofstream f(results_file, std::ios::app);
+			f << os.str() << std::endl;
+		}
+		stage_count++;
+	}
+
+	static double percentile(std::vector<double> &v, double p)
+	{
+		if (v.empty())
+			return 0.0;
+		std::sort(v.begin(), v.end());
+		size_t idx = std::min(v.size() - 1, size_t(p * v.size()));
+		return v[idx];
+	}
+
+	/* -*- stages -*- */
+
+	void init()
+	{
+		nh_bm.param<std::string>("results_file", results_file, "");
+		nh_bm.param("stage_time", stage_time, 10.0);
+
+		mavros_pid = find_mavros_pid();
+		if (mavros_pid < 0)
+			ROS_WARN("Benchmark: mavros node not found locally, CPU/RSS KPIs disabled");
+	}
+
+	/**
+	 * Wire-to-topic latency of the IMU stream: the header stamp is
+	 * the synchronised FCU capture time, so arrival minus stamp is
+	 * the full transport + conversion + dispatch pipeline.
+	 */
+	void stage_telemetry_latency(ros::NodeHandle &nh)
+	{
+		std::vector<double> delays_ms;
+
+		auto sub = nh.subscribe<sensor_msgs::Imu>("/mavros/imu/data", 100,
+				[&delays_ms](const sensor_msgs::Imu::ConstPtr &imu) {
+					delays_ms.push_back((ros::Time::now() - imu->header.stamp).toSec() * 1e3);
+				});
+
+		ProcSample before{}, after{};
+		proc_sample(before);
+		ros::Time t0 = ros::Time::now();
+
+		while (ros::ok() && (ros::Time::now() - t0).toSec() < stage_time) {
+			ros::spinOnce();
+			ros::Duration(0.001).sleep();
+		}
+
+		double wall = (ros::Time::now() - t0).toSec();
+		proc_sample(after);
+
+		double mean = 0.0;
+		for (auto d : delays_ms)
+			mean += d;
+		if (!delays_ms.empty())
+			mean /= delays_ms.size();
+
+		double p50 = percentile(delays_ms, 0.50);
+		double p95 = percentile(delays_ms, 0.95);
+		double max = delays_ms.empty() ? 0.0 : delays_ms.back();
+
+		std::ostringstream kpi;
+		kpi << "\"samples\": " << delays_ms.size()
+		    << ", \"mean_ms\": " << mean
+		    << ", \"p50_ms\": " << p50
+		    << ", \"p95_ms\": " << p95
+		    << ", \"max_ms\": " << max;
+		emit("telemetry_latency", kpi.str(), before, after, wall);
+	}
+
+	/**
+	 * Topic-to-wire throughput: publish position setpoints at a
+	 * ramp of rates and record what actually went out. When the
+	 * requested rate exceeds what the link sustains, the tx queue
+	 * saturates and the achieved rate flattens — that knee is the
+	 * max sustainable message rate.
+	 */
+	void stage_setpoint_rate(ros::NodeHandle &nh)
+	{
+		auto sp_pub = nh.advertise<geometry_msgs::PoseStamped>("/mavros/setpoint_position/local", 10);
+
+		const std::vector<double> rates = {50, 100, 250, 500, 1000};
+
+		geometry_msgs::PoseStamped sp;
+		sp.pose.orientation.w = 1.0;
+		sp.pose.position.z = 2.0;
+
+		for (auto target : rates) {
+			ProcSample before{}, after{};
+			proc_sample(before);
+
+			ros::Rate loop(target);
+			ros::Time t0 = ros::Time::now();
+			size_t sent = 0;
+
+			while (ros::ok() && (ros::Time::now() - t0).toSec() < stage_time / rates.size()) {
+				sp.header.stamp = ros::Time::now();
+				sp_pub.publish(sp);
+				sent++;
+				ros::spinOnce();
+				loop.sleep();
+			}
+
+			double wall = (ros::Time::now() - t0).toSec();
+			proc_sample(after);
+
+			std::ostringstream kpi;
+			kpi << "\"target_hz\": " << target
+			    << ", \"achieved_hz\": " << (wall > 0.0 ? sent / wall : 0.0);
+			emit("setpoint_rate", kpi.str(), before, after, wall);
+		}
+	}
+
+	void stage_param_pull(ros::NodeHandle &nh)
+	{
+		auto client = nh.serviceClient<mavros_msgs::ParamPull>("/mavros/param/pull");
+		if (!client.waitForExistence(ros::Duration(10.0))) {
+			ROS_WARN("Benchmark: param pull service not available, stage skipped");
+			return;
+		}
+
+		ProcSample before{}, after{};
+		proc_sample(before);
+		ros::Time t0 = ros::Time::now();
+
+		mavros_msgs::ParamPull pull;
+		pull.request.force_pull = true;
+		bool ok = client.call(pull) && pull.response.success;
+
+		double wall = (ros::Time::now() - t0).toSec();
+		proc_sample(after);
+
+		std::ostringstream kpi;
+		kpi << "\"success\": " << (ok ? "true" : "false")
+		    << ", \"param_count\": " << pull.response.param_received
+		    << ", \"wall_s\": " << wall;
+		emit("param_pull", kpi.str(), before, after, wall);
+	}
+
+	void stage_mission_push(ros::NodeHandle &nh)
+	{
+		auto push_client = nh.serviceClient<mavros_msgs::WaypointPush>("/mavros/mission/push");
+		auto clear_client = nh.serviceClient<mavros_msgs::WaypointClear>("/mavros/mission/clear");
+		if (!push_client.waitForExistence(ros::Duration(10.0))) {
+			ROS_WARN("Benchmark: mission push service not available, stage skipped");
+			return;
+		}
+
+		mavros_msgs::WaypointPush push;
+		for (int i = 0; i < 50; i++) {
+			mavros_msgs::Waypoint wp;
+			wp.frame = mavros_msgs::Waypoint::FRAME_GLOBAL_REL_ALT;
+			wp.command = 16;	// MAV_CMD_NAV_WAYPOINT
+			wp.autocontinue = true;
+			wp.x_lat = 47.397742 + 1e-4 * i;
+			wp.y_long = 8.545594;
+			wp.z_alt = 10.0;
+			push.request.waypoints.push_back(wp);
+		}
+
+		ProcSample before{}, after{};
+		proc_sample(before);
+		ros::Time t0 = ros::Time::now();
+
+		bool ok = push_client.call(push) && push.response.success;
+
+		double wall = (ros::Time::now() - t0).toSec();
+		proc_sample(after);
+
+		std::ostringstream kpi;
+		kpi << "\"success\": " << (ok ? "true" : "false")
+		    << ", \"waypoints\": " << push.request.waypoints.size()
+		    << ", \"wall_s\": " << wall;
+		emit("mission_push", kpi.str(), before, after, wall);
+
+		mavros_msgs::WaypointClear clear;
+		clear_client.call(clear);
+	}
+};
+}	// namespace testsetup
@@ -52,8 +52,10 @@ public:
 		nh_sp(test.nh),
 		local_pos_sp_pub(nh_sp.advertise<geometry_msgs::PoseStamped>("/mavros/setpoint_position/local", 10)),
 		vel_sp_pub(nh_sp.advertise<geometry_msgs::TwistStamped>("/mavros/setpoint_velocity/cmd_vel", 10)),
+		att_sp_pub(nh_sp.advertise<geometry_msgs::PoseStamped>("/mavros/setpoint_attitude/attitude", 10)),
 		local_pos_sub(nh_sp.subscribe("/mavros/local_position/local", 10, &OffboardControl::local_pos_cb, this)),
-		threshold(threshold_definition())
+		threshold(threshold_definition()),
+		stress_mode(false)
 	{ };
 
 	void init() {
@@ -101,6 +103,16 @@ public:
 		std::string mode_;
 		nh_sp.param<std::string>("mode", mode_, "position");
 
+		/**
+		 * @brief Stress mode: no path is flown; setpoint types are
+		 * alternated while the send rate ramps up, to find the
+		 * transport's setpoint ceiling.
+		 */
+		if (mode_ == "stress") {
+			stress_mode = true;
+			return;
+		}
+
 		/**
 		 * @brief Setpoint path shape selector
 		 *
@@ -142,6 +154,12 @@ public:
 
 	void spin(int argc, char *argv[]) {
 		init();
+
+		if (stress_mode) {
+			stress_test();
+			return;
+		}
+
 		ros::Rate loop_rate(rate);
 
 		ROS_INFO("SITL Test: Offboard control test running!");
@@ -205,8 +223,12 @@ private:
 	ros::NodeHandle nh_sp;
 	ros::Publisher local_pos_sp_pub;
 	ros::Publisher vel_sp_pub;
+	ros::Publisher att_sp_pub;
 	ros::Subscriber local_pos_sub;
 
+	bool stress_mode;
+	size_t feedback_count = 0;	//!< local position updates seen
+
 	geometry_msgs::PoseStamped localpos, ps;
 	geometry_msgs::TwistStamped vs;
 
@@ -533,6 +555,65 @@ private:
 		}
 	}
 
+	/**
+	 * @brief High-rate setpoint stress routine
+	 *
+	 * Ramps the setpoint rate from 100 to 1000 Hz while cycling
+	 * position, velocity and attitude setpoints. Per step it
+	 * reports requested vs achieved send rate and the telemetry
+	 * feedback rate: the step where achieved flattens below target
+	 * is the transport's setpoint ceiling, a collapsing feedback
+	 * rate means the link no longer keeps up end-to-end. Run it
+	 * once over serial and once over UDP to compare transports.
+	 */
+	void stress_test() {
+		double step_time;
+		nh_sp.param("stress_step_time", step_time, 2.0);
+
+		ROS_INFO("SITL Test: Offboard setpoint stress running!");
+
+		geometry_msgs::PoseStamped att_sp;
+		att_sp.pose.orientation.w = 1.0;
+		tf::pointEigenToMsg(Eigen::Vector3d(0.0f, 0.0f, 2.0f), ps.pose.position);
+		tf::vectorEigenToMsg(Eigen::Vector3d::Zero(), vs.twist.linear);
+
+		for (int target = 100; target <= 1000 && ros::ok(); target += 100) {
+			ros::Rate loop_rate(target);
+			ros::Time t0 = ros::Time::now();
+			size_t sent = 0;
+			feedback_count = 0;
+
+			while (ros::ok() && (ros::Time::now() - t0).toSec() < step_time) {
+				// alternate setpoint types so all ingest paths
+				// are exercised at rate
+				switch (sent % 3) {
+				case 0:
+					ps.header.stamp = ros::Time::now();
+					local_pos_sp_pub.publish(ps);
+					break;
+				case 1:
+					vs.header.stamp = ros::Time::now();
+					vel_sp_pub.publish(vs);
+					break;
+				case 2:
+					att_sp.header.stamp = ros::Time::now();
+					att_sp_pub.publish(att_sp);
+					break;
+				}
+				sent++;
+
+				loop_rate.sleep();
+				ros::spinOnce();
+			}
+
+			double wall = (ros::Time::now() - t0).toSec();
+			ROS_INFO("STRESS target: %4d Hz achieved: %7.1f Hz feedback: %5.1f Hz",
+					target, sent / wall, feedback_count / wall);
+		}
+
+		ROS_INFO("Test complete!");
+	}
+
 	/**
 	 * @brief Gaussian noise generator for accepted position threshold
 	 */
@@ -553,6 +634,7 @@ private:
 
 	void local_pos_cb(const geometry_msgs::PoseStampedConstPtr& msg){
 		localpos = *msg;
+		feedback_count++;
 	}
 };
 };	// namespace testsetup
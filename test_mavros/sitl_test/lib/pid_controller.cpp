@@ -65,3 +65,60 @@ double PIDController::compute_yawrate_effort(double goal, double current, ros::T
 
 	return yaw_rate;
 }
+
+/* -*- vectorized multi-axis PID -*- */
+
+VectorPID::VectorPID() :
+	p_gain(Eigen::Vector4d::Zero()),
+	i_gain(Eigen::Vector4d::Zero()),
+	d_gain(Eigen::Vector4d::Zero()),
+	i_min(Eigen::Vector4d::Zero()),
+	i_max(Eigen::Vector4d::Zero()),
+	d_filter_tau(0.0),
+	integral(Eigen::Vector4d::Zero()),
+	last_error(Eigen::Vector4d::Zero()),
+	d_filtered(Eigen::Vector4d::Zero()),
+	has_last_error(false)
+{};
+
+void VectorPID::setup(const Eigen::Vector4d &p_gain_, const Eigen::Vector4d &i_gain_, const Eigen::Vector4d &d_gain_,
+		const Eigen::Vector4d &i_min_, const Eigen::Vector4d &i_max_, double d_filter_tau_){
+	p_gain = p_gain_;
+	i_gain = i_gain_;
+	d_gain = d_gain_;
+	i_min = i_min_;
+	i_max = i_max_;
+	d_filter_tau = d_filter_tau_;
+
+	reset();
+}
+
+void VectorPID::reset(){
+	integral.setZero();
+	last_error.setZero();
+	d_filtered.setZero();
+	has_last_error = false;
+}
+
+Eigen::Vector4d VectorPID::compute(const Eigen::Vector4d &error, double dt){
+	if (dt <= 0.0)
+		return Eigen::Vector4d::Zero();
+
+	// anti-windup: clamp the integrator per axis
+	integral += error * dt;
+	integral = integral.cwiseMax(i_min).cwiseMin(i_max);
+
+	Eigen::Vector4d d_raw = Eigen::Vector4d::Zero();
+	if (has_last_error)
+		d_raw = (error - last_error) / dt;
+	last_error = error;
+	has_last_error = true;
+
+	// first-order low-pass keeps measurement noise out of the D term
+	const double alpha = (d_filter_tau > 0.0) ? dt / (d_filter_tau + dt) : 1.0;
+	d_filtered += alpha * (d_raw - d_filtered);
+
+	return p_gain.cwiseProduct(error)
+	       + i_gain.cwiseProduct(integral)
+	       + d_gain.cwiseProduct(d_filtered);
+}
@@ -28,6 +28,12 @@ void SitlTest::spin(int argc, char *argv[])
 		testsetup::OffboardControl offboard_control;
 		offboard_control.spin(argc, argv);
 	}
+	else if (strcmp(argv[1],"benchmark") == 0)
+	{
+		ros::init(argc, argv, "benchmark");
+		testsetup::Benchmark benchmark;
+		benchmark.spin(argc, argv);
+	}
 
 	/** @todo add more testing structures */
 }